@@ -3,13 +3,16 @@
 #include "av/sdl2/error.h"
 #include "av/sdl2/sdl2.h"
 #include "av/sdl2/window.h"
+#include "os/c.h"
+#include "tiles/atlas.h"
 #include "tiles/client-conf.h"
+#include "tiles/display-list.h"
+#include "tiles/image-decode.h"
 #include "tiles/log.h"
-#include "tiles/resources.h"
 #include "util/assert.h"
 #include "util/compiler.h"
-#include "util/hashvector.h"
 #include "util/int.h"
+#include "util/math2.h"
 #include "util/measure.h"
 #include "util/string-view.h"
 #include "util/string.h"
@@ -51,13 +54,16 @@ typedef U8 GLboolean;
 typedef char GLchar;
 typedef unsigned GLenum;
 typedef int GLint;
+typedef SSize GLintptr;
 typedef float GLfloat;
 typedef float GLclampf;
 typedef double GLdouble;
 typedef int GLsizei;
 typedef SSize GLsizeiptr;
+typedef struct __GLsync* GLsync;
 typedef U8 GLubyte;
 typedef unsigned GLuint;
+typedef U64 GLuint64;
 
 typedef GLint Attribute;
 typedef GLuint Buffer;
@@ -65,7 +71,6 @@ typedef GLuint Program;
 typedef GLuint Shader;
 typedef GLuint Texture;
 typedef GLint Uniform;
-typedef GLuint VertexBuffer;
 
 // TODO: Figure out noexcept?
 typedef GLenum(APIENTRY* GlGetErrorProc)();
@@ -155,22 +160,51 @@ static APICALL GlGetErrorProc glGetError;
         return x;                           \
     }
 
+#define GLFN_RETURN_3(rt, fn, t1, t2, t3)        \
+    typedef rt(APIENTRY* fn##Proc)(t1, t2, t3);  \
+    static APICALL fn##Proc fn;                  \
+    static rt fn##_(t1 a, t2 b, t3 c) noexcept { \
+        rt x = fn(a, b, c);                      \
+        checkError(#fn);                         \
+        return x;                                \
+    }
+
+#define GLFN_RETURN_4(rt, fn, t1, t2, t3, t4)          \
+    typedef rt(APIENTRY* fn##Proc)(t1, t2, t3, t4);    \
+    static APICALL fn##Proc fn;                        \
+    static rt fn##_(t1 a, t2 b, t3 c, t4 d) noexcept { \
+        rt x = fn(a, b, c, d);                         \
+        checkError(#fn);                               \
+        return x;                                      \
+    }
+
 GLFN_VOID_1(void, glActiveTexture, GLenum)
 GLFN_VOID_2(void, glAlphaFunc, GLenum, GLclampf)
 GLFN_VOID_2(void, glAttachShader, Program, Shader)
+GLFN_VOID_3(void, glBindAttribLocation, Program, GLuint, const GLchar*)
 GLFN_VOID_2(void, glBindBuffer, GLenum, Buffer)
 GLFN_VOID_2(void, glBindTexture, GLenum, Texture)
 GLFN_VOID_2(void, glBlendFunc, GLenum, GLenum)
 GLFN_VOID_4(void, glBufferData, GLenum, GLsizeiptr, const void*, GLenum)
+GLFN_VOID_4(void, glBufferStorage, GLenum, GLsizeiptr, const void*,
+            GLbitfield)
+GLFN_VOID_4(void, glBufferSubData, GLenum, GLintptr, GLsizeiptr, const void*)
 GLFN_VOID_1(void, glClear, GLbitfield)
 GLFN_VOID_4(void, glClearColor, GLfloat, GLfloat, GLfloat, GLfloat)
+GLFN_RETURN_3(GLenum, glClientWaitSync, GLsync, GLbitfield, GLuint64)
 GLFN_VOID_1(void, glCompileShader, Shader)
 GLFN_RETURN_0(Program, glCreateProgram)
 GLFN_RETURN_1(Shader, glCreateShader, GLenum)
+GLFN_VOID_2(void, glDeleteBuffers, GLsizei, const Buffer*)
+GLFN_VOID_1(void, glDeleteSync, GLsync)
+GLFN_VOID_2(void, glDeleteTextures, GLsizei, const Texture*)
 GLFN_VOID_1(void, glDisable, GLenum)
+GLFN_VOID_1(void, glDisableVertexAttribArray, Attribute)
 GLFN_VOID_3(void, glDrawArrays, GLenum, GLint, GLsizei)
+GLFN_VOID_4(void, glDrawArraysInstanced, GLenum, GLint, GLsizei, GLsizei)
 GLFN_VOID_1(void, glEnable, GLenum)
 GLFN_VOID_1(void, glEnableVertexAttribArray, Attribute)
+GLFN_RETURN_2(GLsync, glFenceSync, GLenum, GLbitfield)
 GLFN_VOID_2(void, glGenBuffers, GLsizei, Buffer*)
 GLFN_VOID_2(void, glGenTextures, GLsizei, Texture*)
 GLFN_RETURN_2(Attribute, glGetAttribLocation, Program, const GLchar*)
@@ -181,6 +215,8 @@ GLFN_VOID_3(void, glGetShaderiv, Shader, GLenum, GLint*)
 GLFN_RETURN_1(const GLubyte*, glGetString, GLenum)
 GLFN_RETURN_2(Uniform, glGetUniformLocation, Program, const GLchar*)
 GLFN_VOID_1(void, glLinkProgram, Program)
+GLFN_RETURN_4(void*, glMapBufferRange, GLenum, GLintptr, GLsizeiptr,
+              GLbitfield)
 GLFN_VOID_4(void, glShaderSource, Shader, GLsizei, const GLchar* const*,
             const GLint*)
 GLFN_VOID_9(void, glTexImage2D, GLenum, GLint, GLint, GLsizei, GLsizei, GLint,
@@ -192,14 +228,19 @@ GLFN_VOID_2(void, glUniform1i, Uniform, GLint)
 GLFN_VOID_4(void, glUniformMatrix4fv, Uniform, GLsizei, GLboolean,
             const GLfloat*)
 GLFN_VOID_1(void, glUseProgram, Program)
+GLFN_VOID_2(void, glVertexAttribDivisor, Attribute, GLuint)
 GLFN_VOID_6(void, glVertexAttribPointer, Buffer, GLint, GLenum, GLboolean,
             GLsizei, const void*)
 GLFN_VOID_4(void, glViewport, GLint, GLint, GLsizei, GLsizei)
 
 #define GL_FALSE                         0x0000
 #define GL_NO_ERROR                      0x0000
+#define GL_SYNC_FLUSH_COMMANDS_BIT       0x0001
+#define GL_MAP_WRITE_BIT                 0x0002
 #define GL_TRIANGLES                     0x0004
 #define GL_TRIANGLE_STRIP                0x0005
+#define GL_MAP_PERSISTENT_BIT            0x0040
+#define GL_MAP_COHERENT_BIT              0x0080
 #define GL_DEPTH_BUFFER_BIT              0x0100
 #define GL_NOTEQUAL                      0x0205
 #define GL_SRC_ALPHA                     0x0302
@@ -214,6 +255,7 @@ GLFN_VOID_4(void, glViewport, GLint, GLint, GLsizei, GLsizei)
 #define GL_BLEND                         0x0BE2
 #define GL_TEXTURE_2D                    0x0DE1
 #define GL_UNSIGNED_BYTE                 0x1401
+#define GL_UNSIGNED_SHORT                0x1403
 #define GL_UNSIGNED_INT                  0x1405
 #define GL_FLOAT                         0x1406
 #define GL_PROJECTION                    0x1701
@@ -229,16 +271,21 @@ GLFN_VOID_4(void, glViewport, GLint, GLint, GLsizei, GLsizei)
 #define GL_TEXTURE_WRAP_S                0x2802
 #define GL_TEXTURE_WRAP_T                0x2803
 #define GL_COLOR_BUFFER_BIT              0x4000
-#define GL_BGRA                          0x80E1
 #define GL_CLAMP_TO_EDGE                 0x812F
 #define GL_TEXTURE0                      0x84C0
 #define GL_ARRAY_BUFFER                  0x8892
+#define GL_STREAM_DRAW                   0x88E0
 #define GL_STATIC_DRAW                   0x88E4
 #define GL_FRAGMENT_SHADER               0x8B30
 #define GL_VERTEX_SHADER                 0x8B31
 #define GL_COMPILE_STATUS                0x8B81
 #define GL_LINK_STATUS                   0x8B82
 #define GL_SHADING_LANGUAGE_VERSION      0x8B8C
+#define GL_SYNC_GPU_COMMANDS_COMPLETE    0x9117
+#define GL_ALREADY_SIGNALED              0x911A
+#define GL_TIMEOUT_EXPIRED               0x911B
+#define GL_CONDITION_SATISFIED           0x911C
+#define GL_WAIT_FAILED                   0x911D
 
 static const StringView
 getErrorName(GLenum error) noexcept {
@@ -306,6 +353,46 @@ getString(GLenum name) noexcept {
     return reinterpret_cast<const char*>(str);
 }
 
+// The context's version as 10 * major + minor, e.g., 33 for OpenGL 3.3.
+static int
+getVersion() noexcept {
+    const char* version = getString(GL_VERSION);
+
+    // OpenGL ES prefixes the version with "OpenGL ES ".
+    while (*version && (*version < '0' || *version > '9'))
+        version++;
+
+    int major = 0;
+    int minor = 0;
+    while (*version >= '0' && *version <= '9')
+        major = major * 10 + (*version++ - '0');
+    if (*version == '.')
+        version++;
+    while (*version >= '0' && *version <= '9')
+        minor = minor * 10 + (*version++ - '0');
+
+    return major * 10 + minor;
+}
+
+static bool
+hasExtension(const char* name) noexcept {
+    StringView extensions = getString(GL_EXTENSIONS);
+    StringView needle = name;
+
+    // Match whole space-separated names only, so that an extension is not
+    // found inside a longer one.
+    StringPosition i = 0;
+    while ((i = extensions.find(needle, i)) != SV_NOT_FOUND) {
+        StringPosition end = i + needle.size;
+        bool startsName = i == 0 || extensions.data[i - 1] == ' ';
+        bool endsName = end == extensions.size || extensions.data[end] == ' ';
+        if (startsName && endsName)
+            return true;
+        i = end;
+    }
+    return false;
+}
+
 static void
 linkProgram(Program program) noexcept {
     glLinkProgram_(program);
@@ -336,13 +423,20 @@ makeShader(GLenum type, const char* source) noexcept {
     return shader;
 }
 
+// If firstAttribute is not null, it is bound to location 0. Compatibility
+// contexts only draw when attribute 0 is an enabled array, so it should name
+// one that advances per vertex.
 static GLuint
-makeProgram(const char* vertexSource, const char* fragmentSource) noexcept {
+makeProgram(const char* vertexSource, const char* fragmentSource,
+            const char* firstAttribute) noexcept {
     Program program = glCreateProgram_();
 
     glAttachShader_(program, makeShader(GL_VERTEX_SHADER, vertexSource));
     glAttachShader_(program, makeShader(GL_FRAGMENT_SHADER, fragmentSource));
 
+    if (firstAttribute)
+        glBindAttribLocation_(program, 0, firstAttribute);
+
     linkProgram(program);
 
     return program;
@@ -352,13 +446,14 @@ makeProgram(const char* vertexSource, const char* fragmentSource) noexcept {
 // Carob-specific code
 //
 
+// Images are copied onto atlas pages of this size.
 #define ATLAS_WIDTH  2048
-#define ATLAS_HEIGHT 512
+#define ATLAS_HEIGHT 2048
+#define ATLAS_SIZE   "vec2(2048.0, 2048.0)"
 
-static HashVector<TiledImage> images;
-static Size atlasUsed = 0;
-
-Texture tAtlas;
+// Never freed, since Areas and Entities still release their images as they
+// are destroyed at exit.
+static Atlas* atlas = 0;
 
 #define Z_NEAR_MAX "1024.0"
 #define Z_FAR_MAX  "-1024.0"
@@ -403,6 +498,8 @@ struct ImageProgram {
     Attribute aPosition;
     Attribute aTexCoord;
 
+    // The page every vertex in attributes samples.
+    Texture texture;
     Vector<ImageVertex> attributes;
 };
 
@@ -450,9 +547,90 @@ struct RectProgram {
     Vector<RectVertex> attributes;
 };
 
-static VertexBuffer vertexBuffer = 1;
+// With instanced arrays, each image is sent as a single Sprite and the vertex
+// shader stretches a unit square over it, rather than six ImageVertex making
+// up two triangles.
+static const char* spriteVertexSource =
+    "#version 110\n"
+    "\n"
+    "uniform mat4 uProjection;\n"
+    "attribute vec2 aCorner;\n"
+    "attribute float aDepth;\n"
+    "attribute vec4 aPlace;\n"
+    "attribute vec4 aSource;\n"
+    "varying vec2 vTexCoord;\n"
+    "\n"
+    "void main() {\n"
+    "    float near = " Z_NEAR_MAX
+    ";\n"
+    "    float far = " Z_FAR_MAX
+    ";\n"
+    "    float z = (aDepth - near) / (far - near);\n"
+    "    vTexCoord = (aSource.xy + aSource.zw * aCorner) / " ATLAS_SIZE
+    ";\n"
+    "    vec2 position = mix(aPlace.xy, aPlace.zw, aCorner);\n"
+    "    gl_Position = uProjection * vec4(position, z, 1.0);\n"
+    "}\n";
+
+// 28 bytes per image. Both corners are computed as for triangles and kept
+// unrounded, so that sprites that meet in the map meet on screen at any
+// scale, without gaps or overlaps.
+struct Sprite {
+    float left;  // In window pixels.
+    float top;
+    float right;
+    float bottom;
+    float z;
+    U16 u;  // Top-left corner in the atlas.
+    U16 v;
+    U16 width;
+    U16 height;
+};
+
+struct SpriteProgram {
+    Program program;
+    Uniform uAtlas;
+    Uniform uProjection;
+    Attribute aCorner;
+    Attribute aDepth;
+    Attribute aPlace;
+    Attribute aSource;
+
+    Buffer corners;
+
+    // The page every sprite in attributes samples.
+    Texture texture;
+    Vector<Sprite> attributes;
+};
+
+// Vertices are streamed through one buffer that is written front to back,
+// without overwriting anything the GPU may still be reading.
+//
+// With buffer storage, the buffer stays mapped and is split into a segment
+// per frame in flight. A fence follows each frame's draws, and a segment is
+// written again only once its fence has signaled. Otherwise, the buffer is
+// written with glBufferSubData and orphaned each time it fills, so the driver
+// can hand out new storage instead of waiting.
+#define STREAM_FRAMES 3
+#define STREAM_SIZE   (256 * 1024)
+
+struct Stream {
+    Buffer buffer;
+    Size size;  // Bytes per segment when persistent, else in total.
+    Size head;  // Where the next write goes.
+    Size end;   // Where the current segment ends.
+
+    bool persistent;
+    U8* mapped;
+    Size segment;
+    GLsync fences[STREAM_FRAMES];
+};
+
 static ImageProgram ip;
 static RectProgram rp;
+static SpriteProgram sp;
+static bool instanced = false;
+static Stream stream;
 
 static bool printed = false;
 
@@ -470,7 +648,127 @@ printVersion() noexcept {
     //logInfo("GL", String() << "Extensions: " << getString(GL_EXTENSIONS));
 }
 
-#define loadFunction(fn) getProcAddress((void**)&fn, #fn)
+static void
+streamCreate(Size size) noexcept {
+    glGenBuffers_(1, &stream.buffer);
+    glBindBuffer_(GL_ARRAY_BUFFER, stream.buffer);
+
+    if (stream.persistent) {
+        GLbitfield flags =
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        Size total = size * STREAM_FRAMES;
+
+        glBufferStorage_(GL_ARRAY_BUFFER, total, 0, flags);
+        stream.mapped = static_cast<U8*>(
+            glMapBufferRange_(GL_ARRAY_BUFFER, 0, total, flags));
+        if (stream.mapped == 0)
+            customError("glMapBufferRange", "Returned NULL");
+    }
+    else {
+        glBufferData_(GL_ARRAY_BUFFER, size, 0, GL_STREAM_DRAW);
+    }
+
+    stream.size = size;
+    stream.head = 0;
+    stream.end = size;
+    stream.segment = 0;
+}
+
+static void
+streamWait(Size segment) noexcept {
+    GLsync& fence = stream.fences[segment];
+    if (fence == 0)
+        return;
+
+    while (true) {
+        GLenum result = glClientWaitSync_(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                          1000000000);  // 1 second
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+            break;
+        if (result == GL_WAIT_FAILED)
+            customError("glClientWaitSync", "GL_WAIT_FAILED");
+        // Otherwise GL_TIMEOUT_EXPIRED. Keep waiting.
+    }
+
+    glDeleteSync_(fence);
+    fence = 0;
+}
+
+// Make room for a write that does not fit before the end of the segment or
+// buffer.
+static void
+streamOverflow(Size bytes) noexcept {
+    Size size = stream.size;
+    while (size < bytes)
+        size *= 2;
+
+    if (stream.persistent) {
+        // One frame filled a whole segment. Move to a buffer with larger
+        // segments once the GPU is done with this one.
+        for (Size i = 0; i < STREAM_FRAMES; i++)
+            streamWait(i);
+        glDeleteBuffers_(1, &stream.buffer);
+        streamCreate(size * 2);
+    }
+    else {
+        glBindBuffer_(GL_ARRAY_BUFFER, stream.buffer);
+        glBufferData_(GL_ARRAY_BUFFER, size, 0, GL_STREAM_DRAW);
+        stream.size = size;
+        stream.head = 0;
+        stream.end = size;
+    }
+}
+
+// Copy vertex data into the stream, leaving its buffer bound to
+// GL_ARRAY_BUFFER, and return the offset it was written at.
+static Size
+streamWrite(const void* data, Size bytes) noexcept {
+    // Align every write for any attribute type.
+    Size offset = (stream.head + 15) & ~static_cast<Size>(15);
+    if (offset + bytes > stream.end) {
+        streamOverflow(bytes);
+        offset = stream.head;
+    }
+    stream.head = offset + bytes;
+
+    glBindBuffer_(GL_ARRAY_BUFFER, stream.buffer);
+    if (stream.persistent)
+        memcpy(stream.mapped + offset, data, bytes);
+    else
+        glBufferSubData_(GL_ARRAY_BUFFER, offset, bytes, data);
+
+    return offset;
+}
+
+static void
+streamStartFrame() noexcept {
+    if (!stream.persistent)
+        return;
+
+    stream.segment = (stream.segment + 1) % STREAM_FRAMES;
+    streamWait(stream.segment);
+
+    stream.head = stream.segment * stream.size;
+    stream.end = stream.head + stream.size;
+}
+
+static void
+streamEndFrame() noexcept {
+    if (!stream.persistent)
+        return;
+
+    stream.fences[stream.segment] =
+        glFenceSync_(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// An attribute pointer to a byte offset in the bound GL_ARRAY_BUFFER.
+static const void*
+bufferOffset(Size offset) noexcept {
+    return reinterpret_cast<const void*>(offset);
+}
+
+#define loadFunction(fn)           getProcAddress((void**)&fn, #fn)
+#define loadFunctionAs(fn, symbol) getProcAddress((void**)&fn, symbol)
 
 void
 imageInit() noexcept {
@@ -482,16 +780,21 @@ imageInit() noexcept {
     loadFunction(glActiveTexture);
     loadFunction(glAlphaFunc);
     loadFunction(glAttachShader);
+    loadFunction(glBindAttribLocation);
     loadFunction(glBindBuffer);
     loadFunction(glBindTexture);
     loadFunction(glBlendFunc);
     loadFunction(glBufferData);
+    loadFunction(glBufferSubData);
     loadFunction(glClear);
     loadFunction(glClearColor);
     loadFunction(glCompileShader);
     loadFunction(glCreateProgram);
     loadFunction(glCreateShader);
+    loadFunction(glDeleteBuffers);
+    loadFunction(glDeleteTextures);
     loadFunction(glDisable);
+    loadFunction(glDisableVertexAttribArray);
     loadFunction(glDrawArrays);
     loadFunction(glEnable);
     loadFunction(glEnableVertexAttribArray);
@@ -527,17 +830,9 @@ imageInit() noexcept {
     glEnable_(GL_ALPHA_TEST);
     glAlphaFunc_(GL_NOTEQUAL, 0.0f);
 
-    glGenTextures_(1, &tAtlas);
     glActiveTexture_(GL_TEXTURE0);
-    glBindTexture_(GL_TEXTURE_2D, tAtlas);
-    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexImage2D_(GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_WIDTH, ATLAS_HEIGHT, 0,
-                  GL_RGBA, GL_UNSIGNED_BYTE, 0);
 
-    ip.program = makeProgram(imageVertexSource, imageFragmentSource);
+    ip.program = makeProgram(imageVertexSource, imageFragmentSource, 0);
     ip.uAtlas = glGetUniformLocation_(ip.program, "uAtlas");
     ip.uProjection = glGetUniformLocation_(ip.program, "uProjection");
     ip.aPosition = glGetAttribLocation_(ip.program, "aPosition");
@@ -545,106 +840,246 @@ imageInit() noexcept {
     glUseProgram_(ip.program);
     glUniform1i_(ip.uAtlas, 0);
 
-    rp.program = makeProgram(rectVertexSource, rectFragmentSource);
+    rp.program = makeProgram(rectVertexSource, rectFragmentSource, 0);
     rp.aColor = glGetAttribLocation_(rp.program, "aColor");
     rp.aPosition = glGetAttribLocation_(rp.program, "aPosition");
     rp.uProjection = glGetUniformLocation_(rp.program, "uProjection");
+
+    int version = getVersion();
+
+    // Buffer storage is core in OpenGL 4.4. The extension also needs
+    // glMapBufferRange and fences, which are core in 3.2.
+    stream.persistent =
+        version >= 44 ||
+        (version >= 32 && hasExtension("GL_ARB_buffer_storage"));
+    if (stream.persistent) {
+        loadFunction(glBufferStorage);
+        loadFunction(glClientWaitSync);
+        loadFunction(glDeleteSync);
+        loadFunction(glFenceSync);
+        loadFunction(glMapBufferRange);
+        logInfo("GL", "Streaming vertices through a persistent mapping");
+    }
+    else {
+        logInfo("GL", "Streaming vertices through an orphaned buffer");
+    }
+    streamCreate(STREAM_SIZE);
+
+    if (version >= 33) {
+        loadFunction(glDrawArraysInstanced);
+        loadFunction(glVertexAttribDivisor);
+        instanced = true;
+    }
+    else if (hasExtension("GL_ARB_instanced_arrays")) {
+        loadFunctionAs(glDrawArraysInstanced, "glDrawArraysInstancedARB");
+        loadFunctionAs(glVertexAttribDivisor, "glVertexAttribDivisorARB");
+        instanced = true;
+    }
+
+    if (instanced) {
+        sp.program =
+            makeProgram(spriteVertexSource, imageFragmentSource, "aCorner");
+        sp.uAtlas = glGetUniformLocation_(sp.program, "uAtlas");
+        sp.uProjection = glGetUniformLocation_(sp.program, "uProjection");
+        sp.aCorner = glGetAttribLocation_(sp.program, "aCorner");
+        sp.aDepth = glGetAttribLocation_(sp.program, "aDepth");
+        sp.aPlace = glGetAttribLocation_(sp.program, "aPlace");
+        sp.aSource = glGetAttribLocation_(sp.program, "aSource");
+        glUseProgram_(sp.program);
+        glUniform1i_(sp.uAtlas, 0);
+
+        // A unit square, drawn as a triangle strip. It is split along the
+        // same diagonal as the triangles imageDraw() makes, so that both
+        // sample the same texels.
+        static const GLfloat corners[] = {0, 1, 1, 1, 0, 0, 1, 0};
+        glGenBuffers_(1, &sp.corners);
+        glBindBuffer_(GL_ARRAY_BUFFER, sp.corners);
+        glBufferData_(GL_ARRAY_BUFFER, sizeof(corners), corners,
+                      GL_STATIC_DRAW);
+
+        logInfo("GL", "Drawing images as instanced sprites");
+    }
+    else {
+        logInfo("GL", "Drawing images as triangles");
+    }
+
+    atlas = new Atlas(ATLAS_WIDTH, ATLAS_HEIGHT);
 }
 
-static TiledImage*
-load(StringView path) noexcept {
-    TiledImage& tiles = images.allocate(hash_(path));
-    tiles = {};
+// Images point to their page by its texture name, which is never 0.
+static Texture
+textureName(void* texture) noexcept {
+    return static_cast<Texture>(reinterpret_cast<Size>(texture));
+}
 
-    String r;
-    if (!resourceLoad(path, r)) {
-        // Error logged.
+static Texture
+makePage() noexcept {
+    Texture page;
+    glGenTextures_(1, &page);
+    glBindTexture_(GL_TEXTURE_2D, page);
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D_(GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_WIDTH, ATLAS_HEIGHT, 0,
+                  GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    return page;
+}
+
+static void
+freePage(void* page) noexcept {
+    Texture texture = textureName(page);
+    glDeleteTextures_(1, &texture);
+}
+
+// Zeros for clearing room on a page, kept between loads.
+static Vector<U32> zeros;
+
+// Set aside room on a page for an image, and clear it so that the image draws
+// as nothing until its pixels are copied in. Returns null if the image is
+// larger than a page.
+static TiledImage*
+reserve(Handle handle, StringView path, U32 width, U32 height) noexcept {
+    U32 page = atlas->place(handle, width, height);
+    if (page == NO_ATLAS_PAGE) {
+        logErr("GL", String() << "Image larger than an atlas page: " << path);
         return 0;
     }
 
-    SDL_RWops* ops =
-        SDL_RWFromMem(static_cast<void*>(const_cast<char*>(r.data)),
-                      static_cast<int>(r.size));
-
-    int x = atlasUsed;
-    int y = 0;
-    int width;
-    int height;
-
-    {
-        TimeMeasure m(String() << "Constructed " << path << " as image");
-
-        //SDL_Surface* surface = IMG_Load_RW(ops, 1);
-        SDL_Surface* surface = SDL_LoadBMP_RW(ops, 1);
-        if (!surface) {
-            logFatal("SDL2", String() << "Invalid image: " << path);
-            return 0;
-        }
-
-        width = surface->w;
-        height = surface->h;
-
-        // Rectangle packing algorithm:
-        //
-        // Copy surface into the atlas to the right of the previous image,
-        // or at the left edge, if there was no previous image.
-        glTexSubImage2D_(GL_TEXTURE_2D,     // target
-                         0,                 // level
-                         x,                 // xoffset
-                         y,                 // yoffset
-                         width,             // width
-                         height,            // height
-                         GL_BGRA,           // format
-                         GL_UNSIGNED_BYTE,  // type
-                         surface->pixels    // data
-        );
-        /*
-        glTexImage2D_(
-            GL_TEXTURE_2D,
-            0,
-            GL_RGBA,
-            width,
-            height,
-            0,
-            GL_RGBA,
-            GL_UNSIGNED_BYTE,
-            surface->pixels
-        );
-        */
+    void* texture = atlas->texture(page);
+    if (texture) {
+        glBindTexture_(GL_TEXTURE_2D, textureName(texture));
+    }
+    else {
+        texture = reinterpret_cast<void*>(static_cast<Size>(makePage()));
+        atlas->setTexture(page, texture);
+    }
+
+    TiledImage* tiles = atlas->at(handle);
+    tiles->image.texture = texture;
 
-        SDL_FreeSurface(surface);
+    Size area = static_cast<Size>(width) * height;
+    if (zeros.size < area) {
+        zeros.resize(area);
+        memset(zeros.data, 0, area * sizeof(U32));
     }
 
-    tiles.image = {
-        reinterpret_cast<void*>(tAtlas),
-        static_cast<U32>(x),
-        static_cast<U32>(y),
-        static_cast<U32>(width),
-        static_cast<U32>(height),
-    };
+    glTexSubImage2D_(GL_TEXTURE_2D, 0, static_cast<GLint>(tiles->image.x),
+                     static_cast<GLint>(tiles->image.y), width, height,
+                     GL_RGBA, GL_UNSIGNED_BYTE, zeros.data);
+
+    return tiles;
+}
+
+static void
+upload(DecodedImage& decoded) noexcept {
+    // Pruned while it was decoding, or too large to place.
+    TiledImage* tiles = atlas->at(decoded.handle);
+    if (!tiles || !TILES_VALID(*tiles))
+        return;
+
+    Image image = tiles->image;
+    // A tileset with unused room at its right or bottom edge is placed
+    // without it, so only the top-left of the decoded image is copied in.
+    if (decoded.width < image.width || decoded.height < image.height) {
+        logErr("GL", String() << decoded.path << ": expected at least a "
+                              << image.width << "x" << image.height
+                              << " image");
+        return;
+    }
 
-    atlasUsed += static_cast<U32>(width);
+    glBindTexture_(GL_TEXTURE_2D, textureName(image.texture));
+
+    // Without unused room at the right edge, the rows are copied at once.
+    // With it, they are copied one at a time to leave it out.
+    U32 height = decoded.width == image.width ? image.height : 1;
+    for (U32 y = 0; y < image.height; y += height) {
+        glTexSubImage2D_(
+            GL_TEXTURE_2D,                    // target
+            0,                                // level
+            static_cast<GLint>(image.x),      // xoffset
+            static_cast<GLint>(image.y + y),  // yoffset
+            image.width,                      // width
+            height,                           // height
+            GL_RGBA,                          // format
+            GL_UNSIGNED_BYTE,                 // type
+            decoded.pixels.data +
+                static_cast<Size>(y) * decoded.width  // data
+        );
+    }
+}
 
-    return &tiles;
+static TiledImage*
+load(StringView path) noexcept {
+    Handle handle = atlas->insert(path);
+
+    // On failure, the image stays invalid rather than being loaded again.
+    DecodedImage decoded;
+    decoded.handle = handle;
+    if (!imageDecode(path, decoded))
+        return atlas->at(handle);
+    if (!reserve(handle, path, decoded.width, decoded.height))
+        return atlas->at(handle);
+
+    upload(decoded);
+
+    return atlas->at(handle);
 }
 
 Image
 imageLoad(StringView path) noexcept {
-    TiledImage* tiles = images.find(hash_(path));
+    TiledImage* tiles = atlas->find(path);
 
     if (!tiles)
         tiles = load(path);
 
-    assert_(tiles);
-
     return tiles->image;
 }
 
 void
-imageRelease(Image image) noexcept { }
+imageRelease(Image image) noexcept {
+    atlas->release(image);
+}
+
+static void
+drawSprite(Image image, float x, float y, float z) noexcept {
+    fvec2 trans = sdl2Translation;
+    fvec2 scale = sdl2Scaling;
+
+    Texture texture = textureName(image.texture);
+
+    // Sprites drawn together share one page.
+    if (sp.attributes.size > 0 && texture != sp.texture)
+        imageFlushImages();
+    sp.texture = texture;
+
+    Sprite sprite = {
+        scale.x * (trans.x + x),
+        scale.y * (trans.y + y),
+        scale.x * (trans.x + x + image.width),
+        scale.y * (trans.y + y + image.height),
+        z,
+        static_cast<U16>(image.x),
+        static_cast<U16>(image.y),
+        static_cast<U16>(image.width),
+        static_cast<U16>(image.height),
+    };
+    sp.attributes.push(sprite);
+}
 
 void
 imageDraw(Image image, float x, float y, float z) noexcept {
+    if (instanced) {
+        drawSprite(image, x, y, z);
+        return;
+    }
+
+    // Vertices drawn together share one page.
+    Texture texture = textureName(image.texture);
+    if (ip.attributes.size > 0 && texture != ip.texture)
+        imageFlushImages();
+    ip.texture = texture;
+
     fvec2 trans = sdl2Translation;
     fvec2 scale = sdl2Scaling;
 
@@ -698,16 +1133,44 @@ imageDraw(Image image, float x, float y, float z) noexcept {
     };
 }
 
+void
+imageDrawBatch(DisplayItem* items, Size count) noexcept {
+    // Make room for the whole batch at once. It is drawn with the rest of
+    // the frame's images at the next flush.
+    if (instanced) {
+        Size needed = sp.attributes.size + count;
+        if (needed > sp.attributes.capacity)
+            sp.attributes.reserve(max(needed, sp.attributes.capacity * 2));
+    }
+    else {
+        Size needed = ip.attributes.size + count * 6;
+        if (needed > ip.attributes.capacity)
+            ip.attributes.reserve(max(needed, ip.attributes.capacity * 2));
+    }
+
+    for (Size i = 0; i < count; i++) {
+        DisplayItem& item = items[i];
+        imageDraw(item.image, item.destination.x, item.destination.y,
+                  item.destination.z);
+    }
+}
+
 TiledImage
 tilesLoad(StringView path, U32 tileWidth, U32 tileHeight, U32 numAcross,
           U32 numHigh) noexcept {
-    TiledImage* tiles = images.find(hash_(path));
+    TiledImage* tiles = atlas->find(path);
 
     if (!tiles) {
-        tiles = load(path);
+        // The image is placed now and decoded on a worker. Until it has been
+        // copied in, it draws as nothing.
+        Handle handle = atlas->insert(path);
+        if (!imageDecodeStart(handle, path))
+            return *atlas->at(handle);
 
-        assert_(tiles->image.width == tileWidth * numAcross);
-        assert_(tiles->image.height == tileHeight * numHigh);
+        tiles = reserve(handle, path, tileWidth * numAcross,
+                        tileHeight * numHigh);
+        if (!tiles)
+            return *atlas->at(handle);
 
         tiles->tileWidth = tileWidth;
         tiles->tileHeight = tileHeight;
@@ -718,7 +1181,9 @@ tilesLoad(StringView path, U32 tileWidth, U32 tileHeight, U32 numAcross,
 }
 
 void
-tilesRelease(TiledImage tiles) noexcept { }
+tilesRelease(TiledImage tiles) noexcept {
+    atlas->release(tiles.image);
+}
 
 Image
 tileAt(TiledImage tiles, U32 index) noexcept {
@@ -736,7 +1201,9 @@ tileAt(TiledImage tiles, U32 index) noexcept {
 }
 
 void
-imagesPrune(Time latestPermissibleUse) noexcept { }
+imagesPrune(Time latestPermissibleUse) noexcept {
+    atlas->prune(latestPermissibleUse, freePage);
+}
 
 void
 imageDrawRect(float left, float right, float top, float bottom, float z,
@@ -811,10 +1278,14 @@ imageDrawRect(float left, float right, float top, float bottom, float z,
 
 void
 imageStartFrame() noexcept {
+    imageDecodeUpload(confImageUploadBytes, upload);
+
     // FIXME: Uses lots of CPU on macOS. Replace with adding black borders
     //        around play area.
     glClearColor_(0, 0, 0, 1);
     glClear_(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    streamStartFrame();
 }
 
 static struct Transform
@@ -826,32 +1297,91 @@ getOrtho() noexcept {
                              transformTranslate(-1, 1));
 }
 
+static void
+flushSprites() noexcept {
+    if (sp.attributes.size == 0)
+        return;
+
+    glUseProgram_(sp.program);
+    glBindTexture_(GL_TEXTURE_2D, sp.texture);
+
+    Size offset =
+        streamWrite(sp.attributes.data, sp.attributes.size * sizeof(Sprite));
+
+    glEnableVertexAttribArray_(sp.aDepth);
+    glEnableVertexAttribArray_(sp.aPlace);
+    glEnableVertexAttribArray_(sp.aSource);
+
+    glVertexAttribPointer_(sp.aPlace, 4, GL_FLOAT, false, sizeof(Sprite),
+                           bufferOffset(offset));
+    glVertexAttribPointer_(sp.aDepth, 1, GL_FLOAT, false, sizeof(Sprite),
+                           bufferOffset(offset + 16));
+    glVertexAttribPointer_(sp.aSource, 4, GL_UNSIGNED_SHORT, false,
+                           sizeof(Sprite), bufferOffset(offset + 20));
+
+    // Advance once per sprite rather than once per corner.
+    glVertexAttribDivisor_(sp.aDepth, 1);
+    glVertexAttribDivisor_(sp.aPlace, 1);
+    glVertexAttribDivisor_(sp.aSource, 1);
+
+    glBindBuffer_(GL_ARRAY_BUFFER, sp.corners);
+    glEnableVertexAttribArray_(sp.aCorner);
+    glVertexAttribPointer_(sp.aCorner, 2, GL_FLOAT, false, 0,
+                           bufferOffset(0));
+
+    glUniformMatrix4fv_(sp.uProjection, 1, false, getOrtho().m);
+
+    glEnable_(GL_DEPTH_TEST);
+    glDrawArraysInstanced_(GL_TRIANGLE_STRIP, 0, 4,
+                           static_cast<GLsizei>(sp.attributes.size));
+
+    // Attribute state is shared by all programs, so leave it as the other
+    // flushes expect to find it.
+    glVertexAttribDivisor_(sp.aDepth, 0);
+    glVertexAttribDivisor_(sp.aPlace, 0);
+    glVertexAttribDivisor_(sp.aSource, 0);
+
+    glDisableVertexAttribArray_(sp.aCorner);
+    glDisableVertexAttribArray_(sp.aDepth);
+    glDisableVertexAttribArray_(sp.aPlace);
+    glDisableVertexAttribArray_(sp.aSource);
+
+    sp.attributes.size = 0;
+}
+
 void
 imageFlushImages() noexcept {
+    if (instanced) {
+        flushSprites();
+        return;
+    }
+
     if (ip.attributes.size == 0)
         return;
 
     glUseProgram_(ip.program);
+    glBindTexture_(GL_TEXTURE_2D, ip.texture);
 
-    glBindBuffer_(GL_ARRAY_BUFFER, vertexBuffer);
-    glBufferData_(GL_ARRAY_BUFFER, ip.attributes.size * sizeof(ImageVertex),
-                  ip.attributes.data, GL_STATIC_DRAW);
+    Size offset = streamWrite(ip.attributes.data,
+                              ip.attributes.size * sizeof(ImageVertex));
 
     glEnableVertexAttribArray_(ip.aPosition);
     glEnableVertexAttribArray_(ip.aTexCoord);
 
     glVertexAttribPointer_(ip.aPosition, 3, GL_FLOAT, false,
-                           sizeof(ImageVertex),
-                           &static_cast<ImageVertex*>(0)->position);
+                           sizeof(ImageVertex), bufferOffset(offset));
     glVertexAttribPointer_(ip.aTexCoord, 2, GL_FLOAT, false,
                            sizeof(ImageVertex),
-                           &static_cast<ImageVertex*>(0)->texCoord);
+                           bufferOffset(offset + sizeof(fvec3)));
 
     glUniformMatrix4fv_(ip.uProjection, 1, false, getOrtho().m);
 
     glEnable_(GL_DEPTH_TEST);
     glDrawArrays_(GL_TRIANGLES, 0, ip.attributes.size);
 
+    glDisableVertexAttribArray_(ip.aPosition);
+    glDisableVertexAttribArray_(ip.aTexCoord);
+
     ip.attributes.size = 0;
 }
 
@@ -862,27 +1392,31 @@ imageFlushRects() noexcept {
 
     glUseProgram_(rp.program);
 
-    glBindBuffer_(GL_ARRAY_BUFFER, vertexBuffer);
-    glBufferData_(GL_ARRAY_BUFFER, rp.attributes.size * sizeof(RectVertex),
-                  rp.attributes.data, GL_STATIC_DRAW);
+    Size offset = streamWrite(rp.attributes.data,
+                              rp.attributes.size * sizeof(RectVertex));
 
     glEnableVertexAttribArray_(rp.aPosition);
     glEnableVertexAttribArray_(rp.aColor);
 
     glVertexAttribPointer_(rp.aPosition, 3, GL_FLOAT, false, sizeof(RectVertex),
-                           &static_cast<RectVertex*>(0)->position);
+                           bufferOffset(offset));
     glVertexAttribPointer_(rp.aColor, 4, GL_UNSIGNED_BYTE, true,
-                           sizeof(RectVertex), &static_cast<RectVertex*>(0)->r);
+                           sizeof(RectVertex),
+                           bufferOffset(offset + sizeof(fvec3)));
 
     glUniformMatrix4fv_(rp.uProjection, 1, false, getOrtho().m);
 
     glDisable_(GL_DEPTH_TEST);
     glDrawArrays_(GL_TRIANGLES, 0, rp.attributes.size);
 
+    glDisableVertexAttribArray_(rp.aPosition);
+    glDisableVertexAttribArray_(rp.aColor);
+
     rp.attributes.size = 0;
 }
 
 void
 imageEndFrame() noexcept {
+    streamEndFrame();
     SDL_GL_SwapWindow(sdl2Window);
 }
@@ -147,6 +147,9 @@ imageLoad(StringView path) noexcept {
 void
 imageDraw(Image image, float x, float y, float z) noexcept { }
 
+void
+imageDrawBatch(DisplayItem* items, Size count) noexcept { }
+
 void
 imageRelease(Image image) noexcept { }
 
@@ -16,6 +16,9 @@ imageLoad(StringView path) noexcept {
 void
 imageDraw(Image image, float x, float y, float z) noexcept { }
 
+void
+imageDrawBatch(DisplayItem* items, Size count) noexcept { }
+
 void
 imageRelease(Image image) noexcept { }
 
@@ -42,3 +45,19 @@ tileAt(TiledImage tiles, U32 index) noexcept {
 
 void
 imagesPrune(Time latestPermissibleUse) noexcept { }
+
+void
+imageDrawRect(float left, float right, float top, float bottom, float z,
+              U32 argb) noexcept { }
+
+void
+imageStartFrame() noexcept { }
+
+void
+imageEndFrame() noexcept { }
+
+void
+imageFlushImages() noexcept { }
+
+void
+imageFlushRects() noexcept { }
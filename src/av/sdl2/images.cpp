@@ -3,24 +3,32 @@
 #include "av/sdl2/error.h"
 #include "av/sdl2/sdl2.h"
 #include "av/sdl2/window.h"
+#include "tiles/atlas.h"
+#include "tiles/client-conf.h"
+#include "tiles/display-list.h"
+#include "tiles/image-decode.h"
 #include "tiles/log.h"
-#include "tiles/resources.h"
 #include "util/assert.h"
 #include "util/compiler.h"
-#include "util/hashvector.h"
 #include "util/int.h"
 #include "util/measure.h"
 #include "util/string-view.h"
 #include "util/string.h"
+#include "util/vector.h"
 
+// Images are copied onto atlas pages of this size.
 #define ATLAS_WIDTH  2048
-#define ATLAS_HEIGHT 512
+#define ATLAS_HEIGHT 2048
 
 static SDL_Renderer* renderer = 0;
-static SDL_Texture* atlas = 0;
-static U32 atlasUsed = 0;
 
-static HashVector<TiledImage> images;
+// Never freed, since Areas and Entities still release their images as they
+// are destroyed at exit.
+static Atlas* atlas = 0;
+
+// Geometry for imageDrawBatch(), kept between frames.
+static Vector<SDL_Vertex> vertices;
+static Vector<int> indices;
 
 void
 imageInit() noexcept {
@@ -51,10 +59,17 @@ imageInit() noexcept {
     //SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xFF);
     //SDL_RenderClear(renderer);
     //SDL_RenderPresent(renderer);
+
+    atlas = new Atlas(ATLAS_WIDTH, ATLAS_HEIGHT);
 }
 
+static void
+upload(DecodedImage& decoded) noexcept;
+
 void
 imageStartFrame() noexcept {
+    imageDecodeUpload(confImageUploadBytes, upload);
+
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
 }
@@ -81,101 +96,108 @@ imageDrawRect(float left, float right, float top, float bottom, float z,
     SDL_RenderFillRect(renderer, &rect);
 }
 
+static SDL_Texture*
+makePage() noexcept {
+    SDL_Texture* page = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                                          SDL_TEXTUREACCESS_TARGET,
+                                          ATLAS_WIDTH, ATLAS_HEIGHT);
+    if (page == 0)
+        logFatal("SDL2", "Failed to create texture");
+
+    SDL_SetTextureBlendMode(page, SDL_BLENDMODE_BLEND);
+
+    SDL_SetRenderTarget(renderer, page);
+    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 0);
+    SDL_RenderClear(renderer);
+    SDL_SetRenderTarget(renderer, 0);
+
+    return page;
+}
+
 static void
-initAtlas() noexcept {
-    if (atlas == 0) {
-        atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
-                                  SDL_TEXTUREACCESS_TARGET, ATLAS_WIDTH,
-                                  ATLAS_HEIGHT);
-        if (atlas == 0)
-            logFatal("SDL2", "Failed to create texture");
-
-        SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
-
-        SDL_SetRenderTarget(renderer, atlas);
-        SDL_SetRenderDrawColor(renderer, 0, 255, 0, 0);
-        SDL_RenderClear(renderer);
-        SDL_SetRenderTarget(renderer, 0);
-    }
+freePage(void* page) noexcept {
+    SDL_DestroyTexture(static_cast<SDL_Texture*>(page));
 }
 
+// Set aside room on a page for an image, and clear it so that the image draws
+// as nothing until its pixels are copied in. Returns null if the image is
+// larger than a page.
 static TiledImage*
-load(StringView path) noexcept {
-    TiledImage& tiles = images.allocate(hash_(path));
-    tiles = {};
-
-    String r;
-    if (!resourceLoad(path, r)) {
-        // Error logged.
+reserve(Handle handle, StringView path, U32 width, U32 height) noexcept {
+    U32 page = atlas->place(handle, width, height);
+    if (page == NO_ATLAS_PAGE) {
+        logErr("SDL2", String() << "Image larger than an atlas page: " << path);
         return 0;
     }
 
-    SDL_RWops* ops =
-        SDL_RWFromMem(static_cast<void*>(const_cast<char*>(r.data)),
-                      static_cast<int>(r.size));
-
-    int x = atlasUsed;
-    int y = 0;
-    int width;
-    int height;
-
-    {
-        TimeMeasure m(String() << "Constructed " << path << " as image");
-
-        //SDL_Surface* surface = IMG_Load_RW(ops, 1);
-        SDL_Surface* surface = SDL_LoadBMP_RW(ops, 1);
-        if (!surface) {
-            logFatal("SDL2", String() << "Invalid image: " << path);
-            return 0;
-        }
-
-        width = surface->w;
-        height = surface->h;
+    SDL_Texture* texture = static_cast<SDL_Texture*>(atlas->texture(page));
+    if (!texture) {
+        texture = makePage();
+        atlas->setTexture(page, texture);
+    }
 
-        initAtlas();
+    TiledImage* tiles = atlas->at(handle);
+    tiles->image.texture = texture;
 
-        // Rectangle packing algorithm:
-        //
-        // Copy surface into the atlas to the right of the previous image,
-        // or at the left edge, if there was no previous image.
-        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-        SDL_FreeSurface(surface);
+    SDL_Rect rect = {static_cast<int>(tiles->image.x),
+                     static_cast<int>(tiles->image.y), static_cast<int>(width),
+                     static_cast<int>(height)};
 
-        if (!texture) {
-            logFatal("SDL2", String() << "Failed to create texture: " << path);
-            return 0;
-        }
+    SDL_SetRenderTarget(renderer, texture);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderFillRect(renderer, &rect);
+    SDL_SetRenderTarget(renderer, 0);
 
-        // Copy this texture's data into the atlas texture.
-        SDL_Rect src = {0, 0, width, height};
-        SDL_Rect dst = {x, y, width, height};
+    return tiles;
+}
 
-        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+static void
+upload(DecodedImage& decoded) noexcept {
+    // Pruned while it was decoding, or too large to place.
+    TiledImage* tiles = atlas->at(decoded.handle);
+    if (!tiles || !TILES_VALID(*tiles))
+        return;
+
+    Image image = tiles->image;
+    // A tileset with unused room at its right or bottom edge is placed
+    // without it, so only the top-left of the decoded image is copied in.
+    if (decoded.width < image.width || decoded.height < image.height) {
+        logErr("SDL2", String() << decoded.path << ": expected at least a "
+                                << image.width << "x" << image.height
+                                << " image");
+        return;
+    }
 
-        SDL_SetRenderTarget(renderer, atlas);
-        SDL_RenderCopy(renderer, texture, &src, &dst);
-        SDL_SetRenderTarget(renderer, 0);
+    // Decoded pixels are laid out as SDL_PIXELFORMAT_RGBA32.
+    SDL_Rect rect = {static_cast<int>(image.x), static_cast<int>(image.y),
+                     static_cast<int>(image.width),
+                     static_cast<int>(image.height)};
+    SDL_UpdateTexture(static_cast<SDL_Texture*>(image.texture), &rect,
+                      decoded.pixels.data,
+                      static_cast<int>(decoded.width * sizeof(U32)));
+}
 
-        // Done with this texture.
-        SDL_DestroyTexture(texture);
-    }
+static TiledImage*
+load(StringView path) noexcept {
+    Handle handle = atlas->insert(path);
 
-    tiles.image = {
-        atlas,
-        static_cast<U32>(x),
-        static_cast<U32>(y),
-        static_cast<U32>(width),
-        static_cast<U32>(height),
-    };
+    // On failure, the image stays invalid rather than being loaded again.
+    DecodedImage decoded;
+    decoded.handle = handle;
+    if (!imageDecode(path, decoded))
+        return atlas->at(handle);
+    if (!reserve(handle, path, decoded.width, decoded.height))
+        return atlas->at(handle);
 
-    atlasUsed += static_cast<U32>(width);
+    upload(decoded);
 
-    return &tiles;
+    return atlas->at(handle);
 }
 
 Image
 imageLoad(StringView path) noexcept {
-    TiledImage* tiles = images.find(hash_(path));
+    TiledImage* tiles = atlas->find(path);
 
     if (!tiles)
         tiles = load(path);
@@ -184,7 +206,9 @@ imageLoad(StringView path) noexcept {
 }
 
 void
-imageRelease(Image image) noexcept { }
+imageRelease(Image image) noexcept {
+    atlas->release(image);
+}
 
 void
 imageDraw(Image image, float x, float y, float z) noexcept {
@@ -204,16 +228,82 @@ imageDraw(Image image, float x, float y, float z) noexcept {
     SDL_RenderCopy(renderer, texture, &src, &dst);
 }
 
+void
+imageDrawBatch(DisplayItem* items, Size count) noexcept {
+    if (count == 0)
+        return;
+
+    fvec2 translation = sdl2Translation;
+    fvec2 scaling = sdl2Scaling;
+
+    SDL_Texture* texture = static_cast<SDL_Texture*>(items[0].image.texture);
+    SDL_Color white = {255, 255, 255, 255};
+    float atlasWidth = ATLAS_WIDTH;
+    float atlasHeight = ATLAS_HEIGHT;
+
+    vertices.resize(count * 4);
+    indices.resize(count * 6);
+
+    for (Size i = 0; i < count; i++) {
+        Image image = items[i].image;
+        fvec3 d = items[i].destination;
+
+        assert_(image.texture == texture);
+
+        // Rounded to whole pixels the same way as imageDraw().
+        int x = static_cast<int>((d.x + translation.x) * scaling.x);
+        int y = static_cast<int>((d.y + translation.y) * scaling.y);
+        int w = static_cast<int>(image.width * scaling.x);
+        int h = static_cast<int>(image.height * scaling.y);
+
+        float left = static_cast<float>(x);
+        float top = static_cast<float>(y);
+        float right = static_cast<float>(x + w);
+        float bottom = static_cast<float>(y + h);
+
+        float uLeft = image.x / atlasWidth;
+        float uRight = (image.x + image.width) / atlasWidth;
+        float vTop = image.y / atlasHeight;
+        float vBottom = (image.y + image.height) / atlasHeight;
+
+        SDL_Vertex* v = vertices.data + i * 4;
+        v[0] = {{left, top}, white, {uLeft, vTop}};
+        v[1] = {{right, top}, white, {uRight, vTop}};
+        v[2] = {{left, bottom}, white, {uLeft, vBottom}};
+        v[3] = {{right, bottom}, white, {uRight, vBottom}};
+
+        int base = static_cast<int>(i * 4);
+        int* index = indices.data + i * 6;
+        index[0] = base;
+        index[1] = base + 1;
+        index[2] = base + 2;
+        index[3] = base + 2;
+        index[4] = base + 1;
+        index[5] = base + 3;
+    }
+
+    SDL_SetRenderTarget(renderer, 0);
+    SDL_RenderGeometry(renderer, texture, vertices.data,
+                       static_cast<int>(vertices.size), indices.data,
+                       static_cast<int>(indices.size));
+}
+
 TiledImage
 tilesLoad(StringView path, U32 tileWidth, U32 tileHeight, U32 numAcross,
           U32 numHigh) noexcept {
-    TiledImage* tiles = images.find(hash_(path));
+    TiledImage* tiles = atlas->find(path);
 
     if (!tiles) {
-        tiles = load(path);
+        // The image is placed now and decoded on a worker. Until it has been
+        // copied in, it draws as nothing.
+        Handle handle = atlas->insert(path);
+        if (!imageDecodeStart(handle, path))
+            return *atlas->at(handle);
 
-        assert_(tiles->image.width == tileWidth * numAcross);
-        assert_(tiles->image.height == tileHeight * numHigh);
+        tiles = reserve(handle, path, tileWidth * numAcross,
+                        tileHeight * numHigh);
+        if (!tiles)
+            return *atlas->at(handle);
 
         tiles->tileWidth = tileWidth;
         tiles->tileHeight = tileHeight;
@@ -224,7 +314,9 @@ tilesLoad(StringView path, U32 tileWidth, U32 tileHeight, U32 numAcross,
 }
 
 void
-tilesRelease(TiledImage tiles) noexcept { }
+tilesRelease(TiledImage tiles) noexcept {
+    atlas->release(tiles.image);
+}
 
 Image
 tileAt(TiledImage tiles, U32 index) noexcept {
@@ -242,7 +334,9 @@ tileAt(TiledImage tiles, U32 index) noexcept {
 }
 
 void
-imagesPrune(Time latestPermissibleUse) noexcept { }
+imagesPrune(Time latestPermissibleUse) noexcept {
+    atlas->prune(latestPermissibleUse, freePage);
+}
 
 void
 imageFlushImages() noexcept { }
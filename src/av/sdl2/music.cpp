@@ -3,7 +3,7 @@
 #include "tiles/music-worker.h"
 #include "tiles/resources.h"
 #include "util/compiler.h"
-#include "util/hashvector.h"
+#include "util/handle-table.h"
 #include "util/int.h"
 #include "util/measure.h"
 #include "util/string-view.h"
@@ -11,6 +11,7 @@
 
 struct Song {
     // The Mix_Music needs the music data to be kept around for its lifetime.
+    // Empty if the data is viewed in the data file, which is never unmapped.
     String fileContent;
 
     Mix_Music* mix;
@@ -18,19 +19,20 @@ struct Song {
 
 static bool initalized = false;
 static int paused = 0;
-static HashVector<Song> songs;
-static U32 songHash = 0;
-static Song* song = 0;
+static HandleTable<Song> songs;
+static Handle song = NO_HANDLE;
 
-static Song*
+static Handle
 load(StringView path) noexcept {
-    Song& newSong = songs.allocate(hash_(path));
+    Handle handle = songs.insert(path);
+    Song& newSong = *songs.at(handle);
     newSong.mix = 0;
 
-    String r;
-    if (!resourceLoad(path, r)) {
+    StringView r;
+    String storage;
+    if (!resourceLoadView(path, r, storage)) {
         // Error logged.
-        return 0;
+        return handle;
     }
 
     SDL_RWops* ops =
@@ -42,14 +44,14 @@ load(StringView path) noexcept {
 
     if (!mix) {
         sdlDie("SDL2", String() << "Failed to load music: " << path);
-        return 0;
+        return handle;
     }
 
     // We need to keep the memory around, so put it in a struct.
-    newSong.fileContent = static_cast<String&&>(r);
+    newSong.fileContent = static_cast<String&&>(storage);
     newSong.mix = mix;
 
-    return &newSong;
+    return handle;
 }
 
 static void
@@ -83,9 +85,9 @@ musicWorkerPlay(StringView path) noexcept {
         return;
     }
 
-    U32 pathHash = hash_(path);
+    Handle handle = path.size ? songs.find(path) : NO_HANDLE;
 
-    if (songHash == pathHash)
+    if (song && song == handle)
         return;
 
     paused = 0;
@@ -94,25 +96,23 @@ musicWorkerPlay(StringView path) noexcept {
         Mix_HaltMusic();
 
     if (path.size == 0) {
-        songHash = 0;
-        song = 0;
+        song = NO_HANDLE;
         return;
     }
 
-    song = songs.find(hash_(path));
-    if (!song)
-        song = load(path);
-    if (!song || !song->mix) {
-        songHash = 0;
-        song = 0;
+    if (!handle)
+        handle = load(path);
+
+    Song* newSong = songs.at(handle);
+    if (!newSong->mix) {
+        song = NO_HANDLE;
         return;
     }
 
-    songHash = pathHash;
-    song = song;
+    song = handle;
 
     TimeMeasure m(String() << "Playing " << path);
-    Mix_PlayMusic(song->mix, -1);
+    Mix_PlayMusic(newSong->mix, -1);
 }
 
 void
@@ -122,8 +122,7 @@ musicWorkerStop() noexcept {
     paused = 0;
 
     if (song) {
-        songHash = 0;
-        song = 0;
+        song = NO_HANDLE;
         Mix_HaltMusic();
     }
 }
@@ -82,11 +82,17 @@ SDL_Metal_GetLayer(void*) noexcept;
 #define SDL_PIXELFORMAT_RGBA8888 373694468
 #define SDL_PIXELFORMAT_ABGR8888 376840196
 #define SDL_PIXELFORMAT_RGBA32   SDL_PIXELFORMAT_ABGR8888  // When little endian
+typedef struct {
+    U8 r, g, b, a;
+} SDL_Color;
 
 // SDL_rect.h
 typedef struct {
     int x, y, w, h;
 } SDL_Rect;
+typedef struct {
+    float x, y;
+} SDL_FPoint;
 
 // SDL_rwops.h
 typedef struct SDL_RWops SDL_RWops;
@@ -147,6 +153,11 @@ SDL_GL_SwapWindow(SDL_Window*) noexcept;
 // SDL_render.h
 typedef struct SDL_Renderer SDL_Renderer;
 typedef struct SDL_Texture SDL_Texture;
+typedef struct {
+    SDL_FPoint position;
+    SDL_Color color;
+    SDL_FPoint tex_coord;
+} SDL_Vertex;
 typedef struct SDL_RendererInfo {
     const char* name;
     U32 flags;
@@ -172,12 +183,17 @@ SDL_SetRenderTarget(SDL_Renderer*, SDL_Texture*) noexcept;
 int
 SDL_SetTextureBlendMode(SDL_Texture*, SDL_BlendMode) noexcept;
 int
+SDL_UpdateTexture(SDL_Texture*, const SDL_Rect*, const void*, int) noexcept;
+int
 SDL_RenderClear(SDL_Renderer*) noexcept;
 int
 SDL_RenderCopy(SDL_Renderer*, SDL_Texture*, const SDL_Rect*,
                const SDL_Rect*) noexcept;
 int
 SDL_RenderFillRect(SDL_Renderer*, const SDL_Rect*) noexcept;
+int
+SDL_RenderGeometry(SDL_Renderer*, SDL_Texture*, const SDL_Vertex*, int,
+                   const int*, int) noexcept;
 void
 SDL_RenderPresent(SDL_Renderer*) noexcept;
 int
@@ -8,6 +8,7 @@
 #include "util/compiler.h"
 #include "util/hashtable.h"
 #include "util/int.h"
+#include "util/intern.h"
 #include "util/markable.h"
 #include "util/measure.h"
 #include "util/pool.h"
@@ -17,7 +18,7 @@ struct SDL2Sound {
     int numUsers;
     Time lastUse;
 
-    String frames;     // Audio frames.
+    String frames;     // Audio frames, unless viewed in the data file.
     Mix_Chunk* chunk;  // Decoding configuration.
 };
 
@@ -34,7 +35,7 @@ struct SDL2PlayingSound {
     int channel;
 };
 
-static Hashmap<String, SoundID> soundIDs;
+static Hashmap<Symbol, SoundID> soundIDs;
 static Pool<SDL2Sound> soundPool;
 static Pool<SDL2PlayingSound> playingSoundPool;
 
@@ -83,8 +84,9 @@ init() noexcept {
 
 static SDL2Sound
 makeSound(StringView path) noexcept {
-    String r;
-    if (!resourceLoad(path, r)) {
+    StringView r;
+    String storage;
+    if (!resourceLoadView(path, r, storage)) {
         // Error logged.
         return SDL2Sound();
     }
@@ -105,14 +107,16 @@ makeSound(StringView path) noexcept {
         return SDL2Sound();
     }
 
-    return SDL2Sound{1, 0, static_cast<String&&>(r), chunk};
+    return SDL2Sound{1, 0, static_cast<String&&>(storage), chunk};
 }
 
 SoundID
 soundLoad(StringView path) noexcept {
     init();
 
-    SoundID* cachedId = soundIDs.tryAt(path);
+    Symbol name = intern(path);
+
+    SoundID* cachedId = soundIDs.tryAt(name);
     if (cachedId) {
         int sid = **cachedId;
         SDL2Sound& sound = soundPool[sid];
@@ -122,7 +126,7 @@ soundLoad(StringView path) noexcept {
 
     SDL2Sound sound = makeSound(path);
     if (sound == SDL2Sound()) {
-        soundIDs[path] = mark;
+        soundIDs[name] = mark;
         return mark;
     }
 
@@ -130,7 +134,7 @@ soundLoad(StringView path) noexcept {
     new (&soundPool[sid].frames) String();
     soundPool[sid] = sound;
 
-    soundIDs[path] = sid;
+    soundIDs[name] = sid;
 
     return SoundID(sid);
 }
@@ -9,9 +9,4 @@ extern SDL_Window* sdl2Window;
 extern fvec2 sdl2Translation;
 extern fvec2 sdl2Scaling;
 
-void
-imageStartFrame() noexcept;
-void
-imageEndFrame() noexcept;
-
 #endif  // SRC_AV_SDL2_WINDOW_H_
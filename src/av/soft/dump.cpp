@@ -0,0 +1,135 @@
+#include "av/soft/dump.h"
+
+#include "os/c.h"
+#include "os/os.h"
+#include "util/checksum.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+// Stored deflate blocks hold at most this many bytes.
+#define DEFLATE_STORED_MAX 65535
+
+static U8*
+putBE32(U8* p, U32 x) noexcept {
+    p[0] = static_cast<U8>(x >> 24);
+    p[1] = static_cast<U8>(x >> 16);
+    p[2] = static_cast<U8>(x >> 8);
+    p[3] = static_cast<U8>(x);
+    return p + 4;
+}
+
+static U8*
+putRGB(U8* p, const U32* pixels, U32 count) noexcept {
+    for (U32 i = 0; i < count; i++) {
+        U32 px = pixels[i];
+        p[0] = static_cast<U8>(px);
+        p[1] = static_cast<U8>(px >> 8);
+        p[2] = static_cast<U8>(px >> 16);
+        p += 3;
+    }
+    return p;
+}
+
+bool
+dumpPPM(StringView path, const U32* pixels, U32 width, U32 height) noexcept {
+    String header;
+    header << "P6\n" << width << " " << height << "\n255\n";
+
+    Vector<U8> body;
+    body.resize(static_cast<Size>(width) * height * 3);
+    putRGB(body.data, pixels, width * height);
+
+    U32 lengths[] = {
+        static_cast<U32>(header.size),
+        static_cast<U32>(body.size),
+    };
+    void* datas[] = {header.data, body.data};
+    return writeFileVec(path, 2, lengths, datas);
+}
+
+// Wrap a chunk's type and data, which begin 8 bytes after start, with its
+// length and CRC.
+static U8*
+finishChunk(U8* start, U8* end) noexcept {
+    U32 length = static_cast<U32>(end - start - 8);
+    putBE32(start, length);
+    return putBE32(end, crc32Checksum(start + 4, length + 4));
+}
+
+bool
+dumpPNG(StringView path, const U32* pixels, U32 width, U32 height) noexcept {
+    // Each row is a filter type of 0 (none) followed by its pixels.
+    Size rowSize = 1 + static_cast<Size>(width) * 3;
+    Size rawSize = rowSize * height;
+    Size blocks = rawSize / DEFLATE_STORED_MAX + 1;
+    Size zlibSize = 2 + blocks * 5 + rawSize + 4;
+
+    Vector<U8> file;
+    file.resize(8 + (12 + 13) + (12 + zlibSize) + 12);
+
+    static const U8 signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    U8* p = file.data;
+    for (Size i = 0; i < sizeof(signature); i++)
+        *p++ = signature[i];
+
+    U8* chunk = p;
+    p = chunk + 4;
+    *p++ = 'I';
+    *p++ = 'H';
+    *p++ = 'D';
+    *p++ = 'R';
+    p = putBE32(p, width);
+    p = putBE32(p, height);
+    *p++ = 8;  // Bit depth.
+    *p++ = 2;  // Color type: RGB.
+    *p++ = 0;  // Compression method.
+    *p++ = 0;  // Filter method.
+    *p++ = 0;  // Interlace method.
+    p = finishChunk(chunk, p);
+
+    Vector<U8> raw;
+    raw.resize(rawSize);
+    U8* r = raw.data;
+    for (U32 y = 0; y < height; y++) {
+        *r++ = 0;
+        r = putRGB(r, pixels + static_cast<Size>(y) * width, width);
+    }
+
+    chunk = p;
+    p = chunk + 4;
+    *p++ = 'I';
+    *p++ = 'D';
+    *p++ = 'A';
+    *p++ = 'T';
+    *p++ = 0x78;  // Deflate with a 32K window.
+    *p++ = 0x01;  // No preset dictionary, fastest compression.
+    Size left = rawSize;
+    r = raw.data;
+    for (Size i = 0; i < blocks; i++) {
+        Size n = left < DEFLATE_STORED_MAX ? left : DEFLATE_STORED_MAX;
+        *p++ = i == blocks - 1 ? 1 : 0;  // Final block flag, stored type.
+        *p++ = static_cast<U8>(n);
+        *p++ = static_cast<U8>(n >> 8);
+        *p++ = static_cast<U8>(~n);
+        *p++ = static_cast<U8>(~n >> 8);
+        memcpy(p, r, n);
+        p += n;
+        r += n;
+        left -= n;
+    }
+    p = putBE32(p, adler32Checksum(raw.data, rawSize));
+    p = finishChunk(chunk, p);
+
+    chunk = p;
+    p = chunk + 4;
+    *p++ = 'I';
+    *p++ = 'E';
+    *p++ = 'N';
+    *p++ = 'D';
+    p = finishChunk(chunk, p);
+
+    return writeFile(path, static_cast<U32>(p - file.data), file.data);
+}
@@ -0,0 +1,20 @@
+#ifndef SRC_AV_SOFT_DUMP_H_
+#define SRC_AV_SOFT_DUMP_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+
+// Write an opaque frame, with pixels packed as R | G << 8 | B << 16, top row
+// first, to a file. Alpha is ignored.
+
+// A binary PPM (P6), which is cheap to write and to compare.
+bool
+dumpPPM(StringView path, const U32* pixels, U32 width, U32 height) noexcept;
+
+// An RGB PNG. The image data is left uncompressed, so it is written nearly
+// as fast as a PPM, but is as large.
+bool
+dumpPNG(StringView path, const U32* pixels, U32 width, U32 height) noexcept;
+
+#endif  // SRC_AV_SOFT_DUMP_H_
@@ -0,0 +1,532 @@
+#include "tiles/images.h"
+
+#include "av/soft/dump.h"
+#include "av/soft/soft.h"
+#include "os/c.h"
+#include "tiles/atlas.h"
+#include "tiles/client-conf.h"
+#include "tiles/display-list.h"
+#include "tiles/image-decode.h"
+#include "tiles/log.h"
+#include "tiles/window.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/sort.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+// Textures and the framebuffer both hold pixels packed as
+// R | G << 8 | B << 16 | A << 24. The framebuffer is always opaque.
+
+// Blending is done four pixels at a time with GCC vector extensions, which
+// compile to SSE2 or NEON, and one pixel at a time elsewhere.
+#if (CLANG || GCC >= 90) && (defined(__x86_64__) || defined(__aarch64__))
+#    define SOFT_VECTOR 1
+#else
+#    define SOFT_VECTOR 0
+#endif
+
+// Images are copied onto atlas pages of this size.
+#define ATLAS_WIDTH  2048
+#define ATLAS_HEIGHT 2048
+
+struct SoftTexture {
+    Vector<U32> pixels;
+    U32 width;
+    U32 height;
+};
+
+// An image or rectangle waiting for the next flush.
+struct Command {
+    SoftTexture* texture;  // Null for a rectangle.
+    U32 color;             // Of a rectangle.
+    float z;
+
+    // Source rectangle in the texture.
+    I32 srcX, srcY, srcW, srcH;
+
+    // Destination rectangle in the framebuffer, and the part of it inside the
+    // clip rectangle when it was queued.
+    I32 dstX, dstY, dstW, dstH;
+    SoftClip visible;
+};
+
+// Never freed, since Areas and Entities still release their images as they
+// are destroyed at exit.
+static Atlas* atlas = 0;
+
+static Vector<U32> framebuffer;
+static I32 fbWidth = 0;
+static I32 fbHeight = 0;
+static U32 frameNumber = 0;
+
+static Vector<Command> commands;
+
+// Scratch space for flushing: sort keys, a source column for each destination
+// column, and one scaled or solid row.
+static Vector<U64> order;
+static Vector<U32> columns;
+static Vector<U32> row;
+
+void
+imageInit() noexcept {
+    fbWidth = windowWidth();
+    fbHeight = windowHeight();
+    framebuffer.resize(static_cast<Size>(fbWidth) * fbHeight);
+
+    logInfo("Soft", String() << "Rendering to a " << fbWidth << "x"
+                             << fbHeight << " framebuffer in memory");
+
+    atlas = new Atlas(ATLAS_WIDTH, ATLAS_HEIGHT);
+}
+
+#if SOFT_VECTOR
+typedef U32 Pixels4 __attribute__((vector_size(16)));
+typedef U8 Bytes16 __attribute__((vector_size(16)));
+typedef U16 Words16 __attribute__((vector_size(32)));
+
+// s * a + d * (255 - a), divided by 255 and rounded, for each channel.
+static inline Pixels4
+blend4(Pixels4 s, Pixels4 d) noexcept {
+    Pixels4 a = (s >> 24) * 0x01010101;
+
+    Words16 sw = __builtin_convertvector(reinterpret_cast<Bytes16>(s), Words16);
+    Words16 dw = __builtin_convertvector(reinterpret_cast<Bytes16>(d), Words16);
+    Words16 aw = __builtin_convertvector(reinterpret_cast<Bytes16>(a), Words16);
+
+    Words16 x = sw * aw + dw * (255 - aw) + 128;
+    x = (x + (x >> 8)) >> 8;
+
+    Bytes16 b = __builtin_convertvector(x, Bytes16);
+    return reinterpret_cast<Pixels4>(b) | 0xFF000000;
+}
+#endif
+
+static inline U32
+blend1(U32 s, U32 d) noexcept {
+    U32 a = s >> 24;
+    U32 out = 0xFF000000;
+    for (U32 shift = 0; shift < 24; shift += 8) {
+        U32 x = ((s >> shift) & 0xFF) * a + ((d >> shift) & 0xFF) * (255 - a) +
+                128;
+        out |= ((x + (x >> 8)) >> 8) << shift;
+    }
+    return out;
+}
+
+// Alpha-blend n source pixels over the framebuffer.
+static void
+blendRow(U32* dst, const U32* src, I32 n) noexcept {
+    I32 i = 0;
+#if SOFT_VECTOR
+    for (; i + 4 <= n; i += 4) {
+        Pixels4 s;
+        memcpy(&s, src + i, sizeof(s));
+
+        U32 all = s[0] & s[1] & s[2] & s[3];
+        U32 any = s[0] | s[1] | s[2] | s[3];
+        if (all >> 24 == 0xFF) {
+            memcpy(dst + i, &s, sizeof(s));
+        }
+        else if (any >> 24 != 0) {
+            Pixels4 d;
+            memcpy(&d, dst + i, sizeof(d));
+            d = blend4(s, d);
+            memcpy(dst + i, &d, sizeof(d));
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        U32 s = src[i];
+        U32 a = s >> 24;
+        if (a == 0xFF)
+            dst[i] = s;
+        else if (a != 0)
+            dst[i] = blend1(s, dst[i]);
+    }
+}
+
+static I32
+toPixel(float f) noexcept {
+    return static_cast<I32>(floorf(f + 0.5f));
+}
+
+static I32
+max(I32 a, I32 b) noexcept {
+    return a > b ? a : b;
+}
+
+static I32
+min(I32 a, I32 b) noexcept {
+    return a < b ? a : b;
+}
+
+// Queue a command covering a rectangle in virtual pixels, unless none of it
+// is visible.
+static Command*
+queue(float x, float y, float width, float height, float z) noexcept {
+    fvec2 translation = softTranslation;
+    fvec2 scaling = softScaling;
+
+    I32 x1 = toPixel((x + translation.x) * scaling.x);
+    I32 y1 = toPixel((y + translation.y) * scaling.y);
+    I32 x2 = toPixel((x + width + translation.x) * scaling.x);
+    I32 y2 = toPixel((y + height + translation.y) * scaling.y);
+
+    SoftClip visible = {
+        max(x1, softClip.x1),
+        max(y1, softClip.y1),
+        min(x2, softClip.x2),
+        min(y2, softClip.y2),
+    };
+    if (visible.x1 >= visible.x2 || visible.y1 >= visible.y2)
+        return 0;
+
+    commands.push(Command());
+    Command& c = commands[commands.size - 1];
+    c.z = z;
+    c.dstX = x1;
+    c.dstY = y1;
+    c.dstW = x2 - x1;
+    c.dstH = y2 - y1;
+    c.visible = visible;
+    return &c;
+}
+
+void
+imageDrawRect(float left, float right, float top, float bottom, float z,
+              U32 argb) noexcept {
+    Command* c = queue(left, top, right - left, bottom - top, z);
+    if (!c)
+        return;
+
+    c->texture = 0;
+    c->color = (argb & 0xFF00FF00) | (argb >> 16 & 0xFF) | (argb & 0xFF) << 16;
+}
+
+void
+imageDraw(Image image, float x, float y, float z) noexcept {
+    assert_(IMAGE_VALID(image));
+
+    Command* c = queue(x, y, static_cast<float>(image.width),
+                       static_cast<float>(image.height), z);
+    if (!c)
+        return;
+
+    c->texture = static_cast<SoftTexture*>(image.texture);
+    c->srcX = image.x;
+    c->srcY = image.y;
+    c->srcW = image.width;
+    c->srcH = image.height;
+}
+
+void
+imageDrawBatch(DisplayItem* items, Size count) noexcept {
+    for (Size i = 0; i < count; i++) {
+        DisplayItem& item = items[i];
+        imageDraw(item.image, item.destination.x, item.destination.y,
+                  item.destination.z);
+    }
+}
+
+static void
+drawImage(Command& c) noexcept {
+    SoftTexture& texture = *c.texture;
+    SoftClip v = c.visible;
+    I32 n = v.x2 - v.x1;
+    bool scaled = c.dstW != c.srcW || c.dstH != c.srcH;
+
+    if (scaled) {
+        // Nearest neighbor. Each destination pixel takes the source pixel
+        // under its left or top edge.
+        columns.resize(static_cast<Size>(n));
+        for (I32 i = 0; i < n; i++)
+            columns[i] = c.srcX + (v.x1 + i - c.dstX) * c.srcW / c.dstW;
+        row.resize(static_cast<Size>(n));
+    }
+
+    I32 lastY = -1;
+    for (I32 y = v.y1; y < v.y2; y++) {
+        I32 sy = c.srcY + (y - c.dstY) * c.srcH / c.dstH;
+        const U32* src = texture.pixels.data + static_cast<Size>(sy) *
+                                                   texture.width;
+        U32* dst = framebuffer.data + static_cast<Size>(y) * fbWidth + v.x1;
+
+        if (!scaled) {
+            blendRow(dst, src + c.srcX + (v.x1 - c.dstX), n);
+            continue;
+        }
+
+        if (sy != lastY) {
+            for (I32 i = 0; i < n; i++)
+                row[i] = src[columns[i]];
+            lastY = sy;
+        }
+        blendRow(dst, row.data, n);
+    }
+}
+
+static void
+drawRect(Command& c) noexcept {
+    SoftClip v = c.visible;
+    I32 n = v.x2 - v.x1;
+
+    row.resize(static_cast<Size>(n));
+    for (I32 i = 0; i < n; i++)
+        row[i] = c.color;
+
+    for (I32 y = v.y1; y < v.y2; y++)
+        blendRow(framebuffer.data + static_cast<Size>(y) * fbWidth + v.x1,
+                 row.data, n);
+}
+
+// Order floats as unsigned integers, with -0 and 0 as the same depth.
+static U32
+depthKey(float z) noexcept {
+    if (z == 0.0f)
+        z = 0.0f;
+
+    U32 bits;
+    memcpy(&bits, &z, sizeof(bits));
+    return bits & 0x80000000 ? ~bits : bits | 0x80000000;
+}
+
+// Draw queued commands back to front. Commands at the same depth are drawn in
+// the order they were queued.
+static void
+flush() noexcept {
+    if (commands.size == 0)
+        return;
+
+    order.clear();
+    for (Size i = 0; i < commands.size; i++)
+        order.push(static_cast<U64>(depthKey(commands[i].z)) << 32 | i);
+    sortA(order);
+
+    for (U64* key = order.begin(); key != order.end(); key++) {
+        Command& c = commands[static_cast<Size>(*key & 0xFFFFFFFF)];
+        if (c.texture)
+            drawImage(c);
+        else
+            drawRect(c);
+    }
+
+    commands.clear();
+}
+
+void
+imageFlushImages() noexcept {
+    flush();
+}
+
+void
+imageFlushRects() noexcept {
+    flush();
+}
+
+static void
+upload(DecodedImage& decoded) noexcept;
+
+void
+imageStartFrame() noexcept {
+    // Frames that are dumped wait for every image, so that they do not
+    // depend on how quickly the workers decode.
+    if (confFrameDumpPath.size)
+        imageDecodeFlush(upload);
+    else
+        imageDecodeUpload(confImageUploadBytes, upload);
+
+    memset(framebuffer.data, 0, framebuffer.size * sizeof(U32));
+}
+
+static void
+dumpFrame() noexcept {
+    // Zero-padded so that the files sort in frame order.
+    String number;
+    number << frameNumber;
+    String path;
+    path << confFrameDumpPath;
+    for (Size i = number.size; i < 6; i++)
+        path << '0';
+    path << number;
+
+    bool ok;
+    if (confFrameDumpPNG) {
+        path << ".png";
+        ok = dumpPNG(path, framebuffer.data, fbWidth, fbHeight);
+    }
+    else {
+        path << ".ppm";
+        ok = dumpPPM(path, framebuffer.data, fbWidth, fbHeight);
+    }
+
+    if (!ok)
+        logErr("Soft", String() << "Could not write " << path);
+}
+
+void
+imageEndFrame() noexcept {
+    flush();
+
+    if (confFrameDumpPath.size)
+        dumpFrame();
+
+    frameNumber += 1;
+}
+
+static SoftTexture*
+makePage() noexcept {
+    SoftTexture* page = new SoftTexture;
+    page->width = ATLAS_WIDTH;
+    page->height = ATLAS_HEIGHT;
+    page->pixels.resize(ATLAS_WIDTH * ATLAS_HEIGHT);
+    memset(page->pixels.data, 0, page->pixels.size * sizeof(U32));
+    return page;
+}
+
+static void
+freePage(void* page) noexcept {
+    delete static_cast<SoftTexture*>(page);
+}
+
+// Set aside room on a page for an image, and clear it so that the image draws
+// as nothing until its pixels are copied in. Returns null if the image is
+// larger than a page.
+static TiledImage*
+reserve(Handle handle, StringView path, U32 width, U32 height) noexcept {
+    U32 page = atlas->place(handle, width, height);
+    if (page == NO_ATLAS_PAGE) {
+        logErr("Soft", String() << "Image larger than an atlas page: " << path);
+        return 0;
+    }
+
+    SoftTexture* texture = static_cast<SoftTexture*>(atlas->texture(page));
+    if (!texture) {
+        texture = makePage();
+        atlas->setTexture(page, texture);
+    }
+
+    TiledImage* tiles = atlas->at(handle);
+    tiles->image.texture = texture;
+
+    for (U32 y = 0; y < height; y++) {
+        U32* dst = texture->pixels.data +
+                   static_cast<Size>(tiles->image.y + y) * ATLAS_WIDTH +
+                   tiles->image.x;
+        memset(dst, 0, width * sizeof(U32));
+    }
+
+    return tiles;
+}
+
+static void
+upload(DecodedImage& decoded) noexcept {
+    // Pruned while it was decoding, or too large to place.
+    TiledImage* tiles = atlas->at(decoded.handle);
+    if (!tiles || !TILES_VALID(*tiles))
+        return;
+
+    Image image = tiles->image;
+    // A tileset with unused room at its right or bottom edge is placed
+    // without it, so only the top-left of the decoded image is copied in.
+    if (decoded.width < image.width || decoded.height < image.height) {
+        logErr("Soft", String() << decoded.path << ": expected at least a "
+                                << image.width << "x" << image.height
+                                << " image");
+        return;
+    }
+
+    SoftTexture* texture = static_cast<SoftTexture*>(image.texture);
+    for (U32 y = 0; y < image.height; y++) {
+        U32* dst = texture->pixels.data +
+                   static_cast<Size>(image.y + y) * ATLAS_WIDTH + image.x;
+        memcpy(dst,
+               decoded.pixels.data + static_cast<Size>(y) * decoded.width,
+               image.width * sizeof(U32));
+    }
+}
+
+static TiledImage*
+load(StringView path) noexcept {
+    Handle handle = atlas->insert(path);
+
+    // On failure, the image stays invalid rather than being loaded again.
+    DecodedImage decoded;
+    decoded.handle = handle;
+    if (!imageDecode(path, decoded))
+        return atlas->at(handle);
+    if (!reserve(handle, path, decoded.width, decoded.height))
+        return atlas->at(handle);
+
+    upload(decoded);
+
+    return atlas->at(handle);
+}
+
+Image
+imageLoad(StringView path) noexcept {
+    TiledImage* tiles = atlas->find(path);
+
+    if (!tiles)
+        tiles = load(path);
+
+    return tiles->image;
+}
+
+void
+imageRelease(Image image) noexcept {
+    atlas->release(image);
+}
+
+TiledImage
+tilesLoad(StringView path, U32 tileWidth, U32 tileHeight, U32 numAcross,
+          U32 numHigh) noexcept {
+    TiledImage* tiles = atlas->find(path);
+
+    if (!tiles) {
+        // The image is placed now and decoded on a worker. Until it has been
+        // copied in, it draws as nothing.
+        Handle handle = atlas->insert(path);
+        if (!imageDecodeStart(handle, path))
+            return *atlas->at(handle);
+
+        tiles = reserve(handle, path, tileWidth * numAcross,
+                        tileHeight * numHigh);
+        if (!tiles)
+            return *atlas->at(handle);
+
+        tiles->tileWidth = tileWidth;
+        tiles->tileHeight = tileHeight;
+        tiles->numTiles = numAcross * numHigh;
+    }
+
+    return *tiles;
+}
+
+void
+tilesRelease(TiledImage tiles) noexcept {
+    atlas->release(tiles.image);
+}
+
+Image
+tileAt(TiledImage tiles, U32 index) noexcept {
+    assert_(TILES_VALID(tiles));
+
+    Image image = tiles.image;
+    U32 across = image.width / tiles.tileWidth;
+
+    return {
+        image.texture,
+        image.x + index % across * tiles.tileWidth,
+        image.y + index / across * tiles.tileHeight,
+        tiles.tileWidth,
+        tiles.tileHeight,
+    };
+}
+
+void
+imagesPrune(Time latestPermissibleUse) noexcept {
+    atlas->prune(latestPermissibleUse, freePage);
+}
@@ -0,0 +1,21 @@
+#ifndef SRC_AV_SOFT_SOFT_H_
+#define SRC_AV_SOFT_SOFT_H_
+
+#include "tiles/vec.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+// State shared between the software window and renderer.
+
+// Maps virtual pixels to framebuffer pixels: (x + translation) * scaling.
+extern fvec2 softTranslation;
+extern fvec2 softScaling;
+
+// Framebuffer pixels drawn to, from (x1, y1) up to but not including (x2, y2).
+struct SoftClip {
+    I32 x1, y1, x2, y2;
+};
+
+extern SoftClip softClip;
+
+#endif  // SRC_AV_SOFT_SOFT_H_
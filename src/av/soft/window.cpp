@@ -0,0 +1,210 @@
+#include "tiles/window.h"
+
+#include "av/soft/soft.h"
+#include "os/chrono.h"
+#include "tiles/client-conf.h"
+#include "tiles/display-list.h"
+#include "tiles/images.h"
+#include "tiles/log.h"
+#include "tiles/world.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/transform.h"
+
+fvec2 softTranslation = {0.0, 0.0};
+fvec2 softScaling = {1.0, 1.0};
+SoftClip softClip = {0, 0, 0, 0};
+
+static struct Transform transformStack[10];
+static Size transformTop = 0;
+
+static SoftClip clipStack[10];
+static Size clipTop = 0;
+
+static Nanoseconds start = 0;
+static bool isOpen = false;
+
+static void
+updateTransform(void) noexcept {
+    struct Transform transform = transformStack[transformTop];
+
+    float xScale = transform.m[0];
+    float yScale = transform.m[5];
+    float x = transform.m[12];
+    float y = transform.m[13];
+
+    softTranslation = {x / xScale, y / yScale};
+    softScaling = {xScale, yScale};
+}
+
+void
+windowCreate(void) noexcept {
+    transformStack[0] = transformIdentity();
+    updateTransform();
+
+    clipStack[0] = {0, 0, confWindowSize.x, confWindowSize.y};
+    softClip = clipStack[0];
+
+    isOpen = true;
+}
+
+Time
+windowTime(void) noexcept {
+    if (start == 0)
+        start = chronoNow();
+    return ns_to_ms(chronoNow() - start);
+}
+
+I32
+windowWidth(void) noexcept {
+    return confWindowSize.x;
+}
+
+I32
+windowHeight(void) noexcept {
+    return confWindowSize.y;
+}
+
+void
+windowSetCaption(StringView) noexcept { }
+
+void
+windowMainLoop(void) noexcept {
+    DisplayList dl = {};
+
+    const Nanoseconds idealFrameTime = s_to_ns(1) / 60;
+
+    Nanoseconds frameStart = chronoNow();
+    Nanoseconds previousFrameStart =
+        frameStart - idealFrameTime;  // Bogus initial value.
+    Nanoseconds nextFrameStart = frameStart + idealFrameTime;
+
+    // Run until the window is closed or, if there is a limit, until the
+    // configured number of frames has gone by.
+    for (U32 frame = 0; isOpen; frame++) {
+        if (confFrameLimit && frame == confFrameLimit)
+            break;
+
+        //
+        // Simulate world and draw frame.
+        //
+        Time dt = ns_to_ms(frameStart - previousFrameStart);
+
+        worldTick(dt);
+
+        if (worldNeedsRedraw()) {
+            worldDraw(&dl);
+
+            imageStartFrame();
+            displayListPresent(&dl);
+            imageEndFrame();
+
+            dl.items.clear();
+        }
+
+        Nanoseconds frameEnd = chronoNow();
+
+        //
+        // Sleep until next frame.
+        //
+        Nanoseconds sleepDuration = nextFrameStart - frameEnd;
+        if (sleepDuration < 0)
+            sleepDuration = 0;
+
+        if (sleepDuration)
+            chronoSleep(sleepDuration);
+
+        previousFrameStart = frameStart;
+        frameStart = chronoNow();
+        nextFrameStart += idealFrameTime;
+
+        if (frameStart > nextFrameStart) {
+            I32 framesDropped = 0;
+            while (frameStart > nextFrameStart) {
+                nextFrameStart += idealFrameTime;
+                framesDropped += 1;
+            }
+            logInfo("Soft",
+                    String() << "Dropped " << framesDropped << " frames");
+        }
+    }
+}
+
+void
+windowPushScale(float x, float y) noexcept {
+    assert_(transformTop + 1 < sizeof(transformStack) /
+                                   sizeof(transformStack[0]));
+
+    struct Transform transform = transformStack[transformTop];
+    transformStack[++transformTop] =
+        transformMultiply(transformScale(x, y), transform);
+    updateTransform();
+}
+
+void
+windowPopScale(void) noexcept {
+    assert_(transformTop > 0);
+    --transformTop;
+    updateTransform();
+}
+
+void
+windowPushTranslate(float x, float y) noexcept {
+    assert_(transformTop + 1 < sizeof(transformStack) /
+                                   sizeof(transformStack[0]));
+
+    struct Transform transform = transformStack[transformTop];
+    transformStack[++transformTop] =
+        transformMultiply(transformTranslate(x, y), transform);
+    updateTransform();
+}
+
+void
+windowPopTranslate(void) noexcept {
+    assert_(transformTop > 0);
+    --transformTop;
+    updateTransform();
+}
+
+void
+windowPushClip(float x, float y, float width, float height) noexcept {
+    assert_(clipTop + 1 < sizeof(clipStack) / sizeof(clipStack[0]));
+
+    // Like images, clip rectangles are moved by the current transform, and
+    // only ever shrink the one they are pushed onto.
+    fvec2 t = softTranslation;
+    fvec2 s = softScaling;
+    SoftClip outer = clipStack[clipTop];
+    SoftClip clip = {
+        static_cast<I32>((x + t.x) * s.x),
+        static_cast<I32>((y + t.y) * s.y),
+        static_cast<I32>((x + width + t.x) * s.x),
+        static_cast<I32>((y + height + t.y) * s.y),
+    };
+
+    if (clip.x1 < outer.x1)
+        clip.x1 = outer.x1;
+    if (clip.y1 < outer.y1)
+        clip.y1 = outer.y1;
+    if (clip.x2 > outer.x2)
+        clip.x2 = outer.x2;
+    if (clip.y2 > outer.y2)
+        clip.y2 = outer.y2;
+
+    clipStack[++clipTop] = clip;
+    softClip = clip;
+}
+
+void
+windowPopClip(void) noexcept {
+    assert_(clipTop > 0);
+    --clipTop;
+    softClip = clipStack[clipTop];
+}
+
+void
+windowClose(void) noexcept {
+    isOpen = false;
+}
@@ -4,7 +4,7 @@
 #include "data/action.h"
 #include "tiles/vec.h"
 #include "util/compiler.h"
-#include "util/hashvector.h"
+#include "util/handle-table.h"
 #include "util/int.h"
 #include "util/string-view.h"
 #include "util/vector.h"
@@ -43,7 +43,8 @@ class DataArea {
     void
     turn() noexcept;
 
-    HashVector<void (*)(DataArea*, Entity* triggeredBy, ivec3 tile) noexcept>
+    // By name.
+    HandleTable<void (*)(DataArea*, Entity* triggeredBy, ivec3 tile) noexcept>
         scripts;
 
  private:
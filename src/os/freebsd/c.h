@@ -182,6 +182,10 @@ int
 pthread_join(pthread_t, void**) noexcept;
 }
 
+// sched.h
+int
+sched_yield() noexcept;
+
 // stdio.h
 extern "C" {
 struct __sFILE;
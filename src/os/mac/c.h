@@ -213,6 +213,10 @@ pthread_create(pthread_t*, const void*, void* (*)(void*), void*) noexcept;
 int
 pthread_join(pthread_t, void**) noexcept;
 
+// sched.h
+int
+sched_yield() noexcept;
+
 // stdio.h
 int
 fclose(FILE*) noexcept;
@@ -75,3 +75,8 @@ threadHardwareConcurrency() noexcept {
     sysctl(mib, 2, &n, &s, 0, 0);
     return n;
 }
+
+void
+threadYield() noexcept {
+    sched_yield();
+}
@@ -29,5 +29,7 @@ void
 threadDisableTimerCoalescing() noexcept;
 U32
 threadHardwareConcurrency() noexcept;
+void
+threadYield() noexcept;
 
 #endif  // SRC_OS_MAC_THREAD_H_
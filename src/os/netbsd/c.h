@@ -182,6 +182,10 @@ pthread_join(pthread_t, void**) noexcept;
 #define pthread_cond_broadcast __libc_cond_broadcast
 #define pthread_cond_wait      __libc_cond_wait
 
+// sched.h
+int
+sched_yield() noexcept;
+
 // stdio.h
 struct __sbuf {
     unsigned char* _base;
@@ -61,4 +61,9 @@ threadHardwareConcurrency() noexcept {
 static inline void
 threadDisableTimerCoalescing() noexcept { }
 
+static inline void
+threadYield() noexcept {
+    sched_yield();
+}
+
 #endif  // SRC_OS_LINUX_THREAD_H_
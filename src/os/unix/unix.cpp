@@ -2,6 +2,7 @@
 #include "os/os.h"
 #include "util/compiler.h"
 #include "util/io.h"
+#include "util/profile.h"
 #include "util/string-view.h"
 #include "util/string.h"
 #include "util/vector.h"
@@ -137,6 +138,8 @@ setTermColor(TermColor color, Output& out) noexcept {
 
 void
 exitProcess(int code) noexcept {
+    profileDump();
+
     sout << Flush();
     serr << Flush();
 
@@ -19,6 +19,8 @@ CreateFileA(LPCSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode,
             LPSECURITY_ATTRIBUTES lpSecurityAttributes,
             DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes,
             HANDLE hTemplateFile) noexcept;
+WINBASEAPI DWORD WINAPI
+GetFileSize(HANDLE hFile, LPDWORD lpFileSizeHigh) noexcept;
 WINBASEAPI HANDLE WINAPI
 CreateFileMappingA(HANDLE hFile, LPSECURITY_ATTRIBUTES lpFileMappingAttributes,
                    DWORD flProtect, DWORD dwMaximumSizeHigh,
@@ -36,6 +38,7 @@ UnmapViewOfFile(LPCVOID lpBaseAddress) noexcept;
 #define FILE_ATTRIBUTE_NORMAL 0x00000080
 #define FILE_MAP_READ         SECTION_MAP_READ
 #define GENERIC_READ          0x80000000L
+#define INVALID_FILE_SIZE     ((DWORD)0xFFFFFFFF)
 #define INVALID_HANDLE_VALUE  ((HANDLE)(LONG_PTR)-1)
 #define OPEN_EXISTING         3
 #define PAGE_READONLY         0x02
@@ -49,6 +52,13 @@ makeMappedFile(MappedFile& file, StringView path) noexcept {
     if (hFile == INVALID_HANDLE_VALUE)
         return false;
 
+    DWORD sizeHigh;
+    DWORD sizeLow = GetFileSize(hFile, &sizeHigh);
+    if (sizeLow == INVALID_FILE_SIZE || sizeHigh != 0) {
+        CloseHandle(hFile);
+        return false;
+    }
+
     HANDLE mapping = CreateFileMapping(hFile, 0, PAGE_READONLY, 0, 0, 0);
     if (mapping == 0) {
         CloseHandle(hFile);
@@ -63,6 +73,7 @@ makeMappedFile(MappedFile& file, StringView path) noexcept {
     }
 
     file.data = static_cast<char*>(data);
+    file.size = static_cast<Size>(sizeLow);
     file.mapping = mapping;
     file.file = hFile;
     return true;
@@ -3,10 +3,12 @@
 
 #include "os/c.h"
 #include "util/compiler.h"
+#include "util/int.h"
 #include "util/string-view.h"
 
 struct MappedFile {
     char* data;
+    Size size;
     HANDLE mapping;
     HANDLE file;
 };
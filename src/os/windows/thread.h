@@ -31,6 +31,8 @@ WINBASEAPI BOOL WINAPI
 CloseHandle(HANDLE hObject) noexcept;
 WINBASEAPI VOID WINAPI
 GetSystemInfo(LPSYSTEM_INFO lpSystemInfo) noexcept;
+WINBASEAPI BOOL WINAPI
+SwitchToThread() noexcept;
 WINBASEAPI DWORD WINAPI
 WaitForSingleObjectEx(HANDLE hHandle, DWORD dwMilliseconds,
                       BOOL bAlertable) noexcept;
@@ -96,4 +98,9 @@ threadHardwareConcurrency() noexcept {
 static void
 threadDisableTimerCoalescing() noexcept { }
 
+static inline void
+threadYield() noexcept {
+    SwitchToThread();
+}
+
 #endif  // SRC_OS_WINDOWS_THREAD_H_
@@ -4,6 +4,7 @@
 #include "os/os.h"
 #include "util/compiler.h"
 #include "util/io.h"
+#include "util/profile.h"
 #include "util/string-view.h"
 #include "util/string.h"
 #include "util/vector.h"
@@ -285,6 +286,8 @@ wMessageBox(StringView title, StringView text) noexcept {
 
 void
 exitProcess(int code) noexcept {
+    profileDump();
+
     ExitProcess(code);
     unreachable;
 }
@@ -0,0 +1,92 @@
+#include "pack/area-compiler.h"
+
+#include "os/c.h"
+#include "os/os.h"
+#include "pack/area-layout.h"
+#include "pack/area-parser.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/io.h"
+#include "util/json.h"
+#include "util/vector.h"
+
+static void
+printErr(StringView path, StringView message) noexcept {
+    serr << path << ": " << message << "\n";
+}
+
+// Place a section after the previous one, aligned to 4 bytes.
+static void
+placeSection(AreaSection& section, U32& offset, Size count,
+             Size elementSize) noexcept {
+    offset = (offset + 3) & ~3u;
+    section.offset = offset;
+    section.count = static_cast<U32>(count);
+    offset += static_cast<U32>(count * elementSize);
+}
+
+static void
+copySection(String& blob, AreaSection& section, void* data,
+            Size elementSize) noexcept {
+    if (section.count)
+        memcpy(blob.data + section.offset, data, section.count * elementSize);
+}
+
+static void
+writeBlob(ParsedArea& a, String& blob) noexcept {
+    AreaHeader& h = a.header;
+    memcpy(h.magic, AREA_MAGIC, sizeof(AREA_MAGIC));
+    h.version = AREA_VERSION;
+
+    U32 offset = sizeof(AreaHeader);
+    placeSection(h.tileSets, offset, a.tileSets.size, sizeof(AreaTileSet));
+    placeSection(h.animations, offset, a.animations.size,
+                 sizeof(AreaAnimation));
+    placeSection(h.frames, offset, a.frames.size, sizeof(U32));
+    placeSection(h.layers, offset, a.layers.size, sizeof(AreaLayer));
+    placeSection(h.tiles, offset, a.tiles.size, sizeof(U32));
+    placeSection(h.flags, offset, a.flags.size, sizeof(AreaFlags));
+    placeSection(h.exits, offset, a.exits.size, sizeof(AreaExit));
+    placeSection(h.layermods, offset, a.layermods.size, sizeof(AreaLayermod));
+    placeSection(h.scripts, offset, a.scripts.size, sizeof(AreaScript));
+    placeSection(h.strings, offset, a.strings.size, 1);
+
+    blob.clear();
+    blob.resize(offset);
+    memset(blob.data, 0, offset);
+
+    memcpy(blob.data, &h, sizeof(AreaHeader));
+    copySection(blob, h.tileSets, a.tileSets.data, sizeof(AreaTileSet));
+    copySection(blob, h.animations, a.animations.data, sizeof(AreaAnimation));
+    copySection(blob, h.frames, a.frames.data, sizeof(U32));
+    copySection(blob, h.layers, a.layers.data, sizeof(AreaLayer));
+    copySection(blob, h.tiles, a.tiles.data, sizeof(U32));
+    copySection(blob, h.flags, a.flags.data, sizeof(AreaFlags));
+    copySection(blob, h.exits, a.exits.data, sizeof(AreaExit));
+    copySection(blob, h.layermods, a.layermods.data, sizeof(AreaLayermod));
+    copySection(blob, h.scripts, a.scripts.data, sizeof(AreaScript));
+    copySection(blob, h.strings, a.strings.data, 1);
+}
+
+CompileResult
+compileArea(StringView path, StringView json, String& blob) noexcept {
+    JsonDocument doc(json, "layers/data");
+    if (!doc.ok)
+        return COMPILE_NOT_AN_AREA;
+
+    JsonValue root = doc.root;
+    if (!root.isObject() || !root["tilesets"].isArray() ||
+        !root["layers"].isArray())
+        return COMPILE_NOT_AN_AREA;
+
+    AreaParserIO io = {readFile, printErr};
+
+    ParsedArea area;
+    if (!parseArea(path, root, io, area)) {
+        serr << path << ": could not compile area\n";
+        return COMPILE_FAILED;
+    }
+
+    writeBlob(area, blob);
+    return COMPILE_OK;
+}
@@ -0,0 +1,23 @@
+#ifndef SRC_PACK_AREA_COMPILER_H_
+#define SRC_PACK_AREA_COMPILER_H_
+
+#include "util/compiler.h"
+#include "util/string-view.h"
+#include "util/string.h"
+
+enum CompileResult {
+    // The file was compiled into a blob.
+    COMPILE_OK,
+    // The file is not a Tiled JSON area.
+    COMPILE_NOT_AN_AREA,
+    // The file is an area, but it is malformed. An error has been printed.
+    COMPILE_FAILED
+};
+
+// Convert a Tiled JSON area and the tilesets it references into the layout in
+// pack/area-layout.h. The path is the area's path within the archive, which
+// must also be where it and its tilesets can be read from disk.
+CompileResult
+compileArea(StringView path, StringView json, String& blob) noexcept;
+
+#endif  // SRC_PACK_AREA_COMPILER_H_
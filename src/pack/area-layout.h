@@ -0,0 +1,138 @@
+#ifndef SRC_PACK_AREA_LAYOUT_H_
+#define SRC_PACK_AREA_LAYOUT_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+
+// Compiled area layout:
+//
+//   Header                           [struct]
+//   TileSets                         [struct array]
+//   Animations                       [struct array]
+//   Frames                           [U32 array]
+//   Layers                           [struct array]
+//   Tiles                            [U32 array]
+//   Flags                            [struct array]
+//   Exits                            [struct array]
+//   Layermods                        [struct array]
+//   Scripts                          [struct array]
+//   Strings                          [string pool, 1-byte alignment]
+//   EOF
+//
+//
+// Produced by "pack-tool compile" from a Tiled JSON area and the tilesets it
+// references. It replaces the area's JSON file in the archive under the same
+// path.
+//
+// Every section but Strings is aligned on a 4-byte boundary. Tiles holds the
+// gid of every tile in the same order as TileGrid::graphics, so it can be
+// copied in as-is. Flags, Exits, Layermods, and Scripts have one entry for
+// each tile covered by each object in the object layers, in the order they
+// would have been applied when loading the JSON file.
+
+// Version history:
+//   (1) Initial version.
+
+//                                  "C   a   r    e    a   \r    \n   \0"
+static constexpr U8 AREA_MAGIC[8] = {67, 97, 114, 101, 97, '\r', '\n', 0};
+
+static constexpr U8 AREA_VERSION = 1;
+
+struct AreaSection {
+    U32 offset;
+    U32 count;
+};
+
+// Offset into the Strings section.
+struct AreaString {
+    U32 offset;
+    U32 size;
+};
+
+struct AreaHeader {
+    U8 magic[8];
+    U8 version;
+    U8 loopX;
+    U8 loopY;
+    U8 hasMusic;
+
+    U32 colorOverlayARGB;
+
+    AreaString name;
+    AreaString music;
+
+    I32 width;
+    I32 height;
+    I32 depth;
+
+    I32 tileWidth;
+    I32 tileHeight;
+
+    // Largest gid in the Tiles section.
+    U32 maxGid;
+
+    AreaSection tileSets;
+    AreaSection animations;
+    AreaSection frames;
+    AreaSection layers;
+    AreaSection tiles;
+    AreaSection flags;
+    AreaSection exits;
+    AreaSection layermods;
+    AreaSection scripts;
+    AreaSection strings;
+};
+
+struct AreaTileSet {
+    AreaString image;
+    U32 firstGid;
+    U32 tileWidth;
+    U32 tileHeight;
+    U32 numAcross;
+    U32 numHigh;
+};
+
+struct AreaAnimation {
+    U32 gid;
+    U32 tileSet;
+
+    // Indices of frames within the tile set, found in the Frames section.
+    U32 firstFrame;
+    U32 frameCount;
+
+    I32 frameLen;
+};
+
+enum AreaLayerType { AREA_TILE_LAYER, AREA_OBJECT_LAYER };
+
+struct AreaLayer {
+    float depth;
+    U32 type;
+};
+
+struct AreaFlags {
+    I32 x, y, z;
+    U32 flags;
+};
+
+struct AreaExit {
+    I32 x, y, z;
+    U32 direction;
+    AreaString area;
+    I32 destX, destY;
+    float destZ;
+};
+
+struct AreaLayermod {
+    I32 x, y, z;
+    U32 direction;
+    float depth;
+};
+
+struct AreaScript {
+    I32 x, y, z;
+    U32 type;
+    AreaString name;
+};
+
+#endif  // SRC_PACK_AREA_LAYOUT_H_
@@ -0,0 +1,664 @@
+#include "pack/area-parser.h"
+
+#include "os/c.h"
+#include "pack/area-layout.h"
+#include "pack/layer-data.h"
+#include "tiles/tile-grid.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/json.h"
+#include "util/string2.h"
+#include "util/vector.h"
+
+#define CHECK(x)          \
+    do {                  \
+        if (!(x)) {       \
+            return false; \
+        }                 \
+    } while (false)
+
+struct AreaParser {
+    StringView path;
+    AreaParserIO io;
+    ParsedArea& area;
+
+    // Number of gids given out so far, including the unused gid 0.
+    U32 gidCount;
+};
+
+static bool
+fail(AreaParser& c, StringView message) noexcept {
+    c.io.fail(c.path, message);
+    return false;
+}
+
+static AreaString
+addString(AreaParser& c, StringView s) noexcept {
+    AreaString ref = {static_cast<U32>(c.area.strings.size),
+                      static_cast<U32>(s.size)};
+    c.area.strings << s;
+    return ref;
+}
+
+static StringView
+dirname(StringView path) noexcept {
+    StringPosition slash = path.rfind('/');
+    return slash == SV_NOT_FOUND ? "" : path.substr(0, slash + 1);
+}
+
+static bool
+parseARGB(AreaParser& c, StringView str, U32& argb) noexcept {
+    Vector<StringView> strs;
+    splitStr(strs, str, ",");
+
+    if (strs.size != 4)
+        return fail(c, "invalid ARGB format");
+
+    argb = 0;
+
+    String buf;
+    for (Size i = 0; i < 4; i++) {
+        buf.clear();
+        buf = strs[i];
+        I32 v;
+        if (!parseInt(v, buf))
+            return fail(c, "invalid ARGB format");
+        if (!(0 <= v && v < 256))
+            return fail(c, "ARGB values must be between 0 and 255");
+        argb = (argb << 8) + static_cast<U32>(v);
+    }
+
+    return true;
+}
+
+static bool
+processMapProperties(AreaParser& c, JsonValue obj) noexcept {
+    JsonValue nameValue = obj["name"];
+    JsonValue musicValue = obj["music"];
+    JsonValue loopValue = obj["loop"];
+    JsonValue coloroverlayValue = obj["coloroverlay"];
+
+    CHECK(musicValue.isString() || musicValue.isNull());
+    CHECK(loopValue.isString() || loopValue.isNull());
+    CHECK(coloroverlayValue.isString() || coloroverlayValue.isNull());
+
+    if (!nameValue.isString())
+        return fail(c, "Area must have \"name\" property");
+
+    c.area.header.name = addString(c, nameValue.toString());
+
+    if (musicValue.isString()) {
+        c.area.header.hasMusic = 1;
+        c.area.header.music = addString(c, musicValue.toString());
+    }
+    if (loopValue.isString()) {
+        StringView directions = loopValue.toString();
+        c.area.header.loopX = directions.find('x') != SV_NOT_FOUND;
+        c.area.header.loopY = directions.find('y') != SV_NOT_FOUND;
+    }
+    if (coloroverlayValue.isString())
+        CHECK(parseARGB(c, coloroverlayValue.toString(),
+                        c.area.header.colorOverlayARGB));
+
+    return true;
+}
+
+static bool
+processTileType(AreaParser& c, JsonValue obj, U32 tileSet, U32 nTiles,
+                U32 id) noexcept {
+    JsonValue framesNode = obj["frames"];
+    JsonValue speedNode = obj["speed"];
+
+    CHECK(framesNode.isString() && speedNode.isNumber());
+
+    Vector<StringView> strs;
+    splitStr(strs, framesNode.toString(), ",");
+    CHECK(strs.size);
+
+    AreaAnimation animation;
+    animation.gid = c.area.tileSets[tileSet].firstGid + id;
+    animation.tileSet = tileSet;
+    animation.firstFrame = static_cast<U32>(c.area.frames.size);
+    animation.frameCount = static_cast<U32>(strs.size);
+
+    String buf;
+    for (Size i = 0; i < strs.size; i++) {
+        buf.clear();
+        buf = strs[i];
+
+        U32 idx;
+        if (!parseUInt(idx, buf))
+            return fail(c, "couldn't parse frame index for animated tile");
+        if (i == 0 && idx != id)
+            return fail(c, String() << "first member of tile id " << id
+                                    << " animation must be itself.");
+        if (nTiles <= idx)
+            return fail(c, "frame index out of range for animated tile");
+
+        c.area.frames.push(idx);
+    }
+
+    float hertz = static_cast<float>(speedNode.toNumber());
+    CHECK(hertz > 0.0f);
+    animation.frameLen = static_cast<I32>(1000.0f / hertz);
+
+    c.area.animations.push(animation);
+    return true;
+}
+
+static bool
+processTileSetFile(AreaParser& c, JsonValue obj, StringView source,
+                   U32 firstGid) noexcept {
+    if (firstGid != c.gidCount)
+        return fail(c, "Tileset firstgid does not follow the previous tileset");
+
+    JsonValue imageNode = obj["image"];
+    JsonValue imagewidthNode = obj["imagewidth"];
+    JsonValue imageheightNode = obj["imageheight"];
+    JsonValue tilewidthNode = obj["tilewidth"];
+    JsonValue tileheightNode = obj["tileheight"];
+    JsonValue tilespropertiesNode = obj["tileproperties"];
+
+    CHECK(imageNode.isString());
+    CHECK(imagewidthNode.isNumber());
+    CHECK(imageheightNode.isNumber());
+    CHECK(tilewidthNode.isNumber());
+    CHECK(tileheightNode.isNumber());
+    CHECK(tilespropertiesNode.isObject() || tilespropertiesNode.isNull());
+
+    U32 tileWidth = tilewidthNode.toInt();
+    U32 tileHeight = tileheightNode.toInt();
+
+    CHECK(tileWidth > 0 && tileHeight > 0);
+    CHECK(tileWidth <= 0x7FFF && tileHeight <= 0x7FFF);
+
+    U32 numAcross = static_cast<U32>(imagewidthNode.toInt()) / tileWidth;
+    U32 numHigh = static_cast<U32>(imageheightNode.toInt()) / tileHeight;
+    U32 nTiles = numAcross * numHigh;
+
+    AreaHeader& h = c.area.header;
+    if ((h.tileWidth || h.tileHeight) &&
+        static_cast<U32>(h.tileWidth) != tileWidth &&
+        static_cast<U32>(h.tileHeight) != tileHeight)
+        return fail(c, "Tileset's width/height contradict earlier <layer>");
+
+    h.tileWidth = static_cast<I32>(tileWidth);
+    h.tileHeight = static_cast<I32>(tileHeight);
+
+    String image = String() << dirname(source) << imageNode.toString();
+
+    AreaTileSet tileSet = {addString(c, image), firstGid, tileWidth,
+                           tileHeight,          numAcross, numHigh};
+    U32 tileSetIndex = static_cast<U32>(c.area.tileSets.size);
+    c.area.tileSets.push(tileSet);
+
+    c.gidCount += nTiles;
+
+    if (!tilespropertiesNode.isObject())
+        return true;
+
+    String buf;
+    for (JsonIterator node = begin(tilespropertiesNode);
+         node != end(tilespropertiesNode); ++node) {
+        CHECK(node->value.isObject());
+
+        buf.clear();
+        buf = node->key;
+        U32 id;
+        if (!parseUInt(id, buf) || nTiles <= id)
+            return fail(c, "Tile type id is invalid");
+
+        CHECK(processTileType(c, node->value, tileSetIndex, nTiles, id));
+    }
+
+    return true;
+}
+
+static bool
+processTileSet(AreaParser& c, JsonValue obj) noexcept {
+    JsonValue firstgidValue = obj["firstgid"];
+    JsonValue sourceValue = obj["source"];
+
+    CHECK(firstgidValue.isNumber());
+    CHECK(sourceValue.isString());
+
+    U32 firstGid = firstgidValue.toInt();
+
+    String source = String() << dirname(c.path) << sourceValue.toString();
+
+    String data;
+    if (!c.io.read(source, data))
+        return fail(c, String() << source << ": failed to load JSON file");
+
+    JsonDocument doc(static_cast<String&&>(data));
+    if (!doc.ok || !doc.root.isObject())
+        return fail(c, String() << source << ": failed to load JSON file");
+
+    if (!processTileSetFile(c, doc.root, source, firstGid))
+        return fail(c, String()
+                           << source << ": failed to parse JSON tileset file");
+
+    return true;
+}
+
+static bool
+addLayer(AreaParser& c, JsonValue properties, AreaLayerType type) noexcept {
+    if (!properties.isObject())
+        return fail(c, "A layer must have the \"depth\" property");
+
+    JsonValue depthValue = properties["depth"];
+    if (!depthValue.isString())
+        return fail(c, "A layer must have the \"depth\" property");
+
+    String buf = depthValue.toString();
+    float depth;
+    if (!parseFloat(depth, buf))
+        return fail(c, "A layer must have the \"depth\" property");
+
+    for (AreaLayer* layer = c.area.layers.begin(); layer != c.area.layers.end();
+         layer++)
+        if (layer->depth == depth)
+            return fail(c, "Layers cannot share a depth");
+
+    AreaLayer layer = {depth, static_cast<U32>(type)};
+    c.area.layers.push(layer);
+
+    Size layerSize =
+        static_cast<Size>(c.area.header.width * c.area.header.height);
+    Size first = c.area.tiles.size;
+    c.area.tiles.resize(first + layerSize);
+    memset(c.area.tiles.data + first, 0, layerSize * sizeof(U32));
+
+    return true;
+}
+
+static bool
+processLayer(AreaParser& c, JsonValue obj) noexcept {
+    JsonValue widthValue = obj["width"];
+    JsonValue heightValue = obj["height"];
+    JsonValue propertiesValue = obj["properties"];
+    JsonValue dataValue = obj["data"];
+    JsonValue encodingValue = obj["encoding"];
+    JsonValue compressionValue = obj["compression"];
+
+    CHECK(widthValue.isNumber());
+    CHECK(heightValue.isNumber());
+    CHECK(propertiesValue.isObject() || propertiesValue.isNull());
+    CHECK(encodingValue.isString() || encodingValue.isNull());
+    CHECK(compressionValue.isString() || compressionValue.isNull());
+
+    bool base64 = false;
+    if (encodingValue.isString()) {
+        StringView encoding = encodingValue.toString();
+        if (encoding == "base64")
+            base64 = true;
+        else if (encoding != "csv")
+            return fail(c, "Unsupported layer encoding");
+    }
+
+    if (base64)
+        CHECK(dataValue.isString());
+    else
+        CHECK(dataValue.isRawArray() || dataValue.isArray());
+
+    LayerCompression compression = LAYER_UNCOMPRESSED;
+    if (base64 && compressionValue.isString()) {
+        compression = layerCompression(compressionValue.toString());
+        if (compression == LAYER_UNSUPPORTED)
+            return fail(c, "Unsupported layer compression");
+    }
+
+    if (c.area.header.width != widthValue.toInt() ||
+        c.area.header.height != heightValue.toInt())
+        return fail(c, "layer x,y size != map x,y size");
+
+    CHECK(addLayer(c, propertiesValue, AREA_TILE_LAYER));
+
+    Size layerSize =
+        static_cast<Size>(c.area.header.width * c.area.header.height);
+    U32* out = c.area.tiles.data + c.area.tiles.size - layerSize;
+
+    Size size = layerSize;
+    if (base64) {
+        if (!decodeLayerData(dataValue.toString(), compression, out,
+                             layerSize, c.gidCount))
+            return fail(c, "Invalid tile layer data");
+    }
+    else if (!jsonReadU32s(dataValue, out, layerSize, c.gidCount, size)) {
+        return fail(c, "Invalid tile layer data");
+    }
+
+    for (Size i = 0; i < size; i++)
+        if (c.area.header.maxGid < out[i])
+            c.area.header.maxGid = out[i];
+
+    return true;
+}
+
+static bool
+splitTileFlags(AreaParser& c, StringView strOfFlags, U32* flags) noexcept {
+    Vector<StringView> flagStrs;
+    splitStr(flagStrs, strOfFlags, ",");
+
+    for (StringView* flagStr = flagStrs.begin(); flagStr != flagStrs.end();
+         flagStr++) {
+        if (*flagStr == "nowalk")
+            *flags |= TILE_NOWALK;
+        else if (*flagStr == "nowalk_player")
+            *flags |= TILE_NOWALK_PLAYER;
+        else if (*flagStr == "nowalk_npc")
+            *flags |= TILE_NOWALK_NPC;
+        else
+            return fail(c, String() << "Invalid tile flag: " << *flagStr);
+    }
+
+    return true;
+}
+
+// Matches regex /^\s*\d+\+?$/
+static bool
+isIntegerOrPlus(StringView s) noexcept {
+    const I32 space = 0;
+    const I32 digit = 1;
+    const I32 sign = 2;
+
+    I32 state = space;
+
+    for (const char* c = s.begin(); c != s.end(); c++) {
+        if (state == space) {
+            if (*c == ' ')
+                continue;
+            else
+                state++;
+        }
+        if (state == digit) {
+            if ('0' <= *c && *c <= '9')
+                continue;
+            else
+                state++;
+        }
+        if (state == sign)
+            return *c == '+';
+    }
+    return true;
+}
+
+struct ParsedExit {
+    StringView area;
+    I32 x, y;
+    float z;
+    bool wwide, hwide;
+};
+
+static bool
+parseExit(AreaParser& c, StringView dest, ParsedExit& exit) noexcept {
+    Vector<StringView> strs;
+    splitStr(strs, dest, ",");
+
+    if (strs.size != 4)
+        return fail(c, "exit: Invalid format");
+
+    StringView x = strs[1];
+    StringView y = strs[2];
+    StringView z = strs[3];
+
+    if (!isIntegerOrPlus(x) || !isIntegerOrPlus(y) || !isIntegerOrPlus(z))
+        return fail(c, "exit: Invalid format");
+
+    exit.area = strs[0];
+    exit.wwide = x.find('+') != SV_NOT_FOUND;
+    exit.hwide = y.find('+') != SV_NOT_FOUND;
+
+    if (exit.wwide)
+        x = x.substr(0, x.size - 1);
+    if (exit.hwide)
+        y = y.substr(0, y.size - 1);
+
+    String buf;
+
+    buf = x;
+    CHECK(parseInt(exit.x, buf));
+
+    buf.clear();
+    buf = y;
+    CHECK(parseInt(exit.y, buf));
+
+    buf.clear();
+    buf = z;
+    CHECK(parseFloat(exit.z, buf));
+
+    return true;
+}
+
+// Keys read from each object in an object layer.
+static constexpr11 JsonKey propertiesKey = "properties";
+static constexpr11 JsonKey xKey = "x";
+static constexpr11 JsonKey yKey = "y";
+static constexpr11 JsonKey widthKey = "width";
+static constexpr11 JsonKey heightKey = "height";
+static constexpr11 JsonKey flagsKey = "flags";
+
+static constexpr11 JsonKey exitKeys[EXITS_LENGTH] = {
+    "exit", "exit:up", "exit:down", "exit:left", "exit:right",
+};
+
+static constexpr11 JsonKey layermodKeys[EXITS_LENGTH] = {
+    "layermod", "layermod:up", "layermod:down", "layermod:left",
+    "layermod:right",
+};
+
+static constexpr11 JsonKey scriptKeys[TileGrid::SCRIPT_TYPE_LAST] = {
+    "on_enter",
+    "on_leave",
+    "on_use",
+};
+
+static bool
+processObject(AreaParser& c, JsonValue obj) noexcept {
+    JsonValue propertiesValue = obj[propertiesKey];
+    if (!propertiesValue.isObject()) {
+        // Empty tile object. Odd, but acceptable.
+        return true;
+    }
+
+    JsonValue xValue = obj[xKey];
+    JsonValue yValue = obj[yKey];
+    JsonValue widthValue = obj[widthKey];
+    JsonValue heightValue = obj[heightKey];
+
+    CHECK(xValue.isNumber());
+    CHECK(yValue.isNumber());
+    CHECK(widthValue.isNumber());
+    CHECK(heightValue.isNumber());
+
+    U32 flags = 0x0;
+
+    JsonValue flagsValue = propertiesValue[flagsKey];
+    CHECK(flagsValue.isString() || flagsValue.isNull());
+    if (flagsValue.isString())
+        CHECK(splitTileFlags(c, flagsValue.toString(), &flags));
+
+    bool haveExit[EXITS_LENGTH] = {};
+    ParsedExit exit[EXITS_LENGTH];
+    AreaString exitArea[EXITS_LENGTH];
+
+    bool haveLayermod[EXITS_LENGTH] = {};
+    float layermod[EXITS_LENGTH];
+
+    for (Size i = 0; i < EXITS_LENGTH; i++) {
+        JsonValue exitValue = propertiesValue[exitKeys[i]];
+        CHECK(exitValue.isString() || exitValue.isNull());
+        if (exitValue.isString()) {
+            haveExit[i] = true;
+            CHECK(parseExit(c, exitValue.toString(), exit[i]));
+            exitArea[i] = addString(c, exit[i].area);
+        }
+
+        JsonValue layermodValue = propertiesValue[layermodKeys[i]];
+        CHECK(layermodValue.isString() || layermodValue.isNull());
+        if (layermodValue.isString()) {
+            haveLayermod[i] = true;
+            String buf = layermodValue.toString();
+            CHECK(parseFloat(layermod[i], buf));
+        }
+    }
+
+    if (haveExit[EXIT_NORMAL] || haveLayermod[EXIT_NORMAL])
+        flags |= TILE_NOWALK_NPC;
+
+    bool haveScript[TileGrid::SCRIPT_TYPE_LAST] = {};
+    AreaString script[TileGrid::SCRIPT_TYPE_LAST];
+
+    for (Size i = 0; i < TileGrid::SCRIPT_TYPE_LAST; i++) {
+        JsonValue scriptValue = propertiesValue[scriptKeys[i]];
+        CHECK(scriptValue.isString() || scriptValue.isNull());
+        if (scriptValue.isString()) {
+            haveScript[i] = true;
+            script[i] = addString(c, scriptValue.toString());
+        }
+    }
+
+    if (!c.area.header.tileWidth || !c.area.header.tileHeight)
+        return fail(c, "Object found before any tileset");
+
+    I32 x = xValue.toInt() / c.area.header.tileWidth;
+    I32 y = yValue.toInt() / c.area.header.tileHeight;
+    I32 w = widthValue.toInt() / c.area.header.tileWidth;
+    I32 h = heightValue.toInt() / c.area.header.tileHeight;
+    I32 z = static_cast<I32>(c.area.layers.size) - 1;
+
+    CHECK(x + w <= c.area.header.width);
+    CHECK(y + h <= c.area.header.height);
+
+    for (I32 Y = y; Y < y + h; Y++) {
+        for (I32 X = x; X < x + w; X++) {
+            AreaFlags f = {X, Y, z, flags};
+            c.area.flags.push(f);
+
+            for (U32 i = 0; i < EXITS_LENGTH; i++) {
+                if (!haveExit[i])
+                    continue;
+                AreaExit e = {X,
+                              Y,
+                              z,
+                              i,
+                              exitArea[i],
+                              exit[i].x + (exit[i].wwide ? X - x : 0),
+                              exit[i].y + (exit[i].hwide ? Y - y : 0),
+                              exit[i].z};
+                c.area.exits.push(e);
+            }
+
+            for (U32 i = 0; i < EXITS_LENGTH; i++) {
+                if (!haveLayermod[i])
+                    continue;
+                AreaLayermod l = {X, Y, z, i, layermod[i]};
+                c.area.layermods.push(l);
+            }
+
+            for (U32 i = 0; i < TileGrid::SCRIPT_TYPE_LAST; i++) {
+                if (!haveScript[i])
+                    continue;
+                AreaScript s = {X, Y, z, i, script[i]};
+                c.area.scripts.push(s);
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool
+processObjectGroup(AreaParser& c, JsonValue obj) noexcept {
+    JsonValue propertiesValue = obj["properties"];
+    JsonValue objectsValue = obj["objects"];
+
+    CHECK(propertiesValue.isObject() || propertiesValue.isNull());
+    CHECK(objectsValue.isArray());
+
+    CHECK(addLayer(c, propertiesValue, AREA_OBJECT_LAYER));
+
+    for (JsonIterator node = begin(objectsValue); node != end(objectsValue);
+         ++node) {
+        CHECK(node->value.isObject());
+        CHECK(processObject(c, node->value));
+    }
+
+    return true;
+}
+
+static bool
+processDescriptor(AreaParser& c, JsonValue root) noexcept {
+    JsonValue widthValue = root["width"];
+    JsonValue heightValue = root["height"];
+    JsonValue propertiesValue = root["properties"];
+    JsonValue tilesetsValue = root["tilesets"];
+    JsonValue layersValue = root["layers"];
+
+    CHECK(widthValue.isNumber());
+    CHECK(heightValue.isNumber());
+    CHECK(propertiesValue.isObject());
+    CHECK(tilesetsValue.isArray());
+    CHECK(layersValue.isArray());
+
+    c.area.header.width = widthValue.toInt();
+    c.area.header.height = heightValue.toInt();
+
+    CHECK(0 <= c.area.header.width && c.area.header.width <= 0x7FFF);
+    CHECK(0 <= c.area.header.height && c.area.header.height <= 0x7FFF);
+
+    CHECK(processMapProperties(c, propertiesValue));
+
+    for (JsonIterator node = begin(tilesetsValue); node != end(tilesetsValue);
+         ++node) {
+        CHECK(node->value.isObject());
+        CHECK(processTileSet(c, node->value));
+    }
+
+    // Make room for every layer's tiles at once.
+    Size layerCount = 0;
+    for (JsonIterator node = begin(layersValue); node != end(layersValue);
+         ++node)
+        layerCount++;
+
+    Size tileCount =
+        static_cast<Size>(c.area.header.width * c.area.header.height) *
+        layerCount;
+    if (tileCount > c.area.tiles.capacity)
+        c.area.tiles.reserve(tileCount);
+
+    for (JsonIterator node = begin(layersValue); node != end(layersValue);
+         ++node) {
+        JsonValue layerValue = node->value;
+        CHECK(layerValue.isObject());
+
+        JsonValue typeValue = layerValue["type"];
+        CHECK(typeValue.isString());
+
+        StringView type = typeValue.toString();
+
+        if (type == "tilelayer")
+            CHECK(processLayer(c, layerValue));
+        else if (type == "objectgroup")
+            CHECK(processObjectGroup(c, layerValue));
+        else
+            return fail(c, "Each layer must be a tilelayer or objectlayer");
+    }
+
+    // Tile sizes come from the tilesets, and the engine divides by them.
+    if (!c.area.header.tileWidth || !c.area.header.tileHeight)
+        return fail(c, "Area must have a tileset");
+
+    c.area.header.depth = static_cast<I32>(c.area.layers.size);
+
+    return true;
+}
+
+bool
+parseArea(StringView path, JsonValue root, AreaParserIO io,
+          ParsedArea& area) noexcept {
+    memset(&area.header, 0, sizeof(area.header));
+
+    AreaParser c = {path, io, area, 1};  // Tiled's gids start from 1.
+    return processDescriptor(c, root);
+}
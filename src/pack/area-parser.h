@@ -0,0 +1,45 @@
+#ifndef SRC_PACK_AREA_PARSER_H_
+#define SRC_PACK_AREA_PARSER_H_
+
+#include "pack/area-layout.h"
+#include "util/compiler.h"
+#include "util/json.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+// A Tiled JSON area, parsed into the sections of pack/area-layout.h. "pack-tool
+// compile" writes them out as a blob, and the engine builds an Area from them
+// directly when it loads the JSON file itself.
+struct ParsedArea {
+    // Every field but the sections, which are placed when writing a blob.
+    AreaHeader header;
+
+    Vector<AreaTileSet> tileSets;
+    Vector<AreaAnimation> animations;
+    Vector<U32> frames;
+    Vector<AreaLayer> layers;
+    Vector<U32> tiles;
+    Vector<AreaFlags> flags;
+    Vector<AreaExit> exits;
+    Vector<AreaLayermod> layermods;
+    Vector<AreaScript> scripts;
+    String strings;
+};
+
+// Where the parser finds the tilesets an area refers to and reports what is
+// wrong with a malformed area.
+struct AreaParserIO {
+    bool (*read)(StringView path, String& data) noexcept;
+    void (*fail)(StringView path, StringView message) noexcept;
+};
+
+// Parse the root of an area's JSON file, which should be read with
+// "layers/data" as a raw array. The path is the area's own, and the tilesets
+// it refers to are found relative to it. Returns false if the area is
+// malformed, with most problems passed to io.fail.
+bool
+parseArea(StringView path, JsonValue root, AreaParserIO io,
+          ParsedArea& area) noexcept;
+
+#endif  // SRC_PACK_AREA_PARSER_H_
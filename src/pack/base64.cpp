@@ -0,0 +1,186 @@
+#include "pack/base64.h"
+
+#include "os/c.h"
+#include "util/compiler.h"
+#include "util/cpu.h"
+#include "util/int.h"
+#include "util/string-view.h"
+
+#define INVALID 255
+
+// Value of each character, or INVALID.
+static const U8 values[256] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255,  62, 255, 255, 255,  63,
+     52,  53,  54,  55,  56,  57,  58,  59,  60,  61, 255, 255,
+    255, 255, 255, 255, 255,   0,   1,   2,   3,   4,   5,   6,
+      7,   8,   9,  10,  11,  12,  13,  14,  15,  16,  17,  18,
+     19,  20,  21,  22,  23,  24,  25, 255, 255, 255, 255, 255,
+    255,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,
+     37,  38,  39,  40,  41,  42,  43,  44,  45,  46,  47,  48,
+     49,  50,  51, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255,
+};
+
+#if (GCC || CLANG) && defined(__x86_64__)
+typedef char Chars16 __attribute__((vector_size(16)));
+typedef short Shorts8 __attribute__((vector_size(16)));
+typedef int Ints4 __attribute__((vector_size(16)));
+typedef U32 Words4 __attribute__((vector_size(16)));
+
+// Decode 16 characters into 12 bytes at a time, for as long as there are 16
+// characters left, room to store 16 bytes, and no padding or invalid
+// characters. Returns the number of characters decoded.
+//
+// Each character is classified by table lookups on its high and low nibbles,
+// which both validates it and gives the offset that turns it into its value.
+// See Wojciech Muła, "Base64 encoding and decoding with SIMD instructions".
+__attribute__((target("ssse3"))) static Size
+decodeSsse3(const U8* s, Size size, U8* d, Size room) noexcept {
+    // Bits of the high-nibble classes that each low nibble is invalid in.
+    const Chars16 lutLo = {0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                           0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A};
+    // Class of each high nibble.
+    const Chars16 lutHi = {0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10};
+    // Offset from a character to its value, by high nibble, with '/' at 1.
+    const Chars16 lutRoll = {0,   16,  19,  4, -65, -65, -71, -71,
+                             0,   0,   0,   0, 0,   0,   0,   0};
+    const Chars16 mergePairs = {0x40, 1, 0x40, 1, 0x40, 1, 0x40, 1,
+                                0x40, 1, 0x40, 1, 0x40, 1, 0x40, 1};
+    const Shorts8 mergeQuads = {0x1000, 1, 0x1000, 1, 0x1000, 1, 0x1000, 1};
+    const Chars16 order = {2,  1,  0, 6,  5,  4,  10, 9,
+                           8,  14, 13, 12, -1, -1, -1, -1};
+
+    Size done = 0;
+    while (size - done >= 16 && room >= 16) {
+        Chars16 in;
+        memcpy(&in, s + done, 16);
+
+        Chars16 hiNibbles =
+            reinterpret_cast<Chars16>(reinterpret_cast<Words4>(in) >> 4) &
+            0x2F;
+        Chars16 loNibbles = in & 0x2F;
+
+        Chars16 lo = __builtin_ia32_pshufb128(lutLo, loNibbles);
+        Chars16 hi = __builtin_ia32_pshufb128(lutHi, hiNibbles);
+        if (__builtin_ia32_pmovmskb128(
+                reinterpret_cast<Chars16>((lo & hi) != 0)))
+            break;
+
+        Chars16 isSlash = reinterpret_cast<Chars16>(in == '/');
+        Chars16 roll = __builtin_ia32_pshufb128(lutRoll, isSlash + hiNibbles);
+        Chars16 sextets = in + roll;
+
+        // Pack each group of four 6-bit values into 24 bits, then gather
+        // those into the first 12 bytes.
+        Shorts8 pairs = __builtin_ia32_pmaddubsw128(sextets, mergePairs);
+        Ints4 quads = __builtin_ia32_pmaddwd128(pairs, mergeQuads);
+        Chars16 out = __builtin_ia32_pshufb128(
+            reinterpret_cast<Chars16>(quads), order);
+        memcpy(d, &out, 16);
+
+        done += 16;
+        d += 12;
+        room -= 12;
+    }
+    return done;
+}
+
+static const bool haveSsse3 = getCpu().ssse3;
+#endif
+
+Size
+base64DecodedSize(StringView text) noexcept {
+    if (text.size % 4 != 0)
+        return SIZE_MAX;
+    if (text.size == 0)
+        return 0;
+
+    Size padding = 0;
+    if (text.data[text.size - 1] == '=')
+        padding++;
+    if (text.data[text.size - 2] == '=')
+        padding++;
+    return text.size / 4 * 3 - padding;
+}
+
+bool
+base64Decode(StringView text, void* dst) noexcept {
+    const U8* s = reinterpret_cast<const U8*>(text.data);
+    const U8* end = s + text.size;
+    U8* d = static_cast<U8*>(dst);
+
+    if (text.size == 0)
+        return true;
+    if (text.size % 4 != 0)
+        return false;
+
+#if (GCC || CLANG) && defined(__x86_64__)
+    if (haveSsse3) {
+        Size size = base64DecodedSize(text);
+        Size done = decodeSsse3(s, text.size, d, size);
+        s += done;
+        d += done / 4 * 3;
+    }
+#endif
+
+    // Every quartet but the last is whole.
+    for (; end - s > 4; s += 4) {
+        U32 a = values[s[0]];
+        U32 b = values[s[1]];
+        U32 c = values[s[2]];
+        U32 e = values[s[3]];
+        if ((a | b | c | e) == INVALID)
+            return false;
+
+        U32 group = (a << 18) | (b << 12) | (c << 6) | e;
+        d[0] = static_cast<U8>(group >> 16);
+        d[1] = static_cast<U8>(group >> 8);
+        d[2] = static_cast<U8>(group);
+        d += 3;
+    }
+
+    U32 a = values[s[0]];
+    U32 b = values[s[1]];
+    if ((a | b) == INVALID)
+        return false;
+
+    if (s[2] == '=') {
+        if (s[3] != '=')
+            return false;
+        d[0] = static_cast<U8>((a << 2) | (b >> 4));
+        return true;
+    }
+
+    U32 c = values[s[2]];
+    if (c == INVALID)
+        return false;
+
+    if (s[3] == '=') {
+        d[0] = static_cast<U8>((a << 2) | (b >> 4));
+        d[1] = static_cast<U8>((b << 4) | (c >> 2));
+        return true;
+    }
+
+    U32 e = values[s[3]];
+    if (e == INVALID)
+        return false;
+
+    d[0] = static_cast<U8>((a << 2) | (b >> 4));
+    d[1] = static_cast<U8>((b << 4) | (c >> 2));
+    d[2] = static_cast<U8>((c << 6) | e);
+    return true;
+}
@@ -0,0 +1,21 @@
+#ifndef SRC_PACK_BASE64_H_
+#define SRC_PACK_BASE64_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+
+// Decoding of standard, padded base64, as written by Tiled for encoded layer
+// data. On x86-64 CPUs with SSSE3, 16 characters are decoded at a time.
+
+// Size of the data that text decodes to, or SIZE_MAX if text's length is not
+// a multiple of 4.
+Size
+base64DecodedSize(StringView text) noexcept;
+
+// Decode text into dst, which holds base64DecodedSize(text) bytes. Returns
+// false if text has a character outside the alphabet or misplaced padding.
+bool
+base64Decode(StringView text, void* dst) noexcept;
+
+#endif  // SRC_PACK_BASE64_H_
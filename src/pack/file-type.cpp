@@ -5,7 +5,21 @@
 
 static const StringView textExtensions[] = {".json"};
 
-static const StringView mediaExtensions[] = {".bmp", ".oga", ".png"};
+static const StringView mediaExtensions[] = {".bmp"};
+
+static const StringView compressedMediaExtensions[] = {".oga", ".png"};
+
+#define LENGTH(array) (sizeof(array) / sizeof(array[0]))
+
+static bool
+contains(const StringView* extensions, Size count,
+         StringView extension) noexcept {
+    for (const StringView* e = extensions; e != extensions + count; e++) {
+        if (extension == *e)
+            return true;
+    }
+    return false;
+}
 
 FileType
 determineFileType(StringView path) noexcept {
@@ -13,19 +27,12 @@ determineFileType(StringView path) noexcept {
     if (dot == SV_NOT_FOUND)
         return FT_UNKNOWN;
     StringView extension = path.substr(dot);
-    for (const StringView* text = &textExtensions[0];
-         text !=
-         &textExtensions[sizeof(textExtensions) / sizeof(textExtensions[0])];
-         text++) {
-        if (extension == *text)
-            return FT_TEXT;
-    }
-    for (const StringView* text = &mediaExtensions[0];
-         text !=
-         &mediaExtensions[sizeof(mediaExtensions) / sizeof(mediaExtensions[0])];
-         text++) {
-        if (extension == *text)
-            return FT_MEDIA;
-    }
+    if (contains(textExtensions, LENGTH(textExtensions), extension))
+        return FT_TEXT;
+    if (contains(mediaExtensions, LENGTH(mediaExtensions), extension))
+        return FT_MEDIA;
+    if (contains(compressedMediaExtensions, LENGTH(compressedMediaExtensions),
+                 extension))
+        return FT_COMPRESSED_MEDIA;
     return FT_UNKNOWN;
 }
@@ -4,7 +4,8 @@
 #include "util/compiler.h"
 #include "util/string-view.h"
 
-enum FileType { FT_TEXT, FT_UNKNOWN, FT_MEDIA };
+// Media that is already compressed is not worth compressing again.
+enum FileType { FT_TEXT, FT_UNKNOWN, FT_MEDIA, FT_COMPRESSED_MEDIA };
 
 FileType
 determineFileType(StringView path) noexcept;
@@ -0,0 +1,450 @@
+#include "pack/inflate.h"
+
+#include "os/c.h"
+#include "util/checksum.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+// Codes of up to this many bits are decoded with a single table lookup.
+#define FAST_BITS 9
+
+#define MAX_BITS 15
+
+#define LITERALS  288
+#define DISTANCES 32
+
+static const U16 lengthBase[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const U8 lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const U16 distanceBase[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+static const U8 distanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+// Order in which a dynamic block lists its code length code lengths.
+static const U8 codeLengthOrder[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+
+// A canonical Huffman code.
+struct Huffman {
+    // Symbol and length of each code of up to FAST_BITS bits, indexed by the
+    // next FAST_BITS bits of input. Zero where a code is longer.
+    U16 fast[1 << FAST_BITS];
+
+    // For longer codes, by length.
+    U16 firstCode[MAX_BITS + 1];
+    U16 firstSymbol[MAX_BITS + 1];
+    U32 maxCode[MAX_BITS + 2];  // Past the last code, left-aligned to 16 bits.
+
+    // By position in canonical order.
+    U8 size[LITERALS];
+    U16 value[LITERALS];
+};
+
+struct Inflater {
+    const U8* in;
+    const U8* inEnd;
+
+    // Bits not yet consumed, least significant first.
+    U64 bits;
+    U32 count;
+
+    // Zero bytes fed into bits after the input ran out.
+    U32 padding;
+
+    U8* outStart;
+    U8* out;
+    U8* outEnd;
+};
+
+static U32
+reverse(U32 code, U32 length) noexcept {
+    code = ((code & 0xAAAA) >> 1) | ((code & 0x5555) << 1);
+    code = ((code & 0xCCCC) >> 2) | ((code & 0x3333) << 2);
+    code = ((code & 0xF0F0) >> 4) | ((code & 0x0F0F) << 4);
+    code = ((code & 0xFF00) >> 8) | ((code & 0x00FF) << 8);
+    return code >> (16 - length);
+}
+
+static bool
+buildHuffman(Huffman& h, const U8* lengths, U32 n) noexcept {
+    U32 counts[MAX_BITS + 1] = {};
+    U32 nextCode[MAX_BITS + 1];
+
+    memset(h.fast, 0, sizeof(h.fast));
+
+    for (U32 i = 0; i < n; i++)
+        counts[lengths[i]]++;
+    counts[0] = 0;
+
+    U32 code = 0;
+    U32 symbol = 0;
+    for (U32 i = 1; i <= MAX_BITS; i++) {
+        nextCode[i] = code;
+        h.firstCode[i] = static_cast<U16>(code);
+        h.firstSymbol[i] = static_cast<U16>(symbol);
+        code += counts[i];
+        if (counts[i] && code - 1 >= (1u << i))
+            return false;  // Oversubscribed.
+        h.maxCode[i] = code << (16 - i);
+        code <<= 1;
+        symbol += counts[i];
+    }
+    h.maxCode[MAX_BITS + 1] = 0x10000;
+
+    for (U32 i = 0; i < n; i++) {
+        U32 s = lengths[i];
+        if (s == 0)
+            continue;
+
+        U32 c = nextCode[s] - h.firstCode[s] + h.firstSymbol[s];
+        h.size[c] = static_cast<U8>(s);
+        h.value[c] = static_cast<U16>(i);
+
+        if (s <= FAST_BITS) {
+            U16 entry = static_cast<U16>((s << 9) | i);
+            for (U32 j = reverse(nextCode[s], s); j < (1u << FAST_BITS);
+                 j += 1u << s)
+                h.fast[j] = entry;
+        }
+
+        nextCode[s]++;
+    }
+
+    return true;
+}
+
+static void
+refill(Inflater& z) noexcept {
+    while (z.count <= 56) {
+        U64 byte = 0;
+        if (z.in < z.inEnd)
+            byte = *z.in++;
+        else
+            z.padding++;
+        z.bits |= byte << z.count;
+        z.count += 8;
+    }
+}
+
+static inline U32
+getBits(Inflater& z, U32 n) noexcept {
+    if (z.count < n)
+        refill(z);
+    U32 v = static_cast<U32>(z.bits & ((1ull << n) - 1));
+    z.bits >>= n;
+    z.count -= n;
+    return v;
+}
+
+// Returns -1 for a code that is not in h.
+static I32
+decodeSlow(Inflater& z, const Huffman& h) noexcept {
+    U32 k = reverse(static_cast<U32>(z.bits & 0xFFFF), 16);
+
+    U32 s = FAST_BITS + 1;
+    while (s <= MAX_BITS && k >= h.maxCode[s])
+        s++;
+    if (s > MAX_BITS)
+        return -1;
+
+    U32 c = (k >> (16 - s)) - h.firstCode[s] + h.firstSymbol[s];
+    if (c >= LITERALS || h.size[c] != s)
+        return -1;
+
+    z.bits >>= s;
+    z.count -= s;
+    return h.value[c];
+}
+
+static inline I32
+decode(Inflater& z, const Huffman& h) noexcept {
+    if (z.count < 16)
+        refill(z);
+
+    U32 entry = h.fast[z.bits & ((1 << FAST_BITS) - 1)];
+    if (entry == 0)
+        return decodeSlow(z, h);
+
+    U32 s = entry >> 9;
+    z.bits >>= s;
+    z.count -= s;
+    return static_cast<I32>(entry & 511);
+}
+
+static bool
+inflateCodes(Inflater& z, const Huffman& literals,
+             const Huffman& distances) noexcept {
+    for (;;) {
+        I32 symbol = decode(z, literals);
+        if (symbol < 0)
+            return false;
+
+        if (symbol < 256) {
+            if (z.out == z.outEnd)
+                return false;
+            *z.out++ = static_cast<U8>(symbol);
+            continue;
+        }
+        if (symbol == 256)
+            return true;
+
+        symbol -= 257;
+        if (symbol >= 29)
+            return false;
+        U32 length = lengthBase[symbol] + getBits(z, lengthExtra[symbol]);
+
+        symbol = decode(z, distances);
+        if (symbol < 0 || symbol >= 30)
+            return false;
+        U32 distance =
+            distanceBase[symbol] + getBits(z, distanceExtra[symbol]);
+
+        if (static_cast<Size>(z.out - z.outStart) < distance ||
+            static_cast<Size>(z.outEnd - z.out) < length)
+            return false;
+
+        const U8* match = z.out - distance;
+        if (distance >= length) {
+            memcpy(z.out, match, length);
+            z.out += length;
+        }
+        else {
+            // The match overlaps the bytes being written.
+            for (U32 i = 0; i < length; i++)
+                *z.out++ = *match++;
+        }
+    }
+}
+
+static bool
+inflateStored(Inflater& z) noexcept {
+    getBits(z, z.count % 8);
+
+    U32 length = getBits(z, 16);
+    U32 complement = getBits(z, 16);
+    if ((length ^ 0xFFFF) != complement)
+        return false;
+    if (static_cast<Size>(z.outEnd - z.out) < length)
+        return false;
+
+    // Bytes already in the bit buffer come first.
+    for (; length && z.count; length--)
+        *z.out++ = static_cast<U8>(getBits(z, 8));
+
+    if (static_cast<Size>(z.inEnd - z.in) < length)
+        return false;
+    memcpy(z.out, z.in, length);
+    z.out += length;
+    z.in += length;
+    return true;
+}
+
+static bool
+inflateFixed(Inflater& z) noexcept {
+    U8 lengths[LITERALS + DISTANCES];
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 256 - 144);
+    memset(lengths + 256, 7, 280 - 256);
+    memset(lengths + 280, 8, LITERALS - 280);
+    memset(lengths + LITERALS, 5, DISTANCES);
+
+    Huffman literals, distances;
+    buildHuffman(literals, lengths, LITERALS);
+    buildHuffman(distances, lengths + LITERALS, DISTANCES);
+    return inflateCodes(z, literals, distances);
+}
+
+static bool
+inflateDynamic(Inflater& z) noexcept {
+    U32 nLiterals = getBits(z, 5) + 257;
+    U32 nDistances = getBits(z, 5) + 1;
+    U32 nCodeLengths = getBits(z, 4) + 4;
+    if (nLiterals > 286 || nDistances > 30)
+        return false;
+
+    U8 codeLengthLengths[19] = {};
+    for (U32 i = 0; i < nCodeLengths; i++)
+        codeLengthLengths[codeLengthOrder[i]] =
+            static_cast<U8>(getBits(z, 3));
+
+    Huffman codeLengths;
+    if (!buildHuffman(codeLengths, codeLengthLengths, 19))
+        return false;
+
+    U8 lengths[LITERALS + DISTANCES];
+    U32 total = nLiterals + nDistances;
+    for (U32 n = 0; n < total;) {
+        I32 symbol = decode(z, codeLengths);
+        if (symbol < 0)
+            return false;
+
+        if (symbol < 16) {
+            lengths[n++] = static_cast<U8>(symbol);
+            continue;
+        }
+
+        U8 fill = 0;
+        U32 repeat;
+        if (symbol == 16) {
+            if (n == 0)
+                return false;
+            fill = lengths[n - 1];
+            repeat = 3 + getBits(z, 2);
+        }
+        else if (symbol == 17) {
+            repeat = 3 + getBits(z, 3);
+        }
+        else {
+            repeat = 11 + getBits(z, 7);
+        }
+
+        if (total - n < repeat)
+            return false;
+        memset(lengths + n, fill, repeat);
+        n += repeat;
+    }
+
+    if (lengths[256] == 0)
+        return false;  // No end of block.
+
+    Huffman literals, distances;
+    if (!buildHuffman(literals, lengths, nLiterals) ||
+        !buildHuffman(distances, lengths + nLiterals, nDistances))
+        return false;
+    return inflateCodes(z, literals, distances);
+}
+
+// Decompress a raw DEFLATE stream into exactly dstSize bytes. Returns the
+// first byte after the stream, or 0 on failure.
+static const U8*
+inflate(const U8* src, Size srcSize, U8* dst, Size dstSize) noexcept {
+    Inflater z;
+    z.in = src;
+    z.inEnd = src + srcSize;
+    z.bits = 0;
+    z.count = 0;
+    z.padding = 0;
+    z.outStart = dst;
+    z.out = dst;
+    z.outEnd = dst + dstSize;
+
+    bool final;
+    do {
+        final = getBits(z, 1) != 0;
+
+        bool ok;
+        switch (getBits(z, 2)) {
+        case 0: ok = inflateStored(z); break;
+        case 1: ok = inflateFixed(z); break;
+        case 2: ok = inflateDynamic(z); break;
+        default: ok = false; break;
+        }
+        if (!ok)
+            return 0;
+    } while (!final);
+
+    // Did the stream run past the input?
+    if (z.padding * 8 > z.count)
+        return 0;
+    if (z.out != z.outEnd)
+        return 0;
+
+    // Give back the whole bytes that were read ahead but not consumed.
+    getBits(z, z.count % 8);
+    return z.in - (z.count / 8 - z.padding);
+}
+
+bool
+zlibDecompress(const void* src, Size srcSize, void* dst,
+               Size dstSize) noexcept {
+    const U8* in = static_cast<const U8*>(src);
+    if (srcSize < 2 + 4)
+        return false;
+
+    U32 cmf = in[0];
+    U32 flg = in[1];
+    if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || (cmf * 256 + flg) % 31 != 0)
+        return false;
+    if (flg & 0x20)
+        return false;  // Preset dictionary.
+
+    const U8* end = inflate(in + 2, srcSize - 2 - 4, static_cast<U8*>(dst),
+                            dstSize);
+    if (end == 0)
+        return false;
+
+    U32 expected = (static_cast<U32>(end[0]) << 24) |
+                   (static_cast<U32>(end[1]) << 16) |
+                   (static_cast<U32>(end[2]) << 8) | end[3];
+    return adler32Checksum(dst, dstSize) == expected;
+}
+
+bool
+gzipDecompress(const void* src, Size srcSize, void* dst,
+               Size dstSize) noexcept {
+    const U8* in = static_cast<const U8*>(src);
+    const U8* inEnd = in + srcSize;
+    if (srcSize < 10 + 8)
+        return false;
+
+    if (in[0] != 0x1F || in[1] != 0x8B || in[2] != 8)
+        return false;
+    U32 flags = in[3];
+    if (flags & 0xE0)
+        return false;
+
+    // The trailer is at a known place, so the optional header fields only
+    // need to stay clear of it.
+    const U8* trailer = inEnd - 8;
+    const U8* p = in + 10;
+
+    if (flags & 0x04) {  // FEXTRA
+        if (trailer - p < 2)
+            return false;
+        Size extra = p[0] | (static_cast<Size>(p[1]) << 8);
+        p += 2;
+        if (static_cast<Size>(trailer - p) < extra)
+            return false;
+        p += extra;
+    }
+    for (U32 field = 0x08; field <= 0x10; field <<= 1) {  // FNAME, FCOMMENT
+        if (!(flags & field))
+            continue;
+        while (p < trailer && *p)
+            p++;
+        if (p == trailer)
+            return false;
+        p++;
+    }
+    if (flags & 0x02) {  // FHCRC
+        if (trailer - p < 2)
+            return false;
+        p += 2;
+    }
+
+    const U8* end = inflate(p, static_cast<Size>(trailer - p),
+                            static_cast<U8*>(dst), dstSize);
+    if (end == 0)
+        return false;
+
+    U32 crc = end[0] | (static_cast<U32>(end[1]) << 8) |
+              (static_cast<U32>(end[2]) << 16) |
+              (static_cast<U32>(end[3]) << 24);
+    U32 size = end[4] | (static_cast<U32>(end[5]) << 8) |
+               (static_cast<U32>(end[6]) << 16) |
+               (static_cast<U32>(end[7]) << 24);
+    return size == static_cast<U32>(dstSize) &&
+           crc == crc32Checksum(dst, dstSize);
+}
@@ -0,0 +1,21 @@
+#ifndef SRC_PACK_INFLATE_H_
+#define SRC_PACK_INFLATE_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+
+// Decompression of DEFLATE streams in the zlib and gzip wrappers, as written
+// by Tiled for compressed layer data. The size of the output must be known
+// ahead of time. Every code, length, and distance is checked against its
+// buffers, and the wrapper's checksum is verified, so corrupt input is
+// rejected rather than read or written out of bounds.
+
+// Returns true if src decompresses to exactly dstSize bytes.
+bool
+zlibDecompress(const void* src, Size srcSize, void* dst, Size dstSize) noexcept;
+
+// Returns true if src decompresses to exactly dstSize bytes.
+bool
+gzipDecompress(const void* src, Size srcSize, void* dst, Size dstSize) noexcept;
+
+#endif  // SRC_PACK_INFLATE_H_
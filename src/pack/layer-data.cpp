@@ -0,0 +1,66 @@
+#include "pack/layer-data.h"
+
+#include "os/c.h"
+#include "pack/base64.h"
+#include "pack/inflate.h"
+#include "util/compiler.h"
+#include "util/cpu.h"
+#include "util/endian.h"
+#include "util/int.h"
+#include "util/new.h"
+#include "util/string-view.h"
+
+LayerCompression
+layerCompression(StringView name) noexcept {
+    if (name.size == 0)
+        return LAYER_UNCOMPRESSED;
+    if (name == "zlib")
+        return LAYER_ZLIB;
+    if (name == "gzip")
+        return LAYER_GZIP;
+    return LAYER_UNSUPPORTED;
+}
+
+static bool
+decompress(StringView text, LayerCompression compression, U32* out,
+           Size outSize) noexcept {
+    Size size = base64DecodedSize(text);
+    if (size == SIZE_MAX)
+        return false;
+
+    if (compression == LAYER_UNCOMPRESSED)
+        return size == outSize && base64Decode(text, out);
+
+    // malloc(0) may return null.
+    void* compressed = malloc(size ? size : 1);
+    if (!compressed)
+        return false;
+
+    bool ok = base64Decode(text, compressed);
+    if (ok && compression == LAYER_ZLIB)
+        ok = zlibDecompress(compressed, size, out, outSize);
+    else if (ok && compression == LAYER_GZIP)
+        ok = gzipDecompress(compressed, size, out, outSize);
+    else
+        ok = false;
+
+    free(compressed);
+    return ok;
+}
+
+bool
+decodeLayerData(StringView text, LayerCompression compression, U32* out,
+                Size count, U32 limit) noexcept {
+    if (!decompress(text, compression, out, count * sizeof(U32)))
+        return false;
+
+    // Or together every gid that is out of range so the loop does not branch.
+    U32 bad = 0;
+    for (Size i = 0; i < count; i++) {
+#if BE
+        out[i] = bswapu32(out[i]);
+#endif
+        bad |= out[i] >= limit;
+    }
+    return bad == 0;
+}
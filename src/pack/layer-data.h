@@ -0,0 +1,29 @@
+#ifndef SRC_PACK_LAYER_DATA_H_
+#define SRC_PACK_LAYER_DATA_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+
+// Tile layers that Tiled saves with "encoding": "base64" hold their gids as
+// little-endian U32s, optionally compressed with zlib or gzip, in a single
+// base64 string.
+
+enum LayerCompression {
+    LAYER_UNCOMPRESSED,
+    LAYER_ZLIB,
+    LAYER_GZIP,
+    LAYER_UNSUPPORTED,
+};
+
+// Parse a layer's "compression" property. An empty name means uncompressed.
+LayerCompression
+layerCompression(StringView name) noexcept;
+
+// Decode count gids from text into out. Returns false if text is malformed,
+// does not hold exactly count gids, or holds a gid that is not below limit.
+bool
+decodeLayerData(StringView text, LayerCompression compression, U32* out,
+                Size count, U32 limit) noexcept;
+
+#endif  // SRC_PACK_LAYER_DATA_H_
@@ -22,11 +22,14 @@
 // Version history:
 //   (1) Initial version.
 //   (2) Coalesce metadata into one section. Align data to boundary.
+//   (3) Compress blobs with LZ4. Version 2 files are still read, since their
+//       blobs are all BLOB_COMPRESSION_NONE.
 
 //                                  "C   a   r    o    b    \r    \n   \0"
 static constexpr U8 PACK_MAGIC[8] = {67, 97, 114, 111, 98, '\r', '\n', 0};
 
-static constexpr U8 PACK_VERSION = 2;
+static constexpr U8 PACK_VERSION = 3;
+static constexpr U8 PACK_MIN_VERSION = 2;
 
 struct HeaderSection {
     U8 magic[8];
@@ -40,7 +43,7 @@ struct HeaderSection {
     U32 dataOffset;
 };
 
-enum BlobCompressionType { BLOB_COMPRESSION_NONE };
+enum BlobCompressionType { BLOB_COMPRESSION_NONE, BLOB_COMPRESSION_LZ4 };
 
 struct BlobMetadata {
     // Offset into paths section.
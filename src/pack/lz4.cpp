@@ -0,0 +1,219 @@
+#include "pack/lz4.h"
+
+#include "os/c.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+// A sequence's match is at least this long.
+#define MIN_MATCH 4
+
+// The last bytes of a block are always literals.
+#define LAST_LITERALS 5
+
+// The last match must start this far from the end of the block.
+#define MF_LIMIT 12
+
+#define MAX_OFFSET 65535
+
+#define HASH_LOG 12
+
+static U32
+read32(const U8* p) noexcept {
+    U32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static U32
+hash(U32 sequence) noexcept {
+    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+// Write the 255-byte continuation of a length that did not fit in its token.
+static U8*
+writeLength(U8* op, U32 length) noexcept {
+    for (; length >= 255; length -= 255)
+        *op++ = 255;
+    *op++ = static_cast<U8>(length);
+    return op;
+}
+
+// Write one sequence, or return 0 if it would not fit before oend.
+static U8*
+writeSequence(U8* op, U8* oend, const U8* literals, U32 litLen,
+              U32 offset, U32 matchLen, bool last) noexcept {
+    U32 needed = 1 + litLen / 255 + 1 + litLen;
+    if (!last)
+        needed += 2 + matchLen / 255 + 1;
+    if (static_cast<Size>(oend - op) < needed)
+        return 0;
+
+    U8* token = op++;
+
+    if (litLen >= 15) {
+        *token = 15 << 4;
+        op = writeLength(op, litLen - 15);
+    }
+    else {
+        *token = static_cast<U8>(litLen << 4);
+    }
+
+    memcpy(op, literals, litLen);
+    op += litLen;
+
+    if (last)
+        return op;
+
+    *op++ = static_cast<U8>(offset);
+    *op++ = static_cast<U8>(offset >> 8);
+
+    if (matchLen >= 15) {
+        *token |= 15;
+        op = writeLength(op, matchLen - 15);
+    }
+    else {
+        *token |= static_cast<U8>(matchLen);
+    }
+
+    return op;
+}
+
+U32
+lz4Bound(U32 size) noexcept {
+    return size + size / 255 + 16;
+}
+
+U32
+lz4Compress(const void* src, U32 size, void* dst, U32 capacity) noexcept {
+    const U8* base = static_cast<const U8*>(src);
+    const U8* ip = base;
+    const U8* anchor = base;
+    const U8* end = base + size;
+
+    U8* op = static_cast<U8*>(dst);
+    U8* oend = op + capacity;
+
+    if (size > MF_LIMIT) {
+        const U8* mfLimit = end - MF_LIMIT;
+        const U8* matchLimit = end - LAST_LITERALS;
+
+        // Position within src of the last sequence seen with each hash.
+        U32 table[1 << HASH_LOG];
+        memset(table, 0, sizeof(table));
+
+        while (ip < mfLimit) {
+            U32 sequence = read32(ip);
+            U32 h = hash(sequence);
+            const U8* ref = base + table[h];
+            table[h] = static_cast<U32>(ip - base);
+
+            if (ref >= ip || ip - ref > MAX_OFFSET ||
+                read32(ref) != sequence) {
+                ip++;
+                continue;
+            }
+
+            // Extend the match backwards into the pending literals.
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+
+            const U8* mp = ip + MIN_MATCH;
+            const U8* rp = ref + MIN_MATCH;
+            while (mp < matchLimit && *mp == *rp) {
+                mp++;
+                rp++;
+            }
+
+            op = writeSequence(op, oend, anchor,
+                               static_cast<U32>(ip - anchor),
+                               static_cast<U32>(ip - ref),
+                               static_cast<U32>(mp - ip) - MIN_MATCH, false);
+            if (!op)
+                return 0;
+
+            ip = mp;
+            anchor = ip;
+        }
+    }
+
+    op = writeSequence(op, oend, anchor, static_cast<U32>(end - anchor), 0, 0,
+                       true);
+    if (!op)
+        return 0;
+
+    return static_cast<U32>(op - static_cast<U8*>(dst));
+}
+
+// Read the 255-byte continuation of a length. Returns false on overrun.
+static bool
+readLength(const U8*& ip, const U8* iend, U32& length) noexcept {
+    U8 byte;
+    do {
+        if (ip == iend)
+            return false;
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool
+lz4Decompress(const void* src, U32 srcSize, void* dst, U32 dstSize) noexcept {
+    const U8* ip = static_cast<const U8*>(src);
+    const U8* iend = ip + srcSize;
+
+    U8* base = static_cast<U8*>(dst);
+    U8* op = base;
+    U8* oend = base + dstSize;
+
+    while (ip < iend) {
+        U8 token = *ip++;
+
+        U32 litLen = token >> 4;
+        if (litLen == 15 && !readLength(ip, iend, litLen))
+            return false;
+
+        if (static_cast<Size>(iend - ip) < litLen ||
+            static_cast<Size>(oend - op) < litLen)
+            return false;
+
+        memcpy(op, ip, litLen);
+        ip += litLen;
+        op += litLen;
+
+        // The last sequence has no match.
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return false;
+        U32 offset = ip[0] | (static_cast<U32>(ip[1]) << 8);
+        ip += 2;
+
+        if (offset == 0 || static_cast<Size>(op - base) < offset)
+            return false;
+
+        U32 matchLen = token & 15;
+        if (matchLen == 15 && !readLength(ip, iend, matchLen))
+            return false;
+        matchLen += MIN_MATCH;
+
+        if (static_cast<Size>(oend - op) < matchLen)
+            return false;
+
+        const U8* match = op - offset;
+        if (offset >= matchLen) {
+            memcpy(op, match, matchLen);
+            op += matchLen;
+        }
+        else {
+            // The match overlaps the bytes being written.
+            for (U32 i = 0; i < matchLen; i++)
+                *op++ = *match++;
+        }
+    }
+
+    return op == oend;
+}
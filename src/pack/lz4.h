@@ -0,0 +1,24 @@
+#ifndef SRC_PACK_LZ4_H_
+#define SRC_PACK_LZ4_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+
+// Compression in the LZ4 block format. Compression is greedy with a single
+// hash table, which favors speed over ratio. Decompression checks every
+// length and offset against its buffers, so corrupt input is rejected rather
+// than read or written out of bounds.
+
+// Largest size that compressing size bytes can produce.
+U32
+lz4Bound(U32 size) noexcept;
+
+// Returns the compressed size, or 0 if the result does not fit in capacity.
+U32
+lz4Compress(const void* src, U32 size, void* dst, U32 capacity) noexcept;
+
+// Returns true if src decompresses to exactly dstSize bytes.
+bool
+lz4Decompress(const void* src, U32 srcSize, void* dst, U32 dstSize) noexcept;
+
+#endif  // SRC_PACK_LZ4_H_
@@ -1,4 +1,6 @@
 #include "os/os.h"
+#include "pack/area-compiler.h"
+#include "pack/file-type.h"
 #include "pack/pack-reader.h"
 #include "pack/pack-writer.h"
 #include "pack/walker.h"
@@ -18,6 +20,9 @@ usage() noexcept {
         << " create [-v] <output-archive> [input-file]...\n"
            "       "
         << exe
+        << " compile [-v] <output-archive> [input-file]...\n"
+           "       "
+        << exe
         << " list <input-archive>\n"
            "       "
         << exe << " extract [-v] <input-archive>\n";
@@ -26,6 +31,12 @@ usage() noexcept {
 
 struct CreateArchiveContext {
     PackWriter* pack;
+
+    // Replace areas with their compiled form.
+    bool compile;
+
+    // Whether every area compiled.
+    bool ok;
 };
 
 static void
@@ -39,9 +50,6 @@ addFile(CreateArchiveContext* ctx, StringView path) noexcept {
         return;
     }
 
-    if (verbose)
-        sout << "Added " << path << ": " << data.size << " bytes\n";
-
     // Write the file path to the pack file with '/' instead of '\\' on Windows.
     String standardizedPath;
 
@@ -55,6 +63,25 @@ addFile(CreateArchiveContext* ctx, StringView path) noexcept {
     path = standardizedPath;
 #endif
 
+    if (ctx->compile && determineFileType(path) == FT_TEXT) {
+        String blob;
+        CompileResult result = compileArea(path, data, blob);
+
+        if (result == COMPILE_FAILED) {
+            ctx->ok = false;
+            return;
+        }
+        if (result == COMPILE_OK) {
+            if (verbose)
+                sout << "Compiled " << path << ": " << data.size << " -> "
+                     << blob.size << " bytes\n";
+            data = static_cast<String&&>(blob);
+        }
+    }
+
+    if (verbose)
+        sout << "Added " << path << ": " << data.size << " bytes\n";
+
     packWriterAddBlob(ctx->pack, path, static_cast<U32>(data.size), data.data);
 
     data.reset();  // Don't delete data pointer.
@@ -67,13 +94,16 @@ addFileCallback(void* data, StringView path) noexcept {
 }
 
 static bool
-createArchive(StringView archivePath, Vector<StringView> paths) noexcept {
+createArchive(StringView archivePath, Vector<StringView> paths,
+              bool compile) noexcept {
     CreateArchiveContext ctx;
     ctx.pack = makePackWriter();
+    ctx.compile = compile;
+    ctx.ok = true;
 
     walk(static_cast<Vector<StringView>&&>(paths), &ctx, addFileCallback);
 
-    bool ok = packWriterWriteToFile(ctx.pack, archivePath);
+    bool ok = ctx.ok && packWriterWriteToFile(ctx.pack, archivePath);
 
     if (verbose)
         sout << "Wrote to " << archivePath << '\n';
@@ -231,7 +261,7 @@ main(I32 argc, char* argv[]) noexcept {
 
     I32 exitCode;
 
-    if (command == "create") {
+    if (command == "create" || command == "compile") {
         if (args.size > 0 && args[0] == "-v") {
             verbose = true;
             args.erase(0);
@@ -247,7 +277,8 @@ main(I32 argc, char* argv[]) noexcept {
         args.erase(0);
 
         return createArchive(archivePath,
-                             static_cast<Vector<StringView>&&>(args))
+                             static_cast<Vector<StringView>&&>(args),
+                             command == "compile")
                    ? 0
                    : 1;
     }
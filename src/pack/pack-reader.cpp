@@ -2,7 +2,9 @@
 
 #include "os/c.h"
 #include "os/io.h"
+#include "os/mapped-file.h"
 #include "pack/layout.h"
+#include "pack/lz4.h"
 #include "util/compiler.h"
 #include "util/hashtable.h"
 #include "util/int.h"
@@ -11,10 +13,27 @@
 struct PackReader {
     PackReader(File file) noexcept
         : file(static_cast<File&&>(file)),
+          mapped(false),
+          metadata(0),
+          paths(0),
           lookupsConstructed(false) { }
+    ~PackReader() noexcept {
+        if (mapped) {
+            destroyMappedFile(map);
+        }
+        else {
+            free(metadata);
+            free(paths);
+        }
+    }
 
     File file;
 
+    // When the pack file could be mapped into memory, metadata and paths
+    // point into the mapping and blobs are viewed in place.
+    bool mapped;
+    MappedFile map;
+
     HeaderSection header;
     BlobMetadata* metadata;
     char* paths;
@@ -32,6 +51,46 @@ constructLookups(PackReader* r) noexcept {
     }
 }
 
+// Point a reader's sections into a mapping of its file, if every section and
+// blob lies within it.
+static bool
+mapSections(PackReader* r, StringView path) noexcept {
+    MappedFile map;
+    if (!makeMappedFile(map, path))
+        return false;
+
+    HeaderSection& header = r->header;
+    U64 size = map.size;
+
+    U64 metadataEnd = static_cast<U64>(header.metadataOffset) +
+                      sizeof(BlobMetadata) * static_cast<U64>(header.blobCount);
+    if (header.metadataOffset % 4 != 0 || metadataEnd > size) {
+        destroyMappedFile(map);
+        return false;
+    }
+
+    BlobMetadata* metadata =
+        reinterpret_cast<BlobMetadata*>(map.data + header.metadataOffset);
+
+    for (U32 i = 0; i < header.blobCount; i++) {
+        BlobMetadata& meta = metadata[i];
+        U64 pathEnd = static_cast<U64>(header.pathsOffset) + meta.pathOffset +
+                      meta.pathSize;
+        U64 dataEnd = static_cast<U64>(header.dataOffset) + meta.dataOffset +
+                      meta.compressedSize;
+        if (pathEnd > size || dataEnd > size) {
+            destroyMappedFile(map);
+            return false;
+        }
+    }
+
+    r->mapped = true;
+    r->map = map;
+    r->metadata = metadata;
+    r->paths = map.data + header.pathsOffset;
+    return true;
+}
+
 PackReader*
 makePackReader(StringView path) noexcept {
     File file(path);
@@ -44,30 +103,33 @@ makePackReader(StringView path) noexcept {
     file.read(&header, sizeof(HeaderSection));
     if (memcmp(header.magic, PACK_MAGIC, sizeof(header.magic)) != 0)
         return 0;
-    if (header.version != PACK_VERSION)
+    if (header.version < PACK_MIN_VERSION || header.version > PACK_VERSION)
         return 0;
 
-    if (file.rem < sizeof(BlobMetadata) * header.blobCount)
+    PackReader* r = new PackReader(static_cast<File&&>(file));
+    r->header = header;
+
+    if (mapSections(r, path))
+        return r;
+
+    if (r->file.rem < sizeof(BlobMetadata) * header.blobCount) {
+        delete r;
         return 0;
-    BlobMetadata* metadata = xmalloc(BlobMetadata, header.blobCount);
-    file.read(metadata, sizeof(BlobMetadata) * header.blobCount);
+    }
+
+    r->metadata = xmalloc(BlobMetadata, header.blobCount);
+    r->file.read(r->metadata, sizeof(BlobMetadata) * header.blobCount);
 
     U32 pathsSize = 0;
     for (Size i = 0; i < header.blobCount; i++)
-        pathsSize += metadata[i].pathSize;
+        pathsSize += r->metadata[i].pathSize;
 
-    if (file.rem < pathsSize) {
-        free(metadata);
+    if (r->file.rem < pathsSize) {
+        delete r;
         return 0;
     }
-    char* paths = xmalloc(char, pathsSize);
-    file.read(paths, pathsSize);
-
-    PackReader* r = new PackReader(static_cast<File&&>(file));
-
-    r->header = header;
-    r->metadata = metadata;
-    r->paths = paths;
+    r->paths = xmalloc(char, pathsSize);
+    r->file.read(r->paths, pathsSize);
 
     return r;
 }
@@ -114,5 +176,44 @@ readerRead(PackReader* r, void* buf, U32 index) noexcept {
     U32 size = meta.compressedSize;
     U32 offset = r->header.dataOffset + meta.dataOffset;
 
-    return r->file.readOffset(buf, size, offset);
+    if (meta.compressionType == BLOB_COMPRESSION_NONE) {
+        if (r->mapped) {
+            memcpy(buf, r->map.data + offset, size);
+            return true;
+        }
+        return r->file.readOffset(buf, size, offset);
+    }
+
+    if (meta.compressionType != BLOB_COMPRESSION_LZ4)
+        return false;
+
+    if (r->mapped)
+        return lz4Decompress(r->map.data + offset, size, buf,
+                             meta.uncompressedSize);
+
+    void* compressed = malloc(size);
+    bool ok = r->file.readOffset(compressed, size, offset) &&
+              lz4Decompress(compressed, size, buf, meta.uncompressedSize);
+    free(compressed);
+    return ok;
+}
+
+bool
+readerMapped(PackReader* r) noexcept {
+    return r->mapped;
+}
+
+bool
+readerView(PackReader* r, U32 index, StringView& view) noexcept {
+    if (!r->mapped)
+        return false;
+
+    BlobMetadata meta = r->metadata[index];
+    if (meta.compressionType != BLOB_COMPRESSION_NONE)
+        return false;
+
+    U32 offset = r->header.dataOffset + meta.dataOffset;
+
+    view = StringView(r->map.data + offset, meta.compressedSize);
+    return true;
 }
@@ -29,4 +29,15 @@ readerDetails(PackReader* r, U32 index) noexcept;
 bool
 readerRead(PackReader* r, void* buf, U32 index) noexcept;
 
+// Whether the pack file is memory-mapped. A mapped reader is never written to
+// after it is made, so any number of threads may read from it at once.
+bool
+readerMapped(PackReader* r) noexcept;
+
+// If the pack file is memory-mapped and the blob is not compressed, point view
+// at the blob's bytes within the mapping, valid until the reader is destroyed.
+// Otherwise, return false, and the blob must be copied out with readerRead().
+bool
+readerView(PackReader* r, U32 index, StringView& view) noexcept;
+
 #endif  // SRC_PACK_PACK_READER_H_
@@ -1,11 +1,14 @@
 #include "pack/pack-writer.h"
 
+#include "os/c.h"
 #include "os/io.h"
 #include "pack/file-type.h"
 #include "pack/layout.h"
+#include "pack/lz4.h"
 #include "util/compiler.h"
 #include "util/int.h"
 #include "util/math2.h"
+#include "util/new.h"
 #include "util/sort.h"
 #include "util/string.h"
 #include "util/vector.h"
@@ -36,6 +39,26 @@ struct PackWriter {
     Vector<Blob> blobs;
 };
 
+// Compress a blob unless it is already compressed media or compression does
+// not make it smaller. Returns the compressed data, or 0 to store the blob
+// as-is.
+static void*
+compressBlob(Blob& blob, BlobSize& compressedSize) noexcept {
+    if (determineFileType(blob.path) == FT_COMPRESSED_MEDIA)
+        return 0;
+
+    U32 capacity = lz4Bound(blob.size);
+    void* compressed = malloc(capacity);
+
+    compressedSize = lz4Compress(blob.data, blob.size, compressed, capacity);
+    if (compressedSize == 0 || compressedSize >= blob.size) {
+        free(compressed);
+        return 0;
+    }
+
+    return compressed;
+}
+
 PackWriter*
 makePackWriter() noexcept {
     PackWriter* writer = new PackWriter();
@@ -70,6 +93,10 @@ packWriterWriteToFile(PackWriter* writer, StringView path) noexcept {
 
     BlobMetadata* metadataSection = xmalloc(BlobMetadata, blobCount);
 
+    // Data to write for each blob, if it was compressed.
+    Vector<void*> compressed;
+    compressed.resize(blobCount);
+
     PathOffset nextPathOffset = 0;
     U32 nextDataOffset = 0;
 
@@ -83,11 +110,16 @@ packWriterWriteToFile(PackWriter* writer, StringView path) noexcept {
         meta.uncompressedSize = blob.size;
         meta.compressedSize = blob.size;
         meta.compressionType = BLOB_COMPRESSION_NONE;
+        memset(meta.unused, 0, sizeof(meta.unused));
+
+        compressed[i] = compressBlob(blob, meta.compressedSize);
+        if (compressed[i])
+            meta.compressionType = BLOB_COMPRESSION_LZ4;
 
         metadataSection[i] = meta;
 
         nextPathOffset += static_cast<U32>(blob.path.size);
-        nextDataOffset += align64(blob.size);
+        nextDataOffset += align64(meta.compressedSize);
     }
 
     //
@@ -154,12 +186,14 @@ packWriterWriteToFile(PackWriter* writer, StringView path) noexcept {
         BlobMetadata& meta = metadataSection[i];
         Blob& blob = blobs[i];
 
-        f.writeOffset(blob.data, meta.uncompressedSize,
-                      dataOffset + meta.dataOffset);
+        const void* data = compressed[i] ? compressed[i] : blob.data;
+        f.writeOffset(data, meta.compressedSize, dataOffset + meta.dataOffset);
     }
 
     ok = true;
 err:
+    for (U32 i = 0; i < blobCount; i++)
+        free(compressed[i]);
     free(metadataSection);
     return ok;
 }
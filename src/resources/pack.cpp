@@ -3,16 +3,49 @@
 #include "pack/pack-reader.h"
 #include "tiles/log.h"
 #include "tiles/resources.h"
-#include "util/assert.h"
+#include "util/atomic.h"
 #include "util/compiler.h"
+#include "util/function.h"
+#include "util/hashtable.h"
 #include "util/int.h"
+#include "util/jobs.h"
 // #include "util/measure.h"
 #include "util/string-view.h"
 #include "util/string.h"
+#include "util/vector.h"
 
+// Access to pack, and to the pack reader when it is not memory-mapped.
 static Mutex mutex;
 static PackReader* pack = 0;
 
+// Why a blob could not be loaded. Loads only return this, and it is logged
+// on the main thread once something asks for the blob, so that prefetches of
+// paths that are never used, or that are not resources at all, stay quiet.
+enum LoadStatus { LOAD_OK, LOAD_MISSING, LOAD_TOO_LARGE, LOAD_CORRUPT };
+
+struct Prefetch {
+    // Counts the job until it has finished. Until then, only the job touches
+    // the fields below.
+    JobCounter running;
+    LoadStatus status;
+    StringView data;
+    String storage;
+};
+
+struct PrefetchJob {
+    String path;
+    Prefetch* prefetch;
+    void (*found)(StringView path, StringView data) noexcept;
+};
+
+// Access to prefetches.
+static Mutex prefetchMutex;
+static Hashmap<String, Prefetch*> prefetches;
+
+// Paths loaded by resourceLoad() and resourceLoadView() without having been
+// prefetched.
+static Vector<String>* recording = 0;
+
 static bool
 openPackFile() noexcept {
     if (pack)
@@ -37,38 +70,233 @@ getFullPath(StringView path) noexcept {
     return String() << dataWorldDatafile << "/" << path;
 }
 
-bool
-resourceLoad(StringView path, String& data) noexcept {
-    LockGuard lock(mutex);
-
-    if (!openPackFile())
-        return false;
-
-    U32 index = readerIndex(pack, path);
-
-    if (index == BLOB_NOT_FOUND) {
+// Log why a blob could not be loaded. Only for the main thread, since
+// logging an error may show a message box or break into a debugger.
+static bool
+report(StringView path, LoadStatus status) noexcept {
+    switch (status) {
+    case LOAD_OK: return true;
+    case LOAD_MISSING:
         logErr("PackResources", String()
                                     << getFullPath(path) << ": file missing");
-        return false;
+        break;
+    case LOAD_TOO_LARGE:
+        logErr("PackResources", String()
+                                    << getFullPath(path) << ": file too large");
+        break;
+    case LOAD_CORRUPT:
+        logErr("PackResources", String()
+                                    << getFullPath(path) << ": file corrupt");
+        break;
     }
+    return false;
+}
+
+static U32
+findBlob(StringView path) noexcept {
+    if (!openPackFile())
+        return BLOB_NOT_FOUND;
+
+    return readerIndex(pack, path);
+}
 
+static LoadStatus
+readBlob(U32 index, String& data) noexcept {
     BlobDetails details = readerDetails(pack, index);
     U32 size = details.size;
 
     // Will it fit in memory?
-    if (size > static_cast<U32>(INT32_MAX)) {
-        logErr("PackResources", String()
-                                    << getFullPath(path) << ": file too large");
-        return false;
-    }
+    if (size > static_cast<U32>(INT32_MAX))
+        return LOAD_TOO_LARGE;
 
     if (data.capacity < static_cast<Size>(size) + 1)
         data.reserve(static_cast<Size>(size) + 1);
 
-    bool ok = readerRead(pack, data.data, index);
-    assert_(ok);
+    if (!readerRead(pack, data.data, index))
+        return LOAD_CORRUPT;
 
     data.size = size;
     data.data[size] = 0;
+    return LOAD_OK;
+}
+
+// Safe on workers, so it logs nothing.
+static LoadStatus
+load(StringView path, StringView& data, String& storage) noexcept {
+    U32 index;
+
+    {
+        LockGuard lock(mutex);
+
+        index = findBlob(path);
+        if (index == BLOB_NOT_FOUND)
+            return LOAD_MISSING;
+
+        if (readerView(pack, index, data))
+            return LOAD_OK;
+
+        if (!readerMapped(pack)) {
+            LoadStatus status = readBlob(index, storage);
+            if (status == LOAD_OK)
+                data = storage.view();
+            return status;
+        }
+    }
+
+    // Copying and decompressing from the mapping can happen on many threads
+    // at once.
+    LoadStatus status = readBlob(index, storage);
+    if (status == LOAD_OK)
+        data = storage.view();
+    return status;
+}
+
+// If path was prefetched, wait for it to finish and take its data. Waiting
+// runs other jobs, perhaps this one.
+static bool
+takePrefetch(StringView path, LoadStatus& status, StringView& data,
+             String& storage) noexcept {
+    Prefetch* prefetch;
+
+    {
+        LockGuard lock(prefetchMutex);
+
+        Hashmap<String, Prefetch*>::iterator it = prefetches.find(path);
+        if (it == prefetches.end())
+            return false;
+
+        prefetch = it->value;
+        prefetches.erase(it);
+    }
+
+    JobsWait(&prefetch->running);
+
+    status = prefetch->status;
+    data = prefetch->data;
+    storage = static_cast<String&&>(prefetch->storage);
+    delete prefetch;
+    return true;
+}
+
+bool
+resourceLoad(StringView path, String& data) noexcept {
+    LoadStatus status;
+    StringView view;
+    String storage;
+
+    if (!takePrefetch(path, status, view, storage)) {
+        if (recording)
+            recording->push(path);
+
+        LockGuard lock(mutex);
+
+        U32 index = findBlob(path);
+        if (index == BLOB_NOT_FOUND)
+            return report(path, LOAD_MISSING);
+
+        return report(path, readBlob(index, data));
+    }
+
+    if (!report(path, status))
+        return false;
+
+    if (view.data == storage.data)
+        data = static_cast<String&&>(storage);
+    else
+        data = view;
     return true;
 }
+
+bool
+resourceLoadView(StringView path, StringView& data, String& storage) noexcept {
+    LoadStatus status;
+    if (takePrefetch(path, status, data, storage))
+        return report(path, status);
+
+    if (recording)
+        recording->push(path);
+
+    return report(path, load(path, data, storage));
+}
+
+static void
+runPrefetch(void* data) noexcept {
+    PrefetchJob* job = static_cast<PrefetchJob*>(data);
+    Prefetch* prefetch = job->prefetch;
+
+    prefetch->status = load(job->path, prefetch->data, prefetch->storage);
+
+    if (prefetch->status == LOAD_OK && job->found)
+        job->found(job->path, prefetch->data);
+
+    delete job;
+
+    // The last touch, as a waiting load may free the prefetch right after.
+    atomicAdd(&prefetch->running.value, -1);
+}
+
+void
+resourcePrefetch(StringView path,
+                 void (*found)(StringView path, StringView data)
+                     noexcept) noexcept {
+    Prefetch* prefetch;
+
+    {
+        LockGuard lock(prefetchMutex);
+
+        if (prefetches.contains(path))
+            return;
+
+        // Counted from now rather than from when the job is enqueued, so that
+        // a load that takes the prefetch in between waits for it.
+        prefetch = new Prefetch;
+        prefetch->status = LOAD_MISSING;
+        prefetch->running.value = 1;
+        prefetches[path] = prefetch;
+    }
+
+    PrefetchJob* job = new PrefetchJob;
+    job->path = path;
+    job->prefetch = prefetch;
+    job->found = found;
+
+    // Outside the lock, since the job may run right away on this thread and
+    // prefetch more.
+    Function fn = {runPrefetch, job};
+    JobsEnqueue(fn);
+}
+
+bool
+resourcePrefetchDone(StringView path) noexcept {
+    LockGuard lock(prefetchMutex);
+
+    Prefetch** prefetch = prefetches.tryAt(path);
+    return !prefetch || atomicLoadAcquire(&(*prefetch)->running.value) == 0;
+}
+
+void
+resourcePrefetchClear() noexcept {
+    // Running prefetches may start more, so take them one at a time.
+    for (;;) {
+        Prefetch* prefetch;
+
+        {
+            LockGuard lock(prefetchMutex);
+
+            Hashmap<String, Prefetch*>::iterator it = prefetches.begin();
+            if (it == prefetches.end())
+                return;
+
+            prefetch = it->value;
+            prefetches.erase(it);
+        }
+
+        JobsWait(&prefetch->running);
+        delete prefetch;
+    }
+}
+
+void
+resourceRecord(Vector<String>* paths) noexcept {
+    recording = paths;
+}
@@ -153,6 +153,24 @@ Animation::needsRedraw(Time now) noexcept {
     return index != data.currentIndex;
 }
 
+bool
+Animation::isAnimated() noexcept {
+    return id != NO_ANIMATION && !isSingleFrame(id);
+}
+
+Time
+Animation::nextFrameChange(Time now) noexcept {
+    assert_(id != NO_ANIMATION);
+
+    if (isSingleFrame(id))
+        return INT64_MAX;
+
+    AnimationData& data = pool[id];
+
+    Time pos = now - data.offset;
+    return now + data.frameTime - pos % data.frameTime;
+}
+
 Image
 Animation::setFrame(Time now) noexcept {
     assert_(id != NO_ANIMATION);
@@ -73,6 +73,21 @@ class Animation {
     bool
     needsRedraw(Time now) noexcept;
 
+    /**
+     * Does this Animation have more than one frame?
+     */
+    bool
+    isAnimated() noexcept;
+
+    /**
+     * Returns the earliest time after now at which the frame will change, or
+     * INT64_MAX if it never will.
+     *
+     * @now current time in milliseconds
+     */
+    Time
+    nextFrameChange(Time now) noexcept;
+
     /**
      * Returns the image that should be displayed at this time.
      *
@@ -0,0 +1,475 @@
+#include "tiles/area-blob.h"
+
+#include "data/data-world.h"
+#include "os/c.h"
+#include "pack/area-layout.h"
+#include "pack/area-parser.h"
+#include "tiles/area.h"
+#include "tiles/images.h"
+#include "tiles/log.h"
+#include "tiles/tile.h"
+#include "tiles/world.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/intern.h"
+#include "util/measure.h"
+#include "util/vector.h"
+
+#define CHECK(x)          \
+    do {                  \
+        if (!(x)) {       \
+            return false; \
+        }                 \
+    } while (false)
+
+// Where the sections of a compiled area are kept: in a blob, or in the
+// Vectors of a ParsedArea. Their sizes are in the header.
+struct AreaSections {
+    const AreaTileSet* tileSets;
+    const AreaAnimation* animations;
+    const U32* frames;
+    const AreaLayer* layers;
+    const U32* tiles;
+    const AreaFlags* flags;
+    const AreaExit* exits;
+    const AreaLayermod* layermods;
+    const AreaScript* scripts;
+    StringView strings;
+};
+
+class AreaBlob : public Area {
+ public:
+    AreaBlob(Player* player, StringView descriptor, StringView data) noexcept;
+    AreaBlob(Player* player, StringView descriptor,
+             ParsedArea& parsed) noexcept;
+
+ private:
+    void
+    init(Player* player, StringView descriptor) noexcept;
+
+    //! Find the sections of a compiled area.
+    bool
+    processBlob(StringView data) noexcept;
+
+    //! Fill in the Area from its sections.
+    bool
+    processSections() noexcept;
+    bool
+    processTileSets() noexcept;
+    bool
+    processAnimations() noexcept;
+    bool
+    processLayers() noexcept;
+    bool
+    processObjects() noexcept;
+
+    bool
+    string(AreaString s, StringView& out) noexcept;
+
+    bool
+    tileOk(I32 x, I32 y, I32 z) noexcept;
+
+ private:
+    // Only valid during construction.
+    AreaHeader header;
+    AreaSections sections;
+};
+
+bool
+isAreaBlob(StringView data) noexcept {
+    return data.size >= sizeof(AreaHeader) &&
+           memcmp(data.data, AREA_MAGIC, sizeof(AREA_MAGIC)) == 0;
+}
+
+// Whether a section of a blob is within bounds and aligned. Strings, with
+// 1-byte elements, need not be aligned.
+static bool
+sectionOk(StringView data, AreaSection s, Size elementSize) noexcept {
+    U64 end = static_cast<U64>(s.offset) +
+              static_cast<U64>(s.count) * static_cast<U64>(elementSize);
+    return (elementSize == 1 || s.offset % 4 == 0) &&
+           end <= static_cast<U64>(data.size);
+}
+
+template<typename T>
+static const T*
+section(StringView data, AreaSection s) noexcept {
+    return reinterpret_cast<const T*>(data.data + s.offset);
+}
+
+// Find a string in the string section.
+static bool
+sectionString(StringView strings, AreaString s, StringView& out) noexcept {
+    CHECK(static_cast<U64>(s.offset) + s.size <= strings.size);
+    out = strings.substr(s.offset, s.size);
+    return true;
+}
+
+bool
+areaBlobResources(StringView data, Vector<StringView>& paths) noexcept {
+    CHECK(isAreaBlob(data));
+
+    AreaHeader header;
+    memcpy(&header, data.data, sizeof(header));
+
+    CHECK(header.version == AREA_VERSION);
+
+    CHECK(sectionOk(data, header.tileSets, sizeof(AreaTileSet)));
+    CHECK(sectionOk(data, header.strings, 1));
+
+    const AreaTileSet* tileSets = section<AreaTileSet>(data, header.tileSets);
+    StringView strings =
+        data.substr(header.strings.offset, header.strings.count);
+
+    for (U32 i = 0; i < header.tileSets.count; i++) {
+        StringView image;
+        CHECK(sectionString(strings, tileSets[i].image, image));
+        paths.push(image);
+    }
+
+    if (header.hasMusic) {
+        StringView music;
+        CHECK(sectionString(strings, header.music, music));
+        if (music.size)
+            paths.push(music);
+    }
+
+    return true;
+}
+
+Area*
+makeAreaFromBlob(Player* player, StringView filename,
+                 StringView data) noexcept {
+    return new AreaBlob(player, filename, data);
+}
+
+Area*
+makeAreaFromParsed(Player* player, StringView filename,
+                   ParsedArea& parsed) noexcept {
+    return new AreaBlob(player, filename, parsed);
+}
+
+
+AreaBlob::AreaBlob(Player* player, StringView descriptor,
+                   StringView data) noexcept {
+    TimeMeasure m(String() << "Constructed " << descriptor << " as area-blob");
+
+    init(player, descriptor);
+
+    ok = processBlob(data) && processSections();
+    if (!ok)
+        logErr(descriptor, "Compiled area is malformed");
+}
+
+AreaBlob::AreaBlob(Player* player, StringView descriptor,
+                   ParsedArea& parsed) noexcept {
+    init(player, descriptor);
+
+    header = parsed.header;
+    header.tileSets.count = static_cast<U32>(parsed.tileSets.size);
+    header.animations.count = static_cast<U32>(parsed.animations.size);
+    header.frames.count = static_cast<U32>(parsed.frames.size);
+    header.layers.count = static_cast<U32>(parsed.layers.size);
+    header.tiles.count = static_cast<U32>(parsed.tiles.size);
+    header.flags.count = static_cast<U32>(parsed.flags.size);
+    header.exits.count = static_cast<U32>(parsed.exits.size);
+    header.layermods.count = static_cast<U32>(parsed.layermods.size);
+    header.scripts.count = static_cast<U32>(parsed.scripts.size);
+    header.strings.count = static_cast<U32>(parsed.strings.size);
+
+    sections.tileSets = parsed.tileSets.data;
+    sections.animations = parsed.animations.data;
+    sections.frames = parsed.frames.data;
+    sections.layers = parsed.layers.data;
+    sections.tiles = parsed.tiles.data;
+    sections.flags = parsed.flags.data;
+    sections.exits = parsed.exits.data;
+    sections.layermods = parsed.layermods.data;
+    sections.scripts = parsed.scripts.data;
+    sections.strings = parsed.strings;
+
+    // The parser has checked everything a corrupt blob could get wrong, and
+    // logged what it found. What is left logs its own errors.
+    ok = processSections();
+}
+
+void
+AreaBlob::init(Player* player, StringView descriptor) noexcept {
+    dataArea = dataWorldArea(descriptor);
+    this->player = player;
+    this->descriptor = descriptor;
+
+    // Add TileType #0. Not used, but Tiled's gids start from 1.
+    tileGraphics.resize(1);
+}
+
+bool
+AreaBlob::string(AreaString s, StringView& out) noexcept {
+    return sectionString(sections.strings, s, out);
+}
+
+bool
+AreaBlob::tileOk(I32 x, I32 y, I32 z) noexcept {
+    return 0 <= x && x < grid.dim.x && 0 <= y && y < grid.dim.y && 0 <= z &&
+           z < grid.dim.z;
+}
+
+bool
+AreaBlob::processBlob(StringView data) noexcept {
+    CHECK(isAreaBlob(data));
+
+    memcpy(&header, data.data, sizeof(header));
+
+    if (header.version != AREA_VERSION) {
+        logErr(descriptor, String() << "Compiled area is version "
+                                    << header.version << ", expected "
+                                    << AREA_VERSION);
+        return false;
+    }
+
+    CHECK(sectionOk(data, header.tileSets, sizeof(AreaTileSet)));
+    CHECK(sectionOk(data, header.animations, sizeof(AreaAnimation)));
+    CHECK(sectionOk(data, header.frames, sizeof(U32)));
+    CHECK(sectionOk(data, header.layers, sizeof(AreaLayer)));
+    CHECK(sectionOk(data, header.tiles, sizeof(U32)));
+    CHECK(sectionOk(data, header.flags, sizeof(AreaFlags)));
+    CHECK(sectionOk(data, header.exits, sizeof(AreaExit)));
+    CHECK(sectionOk(data, header.layermods, sizeof(AreaLayermod)));
+    CHECK(sectionOk(data, header.scripts, sizeof(AreaScript)));
+    CHECK(sectionOk(data, header.strings, 1));
+
+    // The grid divides pixel positions by these.
+    CHECK(header.tileWidth > 0 && header.tileHeight > 0);
+
+    sections.tileSets = section<AreaTileSet>(data, header.tileSets);
+    sections.animations = section<AreaAnimation>(data, header.animations);
+    sections.frames = section<U32>(data, header.frames);
+    sections.layers = section<AreaLayer>(data, header.layers);
+    sections.tiles = section<U32>(data, header.tiles);
+    sections.flags = section<AreaFlags>(data, header.flags);
+    sections.exits = section<AreaExit>(data, header.exits);
+    sections.layermods = section<AreaLayermod>(data, header.layermods);
+    sections.scripts = section<AreaScript>(data, header.scripts);
+    sections.strings =
+        data.substr(header.strings.offset, header.strings.count);
+
+    return true;
+}
+
+bool
+AreaBlob::processSections() noexcept {
+    StringView name_;
+    CHECK(string(header.name, name_));
+    name = name_;
+
+    if (header.hasMusic) {
+        StringView music;
+        CHECK(string(header.music, music));
+        musicPath = music;
+        if (musicPath == "")
+            musicPath << StringView("\0", 1);
+    }
+
+    grid.loopX = header.loopX != 0;
+    grid.loopY = header.loopY != 0;
+    colorOverlayARGB = header.colorOverlayARGB;
+
+    CHECK(0 <= header.width && header.width <= 0x7FFF);
+    CHECK(0 <= header.height && header.height <= 0x7FFF);
+
+    grid.dim.x = header.width;
+    grid.dim.y = header.height;
+    grid.dim.z = 0;
+
+    grid.tileDim.x = header.tileWidth;
+    grid.tileDim.y = header.tileHeight;
+
+    CHECK(processTileSets());
+    CHECK(processAnimations());
+    CHECK(processLayers());
+    CHECK(processObjects());
+
+    return true;
+}
+
+bool
+AreaBlob::processTileSets() noexcept {
+    const AreaTileSet* tileSets_ = sections.tileSets;
+
+    for (U32 i = 0; i < header.tileSets.count; i++) {
+        const AreaTileSet& ts = tileSets_[i];
+
+        StringView image;
+        CHECK(string(ts.image, image));
+        CHECK(ts.firstGid == tileGraphics.size);
+        CHECK(0 < ts.tileWidth && ts.tileWidth <= 0x7FFF);
+        CHECK(0 < ts.tileHeight && ts.tileHeight <= 0x7FFF);
+
+        TileSet tileSet = {ts.firstGid, ts.numAcross, ts.numHigh};
+        tileSets[intern(image)] = tileSet;
+
+        TiledImage images = tilesLoad(image, ts.tileWidth, ts.tileHeight,
+                                      ts.numAcross, ts.numHigh);
+        if (!TILES_VALID(images)) {
+            logErr(descriptor, "Tileset image not found");
+            return false;
+        }
+        tileSetImages.push(images);
+
+        U32 nTiles = images.numTiles;
+        tileGraphics.reserve(tileGraphics.size + nTiles);
+
+        for (U32 j = 0; j < nTiles; j++)
+            tileGraphics.push(Animation(tileAt(images, j)));
+    }
+
+    return true;
+}
+
+bool
+AreaBlob::processAnimations() noexcept {
+    const AreaAnimation* animations = sections.animations;
+    const U32* frames = sections.frames;
+
+    Time now = worldTime();
+
+    for (U32 i = 0; i < header.animations.count; i++) {
+        const AreaAnimation& a = animations[i];
+
+        CHECK(a.gid < tileGraphics.size);
+        CHECK(a.tileSet < tileSetImages.size);
+        CHECK(static_cast<U64>(a.firstFrame) + a.frameCount <=
+              header.frames.count);
+        CHECK(a.frameCount > 0);
+        CHECK(a.frameLen > 0);
+
+        TiledImage images = tileSetImages[a.tileSet];
+
+        Vector<Image> framesvec;
+        framesvec.reserve(a.frameCount);
+
+        for (U32 j = 0; j < a.frameCount; j++) {
+            U32 idx = frames[a.firstFrame + j];
+            CHECK(idx < images.numTiles);
+            framesvec.push(tileAt(images, idx));
+        }
+
+        Animation& graphic = tileGraphics[a.gid];
+        graphic = Animation(static_cast<Vector<Image>&&>(framesvec),
+                            a.frameLen);
+        graphic.restart(now);
+    }
+
+    return true;
+}
+
+bool
+AreaBlob::processLayers() noexcept {
+    const AreaLayer* layers = sections.layers;
+
+    CHECK(header.layers.count == static_cast<U32>(header.depth));
+
+    Size layerSize = static_cast<Size>(grid.dim.x * grid.dim.y);
+    CHECK(header.tiles.count == layerSize * header.layers.count);
+
+    for (U32 i = 0; i < header.layers.count; i++) {
+        float depth = layers[i].depth;
+
+        if (grid.depth2idx.contains(depth)) {
+            logErr(descriptor, "Layers cannot share a depth");
+            return false;
+        }
+
+        grid.layerTypes.push(layers[i].type == AREA_TILE_LAYER
+                                 ? TileGrid::TILE_LAYER
+                                 : TileGrid::OBJECT_LAYER);
+        grid.depth2idx[depth] = static_cast<I32>(i);
+        grid.idx2depth.push(depth);
+        grid.dim.z++;
+    }
+
+    // The compiler checked every gid against its tilesets, so only the largest
+    // needs to be checked against ours.
+    if (header.maxGid >= tileGraphics.size) {
+        logErr(descriptor, "Invalid tile gid");
+        return false;
+    }
+
+    if (header.tiles.count) {
+        grid.graphics.reserve(header.tiles.count);
+        grid.graphics.size = header.tiles.count;
+        memcpy(grid.graphics.data, sections.tiles,
+               header.tiles.count * sizeof(U32));
+    }
+
+    return true;
+}
+
+bool
+AreaBlob::processObjects() noexcept {
+    const AreaFlags* flags = sections.flags;
+    const AreaExit* exits = sections.exits;
+    const AreaLayermod* layermods = sections.layermods;
+    const AreaScript* scripts = sections.scripts;
+
+    for (U32 i = 0; i < header.flags.count; i++) {
+        const AreaFlags& f = flags[i];
+        CHECK(tileOk(f.x, f.y, f.z));
+
+        ivec3 tile = {f.x, f.y, f.z};
+        grid.addTileFlags(tile, f.flags & (TILE_NOWALK | TILE_NOWALK_PLAYER |
+                                           TILE_NOWALK_NPC));
+    }
+
+    for (U32 i = 0; i < header.exits.count; i++) {
+        const AreaExit& e = exits[i];
+        CHECK(tileOk(e.x, e.y, e.z));
+        CHECK(e.direction < EXITS_LENGTH);
+
+        StringView area;
+        CHECK(string(e.area, area));
+
+        Exit exit;
+        exit.area = intern(area);
+        exit.coords.x = e.destX;
+        exit.coords.y = e.destY;
+        exit.coords.z = e.destZ;
+
+        ivec3 tile = {e.x, e.y, e.z};
+        grid.exits[e.direction][tile] = static_cast<Exit&&>(exit);
+    }
+
+    for (U32 i = 0; i < header.layermods.count; i++) {
+        const AreaLayermod& l = layermods[i];
+        CHECK(tileOk(l.x, l.y, l.z));
+        CHECK(l.direction < EXITS_LENGTH);
+
+        ivec3 tile = {l.x, l.y, l.z};
+        grid.layermods[l.direction][tile] = l.depth;
+    }
+
+    for (U32 i = 0; i < header.scripts.count; i++) {
+        const AreaScript& s = scripts[i];
+        CHECK(tileOk(s.x, s.y, s.z));
+        CHECK(s.type < TileGrid::SCRIPT_TYPE_LAST);
+
+        StringView scriptName;
+        CHECK(string(s.name, scriptName));
+
+        if (!dataArea || !dataArea->scripts.tryAt(scriptName)) {
+            logErr(descriptor, String() << "Script " << scriptName
+                                        << " not found");
+            return false;
+        }
+
+        // For some reason, Visual Studio 2015 and up widen a void (*) noexcept
+        // to a void (*), which has no noexcept qualifier. It suggests a
+        // reinterpret_cast to bring back the noexcept.
+        ivec3 tile = {s.x, s.y, s.z};
+        grid.scripts[s.type][tile] =
+            reinterpret_cast<void (*)(DataArea*, Entity*, ivec3) noexcept>(
+                *dataArea->scripts.tryAt(scriptName));
+    }
+
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef SRC_TILES_AREA_BLOB_H_
+#define SRC_TILES_AREA_BLOB_H_
+
+#include "util/compiler.h"
+#include "util/string-view.h"
+#include "util/vector.h"
+
+class Area;
+class Player;
+struct ParsedArea;
+
+//! Whether a resource holds an area compiled by "pack-tool compile" rather
+//! than Tiled JSON.
+bool
+isAreaBlob(StringView data) noexcept;
+
+//! Find the tileset images and music that a compiled area refers to, without
+//! loading it. Returns false if the blob is malformed.
+bool
+areaBlobResources(StringView data, Vector<StringView>& paths) noexcept;
+
+//! Load an area compiled by "pack-tool compile".
+Area*
+makeAreaFromBlob(Player* player, StringView filename, StringView data) noexcept;
+
+//! Load an area that parseArea() read from Tiled JSON. The area is only used
+//! during the call.
+Area*
+makeAreaFromParsed(Player* player, StringView filename,
+                   ParsedArea& parsed) noexcept;
+
+#endif  // SRC_TILES_AREA_BLOB_H_
@@ -3,11 +3,14 @@
 
 #include "util/compiler.h"
 #include "util/string-view.h"
+#include "util/string.h"
 
 class Area;
 class Player;
 
+//! Load a Tiled JSON area. Returns null, with an error logged, if it is
+//! malformed.
 Area*
-makeAreaFromJSON(Player* player, StringView filename) noexcept;
+makeAreaFromJSON(Player* player, StringView filename, String json) noexcept;
 
 #endif  // SRC_TILES_AREA_JSON_H_
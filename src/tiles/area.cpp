@@ -17,15 +17,43 @@
 #include "util/algorithm.h"
 #include "util/assert.h"
 #include "util/compiler.h"
+#include "util/intern.h"
 #include "util/math2.h"
+#include "util/profile.h"
+
+static ProfileZone tickZone("Area::tick");
+static ProfileZone needsRedrawZone("Area::needsRedraw");
+static ProfileZone drawTilesZone("Area::drawTiles");
+static ProfileZone drawEntitiesZone("Area::drawEntities");
+
+// Added to the Entity::drawOrder of Overlays so they are drawn over the NPCs on
+// their layer.
+#define OVERLAY_DRAW_ORDER 0x80000000u
 
 Area::Area() noexcept
     : ok(true),
+      animatedTypesFound(false),
+      animatedWords(0),
+      animationTilesVersion(0),
+      animationDeadline(0),
+      entitiesSpawned(0),
       beenFocused(false),
       redraw(true),
       colorOverlayARGB(0),
       dataArea(0),
-      player(0) { }
+      player(0) {
+    entityGrid.tiles = &grid;
+}
+
+Area::~Area() noexcept {
+    for (Character** c = characters.begin(); c != characters.end(); c++)
+        delete *c;
+    for (Overlay** o = overlays.begin(); o != overlays.end(); o++)
+        delete *o;
+    for (TiledImage* images = tileSetImages.begin();
+         images != tileSetImages.end(); images++)
+        tilesRelease(*images);
+}
 
 void
 Area::focus() noexcept {
@@ -107,6 +135,12 @@ Area::draw(DisplayList* display) noexcept {
     assert_(tiles.z1 == 0);
     assert_(tiles.z2 == maxZ);
 
+    findAnimatedTypes();
+
+    Time now = worldTime();
+    for (Size i = 0; i < animatedTypes.size; i++)
+        animatedFrames[i] = tileGraphics[animatedTypes[i]].setFrame(now);
+
     for (I32 z = 0; z < maxZ; z++) {
         switch (grid.layerTypes[z]) {
         case TileGrid::TILE_LAYER: drawTiles(display, tiles, z); break;
@@ -117,60 +151,214 @@ Area::draw(DisplayList* display) noexcept {
     redraw = false;
 }
 
+icube
+Area::tilePixels(icube& tiles) noexcept {
+    icube pixels = {
+        tiles.x1 * grid.tileDim.x, tiles.y1 * grid.tileDim.y, tiles.z1,
+        tiles.x2 * grid.tileDim.x, tiles.y2 * grid.tileDim.y, tiles.z2,
+    };
+    return pixels;
+}
+
 bool
 Area::needsRedraw() noexcept {
+    ProfileScope scope(needsRedrawZone);
+
     if (redraw)
         return true;
 
     icube tiles = visibleTiles();
-    icube pixels = {
-        tiles.x1 * grid.tileDim.x, tiles.y1 * grid.tileDim.y, tiles.z1,
-        tiles.x2 * grid.tileDim.x, tiles.y2 * grid.tileDim.y, tiles.z2,
-    };
+    icube pixels = tilePixels(tiles);
 
     if (player->needsRedraw(pixels))
         return true;
-    for (Character** character = characters.begin();
-         character != characters.end(); character++) {
-        if ((*character)->needsRedraw(pixels))
-            return true;
-    }
-    for (Overlay** overlay = overlays.begin(); overlay != overlays.end();
-         overlay++) {
-        if ((*overlay)->needsRedraw(pixels))
+
+    nearbyEntities.clear();
+    entityGrid.query(pixels, nearbyEntities);
+    for (Entity** entity = nearbyEntities.begin();
+         entity != nearbyEntities.end(); entity++) {
+        if ((*entity)->needsRedraw(pixels))
             return true;
     }
 
     // Do any on-screen tile types need to update their animations?
-    if (tileGraphics.size > checkedForAnimation.size)
-        checkedForAnimation.resize(tileGraphics.size);
-    memset(checkedForAnimation.data, 0, checkedForAnimation.size);
+    return tilesNeedRedraw(tiles);
+}
+
+static bool
+operator==(const icube& a, const icube& b) noexcept {
+    return a.x1 == b.x1 && a.y1 == b.y1 && a.z1 == b.z1 && a.x2 == b.x2 &&
+           a.y2 == b.y2 && a.z2 == b.z2;
+}
+
+void
+Area::findAnimatedTypes() noexcept {
+    if (animatedTypesFound)
+        return;
+    animatedTypesFound = true;
+
+    animatedIndex.resize(tileGraphics.size);
+    for (Size type = 0; type < tileGraphics.size; type++) {
+        if (tileGraphics[type].isAnimated()) {
+            animatedIndex[type] = static_cast<U32>(animatedTypes.size);
+            animatedTypes.push(static_cast<U32>(type));
+        }
+        else {
+            animatedIndex[type] = UINT32_MAX;
+        }
+    }
+
+    animatedFrames.resize(animatedTypes.size);
+
+    animatedWords = (animatedTypes.size + 31) / 32;
+    visibleAnimated.resize(animatedWords);
+}
+
+icube
+Area::chunksContaining(icube& tiles) noexcept {
+    I32 x1 = bound(tiles.x1, 0, grid.dim.x);
+    I32 y1 = bound(tiles.y1, 0, grid.dim.y);
+    I32 x2 = bound(tiles.x2, 0, grid.dim.x);
+    I32 y2 = bound(tiles.y2, 0, grid.dim.y);
+
+    if (x1 == x2 || y1 == y2) {
+        icube none = {0, 0, tiles.z1, 0, 0, tiles.z2};
+        return none;
+    }
+
+    icube chunks = {
+        x1 >> TILE_CHUNK_SHIFT,
+        y1 >> TILE_CHUNK_SHIFT,
+        tiles.z1,
+        ((x2 - 1) >> TILE_CHUNK_SHIFT) + 1,
+        ((y2 - 1) >> TILE_CHUNK_SHIFT) + 1,
+        tiles.z2,
+    };
+    return chunks;
+}
+
+bool
+Area::tilesNeedRedraw(icube& tiles) noexcept {
+    findAnimatedTypes();
+
+    if (animatedTypes.size == 0 || tiles.x1 == tiles.x2 || tiles.y1 == tiles.y2)
+        return false;
 
     Time now = worldTime();
 
+    bool unchanged = tiles == animationWindow &&
+                     grid.tilesVersion == animationTilesVersion;
+    if (unchanged && now < animationDeadline)
+        return false;
+
+    animationDeadline = 0;
+
+    // Collect the animated types of every visible chunk.
+    ivec3 chunks = grid.chunkDim();
+    icube visible = chunksContaining(tiles);
+
+    I32 cx1 = visible.x1;
+    I32 cx2 = visible.x2;
+    I32 cy1 = visible.y1;
+    I32 cy2 = visible.y2;
+
+    // Looping maps can show any part of the grid, so check all their chunks.
+    if (grid.loopX) {
+        cx1 = 0;
+        cx2 = chunks.x;
+    }
+    if (grid.loopY) {
+        cy1 = 0;
+        cy2 = chunks.y;
+    }
+
+    memset(visibleAnimated.data, 0, animatedWords * sizeof(U32));
+
     for (I32 z = tiles.z1; z < tiles.z2; z++) {
         if (grid.layerTypes[z] != TileGrid::TILE_LAYER)
             continue;
-        for (I32 y = tiles.y1; y < tiles.y2; y++) {
-            for (I32 x = tiles.x1; x < tiles.x2; x++) {
-                ivec3 coord = {x, y, z};
-                I32 type = grid.getTileType(coord);
+        for (I32 cy = cy1; cy < cy2; cy++) {
+            for (I32 cx = cx1; cx < cx2; cx++) {
+                Size chunk =
+                    static_cast<Size>((z * chunks.y + cy) * chunks.x + cx);
+                U32* types = chunkAnimatedTypes(chunk);
+                for (Size i = 0; i < animatedWords; i++)
+                    visibleAnimated[i] |= types[i];
+            }
+        }
+    }
 
-                if (type == 0)
-                    continue;
+    // Check only the animated types that are visible.
+    Time deadline = INT64_MAX;
 
-                if (checkedForAnimation[type])
-                    continue;
-                checkedForAnimation[type] = true;
+    for (Size word = 0; word < animatedWords; word++) {
+        for (U32 bits = visibleAnimated[word]; bits; bits &= bits - 1) {
+            Size bit = 0;
+            while (!(bits & (1u << bit)))
+                bit++;
 
-                if (tileGraphics[type].needsRedraw(now))
-                    return true;
-            }
+            Animation& graphic = tileGraphics[animatedTypes[word * 32 + bit]];
+
+            if (graphic.needsRedraw(now))
+                return true;
+
+            deadline = min(deadline, graphic.nextFrameChange(now));
         }
     }
+
+    animationWindow = tiles;
+    animationTilesVersion = grid.tilesVersion;
+    animationDeadline = deadline;
+
     return false;
 }
 
+U32*
+Area::chunkAnimatedTypes(Size chunk) noexcept {
+    if (chunkAnimatedVersions.size == 0) {
+        ivec3 chunks = grid.chunkDim();
+        Size chunkCount = static_cast<Size>(chunks.x * chunks.y * chunks.z);
+
+        chunkAnimated.resize(chunkCount * animatedWords);
+        chunkAnimatedVersions.resize(chunkCount);
+        memset(chunkAnimatedVersions.data, 0, chunkCount * sizeof(U32));
+    }
+
+    U32* types = chunkAnimated.data + chunk * animatedWords;
+
+    U32 version = grid.chunkVersion(chunk) + 1;
+    if (chunkAnimatedVersions[chunk] == version)
+        return types;
+    chunkAnimatedVersions[chunk] = version;
+
+    memset(types, 0, animatedWords * sizeof(U32));
+
+    ivec3 chunks = grid.chunkDim();
+    I32 cx = static_cast<I32>(chunk % static_cast<Size>(chunks.x));
+    I32 cy = static_cast<I32>(chunk / static_cast<Size>(chunks.x) %
+                              static_cast<Size>(chunks.y));
+    I32 z = static_cast<I32>(chunk / static_cast<Size>(chunks.x * chunks.y));
+
+    I32 x1 = cx << TILE_CHUNK_SHIFT;
+    I32 y1 = cy << TILE_CHUNK_SHIFT;
+    I32 x2 = min(x1 + TILE_CHUNK_SIZE, grid.dim.x);
+    I32 y2 = min(y1 + TILE_CHUNK_SIZE, grid.dim.y);
+
+    for (I32 y = y1; y < y2; y++) {
+        for (I32 x = x1; x < x2; x++) {
+            ivec3 coord = {x, y, z};
+            U32 type = grid.getTileType(coord);
+
+            U32 index = type < animatedIndex.size ? animatedIndex[type]
+                                                  : UINT32_MAX;
+            if (index != UINT32_MAX)
+                types[index / 32] |= 1u << (index % 32);
+        }
+    }
+
+    return types;
+}
+
 void
 Area::requestRedraw() noexcept {
     redraw = true;
@@ -193,6 +381,8 @@ isOverlayDead(Overlay* o) noexcept {
 
 void
 Area::tick(Time dt) noexcept {
+    ProfileScope scope(tickZone);
+
     if (dataArea)
         dataArea->tick(dt);
 
@@ -200,7 +390,6 @@ Area::tick(Time dt) noexcept {
          overlay++) {
         (*overlay)->tick(dt);
     }
-    erase_if(overlays, isOverlayDead);
 
     if (confMoveMode != TURN) {
         player->tick(dt);
@@ -209,9 +398,15 @@ Area::tick(Time dt) noexcept {
              character != characters.end(); character++) {
             (*character)->tick(dt);
         }
-        erase_if(characters, isCharacterDead);
     }
 
+    // Move every moving Entity at once, then run their arrived() callbacks.
+    motion.tick(dt);
+
+    erase_if(overlays, isOverlayDead);
+    if (confMoveMode != TURN)
+        erase_if(characters, isCharacterDead);
+
     viewportTick(dt);
 }
 
@@ -247,11 +442,11 @@ Area::setColorOverlay(U8 a, U8 r, U8 g, U8 b) noexcept {
 
 TileSet*
 Area::getTileSet(StringView imagePath) noexcept {
-    if (!tileSets.contains(imagePath)) {
+    Symbol name = internFind(imagePath);
+    TileSet* tileSet = name == Symbol() ? 0 : tileSets.tryAt(name);
+    if (!tileSet)
         logErr("Area", String() << "tileset " << imagePath << " not found");
-        return 0;
-    }
-    return &tileSets[imagePath];
+    return tileSet;
 }
 
 
@@ -294,6 +489,8 @@ Area::spawnNPC(StringView descriptor_, vicoord coord,
         return 0;
     }
     c->setArea(this, coord);
+    c->drawOrder = entitiesSpawned++;
+    entityGrid.insert(c);
     characters.push(c);
     return c;
 }
@@ -309,6 +506,8 @@ Area::spawnOverlay(StringView descriptor_, vicoord coord,
     }
     o->setArea(this);
     o->teleport(coord);
+    o->drawOrder = OVERLAY_DRAW_ORDER | entitiesSpawned++;
+    entityGrid.insert(o);
     overlays.push(o);
     return o;
 }
@@ -319,6 +518,52 @@ Area::getDataArea() noexcept {
     return dataArea;
 }
 
+template<typename T>
+static Size
+bytes(Vector<T>& v) noexcept {
+    return v.capacity * sizeof(T);
+}
+
+template<typename K, typename V, typename E>
+static Size
+bytes(Hashmap<K, V, E>& h) noexcept {
+    return h.capacity * sizeof(*h.data);
+}
+
+Size
+Area::memoryUsage() noexcept {
+    Size total = sizeof(*this);
+
+    total += bytes(grid.graphics) + bytes(grid.chunkVersions) +
+             bytes(grid.layerTypes) + bytes(grid.idx2depth) +
+             bytes(grid.depth2idx) + bytes(grid.sparseFlags);
+    for (Size i = 0; i < TILE_FLAG_PLANES; i++)
+        total += bytes(grid.flagPlanes[i]);
+    for (Size i = 0; i < TileGrid::SCRIPT_TYPE_LAST; i++)
+        total += bytes(grid.scripts[i]);
+    for (Size i = 0; i < EXITS_LENGTH; i++)
+        total += bytes(grid.exits[i]) + bytes(grid.layermods[i]);
+
+    total += bytes(tileSets) + bytes(tileSetImages) + bytes(tileGraphics);
+
+    total += bytes(animatedTypes) + bytes(animatedFrames) +
+             bytes(animatedIndex) + bytes(chunkAnimated) +
+             bytes(chunkAnimatedVersions) + bytes(visibleAnimated);
+
+    total += bytes(chunkMeshes);
+    for (TileChunkMesh* mesh = chunkMeshes.begin(); mesh != chunkMeshes.end();
+         mesh++) {
+        total += bytes(mesh->items) + bytes(mesh->columns) +
+                 bytes(mesh->animatedItems) + bytes(mesh->animatedIndices);
+    }
+
+    total += bytes(characters) + bytes(overlays) + motion.memoryUsage() +
+             entityGrid.memoryUsage() + bytes(nearbyEntities) +
+             flowFields.memoryUsage();
+
+    return total;
+}
+
 void
 Area::runScript(TileGrid::ScriptType type, ivec3 tile,
                 Entity* triggeredBy) noexcept {
@@ -330,32 +575,106 @@ Area::runScript(TileGrid::ScriptType type, ivec3 tile,
 
 void
 Area::drawTiles(DisplayList* display, icube& tiles, I32 z) noexcept {
+    ProfileScope scope(drawTilesZone);
+
     Vector<DisplayItem>& items = display->items;
 
-    Time now = worldTime();
+    icube chunks = chunksContaining(tiles);
 
-    // FIXME: Same.
-    if (tileGraphics.size > tilesAnimated.size)
-        tilesAnimated.resize(tileGraphics.size);
+    for (I32 cy = chunks.y1; cy < chunks.y2; cy++) {
+        for (I32 cx = chunks.x1; cx < chunks.x2; cx++) {
+            TileChunkMesh& mesh = chunkMesh(cx, cy, z);
 
-    // FIXME: Only do this once per draw() call. Don't do it per drawTiles.
-    memset(tilesAnimated.data, 0, tilesAnimated.size);
+            // Bring animated tiles up to date with the frames chosen in
+            // draw().
+            for (Size i = 0; i < mesh.animatedItems.size; i++) {
+                DisplayItem& item = mesh.items[mesh.animatedItems[i]];
+                item.image = animatedFrames[mesh.animatedIndices[i]];
+            }
+
+            // Visible part of the chunk, in tiles relative to its corner.
+            I32 x0 = cx << TILE_CHUNK_SHIFT;
+            I32 y0 = cy << TILE_CHUNK_SHIFT;
+            I32 rx1 = max(tiles.x1 - x0, 0);
+            I32 ry1 = max(tiles.y1 - y0, 0);
+            I32 rx2 = min(tiles.x2 - x0, TILE_CHUNK_SIZE);
+            I32 ry2 = min(tiles.y2 - y0, TILE_CHUNK_SIZE);
+
+            Size first = mesh.rowStarts[ry1];
+            Size last = mesh.rowStarts[ry2];
+
+            if (first == last)
+                continue;
+
+            if (items.size + (last - first) > items.capacity)
+                items.reserve(max(items.size + (last - first),
+                                  items.capacity * 2));
+
+            DisplayItem* out = items.data + items.size;
+
+            if (rx1 == 0 && rx2 == TILE_CHUNK_SIZE) {
+                // Every column is visible, so the rows are contiguous.
+                memcpy(out, mesh.items.data + first,
+                       (last - first) * sizeof(DisplayItem));
+                out += last - first;
+            }
+            else {
+                for (Size i = first; i < last; i++) {
+                    I32 column = mesh.columns[i];
+                    if (rx1 <= column && column < rx2)
+                        *out++ = mesh.items[i];
+                }
+            }
+
+            items.size = static_cast<Size>(out - items.data);
+        }
+    }
+}
+
+TileChunkMesh&
+Area::chunkMesh(I32 cx, I32 cy, I32 z) noexcept {
+    ivec3 chunks = grid.chunkDim();
+
+    if (chunkMeshes.size == 0) {
+        Size chunkCount = static_cast<Size>(chunks.x * chunks.y * chunks.z);
+        chunkMeshes.resize(chunkCount);
+        for (Size i = 0; i < chunkCount; i++)
+            chunkMeshes[i].version = 0;
+    }
 
-    Size maxTiles = (tiles.y2 - tiles.y1) * (tiles.x2 - tiles.x1);
-    Size itemCount = items.size;
+    Size chunk = static_cast<Size>((z * chunks.y + cy) * chunks.x + cx);
+    TileChunkMesh& mesh = chunkMeshes[chunk];
 
-    // FIXME: Resize once before any drawTiles calls.
-    //        Do maxTiles * count(TILE_LAYERS).
-    items.resize(maxTiles + itemCount);
+    U32 version = grid.chunkVersion(chunk) + 1;
+    if (mesh.version == version)
+        return mesh;
+    mesh.version = version;
+
+    mesh.items.clear();
+    mesh.columns.clear();
+    mesh.animatedItems.clear();
+    mesh.animatedIndices.clear();
 
     float depth = grid.idx2depth[(Size)z];
 
     I32 width = grid.tileDim.x;
     I32 height = grid.tileDim.y;
 
-    for (I32 y = tiles.y1; y < tiles.y2; y++) {
-        for (I32 x = tiles.x1; x < tiles.x2; x++) {
-            // We are certain the Tile exists.
+    I32 x0 = cx << TILE_CHUNK_SHIFT;
+    I32 y0 = cy << TILE_CHUNK_SHIFT;
+    I32 w = min(grid.dim.x - x0, TILE_CHUNK_SIZE);
+    I32 h = min(grid.dim.y - y0, TILE_CHUNK_SIZE);
+
+    for (I32 ry = 0; ry < TILE_CHUNK_SIZE; ry++) {
+        mesh.rowStarts[ry] = static_cast<U16>(mesh.items.size);
+
+        if (ry >= h)
+            continue;
+
+        for (I32 rx = 0; rx < w; rx++) {
+            I32 x = x0 + rx;
+            I32 y = y0 + ry;
+
             ivec3 coord = {x, y, z};
             U32 type = grid.getTileType(coord);
 
@@ -365,9 +684,10 @@ Area::drawTiles(DisplayList* display, icube& tiles, I32 z) noexcept {
             if (tileGraphics[type].id == NO_ANIMATION)
                 continue;
 
-            if (!tilesAnimated[type]) {
-                tilesAnimated[type] = true;
-                tileGraphics[type].setFrame(now);
+            U32 animated = animatedIndex[type];
+            if (animated != UINT32_MAX) {
+                mesh.animatedItems.push(static_cast<U32>(mesh.items.size));
+                mesh.animatedIndices.push(animated);
             }
 
             // Image guaranteed to exist because Animation won't hold a null
@@ -378,29 +698,44 @@ Area::drawTiles(DisplayList* display, icube& tiles, I32 z) noexcept {
             // drawPos.z = depth + drawPos.y / tileDimY *
             // ISOMETRIC_ZOFF_PER_TILE;
             DisplayItem item = {img, drawPos};
-            items[itemCount++] = item;
+            mesh.items.push(item);
+            mesh.columns.push(static_cast<U8>(rx));
         }
     }
+    mesh.rowStarts[TILE_CHUNK_SIZE] = static_cast<U16>(mesh.items.size);
 
-    items.size = itemCount;
+    return mesh;
 }
 
 void
 Area::drawEntities(DisplayList* display, icube& tiles, I32 z) noexcept {
-    float depth = grid.idx2depth[(Size)z];
+    ProfileScope scope(drawEntitiesZone);
 
-    for (Character** character = characters.begin();
-         character != characters.end(); character++) {
-        if ((*character)->getTileCoords_i().z == z)
-            (*character)->draw(display);
-    }
+    icube pixels = tilePixels(tiles);
+    pixels.z1 = z;
+    pixels.z2 = z + 1;
 
-    for (Overlay** overlay = overlays.begin(); overlay != overlays.end();
-         overlay++) {
-        if ((*overlay)->getPixelCoord().z == depth)
-            (*overlay)->draw(display);
+    nearbyEntities.clear();
+    entityGrid.query(pixels, nearbyEntities);
+
+    // Keep the on-screen Entities, sorted into the order they were spawned.
+    // There are usually few enough that an insertion sort is fastest.
+    Size visible = 0;
+    for (Size i = 0; i < nearbyEntities.size; i++) {
+        Entity* entity = nearbyEntities[i];
+        if (!entity->inView(pixels))
+            continue;
+
+        Size j = visible++;
+        for (; j > 0 && nearbyEntities[j - 1]->drawOrder > entity->drawOrder;
+             j--)
+            nearbyEntities[j] = nearbyEntities[j - 1];
+        nearbyEntities[j] = entity;
     }
 
+    for (Size i = 0; i < visible; i++)
+        nearbyEntities[i]->draw(display);
+
     if (player->getTileCoords_i().z == z)
         player->draw(display);
 }
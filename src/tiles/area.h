@@ -2,17 +2,21 @@
 #define SRC_TILES_AREA_H_
 
 #include "tiles/animation.h"
+#include "tiles/display-list.h"
+#include "tiles/entity-grid.h"
+#include "tiles/motion.h"
+#include "tiles/pathfinding.h"
 #include "tiles/tile-grid.h"
 #include "tiles/tile.h"
 #include "tiles/vec.h"
 #include "tiles/window.h"
 #include "util/compiler.h"
 #include "util/hashtable.h"
+#include "util/intern.h"
 #include "util/string-view.h"
 #include "util/string.h"
 #include "util/vector.h"
 
-class AreaJSON;
 class Character;
 class DataArea;
 struct DisplayList;
@@ -20,6 +24,25 @@ class Entity;
 class Overlay;
 class Player;
 
+// The DisplayItems for one chunk of one tile layer. Kept across frames until
+// the chunk is changed by TileGrid::setTileType().
+struct TileChunkMesh {
+    // Row y of the chunk is items[rowStarts[y], rowStarts[y + 1]).
+    Vector<DisplayItem> items;
+    U16 rowStarts[TILE_CHUNK_SIZE + 1];
+
+    // Column within the chunk of each item.
+    Vector<U8> columns;
+
+    // Items showing an animated tile type, and that type's index in
+    // Area::animatedTypes.
+    Vector<U32> animatedItems;
+    Vector<U32> animatedIndices;
+
+    // TileGrid::chunkVersion() + 1 when built, or 0 if not built.
+    U32 version;
+};
+
 //! An Area represents one map, or screen, in a World.
 /*!
     The Area class manages a three-dimensional structure of Tiles and a set
@@ -34,6 +57,7 @@ class Player;
 class Area {
  public:
     Area() noexcept;
+    virtual ~Area() noexcept;
 
     //! Prepare game state for this Area to be in focus.
     void
@@ -100,6 +124,11 @@ class Area {
     DataArea*
     getDataArea() noexcept;
 
+    //! Approximate number of bytes held by this Area. Images are shared
+    //! between Areas and are not counted.
+    Size
+    memoryUsage() noexcept;
+
     void
     runScript(TileGrid::ScriptType type, ivec3 tile,
               Entity* triggeredBy) noexcept;
@@ -107,6 +136,15 @@ class Area {
  public:
     TileGrid grid;
 
+    // The Entities in this Area that are moving.
+    MotionStore motion;
+
+    // The NPCs and Overlays in this Area, by where they are.
+    EntityGrid entityGrid;
+
+    // Paths that the Characters in this Area are following.
+    FlowFields flowFields;
+
     bool ok;
 
  protected:
@@ -116,16 +154,84 @@ class Area {
     void
     drawEntities(DisplayList* display, icube& tiles, I32 z) noexcept;
 
+    //! Do any animated tile types within the visible tiles need to change
+    //! frame?
+    bool
+    tilesNeedRedraw(icube& tiles) noexcept;
+
+    //! Returns the set of animated tile types within a chunk, rebuilding it
+    //! if the chunk has changed.
+    U32*
+    chunkAnimatedTypes(Size chunk) noexcept;
+
+    //! Returns the cached DisplayItems for a chunk, rebuilding them if the
+    //! chunk has changed.
+    TileChunkMesh&
+    chunkMesh(I32 cx, I32 cy, I32 z) noexcept;
+
+    //! Find the tile types with more than one frame, once tileGraphics is
+    //! complete.
+    void
+    findAnimatedTypes() noexcept;
+
+    //! Range of pixels covered by a range of tiles.
+    icube
+    tilePixels(icube& tiles) noexcept;
+
+    //! Range of chunks that contain a range of tiles, limited to the grid.
+    icube
+    chunksContaining(icube& tiles) noexcept;
+
  protected:
-    Hashmap<String, TileSet> tileSets;
+    Hashmap<Symbol, TileSet> tileSets;
+
+    // The image of each tile set, released with the Area.
+    Vector<TiledImage> tileSetImages;
 
     Vector<Animation> tileGraphics;
-    Vector<bool> checkedForAnimation;
-    Vector<bool> tilesAnimated;
+
+    // Tile types with more than one frame. Built on the first call to
+    // needsRedraw() or draw(), after tileGraphics is complete.
+    Vector<U32> animatedTypes;
+    bool animatedTypesFound;
+
+    // Current frame of each type in animatedTypes. Updated by draw().
+    Vector<Image> animatedFrames;
+
+    // Indexed like TileGrid::chunkVersions. Built lazily as chunks are drawn.
+    Vector<TileChunkMesh> chunkMeshes;
+
+    // Maps a tile type to its index in animatedTypes, or UINT32_MAX.
+    Vector<U32> animatedIndex;
+
+    // For each chunk of the grid, a bitset over animatedTypes of the types
+    // found in that chunk. Each set is animatedWords long.
+    Vector<U32> chunkAnimated;
+    Size animatedWords;
+
+    // TileGrid::chunkVersion() + 1 of each set in chunkAnimated when it was
+    // built, or 0 if it has not been built.
+    Vector<U32> chunkAnimatedVersions;
+
+    // Union of the sets of the visible chunks as of the last check.
+    Vector<U32> visibleAnimated;
+
+    // No visible tile needs to change frame before animationDeadline as long
+    // as the visible tiles stay animationWindow and the grid stays at
+    // animationTilesVersion.
+    icube animationWindow;
+    U32 animationTilesVersion;
+    Time animationDeadline;
 
     Vector<Character*> characters;
     Vector<Overlay*> overlays;
 
+    // Number of Entities spawned so far, which orders them for drawing.
+    U32 entitiesSpawned;
+
+    // Scratch space for EntityGrid::query().
+    Vector<Entity*> nearbyEntities;
+
     bool beenFocused;
     bool redraw;
     U32 colorOverlayARGB;
@@ -141,7 +247,7 @@ class Area {
     String author;
     String musicPath;
 
-    friend class AreaJSON;
+    friend class AreaBlob;
 };
 
 #endif  // SRC_TILES_AREA_H_
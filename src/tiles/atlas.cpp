@@ -0,0 +1,396 @@
+#include "tiles/atlas.h"
+
+#include "tiles/log.h"
+#include "tiles/world.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string.h"
+
+// Above the part of the skyline from x to x + width, the page is filled down
+// to y.
+struct SkylineNode {
+    U32 x;
+    U32 y;
+    U32 width;
+};
+
+struct FreeRect {
+    U32 x;
+    U32 y;
+    U32 width;
+    U32 height;
+};
+
+struct AtlasPage {
+    // Left to right, covering the width of the page.
+    Vector<SkylineNode> skyline;
+
+    // Room above the skyline that is not in use: left behind by images that
+    // were freed, or under images placed over a dip in the skyline.
+    Vector<FreeRect> freed;
+
+    Vector<Handle> images;
+    U32 usedPixels;
+
+    void* texture;
+};
+
+static void
+clearPage(AtlasPage& page, U32 width) noexcept {
+    page.skyline.clear();
+    page.skyline.push(SkylineNode{0, 0, width});
+    page.freed.clear();
+    page.usedPixels = 0;
+}
+
+// Where the top of an image would be with its left edge at skyline node i,
+// if it fits there.
+static bool
+skylineFit(AtlasPage& page, Size i, U32 width, U32 height, U32 pageWidth,
+           U32 pageHeight, U32* top) noexcept {
+    Vector<SkylineNode>& skyline = page.skyline;
+
+    U32 x = skyline[i].x;
+    if (x + width > pageWidth)
+        return false;
+
+    U32 y = 0;
+    for (Size j = i; j < skyline.size && skyline[j].x < x + width; j++)
+        if (skyline[j].y > y)
+            y = skyline[j].y;
+
+    if (y + height > pageHeight)
+        return false;
+
+    *top = y;
+    return true;
+}
+
+// Put an image on top of the skyline, choosing the spot where its bottom
+// edge is highest, and leftmost among those.
+static bool
+skylinePlace(AtlasPage& page, U32 width, U32 height, U32 pageWidth,
+             U32 pageHeight, U32* x, U32* y) noexcept {
+    Vector<SkylineNode>& skyline = page.skyline;
+
+    Size best = SIZE_MAX;
+    U32 bestTop = 0;
+    for (Size i = 0; i < skyline.size; i++) {
+        U32 top;
+        if (!skylineFit(page, i, width, height, pageWidth, pageHeight, &top))
+            continue;
+        if (best == SIZE_MAX || top < bestTop) {
+            best = i;
+            bestTop = top;
+        }
+    }
+
+    if (best == SIZE_MAX)
+        return false;
+
+    U32 left = skyline[best].x;
+    U32 right = left + width;
+
+    // Replace the nodes under the image with one on top of it. Any room
+    // between them and the image is kept to be reused.
+    Size i = best;
+    while (i < skyline.size && skyline[i].x < right) {
+        SkylineNode& node = skyline[i];
+        U32 nodeRight = node.x + node.width;
+        U32 coveredRight = nodeRight < right ? nodeRight : right;
+
+        if (node.y < bestTop) {
+            FreeRect gap = {node.x, node.y, coveredRight - node.x,
+                            bestTop - node.y};
+            page.freed.push(gap);
+        }
+
+        if (nodeRight > right) {
+            node.width = nodeRight - right;
+            node.x = right;
+            break;
+        }
+        skyline.erase(i);
+    }
+
+    // Vector::insert() shifts the wrong way, so make room by hand.
+    skyline.push(SkylineNode());
+    for (Size j = skyline.size - 1; j > best; j--)
+        skyline[j] = skyline[j - 1];
+    skyline[best] = SkylineNode{left, bestTop + height, width};
+
+    // Join neighbors at the same height.
+    for (Size j = 0; j + 1 < skyline.size;) {
+        if (skyline[j].y == skyline[j + 1].y) {
+            skyline[j].width += skyline[j + 1].width;
+            skyline.erase(j + 1);
+        }
+        else {
+            j++;
+        }
+    }
+
+    *x = left;
+    *y = bestTop;
+    return true;
+}
+
+// Put an image in the freed room it fits most snugly.
+static bool
+freedPlace(AtlasPage& page, U32 width, U32 height, U32* x, U32* y) noexcept {
+    Vector<FreeRect>& freed = page.freed;
+
+    Size best = SIZE_MAX;
+    U64 bestWaste = 0;
+    for (Size i = 0; i < freed.size; i++) {
+        FreeRect& r = freed[i];
+        if (r.width < width || r.height < height)
+            continue;
+
+        U64 waste = static_cast<U64>(r.width) * r.height -
+                    static_cast<U64>(width) * height;
+        if (best == SIZE_MAX || waste < bestWaste) {
+            best = i;
+            bestWaste = waste;
+        }
+    }
+
+    if (best == SIZE_MAX)
+        return false;
+
+    FreeRect r = freed[best];
+    freed[best] = freed[freed.size - 1];
+    freed.pop();
+
+    // Split what is left into two rectangles, keeping the larger of the
+    // leftover strips whole.
+    U32 right = r.width - width;
+    U32 below = r.height - height;
+    FreeRect a, b;
+    if (right > below) {
+        a = FreeRect{r.x + width, r.y, right, r.height};
+        b = FreeRect{r.x, r.y + height, width, below};
+    }
+    else {
+        a = FreeRect{r.x + width, r.y, right, height};
+        b = FreeRect{r.x, r.y + height, r.width, below};
+    }
+    if (a.width && a.height)
+        freed.push(a);
+    if (b.width && b.height)
+        freed.push(b);
+
+    *x = r.x;
+    *y = r.y;
+    return true;
+}
+
+Atlas::Atlas(U32 pageWidth, U32 pageHeight) noexcept
+    : pageWidth(pageWidth), pageHeight(pageHeight) { }
+
+TiledImage*
+Atlas::find(StringView path) noexcept {
+    AtlasEntry* entry = entries.tryAt(path);
+    if (!entry)
+        return 0;
+
+    entry->numUsers += 1;
+    return &entry->tiles;
+}
+
+Handle
+Atlas::insert(StringView path) noexcept {
+    Handle handle = entries.insert(path);
+
+    AtlasEntry& entry = *entries.at(handle);
+    entry.tiles = {};
+    entry.page = NO_ATLAS_PAGE;
+    entry.numUsers = 1;
+    entry.lastUse = 0;
+
+    return handle;
+}
+
+TiledImage*
+Atlas::at(Handle handle) noexcept {
+    AtlasEntry* entry = entries.at(handle);
+    return entry ? &entry->tiles : 0;
+}
+
+U32
+Atlas::place(Handle handle, U32 width, U32 height) noexcept {
+    if (width > pageWidth || height > pageHeight)
+        return NO_ATLAS_PAGE;
+
+    U32 x = 0;
+    U32 y = 0;
+    U32 page = NO_ATLAS_PAGE;
+
+    // Fill the gaps in pages in use, then their skylines, before starting on
+    // an empty page.
+    for (U32 i = 0; i < pages.size && page == NO_ATLAS_PAGE; i++)
+        if (pages[i]->images.size &&
+            freedPlace(*pages[i], width, height, &x, &y))
+            page = i;
+    for (U32 i = 0; i < pages.size && page == NO_ATLAS_PAGE; i++)
+        if (pages[i]->images.size &&
+            skylinePlace(*pages[i], width, height, pageWidth, pageHeight, &x,
+                         &y))
+            page = i;
+
+    if (page == NO_ATLAS_PAGE) {
+        for (U32 i = 0; i < pages.size && page == NO_ATLAS_PAGE; i++)
+            if (pages[i]->images.size == 0)
+                page = i;
+
+        if (page == NO_ATLAS_PAGE) {
+            AtlasPage* newPage = new AtlasPage;
+            newPage->texture = 0;
+            clearPage(*newPage, pageWidth);
+
+            page = static_cast<U32>(pages.size);
+            pages.push(newPage);
+
+            logInfo("Atlas", String() << "Added page " << page << " of "
+                                      << pageWidth << "x" << pageHeight);
+        }
+
+        bool placed = skylinePlace(*pages[page], width, height, pageWidth,
+                                   pageHeight, &x, &y);
+        assert_(placed);
+        (void)placed;
+    }
+
+    AtlasPage& p = *pages[page];
+    p.images.push(handle);
+    p.usedPixels += width * height;
+
+    AtlasEntry& entry = *entries.at(handle);
+    entry.page = page;
+    entry.tiles.image.x = x;
+    entry.tiles.image.y = y;
+    entry.tiles.image.width = width;
+    entry.tiles.image.height = height;
+
+    return page;
+}
+
+void
+Atlas::release(Image image) noexcept {
+    if (!IMAGE_VALID(image))
+        return;
+
+    // Few pages share a texture with the image and few images share its
+    // page, and images are released rarely, so a search is fine.
+    for (U32 i = 0; i < pages.size; i++) {
+        AtlasPage& page = *pages[i];
+        if (page.texture != image.texture)
+            continue;
+
+        for (Size j = 0; j < page.images.size; j++) {
+            AtlasEntry& entry = *entries.at(page.images[j]);
+            Image loaded = entry.tiles.image;
+            if (loaded.x != image.x || loaded.y != image.y ||
+                loaded.width != image.width || loaded.height != image.height)
+                continue;
+
+            entry.numUsers -= 1;
+            assert_(entry.numUsers >= 0);
+
+            if (entry.numUsers == 0)
+                entry.lastUse = worldTime();
+            return;
+        }
+    }
+}
+
+Size
+Atlas::prune(Time latestPermissibleUse,
+             void (*freeTexture)(void* texture)) noexcept {
+    Size freed = 0;
+
+    for (U32 i = 0; i < pages.size; i++) {
+        AtlasPage& page = *pages[i];
+
+        for (Size j = 0; j < page.images.size;) {
+            Handle handle = page.images[j];
+            AtlasEntry& entry = *entries.at(handle);
+            if (entry.numUsers > 0 || entry.lastUse >= latestPermissibleUse) {
+                j++;
+                continue;
+            }
+
+            Image image = entry.tiles.image;
+            page.freed.push(
+                FreeRect{image.x, image.y, image.width, image.height});
+            page.usedPixels -= image.width * image.height;
+
+            page.images[j] = page.images[page.images.size - 1];
+            page.images.pop();
+
+            entries.release(handle);
+            freed += 1;
+        }
+
+        if (page.images.size == 0) {
+            clearPage(page, pageWidth);
+            if (page.texture) {
+                freeTexture(page.texture);
+                page.texture = 0;
+            }
+        }
+    }
+
+    if (freed) {
+        logInfo("Atlas", String() << "Freed " << freed << " images");
+        logStats();
+    }
+
+    return freed;
+}
+
+U32
+Atlas::pageCount() noexcept {
+    return static_cast<U32>(pages.size);
+}
+
+void*
+Atlas::texture(U32 page) noexcept {
+    return pages[page]->texture;
+}
+
+void
+Atlas::setTexture(U32 page, void* texture) noexcept {
+    pages[page]->texture = texture;
+}
+
+AtlasStats
+Atlas::stats(U32 page) noexcept {
+    AtlasPage& p = *pages[page];
+
+    AtlasStats stats = {};
+    stats.images = static_cast<U32>(p.images.size);
+    stats.usedPixels = p.usedPixels;
+    for (Size i = 0; i < p.freed.size; i++)
+        stats.freedPixels += p.freed[i].width * p.freed[i].height;
+    for (Size i = 0; i < p.skyline.size; i++)
+        if (p.skyline[i].y > stats.height)
+            stats.height = p.skyline[i].y;
+
+    return stats;
+}
+
+void
+Atlas::logStats() noexcept {
+    U32 area = pageWidth * pageHeight;
+
+    for (U32 i = 0; i < pages.size; i++) {
+        AtlasStats s = stats(i);
+        logInfo("Atlas", String()
+                             << "Page " << i << ": " << s.images << " images, "
+                             << s.usedPixels * 100 / area << "% used, "
+                             << s.freedPixels * 100 / area << "% freed, "
+                             << "filled down to " << s.height);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef SRC_TILES_ATLAS_H_
+#define SRC_TILES_ATLAS_H_
+
+#include "tiles/images.h"
+#include "util/compiler.h"
+#include "util/handle-table.h"
+#include "util/int.h"
+#include "util/string-view.h"
+#include "util/vector.h"
+
+// Atlas
+//
+// Where each image a renderer has loaded lives: on which of several pages of
+// the same size, and where on it. The renderer keeps a texture for each page,
+// copies each image into the place it is given, and draws from the pages.
+//
+// Pages are packed with the skyline bottom-left heuristic. A page tracks how
+// far down it is filled at each x, and an image goes wherever its bottom edge
+// would be nearest the top of the page. Room left by freed images is kept and
+// reused before the skyline, and a page left with no images is cleared.
+//
+// Users of an image are counted through find(), insert(), and release(). An
+// image nothing uses stays loaded until prune() finds it has gone unused for
+// long enough.
+struct AtlasStats {
+    U32 images;
+    U32 usedPixels;   // Covered by images.
+    U32 freedPixels;  // In gaps that can be reused.
+    U32 height;       // Down to the lowest point of the skyline.
+};
+
+struct AtlasEntry {
+    TiledImage tiles;
+    U32 page;
+
+    I32 numUsers;
+    Time lastUse;  // When numUsers last fell to zero.
+};
+
+struct AtlasPage;
+
+class Atlas {
+ public:
+    Atlas(U32 pageWidth, U32 pageHeight) noexcept;
+
+    // The image loaded from a path, with one more user, or null if it has
+    // not been loaded.
+    TiledImage*
+    find(StringView path) noexcept;
+
+    // Add a zeroed, and so invalid, image for a path that find() did not
+    // have, with one user.
+    Handle
+    insert(StringView path) noexcept;
+
+    // Pointers are only good until the next insert().
+    TiledImage*
+    at(Handle handle) noexcept;
+
+    // Find room for an image of the given size on some page and set the
+    // image's position, but not its texture, to it. Returns the page, or
+    // NO_ATLAS_PAGE if the image is larger than a page.
+    U32
+    place(Handle handle, U32 width, U32 height) noexcept;
+
+    // A user is done with an image that was loaded whole.
+    void
+    release(Image image) noexcept;
+
+    // Free images that nothing has used since before latestPermissibleUse.
+    // The textures of pages left empty are passed to freeTexture and
+    // forgotten. Returns how many images were freed.
+    Size
+    prune(Time latestPermissibleUse,
+          void (*freeTexture)(void* texture)) noexcept;
+
+    U32
+    pageCount() noexcept;
+
+    // The renderer's texture for a page, or null.
+    void*
+    texture(U32 page) noexcept;
+    void
+    setTexture(U32 page, void* texture) noexcept;
+
+    AtlasStats
+    stats(U32 page) noexcept;
+
+    // Log the occupancy of each page.
+    void
+    logStats() noexcept;
+
+ private:
+    U32 pageWidth;
+    U32 pageHeight;
+
+    HandleTable<AtlasEntry> entries;
+    Vector<AtlasPage*> pages;
+};
+
+#define NO_ATLAS_PAGE UINT32_MAX
+
+#endif  // SRC_TILES_ATLAS_H_
@@ -0,0 +1,202 @@
+#include "tiles/bmp.h"
+
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+#include "util/vector.h"
+
+#define BI_RGB       0
+#define BI_BITFIELDS 3
+
+// Largest width or height accepted, which keeps sizes within 32 bits.
+#define BMP_MAX_SIDE 16384
+
+static U32
+le16(const U8* p) noexcept {
+    return static_cast<U32>(p[0]) | static_cast<U32>(p[1]) << 8;
+}
+
+static U32
+le32(const U8* p) noexcept {
+    return static_cast<U32>(p[0]) | static_cast<U32>(p[1]) << 8 |
+           static_cast<U32>(p[2]) << 16 | static_cast<U32>(p[3]) << 24;
+}
+
+// Where one channel sits in a pixel, and how to widen it to 8 bits.
+struct Channel {
+    U32 mask;
+    U32 shift;
+    U32 max;
+};
+
+static Channel
+channelOf(U32 mask) noexcept {
+    Channel c = {mask, 0, 0};
+    if (mask) {
+        while (!(mask & 1)) {
+            mask >>= 1;
+            c.shift++;
+        }
+        c.max = mask;
+    }
+    return c;
+}
+
+static U32
+channelValue(Channel c, U32 px) noexcept {
+    if (!c.max)
+        return 0;
+    U32 v = (px & c.mask) >> c.shift;
+    return c.max == 255 ? v : (v * 255 + c.max / 2) / c.max;
+}
+
+bool
+bmpDecode(StringView data, Vector<U32>& pixels, U32* width,
+          U32* height) noexcept {
+    const U8* bytes = reinterpret_cast<const U8*>(data.data);
+    Size size = data.size;
+
+    if (size < 26 || bytes[0] != 'B' || bytes[1] != 'M')
+        return false;
+
+    U32 pixelOffset = le32(bytes + 10);
+    U32 headerSize = le32(bytes + 14);
+    if (14 + static_cast<Size>(headerSize) > size)
+        return false;
+
+    I32 w, h;
+    U32 bpp, compression, colorsUsed = 0;
+    if (headerSize == 12) {
+        // OS/2 BITMAPCOREHEADER.
+        w = static_cast<I32>(le16(bytes + 18));
+        h = static_cast<I32>(le16(bytes + 20));
+        bpp = le16(bytes + 24);
+        compression = BI_RGB;
+    }
+    else if (headerSize >= 40) {
+        w = static_cast<I32>(le32(bytes + 18));
+        h = static_cast<I32>(le32(bytes + 22));
+        bpp = le16(bytes + 28);
+        compression = le32(bytes + 30);
+        colorsUsed = le32(bytes + 46);
+    }
+    else {
+        return false;
+    }
+
+    bool topDown = h < 0;
+    if (topDown)
+        h = -h;
+    if (w <= 0 || h <= 0 || w > BMP_MAX_SIDE || h > BMP_MAX_SIDE)
+        return false;
+
+    // Masks follow a 40-byte header, or are part of a longer one. Only the
+    // longer headers have room for an alpha mask.
+    Channel r, g, b, a;
+    if (compression == BI_BITFIELDS) {
+        if (bpp != 16 && bpp != 32)
+            return false;
+        if (14 + 40 + 12 > size)
+            return false;
+        r = channelOf(le32(bytes + 54));
+        g = channelOf(le32(bytes + 58));
+        b = channelOf(le32(bytes + 62));
+        a = channelOf(headerSize >= 56 && 14 + 56 <= size ? le32(bytes + 66)
+                                                          : 0);
+    }
+    else if (compression == BI_RGB) {
+        if (bpp == 16) {
+            r = channelOf(0x7C00);
+            g = channelOf(0x03E0);
+            b = channelOf(0x001F);
+            a = channelOf(0);
+        }
+        else {
+            r = channelOf(0x00FF0000);
+            g = channelOf(0x0000FF00);
+            b = channelOf(0x000000FF);
+            a = channelOf(bpp == 32 ? 0xFF000000 : 0);
+        }
+    }
+    else {
+        // Run-length encoded and embedded JPEG or PNG images.
+        return false;
+    }
+
+    U32 palette[256];
+    if (bpp == 1 || bpp == 4 || bpp == 8) {
+        U32 entrySize = headerSize == 12 ? 3 : 4;
+        U32 count = colorsUsed ? colorsUsed : 1u << bpp;
+        if (count > 256u)
+            return false;
+        Size paletteOffset = 14 + static_cast<Size>(headerSize);
+        if (paletteOffset + count * entrySize > size)
+            return false;
+        for (U32 i = 0; i < 256; i++)
+            palette[i] = 0xFF000000;
+        for (U32 i = 0; i < count; i++) {
+            const U8* e = bytes + paletteOffset + i * entrySize;
+            palette[i] = static_cast<U32>(e[2]) |
+                         static_cast<U32>(e[1]) << 8 |
+                         static_cast<U32>(e[0]) << 16 | 0xFF000000;
+        }
+    }
+    else if (bpp != 16 && bpp != 24 && bpp != 32) {
+        return false;
+    }
+
+    Size stride = (static_cast<Size>(w) * bpp + 31) / 32 * 4;
+    if (pixelOffset > size || stride * h > size - pixelOffset)
+        return false;
+
+    pixels.resize(static_cast<Size>(w) * h);
+
+    bool anyAlpha = false;
+    for (I32 y = 0; y < h; y++) {
+        I32 fileRow = topDown ? y : h - 1 - y;
+        const U8* row = bytes + pixelOffset + stride * fileRow;
+        U32* out = pixels.data + static_cast<Size>(y) * w;
+
+        switch (bpp) {
+        case 1:
+        case 4:
+        case 8: {
+            U32 perByte = 8 / bpp;
+            U32 mask = (1u << bpp) - 1;
+            for (I32 x = 0; x < w; x++) {
+                U32 byte = row[x / perByte];
+                U32 shift = (perByte - 1 - x % perByte) * bpp;
+                out[x] = palette[(byte >> shift) & mask];
+            }
+            break;
+        }
+        case 24:
+            for (I32 x = 0; x < w; x++) {
+                const U8* p = row + x * 3;
+                out[x] = static_cast<U32>(p[2]) |
+                         static_cast<U32>(p[1]) << 8 |
+                         static_cast<U32>(p[0]) << 16 | 0xFF000000;
+            }
+            break;
+        default:
+            for (I32 x = 0; x < w; x++) {
+                U32 px = bpp == 16 ? le16(row + x * 2) : le32(row + x * 4);
+                U32 alpha = channelValue(a, px);
+                anyAlpha |= alpha != 0;
+                out[x] = channelValue(r, px) | channelValue(g, px) << 8 |
+                         channelValue(b, px) << 16 | alpha << 24;
+            }
+            break;
+        }
+    }
+
+    // Like SDL, treat an alpha channel that is entirely zero as missing.
+    if ((bpp == 16 || bpp == 32) && !anyAlpha) {
+        for (Size i = 0; i < pixels.size; i++)
+            pixels[i] |= 0xFF000000;
+    }
+
+    *width = static_cast<U32>(w);
+    *height = static_cast<U32>(h);
+    return true;
+}
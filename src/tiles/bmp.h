@@ -0,0 +1,20 @@
+#ifndef SRC_TILES_BMP_H_
+#define SRC_TILES_BMP_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+#include "util/vector.h"
+
+// Decode a Windows bitmap into pixels packed as R | G << 8 | B << 16 | A << 24,
+// top row first.
+//
+// Handles what SDL_LoadBMP() is given in practice: uncompressed images with a
+// palette of 1, 4, or 8 bits per pixel, or 16, 24, or 32 bits per pixel with
+// or without BI_BITFIELDS masks. Images without an alpha channel, or whose
+// alpha channel is entirely zero, are opaque.
+bool
+bmpDecode(StringView data, Vector<U32>& pixels, U32* width,
+          U32* height) noexcept;
+
+#endif  // SRC_TILES_BMP_H_
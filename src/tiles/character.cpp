@@ -24,7 +24,9 @@ Character::tick(Time dt) noexcept {
     case TURN:
         // Characters don't do anything on tick() for TURN mode.
         break;
-    case TILE: moveTowardDestination(dt); break;
+    case TILE:
+        // The Area moves all of its Characters at once after ticking them.
+        break;
     case NOTILE: assert_(false && "not implemented"); break;
     }
 }
@@ -53,7 +55,7 @@ Character::setTileCoords(I32 x, I32 y) noexcept {
     leaveTile();
     redraw = true;
     vicoord virt = {x, y, r.z};
-    r = area->grid.virt2virt(virt);
+    setPixelCoord(area->grid.virt2virt(virt));
     enterTile();
 }
 
@@ -61,7 +63,7 @@ void
 Character::setTileCoords(ivec3 phys) noexcept {
     leaveTile();
     redraw = true;
-    r = area->grid.phys2virt_r(phys);
+    setPixelCoord(area->grid.phys2virt_r(phys));
     enterTile();
 }
 
@@ -69,7 +71,7 @@ void
 Character::setTileCoords(vicoord virt) noexcept {
     leaveTile();
     redraw = true;
-    r = area->grid.virt2virt(virt);
+    setPixelCoord(area->grid.virt2virt(virt));
     enterTile();
 }
 
@@ -77,7 +79,7 @@ void
 Character::setTileCoords(fvec3 virt) noexcept {
     leaveTile();
     redraw = true;
-    r = virt;
+    setPixelCoord(virt);
     enterTile();
 }
 
@@ -85,7 +87,7 @@ void
 Character::setArea(Area* area, vicoord position) noexcept {
     leaveTile();
     Entity::setArea(area);
-    r = area->grid.virt2virt(position);
+    setPixelCoord(area->grid.virt2virt(position));
     enterTile();
     redraw = true;
 }
@@ -114,7 +116,7 @@ Character::moveByTile(ivec2 delta) noexcept {
     }
 
     setAnimationMoving();
-    moving = true;
+    startMoving();
 
     // Process triggers.
     runTileExitScript();
@@ -137,15 +139,14 @@ Character::moveByTile(ivec2 delta) noexcept {
     case TURN:
         // Movement is instantaneous.
         redraw = true;
-        r = destCoord;
-        moving = false;
+        stopMoving();
+        setPixelCoord(destCoord);
         setAnimationStanding();
         arrived();
         break;
     case TILE:
     case NOTILE:
-        // Movement happens in Entity::moveTowardDestination() during
-        // tick().
+        // Movement happens in MotionStore::tick() during Area::tick().
         break;
     }
 }
@@ -164,6 +165,21 @@ Character::moveDest(ivec2 facing) noexcept {
     }
 }
 
+bool
+Character::stepToward(ivec3 target) noexcept {
+    if (moving)
+        return false;
+
+    U32 nowalk = (nowalkFlags & ~nowalkExempt) | TILE_NOWALK_EXIT;
+    ivec2 delta = area->flowFields.step(area->grid, getTileCoords_i(), target,
+                                        nowalk);
+    if (delta.x == 0 && delta.y == 0)
+        return false;
+
+    moveByTile(delta);
+    return true;
+}
+
 bool
 Character::canMove(ivec3 dest) noexcept {
     if (destExit) {
@@ -178,7 +194,7 @@ Character::canMove(ivec3 dest) noexcept {
         // Tile is inside map. Can we move?
         if (nowalked(dest))
             return false;
-        if (area->grid.occupied.contains(dest)) {
+        if (area->grid.tileFlags(dest, TILE_OCCUPIED)) {
             // Space is occupied by another Entity.
             return false;
         }
@@ -193,8 +209,7 @@ Character::canMove(ivec3 dest) noexcept {
 bool
 Character::nowalked(ivec3 phys) noexcept {
     U32 flags = nowalkFlags & ~nowalkExempt;
-    U32* tileFlags = area->grid.flags.tryAt(phys);
-    return tileFlags && (*tileFlags & flags) != 0;
+    return area->grid.tileFlags(phys, flags) != 0;
 }
 
 void
@@ -206,8 +221,10 @@ Character::arrived() noexcept {
 
     if (inBounds) {
         float* layermod = area->grid.layermods[EXIT_NORMAL].tryAt(dest);
-        if (layermod)
+        if (layermod) {
             r.z = *layermod;
+            reindex();
+        }
 
         // Process triggers.
         area->runScript(TileGrid::SCRIPT_TYPE_ENTER, dest, this);
@@ -234,7 +251,7 @@ Character::leaveTile() noexcept {
 
 void
 Character::leaveTile(ivec3 phys) noexcept {
-    area->grid.occupied.erase(phys);
+    area->grid.removeTileFlags(phys, TILE_OCCUPIED);
 }
 
 void
@@ -245,7 +262,7 @@ Character::enterTile() noexcept {
 
 void
 Character::enterTile(ivec3 phys) noexcept {
-    area->grid.occupied[phys] = true;
+    area->grid.addTileFlags(phys, TILE_OCCUPIED);
 }
 
 void
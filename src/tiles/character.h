@@ -45,6 +45,11 @@ class Character : public Entity {
     virtual void
     moveByTile(ivec2 delta) noexcept;
 
+    //! Take the first step of a shortest path toward a tile in the Area,
+    //! avoiding Exits. Returns false if no step can be taken.
+    bool
+    stepToward(ivec3 target) noexcept;
+
  protected:
     //! Indicates which coordinate we will move into if we proceed in
     //! direction specified.
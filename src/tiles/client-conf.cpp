@@ -3,6 +3,7 @@
 #include "os/os.h"
 #include "util/compiler.h"
 #include "util/json.h"
+#include "util/profile.h"
 #include "util/string.h"
 
 extern fvec2 dataWorldViewportResolution;
@@ -10,6 +11,12 @@ extern fvec2 dataWorldViewportResolution;
 MoveMode confMoveMode;
 ivec2 confWindowSize;
 bool confFullscreen;
+Size confAreaCacheBytes = 64 * 1024 * 1024;
+bool confPreloadAreas = true;
+Size confImageUploadBytes = 2 * 1024 * 1024;
+String confFrameDumpPath;
+bool confFrameDumpPNG = false;
+U32 confFrameLimit = 0;
 
 // Parse and process the client config file, and set configuration defaults for
 // missing options.
@@ -46,5 +53,37 @@ confParse(StringView filename) noexcept {
         JsonValue fullscreenValue = windowValue["fullscreen"];
         if (fullscreenValue.isBool())
             confFullscreen = fullscreenValue.toBool();
+        JsonValue dumpValue = windowValue["dump_frames"];
+        if (dumpValue.isString())
+            confFrameDumpPath = dumpValue.toString();
+        JsonValue formatValue = windowValue["dump_format"];
+        if (formatValue.isString())
+            confFrameDumpPNG = formatValue.toString() == "png";
+        JsonValue framesValue = windowValue["frames"];
+        if (framesValue.isNumber() && framesValue.toNumber() >= 0)
+            confFrameLimit = static_cast<U32>(framesValue.toNumber());
     }
+
+    JsonValue areasValue = root["areas"];
+    if (areasValue.isObject()) {
+        JsonValue cacheValue = areasValue["cache_megabytes"];
+        if (cacheValue.isNumber() && cacheValue.toNumber() >= 0)
+            confAreaCacheBytes =
+                static_cast<Size>(cacheValue.toNumber() * 1024 * 1024);
+        JsonValue preloadValue = areasValue["preload_exits"];
+        if (preloadValue.isBool())
+            confPreloadAreas = preloadValue.toBool();
+    }
+
+    JsonValue imagesValue = root["images"];
+    if (imagesValue.isObject()) {
+        JsonValue uploadValue = imagesValue["upload_kilobytes"];
+        if (uploadValue.isNumber() && uploadValue.toNumber() >= 0)
+            confImageUploadBytes =
+                static_cast<Size>(uploadValue.toNumber() * 1024);
+    }
+
+    JsonValue profileValue = root["profile"];
+    if (profileValue.isString())
+        profileEnable(profileValue.toString());
 }
@@ -6,6 +6,7 @@
 #include "util/compiler.h"
 #include "util/int.h"
 #include "util/string-view.h"
+#include "util/string.h"
 
 //! Engine-wide user-configurable values.
 
@@ -16,6 +17,30 @@ extern MoveMode confMoveMode;
 extern ivec2 confWindowSize;
 extern bool confFullscreen;
 
+//! Areas that are not in focus are freed, least recently used first, once
+//! the Areas together use more than this many bytes.
+extern Size confAreaCacheBytes;
+
+//! Whether to load the Areas that the focused Area's exits lead to before
+//! the player takes them.
+extern bool confPreloadAreas;
+
+//! How many bytes of newly decoded images are copied to the renderer in each
+//! frame, though one image is always copied. The rest wait for later frames.
+//! 0 for no limit.
+extern Size confImageUploadBytes;
+
+//! Where the software renderer writes each frame it draws, as a prefix to
+//! which the frame number and extension are added. Empty for no dumps.
+extern String confFrameDumpPath;
+
+//! Whether dumped frames are PNG rather than PPM files.
+extern bool confFrameDumpPNG;
+
+//! How many frames the software renderer's main loop runs before returning,
+//! or 0 for no limit.
+extern U32 confFrameLimit;
+
 void
 confParse(StringView filename) noexcept;
 
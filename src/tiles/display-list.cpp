@@ -1,8 +1,125 @@
 #include "tiles/display-list.h"
 
+#include "os/c.h"
 #include "tiles/window.h"
 #include "util/compiler.h"
+#include "util/int.h"
 #include "util/math2.h"
+#include "util/profile.h"
+#include "util/vector.h"
+
+static ProfileZone presentZone("displayListPresent");
+static ProfileZone sortZone("displayListSort");
+
+// An item's place in the drawing order. Items are sorted by depth alone, so
+// items at the same depth, such as overlapping Entities on one layer, are
+// drawn in the order they were added.
+struct SortKey {
+    U32 key;
+    U32 index;
+};
+
+// Kept between frames so that presenting does not allocate.
+static Vector<SortKey> keys;
+static Vector<SortKey> keysScratch;
+static Vector<DisplayItem> sorted;
+
+// Order floats as unsigned integers, with -0 and 0 as the same depth.
+static U32
+depthKey(float z) noexcept {
+    if (z == 0.0f)
+        z = 0.0f;
+
+    U32 bits;
+    memcpy(&bits, &z, sizeof(bits));
+    return bits & 0x80000000 ? ~bits : bits | 0x80000000;
+}
+
+// Stable LSD radix sort, a byte at a time. Bytes that every key shares, as
+// when most items are on a few layers with nearby depths, are skipped.
+static void
+radixSort() noexcept {
+    Size n = keys.size;
+    if (n < 2)
+        return;
+
+    U32 differ = 0;
+    U32 first = keys[0].key;
+    for (Size i = 1; i < n; i++)
+        differ |= keys.data[i].key ^ first;
+
+    keysScratch.resize(n);
+    SortKey* from = keys.data;
+    SortKey* to = keysScratch.data;
+
+    for (U32 shift = 0; shift < 32; shift += 8) {
+        if (((differ >> shift) & 0xFF) == 0)
+            continue;
+
+        Size counts[256];
+        memset(counts, 0, sizeof(counts));
+        for (Size i = 0; i < n; i++)
+            counts[(from[i].key >> shift) & 0xFF]++;
+
+        Size offset = 0;
+        for (Size b = 0; b < 256; b++) {
+            Size count = counts[b];
+            counts[b] = offset;
+            offset += count;
+        }
+
+        for (Size i = 0; i < n; i++)
+            to[counts[(from[i].key >> shift) & 0xFF]++] = from[i];
+
+        SortKey* swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != keys.data)
+        memcpy(keys.data, from, n * sizeof(SortKey));
+}
+
+void
+displayListSort(DisplayList* display, Vector<DisplayItem>& out) noexcept {
+    ProfileScope scope(sortZone);
+
+    // The part of the map on screen, in virtual pixels. Drawing maps a point
+    // p to (p - scroll) * scale - padding.
+    fvec2 scale = display->scale;
+    fvec2 scroll = display->scroll;
+    fvec2 padding = display->padding;
+    fvec2 size = display->size;
+    fvec2 topLeft = {
+        scroll.x + padding.x / scale.x,
+        scroll.y + padding.y / scale.y,
+    };
+    fvec2 bottomRight = {
+        scroll.x + (size.x + padding.x) / scale.x,
+        scroll.y + (size.y + padding.y) / scale.y,
+    };
+
+    keys.clear();
+
+    DisplayItem* items = display->items.data;
+    for (Size i = 0; i < display->items.size; i++) {
+        DisplayItem& item = items[i];
+        fvec3 d = item.destination;
+        if (d.x >= bottomRight.x || d.y >= bottomRight.y ||
+            d.x + item.image.width <= topLeft.x ||
+            d.y + item.image.height <= topLeft.y)
+            continue;
+
+        SortKey key = {depthKey(d.z), static_cast<U32>(i)};
+        keys.push(key);
+    }
+
+    radixSort();
+
+    out.resize(keys.size);
+    for (Size i = 0; i < keys.size; i++)
+        out.data[i] = items[keys.data[i].index];
+}
 
 static void
 pushLetterbox(DisplayList* display) noexcept {
@@ -45,6 +162,8 @@ popLetterbox() noexcept {
 
 void
 displayListPresent(DisplayList* display) noexcept {
+    ProfileScope scope(presentZone);
+
     pushLetterbox(display);
 
     // Zoom and pan the Area to fit on-screen.
@@ -52,10 +171,18 @@ displayListPresent(DisplayList* display) noexcept {
     windowPushScale(display->scale.x, display->scale.y);
     windowPushTranslate(-display->scroll.x, -display->scroll.y);
 
-    for (DisplayItem* item = display->items.begin();
-         item != display->items.end(); item++) {
-        imageDraw(item->image, item->destination.x, item->destination.y,
-                  item->destination.z);
+    displayListSort(display, sorted);
+
+    // Hand the renderer each run of items that share a texture at once.
+    Size start = 0;
+    while (start < sorted.size) {
+        void* texture = sorted.data[start].image.texture;
+        Size end = start + 1;
+        while (end < sorted.size && sorted.data[end].image.texture == texture)
+            end++;
+
+        imageDrawBatch(sorted.data + start, end - start);
+        start = end;
     }
 
     windowPopTranslate();
@@ -29,4 +29,9 @@ struct DisplayList {
 void
 displayListPresent(DisplayList* display) noexcept;
 
+// Fill sorted with the items that are on screen, back to front. Items at the
+// same depth keep the order they were added in.
+void
+displayListSort(DisplayList* display, Vector<DisplayItem>& sorted) noexcept;
+
 #endif  // SRC_TILES_DISPLAY_LIST_H_
@@ -0,0 +1,142 @@
+#include "tiles/entity-grid.h"
+
+#include "tiles/entity.h"
+#include "tiles/tile-grid.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/math2.h"
+#include "util/vector.h"
+
+EntityGrid::EntityGrid() noexcept : tiles(0), layerBuckets(0) {
+    chunks.x = 0;
+    chunks.y = 0;
+    chunks.z = 0;
+    chunkScale.x = 0.0f;
+    chunkScale.y = 0.0f;
+    maxImage.x = 0;
+    maxImage.y = 0;
+}
+
+static void
+layOut(EntityGrid& grid) noexcept {
+    TileGrid* tiles = grid.tiles;
+
+    grid.chunks = tiles->chunkDim();
+    grid.layerBuckets = static_cast<U32>(grid.chunks.x * grid.chunks.y);
+    grid.chunkScale.x = 1.0f / (tiles->tileDim.x << TILE_CHUNK_SHIFT);
+    grid.chunkScale.y = 1.0f / (tiles->tileDim.y << TILE_CHUNK_SHIFT);
+    grid.buckets.resize(grid.layerBuckets * grid.chunks.z + 1);
+}
+
+// Called each tick for every moving Entity, so the layer is looked up in
+// depth2idx only if the Entity's depth changed.
+static U32
+bucketOf(EntityGrid& grid, Entity* e) noexcept {
+    TileGrid* tiles = grid.tiles;
+    U32 unlayered = static_cast<U32>(grid.buckets.size - 1);
+
+    if (grid.layerBuckets == 0)
+        return unlayered;
+
+    U32 old = e->gridBucket;
+    U32 layer = old / grid.layerBuckets;
+    if (old >= unlayered || tiles->idx2depth[layer] != e->r.z) {
+        I32* idx = tiles->depth2idx.tryAt(e->r.z);
+        if (!idx)
+            return unlayered;
+        layer = static_cast<U32>(*idx);
+    }
+
+    I32 cx = static_cast<I32>(e->r.x * grid.chunkScale.x);
+    I32 cy = static_cast<I32>(e->r.y * grid.chunkScale.y);
+    cx = bound(cx, 0, grid.chunks.x - 1);
+    cy = bound(cy, 0, grid.chunks.y - 1);
+    return layer * grid.layerBuckets +
+           static_cast<U32>(cy * grid.chunks.x + cx);
+}
+
+static void
+addTo(EntityGrid& grid, Entity* e, U32 bucket) noexcept {
+    Vector<Entity*>& entities = grid.buckets[bucket];
+    e->gridBucket = bucket;
+    e->gridSlot = static_cast<U32>(entities.size);
+    entities.push(e);
+}
+
+void
+EntityGrid::insert(Entity* e) noexcept {
+    assert_(e->gridBucket == NO_GRID_BUCKET);
+
+    if (buckets.size == 0)
+        layOut(*this);
+
+    maxImage.x = max(maxImage.x, e->imgsz.x);
+    maxImage.y = max(maxImage.y, e->imgsz.y);
+
+    addTo(*this, e, bucketOf(*this, e));
+}
+
+void
+EntityGrid::update(Entity* e) noexcept {
+    U32 bucket = bucketOf(*this, e);
+    if (bucket != e->gridBucket) {
+        remove(e);
+        addTo(*this, e, bucket);
+    }
+}
+
+void
+EntityGrid::remove(Entity* e) noexcept {
+    Vector<Entity*>& entities = buckets[e->gridBucket];
+    Size i = e->gridSlot;
+    assert_(i < entities.size && entities[i] == e);
+
+    entities[i] = entities[entities.size - 1];
+    entities.pop();
+    if (i < entities.size)
+        entities[i]->gridSlot = static_cast<U32>(i);
+
+    e->gridBucket = NO_GRID_BUCKET;
+}
+
+void
+EntityGrid::query(icube pixels, Vector<Entity*>& out) noexcept {
+    if (layerBuckets == 0)
+        return;
+
+    // An Entity's image lies within maxImage of the tile it stands on.
+    ivec2 tile = tiles->tileDim;
+    I32 tx1 = (pixels.x1 - tile.x - maxImage.x) / tile.x;
+    I32 ty1 = (pixels.y1 - tile.y - maxImage.y) / tile.y;
+    I32 tx2 = (pixels.x2 + maxImage.x) / tile.x;
+    I32 ty2 = (pixels.y2 + maxImage.y) / tile.y;
+
+    // Entities beyond the edge of the grid are in the edge chunks, so the
+    // range is clamped rather than cut off.
+    I32 cx1 = bound(tx1 >> TILE_CHUNK_SHIFT, 0, chunks.x - 1);
+    I32 cy1 = bound(ty1 >> TILE_CHUNK_SHIFT, 0, chunks.y - 1);
+    I32 cx2 = bound(tx2 >> TILE_CHUNK_SHIFT, 0, chunks.x - 1);
+    I32 cy2 = bound(ty2 >> TILE_CHUNK_SHIFT, 0, chunks.y - 1);
+    I32 z1 = max(pixels.z1, 0);
+    I32 z2 = min(pixels.z2, chunks.z);
+
+    for (I32 z = z1; z < z2; z++) {
+        for (I32 cy = cy1; cy <= cy2; cy++) {
+            for (I32 cx = cx1; cx <= cx2; cx++) {
+                Vector<Entity*>& entities =
+                    buckets[(z * chunks.y + cy) * chunks.x + cx];
+                for (Size i = 0; i < entities.size; i++)
+                    out.push(entities[i]);
+            }
+        }
+    }
+}
+
+Size
+EntityGrid::memoryUsage() noexcept {
+    Size total = buckets.capacity * sizeof(Vector<Entity*>);
+    for (Size i = 0; i < buckets.size; i++)
+        total += buckets[i].capacity * sizeof(Entity*);
+    return total;
+}
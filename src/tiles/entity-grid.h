@@ -0,0 +1,69 @@
+#ifndef SRC_TILES_ENTITY_GRID_H_
+#define SRC_TILES_ENTITY_GRID_H_
+
+#include "tiles/vec.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/vector.h"
+
+class Entity;
+class TileGrid;
+
+// Entity::gridBucket of an Entity that is not in an EntityGrid.
+#define NO_GRID_BUCKET UINT32_MAX
+
+// The NPCs and Overlays of one Area, bucketed by the layer and the tile chunk
+// that they stand on.
+//
+// Drawing and redraw checks ask for the Entities near a range of pixels and
+// only visit the buckets of the chunks around it, so their cost follows the
+// number of Entities on-screen rather than the number in the Area. Entities
+// off the edge of the grid share the bucket of the nearest chunk. Entities
+// whose depth is not a layer of the grid are kept in a bucket of their own
+// that no query visits, since they cannot be drawn.
+//
+// An Entity's bucket must be refreshed with update() whenever Entity::r
+// changes.
+struct EntityGrid {
+    EntityGrid() noexcept;
+
+    // Add e, which must not be in an EntityGrid, to the bucket for its
+    // position.
+    void
+    insert(Entity* e) noexcept;
+
+    // Move e to the bucket for its current position.
+    void
+    update(Entity* e) noexcept;
+
+    void
+    remove(Entity* e) noexcept;
+
+    // Append to out every Entity on layers [pixels.z1, pixels.z2) whose image
+    // might intersect the pixels from (x1, y1) to (x2, y2). The caller still
+    // has to test each one exactly.
+    void
+    query(icube pixels, Vector<Entity*>& out) noexcept;
+
+    Size
+    memoryUsage() noexcept;
+
+    // Set by the Area that owns this.
+    TileGrid* tiles;
+
+    // Indexed like TileGrid::chunkVersions, followed by the bucket for
+    // Entities that are not on a layer. Laid out on the first insert().
+    Vector<Vector<Entity*>> buckets;
+
+    // TileGrid::chunkDim() when the buckets were laid out, the number of
+    // buckets per layer, and the reciprocal of a chunk's size in pixels.
+    ivec3 chunks;
+    U32 layerBuckets;
+    fvec2 chunkScale;
+
+    // Largest image of any Entity inserted so far, which bounds how far an
+    // Entity can be drawn from the tile it stands on.
+    ivec2 maxImage;
+};
+
+#endif  // SRC_TILES_ENTITY_GRID_H_
@@ -11,6 +11,7 @@
 #include "tiles/world.h"
 #include "util/assert.h"
 #include "util/compiler.h"
+#include "util/intern.h"
 #include "util/math2.h"
 
 #define CHECK(x)      \
@@ -49,6 +50,12 @@ parseScript(Entity* e, StringView name, StringView path) noexcept;
 // static static bool
 // setScript(Entity* e, StringView trigger, ScriptRef& script) noexcept;
 
+// Keys read from every entity descriptor.
+static constexpr11 JsonKey speedKey = "speed";
+static constexpr11 JsonKey spriteKey = "sprite";
+static constexpr11 JsonKey soundsKey = "sounds";
+static constexpr11 JsonKey scriptsKey = "scripts";
+
 static bool
 parseDescriptor(Entity* e) noexcept {
     JsonDocument document = loadJson(e->descriptor);
@@ -58,10 +65,10 @@ parseDescriptor(Entity* e) noexcept {
     JsonValue root = document.root;
     CHECK(root.isObject());
 
-    JsonValue speedValue = root["speed"];
-    JsonValue spriteValue = root["sprite"];
-    JsonValue soundsValue = root["sounds"];
-    JsonValue scriptsValue = root["scripts"];
+    JsonValue speedValue = root[speedKey];
+    JsonValue spriteValue = root[spriteKey];
+    JsonValue soundsValue = root[soundsKey];
+    JsonValue scriptsValue = root[scriptsKey];
 
     CHECK(speedValue.isNumber() || speedValue.isNull());
     CHECK(spriteValue.isObject() || spriteValue.isNull());
@@ -116,6 +123,7 @@ parseSprite(Entity* e, JsonValue sprite) noexcept {
 
     TiledImage tiles =
         tilesLoad(path, tileWidth, tileHeight, numAcross, numHigh);
+    e->sheet = tiles;
     CHECK(TILES_VALID(tiles));
 
     return parsePhases(e, phasesValue, tiles);
@@ -319,7 +327,13 @@ Entity::Entity() noexcept
       area(0),
       frozen(false),
       moving(false),
-      phase(0) {
+      motionSlot(NO_MOTION_SLOT),
+      gridBucket(NO_GRID_BUCKET),
+      gridSlot(0),
+      drawOrder(0),
+      sheet(),
+      phase(0),
+      phaseName() {
     r.x = 0.0;
     r.y = 0.0;
     r.z = 0.0;
@@ -327,7 +341,13 @@ Entity::Entity() noexcept
     facing.y = 0;
 }
 
-Entity::~Entity() noexcept { }
+Entity::~Entity() noexcept {
+    if (motionSlot != NO_MOTION_SLOT)
+        area->motion.remove(this);
+    if (gridBucket != NO_GRID_BUCKET)
+        area->entityGrid.remove(this);
+    tilesRelease(sheet);
+}
 
 bool
 Entity::init(StringView descriptor, StringView initialPhase) noexcept {
@@ -339,6 +359,9 @@ Entity::init(StringView descriptor, StringView initialPhase) noexcept {
 
 void
 Entity::destroy() noexcept {
+    stopMoving();
+    if (gridBucket != NO_GRID_BUCKET)
+        area->entityGrid.remove(this);
     dead = true;
     if (area)
         area->requestRedraw();
@@ -386,7 +409,11 @@ Entity::needsRedraw(icube& visiblePixels) noexcept {
     // At this point, we know the entity is visible, and has either moved since
     // the last frame or it wants to update its animation frame. Now we check
     // if it is on-screen.
+    return inView(visiblePixels);
+}
 
+bool
+Entity::inView(icube& visiblePixels) noexcept {
     // X-axis is centered on tile.
     I32 maxX = (area->grid.tileDim.x + imgsz.x) / 2 + static_cast<I32>(r.x);
     I32 minX = maxX - imgsz.x;
@@ -458,6 +485,14 @@ Entity::getPixelCoord() noexcept {
     return r;
 }
 
+void
+Entity::setPixelCoord(fvec3 coord) noexcept {
+    r = coord;
+    if (motionSlot != NO_MOTION_SLOT)
+        area->motion.update(this);
+    reindex();
+}
+
 Area*
 Entity::getArea() noexcept {
     return area;
@@ -465,12 +500,25 @@ Entity::getArea() noexcept {
 
 void
 Entity::setArea(Area* area) noexcept {
+    if (motionSlot != NO_MOTION_SLOT)
+        this->area->motion.remove(this);
+
+    // Entities drawn from a grid follow themselves to the new Area's grid.
+    bool gridded = gridBucket != NO_GRID_BUCKET;
+    if (gridded)
+        this->area->entityGrid.remove(this);
+
     this->area = area;
     calcDraw();
 
     if (confMoveMode != TURN)
         assert_(area->grid.tileDim.x == area->grid.tileDim.y);
     pixelsPerSecond = tilesPerSecond * area->grid.tileDim.x;
+
+    if (moving)
+        area->motion.add(this);
+    if (gridded)
+        area->entityGrid.insert(this);
 }
 
 float
@@ -499,6 +547,30 @@ Entity::attach(OnTurnFn fn) noexcept {
     onTurnFns.push(static_cast<OnTurnFn&&>(fn));
 }
 
+void
+Entity::arrive(Time rollover) noexcept {
+    r = destCoord;
+    moving = false;
+    reindex();
+    arrived();
+
+    // If arrived() starts a new movement, rollover unused traveled pixels and
+    // leave the moving animation.
+    if (moving) {
+        if (motionSlot != NO_MOTION_SLOT)
+            area->motion.advance(this, rollover);
+    }
+    else {
+        setAnimationStanding();
+    }
+}
+
+void
+Entity::reindex() noexcept {
+    if (gridBucket != NO_GRID_BUCKET)
+        area->entityGrid.update(this);
+}
+
 void
 Entity::calcDraw() noexcept {
     if (area) {
@@ -547,11 +619,15 @@ Entity::_setPhase(StringView name) noexcept {
     else
         return PHASE_NOTFOUND;
 
+    // The descriptor did not define this phase.
+    if (newPhase->id == NO_ANIMATION)
+        return PHASE_NOTFOUND;
+
     if (phase != newPhase) {
         Time now = worldTime();
         phase = newPhase;
         phase->restart(now);
-        phaseName = name;
+        phaseName = intern(name);
         redraw = true;
         return PHASE_CHANGED;
     }
@@ -563,42 +639,24 @@ Entity::setDestinationCoordinate(fvec3 destCoord) noexcept {
     // Set z right away so that we're on-level with the square we're
     // entering.
     r.z = destCoord.z;
+    reindex();
 
     this->destCoord = destCoord;
-    angleToDest = atan2f(destCoord.y - r.y, destCoord.x - r.x);
+    if (motionSlot != NO_MOTION_SLOT)
+        area->motion.update(this);
 }
 
 void
-Entity::moveTowardDestination(Time dt) noexcept {
-    if (!moving)
-        return;
-
-    redraw = true;
+Entity::startMoving() noexcept {
+    moving = true;
+    area->motion.add(this);
+}
 
-    float traveledPixels = pixelsPerSecond * static_cast<float>(dt) / 1000.0f;
-    float toDestPixels = distanceTo(r, destCoord);
-    if (toDestPixels > traveledPixels) {
-        // The destination has not been reached yet.
-        r.x += cosf(angleToDest) * traveledPixels;
-        r.y += sinf(angleToDest) * traveledPixels;
-    }
-    else {
-        // We have arrived at the destination.
-        r = destCoord;
-        moving = false;
-        arrived();
-
-        // If arrived() starts a new movement, rollover unused traveled
-        // pixels and leave the the moving animation.
-        if (moving) {
-            float percent = 1.0f - toDestPixels / traveledPixels;
-            Time rem = static_cast<Time>(percent * static_cast<float>(dt));
-            moveTowardDestination(rem);
-        }
-        else {
-            setAnimationStanding();
-        }
-    }
+void
+Entity::stopMoving() noexcept {
+    moving = false;
+    if (motionSlot != NO_MOTION_SLOT)
+        area->motion.remove(this);
 }
 
 void
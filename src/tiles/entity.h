@@ -2,10 +2,13 @@
 #define SRC_TILES_ENTITY_H_
 
 #include "tiles/animation.h"
+#include "tiles/entity-grid.h"
 #include "tiles/images.h"
+#include "tiles/motion.h"
 #include "tiles/vec.h"
 #include "util/compiler.h"
 #include "util/function.h"
+#include "util/intern.h"
 #include "util/string-view.h"
 #include "util/string.h"
 #include "util/vector.h"
@@ -44,6 +47,9 @@ class Entity {
     draw(DisplayList* display) noexcept;
     bool
     needsRedraw(icube& visiblePixels) noexcept;
+    // Whether the Entity's image intersects a range of pixels.
+    bool
+    inView(icube& visiblePixels) noexcept;
     bool
     isDead() noexcept;
 
@@ -78,6 +84,8 @@ class Entity {
     // Tile the Entity is standing on.
     fvec3
     getPixelCoord() noexcept;
+    void
+    setPixelCoord(fvec3 coord) noexcept;
 
 
     // Gets the Entity's current Area.
@@ -113,6 +121,16 @@ class Entity {
     void
     attach(OnTurnFn fn) noexcept;
 
+    // Called by MotionStore when the Entity reaches destCoord, after it has
+    // left the store. rollover is the part of the tick's time that was not
+    // needed to get there.
+    void
+    arrive(Time rollover) noexcept;
+
+    // Keep area->entityGrid up to date after r changes.
+    void
+    reindex() noexcept;
+
     // Script hooks.
     // ScriptRef tickScript, turnScript, tileEntryScript,
     //            tileExitScript;
@@ -132,8 +150,12 @@ class Entity {
     void
     setDestinationCoordinate(fvec3 destCoord) noexcept;
 
+    // Begin or end movement toward destCoord. While moving, the Entity is
+    // advanced by its Area's MotionStore.
+    void
+    startMoving() noexcept;
     void
-    moveTowardDestination(Time dt) noexcept;
+    stopMoving() noexcept;
 
     // arrived() is called when an Entity arrives at its destination.  If
     // it is ordered to begin moving again from within arrived(), then the
@@ -166,11 +188,22 @@ class Entity {
     bool moving;
 
     fvec3 destCoord;
-    float angleToDest;
+
+    // Index in area->motion while moving, or NO_MOTION_SLOT.
+    U32 motionSlot;
+
+    // Bucket in area->entityGrid and index within it, or NO_GRID_BUCKET if
+    // the Area does not draw this Entity from its grid, as with the Player.
+    U32 gridBucket;
+    U32 gridSlot;
+
+    // Entities on the same layer are drawn in increasing drawOrder.
+    U32 drawOrder;
 
     ivec2 imgsz;
+    TiledImage sheet;  // Released along with the Entity.
     Animation* phase;
-    String phaseName;
+    Symbol phaseName;
     ivec2 facing;
 
     Animation phaseStance;
@@ -0,0 +1,143 @@
+#include "tiles/image-decode.h"
+
+#include "tiles/bmp.h"
+#include "tiles/log.h"
+#include "tiles/resources.h"
+#include "util/atomic.h"
+#include "util/compiler.h"
+#include "util/function.h"
+#include "util/int.h"
+#include "util/jobs.h"
+#include "util/measure.h"
+#include "util/profile.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+static ProfileZone uploadZone("imageDecodeUpload");
+
+struct Decode {
+    // Counts the job until it has finished. Until then, only the job touches
+    // the fields below.
+    JobCounter running;
+    bool ok;
+    StringView data;
+    String storage;
+    DecodedImage image;
+};
+
+// Decodes that have been started and not yet uploaded, oldest first. Ones
+// that finish are uploaded even while older ones are still running. Only for
+// the main thread.
+static Vector<Decode*> decodes;
+
+// Whether an image has been passed to upload since the last call to
+// imageDecodeNeedsRedraw().
+static bool uploaded = false;
+
+static bool
+decode(StringView data, DecodedImage& image) noexcept {
+    return bmpDecode(data, image.pixels, &image.width, &image.height);
+}
+
+// Only for the main thread, since logging an error may show a message box or
+// break into a debugger. The image is left blank.
+static void
+logInvalid(DecodedImage& image) noexcept {
+    logErr("Images", String() << "Invalid image: " << image.path);
+}
+
+bool
+imageDecode(StringView path, DecodedImage& image) noexcept {
+    image.path = path;
+
+    StringView data;
+    String storage;
+    if (!resourceLoadView(path, data, storage)) {
+        // Error logged.
+        return false;
+    }
+
+    TimeMeasure m(String() << "Constructed " << image.path << " as image");
+
+    if (!decode(data, image)) {
+        logInvalid(image);
+        return false;
+    }
+
+    return true;
+}
+
+static void
+runDecode(void* data) noexcept {
+    Decode* d = static_cast<Decode*>(data);
+    d->ok = decode(d->data, d->image);
+}
+
+bool
+imageDecodeStart(Handle handle, StringView path) noexcept {
+    Decode* d = new Decode;
+    d->ok = false;
+    d->image.handle = handle;
+    d->image.path = path;
+
+    // The file is found on this thread, where loads are recorded for the
+    // next time the area is prefetched. It is usually either viewed in the
+    // memory-mapped data file or already read by a prefetch.
+    if (!resourceLoadView(path, d->data, d->storage)) {
+        // Error logged.
+        delete d;
+        return false;
+    }
+
+    decodes.push(d);
+
+    Function fn = {runDecode, d};
+    JobsEnqueue(fn, &d->running);
+    return true;
+}
+
+void
+imageDecodeUpload(Size budget,
+                  void (*upload)(DecodedImage& image) noexcept) noexcept {
+    if (decodes.size == 0)
+        return;
+
+    ProfileScope scope(uploadZone);
+
+    Size bytes = 0;
+    for (Size i = 0; i < decodes.size && (budget == 0 || bytes < budget);) {
+        Decode* d = decodes[i];
+        if (atomicLoadAcquire(&d->running.value) > 0) {
+            i++;
+            continue;
+        }
+
+        if (d->ok) {
+            upload(d->image);
+            uploaded = true;
+            bytes += d->image.pixels.size * sizeof(U32);
+        }
+        else {
+            logInvalid(d->image);
+        }
+
+        decodes.erase(i);
+        delete d;
+    }
+}
+
+void
+imageDecodeFlush(void (*upload)(DecodedImage& image) noexcept) noexcept {
+    for (Size i = 0; i < decodes.size; i++)
+        JobsWait(&decodes[i]->running);
+
+    imageDecodeUpload(0, upload);
+}
+
+bool
+imageDecodeNeedsRedraw() noexcept {
+    bool redraw = uploaded || decodes.size > 0;
+    uploaded = false;
+    return redraw;
+}
@@ -0,0 +1,57 @@
+#ifndef SRC_TILES_IMAGE_DECODE_H_
+#define SRC_TILES_IMAGE_DECODE_H_
+
+#include "util/compiler.h"
+#include "util/handle-table.h"
+#include "util/int.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+// Image decoding
+//
+// Renderers load images in two stages. Decoding an image file into pixels is
+// done on a worker thread, and the main thread then copies the pixels to the
+// place the renderer's Atlas set aside for them. The copies are spread over
+// frames so that no one frame waits on many of them.
+
+struct DecodedImage {
+    Handle handle;  // The image's entry in the renderer's Atlas.
+    String path;
+
+    U32 width;
+    U32 height;
+    Vector<U32> pixels;  // Packed as by bmpDecode().
+};
+
+// Decode an image on this thread. Errors are logged.
+bool
+imageDecode(StringView path, DecodedImage& image) noexcept;
+
+// Start decoding an image on a worker thread. It is passed to the upload
+// function of a later imageDecodeUpload() or imageDecodeFlush() if it
+// decodes, and forgotten with an error logged if it does not. Returns false,
+// with an error logged, if there is no file at path.
+bool
+imageDecodeStart(Handle handle, StringView path) noexcept;
+
+// Pass images that have finished decoding to upload, oldest first, until
+// budget bytes of pixels have been passed. Images still decoding are skipped,
+// so a later image may be passed before an earlier one. At least one image is
+// passed if any is ready. A budget of 0 is no limit.
+void
+imageDecodeUpload(Size budget,
+                  void (*upload)(DecodedImage& image) noexcept) noexcept;
+
+// Wait for every image that has been started to decode, then pass them all to
+// upload.
+void
+imageDecodeFlush(void (*upload)(DecodedImage& image) noexcept) noexcept;
+
+// Whether another frame should be drawn for the sake of images: some have been
+// started and not yet passed to upload, or some have been passed to upload
+// since the last call.
+bool
+imageDecodeNeedsRedraw() noexcept;
+
+#endif  // SRC_TILES_IMAGE_DECODE_H_
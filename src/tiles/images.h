@@ -36,6 +36,13 @@ imageLoad(StringView path) noexcept;
 void
 imageDraw(Image image, float x, float y, float z) noexcept;
 
+struct DisplayItem;
+
+// Draw a run of items that all use the same texture, in order. Renderers that
+// can draw them with a single call do so.
+void
+imageDrawBatch(DisplayItem* items, Size count) noexcept;
+
 void
 imageRelease(Image image) noexcept;
 
@@ -66,6 +73,14 @@ void
 imageDrawRect(float left, float right, float top, float bottom, float z,
               U32 argb) noexcept;
 
+// Begin a frame by clearing the screen.
+void
+imageStartFrame() noexcept;
+
+// Finish drawing a frame and show it.
+void
+imageEndFrame() noexcept;
+
 void
 imageFlushImages() noexcept;
 
@@ -7,7 +7,9 @@
 #include "tiles/world.h"
 #include "util/compiler.h"
 #include "util/io.h"
+#include "util/jobs.h"
 #include "util/measure.h"
+#include "util/profile.h"
 #include "util/random.h"
 
 #if MSVC
@@ -37,6 +39,8 @@ main() noexcept {
 
     logInit();
 
+    JobsInit();
+
 #if defined(__APPLE__) && (!defined(WINDOW_NULL) || !defined(AUDIO_NULL))
     macSetWorkingDirectory();
 #endif
@@ -58,6 +62,11 @@ main() noexcept {
 
     windowMainLoop();
 
+    // Let the worker threads quit before static destructors run.
+    JobsQuit();
+
+    profileDump();
+
     return 0;
 }
 
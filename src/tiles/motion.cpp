@@ -0,0 +1,186 @@
+#include "tiles/motion.h"
+
+#include "os/c.h"
+#include "tiles/entity.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/vector.h"
+
+template<typename T>
+static void
+swapRemove(Vector<T>& v, Size i) noexcept {
+    v[i] = v[v.size - 1];
+    v.pop();
+}
+
+void
+MotionStore::add(Entity* e) noexcept {
+    if (e->motionSlot != NO_MOTION_SLOT) {
+        update(e);
+        return;
+    }
+
+    e->motionSlot = static_cast<U32>(entities.size);
+
+    entities.push(e);
+    xs.push(0.0f);
+    ys.push(0.0f);
+    destXs.push(0.0f);
+    destYs.push(0.0f);
+    dirXs.push(0.0f);
+    dirYs.push(0.0f);
+    speeds.push(0.0f);
+    overshoots.push(0.0f);
+
+    update(e);
+}
+
+void
+MotionStore::update(Entity* e) noexcept {
+    Size i = e->motionSlot;
+    assert_(i < entities.size && entities[i] == e);
+
+    float dx = e->destCoord.x - e->r.x;
+    float dy = e->destCoord.y - e->r.y;
+    float distance = sqrtf(dx * dx + dy * dy);
+
+    xs[i] = e->r.x;
+    ys[i] = e->r.y;
+    destXs[i] = e->destCoord.x;
+    destYs[i] = e->destCoord.y;
+    dirXs[i] = distance > 0.0f ? dx / distance : 0.0f;
+    dirYs[i] = distance > 0.0f ? dy / distance : 0.0f;
+    speeds[i] = e->pixelsPerSecond;
+}
+
+void
+MotionStore::remove(Entity* e) noexcept {
+    Size i = e->motionSlot;
+    assert_(i < entities.size && entities[i] == e);
+
+    swapRemove(entities, i);
+    swapRemove(xs, i);
+    swapRemove(ys, i);
+    swapRemove(destXs, i);
+    swapRemove(destYs, i);
+    swapRemove(dirXs, i);
+    swapRemove(dirYs, i);
+    swapRemove(speeds, i);
+    swapRemove(overshoots, i);
+
+    if (i < entities.size)
+        entities[i]->motionSlot = static_cast<U32>(i);
+    e->motionSlot = NO_MOTION_SLOT;
+}
+
+// The distance to the destination is measured each tick, as the rollover
+// into the next movement depends on it.
+static inline float
+overshoot(float travel, float distance) noexcept {
+    if (distance < travel)
+        return 1.0f - distance / travel;
+    return distance == travel ? 0.0f : -1.0f;
+}
+
+void
+MotionStore::tick(Time dt) noexcept {
+    Size n = entities.size;
+    float time = static_cast<float>(dt);
+
+    float* x = xs.data;
+    float* y = ys.data;
+    const float* destX = destXs.data;
+    const float* destY = destYs.data;
+    const float* dirX = dirXs.data;
+    const float* dirY = dirYs.data;
+    const float* speed = speeds.data;
+    float* over = overshoots.data;
+
+    // No branches or calls, so the compiler can vectorize this.
+    for (Size i = 0; i < n; i++) {
+        float travel = speed[i] * time / 1000.0f;
+        float dx = destX[i] - x[i];
+        float dy = destY[i] - y[i];
+        float distance = sqrtf(dx * dx + dy * dy);
+
+        float step = distance > travel ? travel : 0.0f;
+        x[i] += dirX[i] * step;
+        y[i] += dirY[i] * step;
+        over[i] = overshoot(travel, distance);
+    }
+
+    arrivals.clear();
+    arrivalOvershoots.clear();
+
+    for (Size i = 0; i < n; i++) {
+        Entity* e = entities[i];
+        e->r.x = x[i];
+        e->r.y = y[i];
+        e->redraw = true;
+        e->reindex();
+
+        if (over[i] >= 0.0f) {
+            arrivals.push(e);
+            arrivalOvershoots.push(over[i]);
+        }
+    }
+
+    // Leave the store before any arrived() runs, since it may start a new
+    // movement or move the Entity to another Area.
+    for (Size i = 0; i < arrivals.size; i++)
+        remove(arrivals[i]);
+
+    for (Size i = 0; i < arrivals.size; i++) {
+        Entity* e = arrivals[i];
+
+        // An earlier arrived() may have stopped e or started it on a new
+        // movement, which this arrival would cut short.
+        if (!e->moving || e->motionSlot != NO_MOTION_SLOT)
+            continue;
+
+        Time rollover = static_cast<Time>(arrivalOvershoots[i] * time);
+        e->arrive(rollover);
+    }
+}
+
+void
+MotionStore::advance(Entity* e, Time dt) noexcept {
+    Size i = e->motionSlot;
+    assert_(i < entities.size && entities[i] == e);
+
+    float time = static_cast<float>(dt);
+    float travel = speeds[i] * time / 1000.0f;
+    float dx = destXs[i] - xs[i];
+    float dy = destYs[i] - ys[i];
+    float distance = sqrtf(dx * dx + dy * dy);
+
+    e->redraw = true;
+
+    if (distance > travel) {
+        xs[i] += dirXs[i] * travel;
+        ys[i] += dirYs[i] * travel;
+        e->r.x = xs[i];
+        e->r.y = ys[i];
+        e->reindex();
+        return;
+    }
+
+    float rest = overshoot(travel, distance);
+
+    remove(e);
+    e->arrive(static_cast<Time>(rest * time));
+}
+
+template<typename T>
+static Size
+bytes(Vector<T>& v) noexcept {
+    return v.capacity * sizeof(T);
+}
+
+Size
+MotionStore::memoryUsage() noexcept {
+    return bytes(entities) + bytes(xs) + bytes(ys) + bytes(destXs) +
+           bytes(destYs) + bytes(dirXs) + bytes(dirYs) + bytes(speeds) +
+           bytes(overshoots) + bytes(arrivals) + bytes(arrivalOvershoots);
+}
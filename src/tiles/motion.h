@@ -0,0 +1,71 @@
+#ifndef SRC_TILES_MOTION_H_
+#define SRC_TILES_MOTION_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/vector.h"
+
+class Entity;
+
+// Entity::motionSlot of an Entity that is not in a MotionStore.
+#define NO_MOTION_SLOT UINT32_MAX
+
+// The Entities of one Area that are walking toward a destination.
+//
+// Each field is kept in its own array, indexed by the Entity's slot, so that
+// Area::tick() can advance every moving Entity in one loop without following
+// pointers or calling virtual functions. Entity::r mirrors the position and
+// is written back once per tick. Arrivals are collected during the loop and
+// delivered through Entity::arrive() afterward, so Entity::arrived() can
+// start a new movement, change Areas, or destroy the Entity. An arrival is
+// dropped if an earlier one's arrived() stops or restarts its Entity.
+struct MotionStore {
+    // Start moving e toward e->destCoord at e->pixelsPerSecond.
+    void
+    add(Entity* e) noexcept;
+
+    // Pick up a change to e's position, destination, or speed.
+    void
+    update(Entity* e) noexcept;
+
+    void
+    remove(Entity* e) noexcept;
+
+    // Advance every Entity as if dt milliseconds had passed.
+    void
+    tick(Time dt) noexcept;
+
+    // Advance one Entity, for movement that starts partway through a tick.
+    void
+    advance(Entity* e, Time dt) noexcept;
+
+    Size
+    memoryUsage() noexcept;
+
+    Vector<Entity*> entities;
+
+    // Position.
+    Vector<float> xs;
+    Vector<float> ys;
+
+    // Destination.
+    Vector<float> destXs;
+    Vector<float> destYs;
+
+    // Unit vector toward the destination, from where the movement began.
+    Vector<float> dirXs;
+    Vector<float> dirYs;
+
+    // Pixels per second.
+    Vector<float> speeds;
+
+    // Fraction of the last tick's travel that was not needed to reach the
+    // destination, or -1 if the destination was not reached.
+    Vector<float> overshoots;
+
+    // Entities that arrived during the last tick, and their overshoots.
+    Vector<Entity*> arrivals;
+    Vector<float> arrivalOvershoots;
+};
+
+#endif  // SRC_TILES_MOTION_H_
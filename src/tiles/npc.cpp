@@ -7,7 +7,7 @@ NPC::arrived() noexcept {
 
     if (destExit) {
         moving = false;  // Prevent time rollover check in
-                         // Entity::moveTowardDestination().
+                         // Entity::arrive().
         destroy();
     }
 }
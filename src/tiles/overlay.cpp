@@ -4,15 +4,9 @@
 #include "tiles/client-conf.h"
 #include "util/compiler.h"
 
-void
-Overlay::tick(Time dt) noexcept {
-    Entity::tick(dt);
-    moveTowardDestination(dt);
-}
-
 void
 Overlay::teleport(vicoord coord) noexcept {
-    r = area->grid.virt2virt(coord);
+    setPixelCoord(area->grid.virt2virt(coord));
     redraw = true;
 }
 
@@ -28,10 +22,10 @@ Overlay::driftTo(ivec2 xy) noexcept {
     setDestinationCoordinate(destCoord);
 
     pickFacingForAngle();
-    moving = true;
+    startMoving();
     setAnimationMoving();
 
-    // Movement happens in Entity::moveTowardDestination() during tick().
+    // Movement happens in MotionStore::tick() during Area::tick().
 }
 
 void
@@ -9,9 +9,6 @@ class Overlay : public Entity {
     Overlay() noexcept { }
     virtual ~Overlay() noexcept { }
 
-    void
-    tick(Time dt) noexcept;
-
     void
     teleport(vicoord coord) noexcept;
 
@@ -0,0 +1,462 @@
+#include "tiles/pathfinding.h"
+
+#include "os/c.h"
+#include "os/thread.h"
+#include "tiles/tile-grid.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/jobs.h"
+#include "util/math2.h"
+#include "util/vector.h"
+
+// How many flow fields each FlowFields keeps.
+#define FLOW_FIELD_CACHE 8
+
+// Batches smaller than this are not worth spreading across threads.
+#define PATH_JOB_MIN 16
+
+#define NOWALK_PLANES \
+    (TILE_NOWALK | TILE_NOWALK_PLAYER | TILE_NOWALK_NPC | TILE_OCCUPIED)
+
+// In the order of EXIT_UP, EXIT_DOWN, EXIT_LEFT, and EXIT_RIGHT.
+static const ivec2 facings[4] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+static bool
+inGrid(TileGrid& grid, ivec3 phys) noexcept {
+    return 0 <= phys.x && phys.x < grid.dim.x && 0 <= phys.y &&
+           phys.y < grid.dim.y && 0 <= phys.z && phys.z < grid.dim.z;
+}
+
+static U32
+tileIndex(TileGrid& grid, ivec3 phys) noexcept {
+    return static_cast<U32>((phys.z * grid.dim.y + phys.y) * grid.dim.x +
+                            phys.x);
+}
+
+static ivec3
+tileAt(TileGrid& grid, U32 index) noexcept {
+    U32 w = static_cast<U32>(grid.dim.x);
+    U32 h = static_cast<U32>(grid.dim.y);
+    ivec3 phys = {static_cast<I32>(index % w),
+                  static_cast<I32>(index / w % h),
+                  static_cast<I32>(index / w / h)};
+    return phys;
+}
+
+// Find where a step from a tile in a direction would end, like
+// TileGrid::moveDest(). Returns false if the step is not allowed.
+//
+// Searches may run on several threads at once, so this only reads from the
+// grid's hashmaps with tryAt(), which does not rehash them.
+static bool
+stepFrom(TileGrid& grid, ivec3 from, ivec2 facing, U32 nowalk,
+         ivec3* dest) noexcept {
+    ivec3 to = {from.x + facing.x, from.y + facing.y, from.z};
+
+    float* layermod = grid.layermodAt(from, facing);
+    if (layermod) {
+        I32* z = grid.depth2idx.tryAt(*layermod);
+        if (!z)
+            return false;
+        to.z = *z;
+    }
+
+    if (!inGrid(grid, to))
+        return false;
+    if (grid.tileFlags(to, nowalk & NOWALK_PLANES))
+        return false;
+    if (nowalk & TILE_NOWALK_EXIT) {
+        if (grid.exitAt(from, facing) || grid.exits[EXIT_NORMAL].tryAt(to))
+            return false;
+    }
+
+    // Like Character::arrived(), a layermod on the tile itself moves the
+    // Character to another layer once it gets there.
+    float* arrival = grid.layermods[EXIT_NORMAL].tryAt(to);
+    if (arrival) {
+        I32* z = grid.depth2idx.tryAt(*arrival);
+        if (!z)
+            return false;
+        to.z = *z;
+    }
+
+    *dest = to;
+    return true;
+}
+
+
+/*
+ * A*
+ */
+
+struct OpenTile {
+    // Estimated length of a path through the tile, with ties broken toward
+    // tiles that are further along.
+    U64 priority;
+    U32 tile;
+};
+
+// Per-tile state of searches. A tile's state belongs to the current search
+// only if its stamp matches, so it does not have to be cleared in between.
+struct PathScratch {
+    PathScratch() noexcept : search(0) { }
+
+    Vector<U32> stamps;
+    Vector<U32> costs;
+    Vector<U32> parents;
+    Vector<OpenTile> open;
+    U32 search;
+};
+
+static void
+pushOpen(Vector<OpenTile>& heap, OpenTile tile) noexcept {
+    heap.push(tile);
+    Size i = heap.size - 1;
+    while (i > 0) {
+        Size parent = (i - 1) / 2;
+        if (heap[parent].priority <= tile.priority)
+            break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = tile;
+}
+
+static OpenTile
+popOpen(Vector<OpenTile>& heap) noexcept {
+    OpenTile top = heap[0];
+    OpenTile last = heap[heap.size - 1];
+    heap.pop();
+
+    Size n = heap.size;
+    Size i = 0;
+    while (2 * i + 1 < n) {
+        Size child = 2 * i + 1;
+        if (child + 1 < n && heap[child + 1].priority < heap[child].priority)
+            child++;
+        if (last.priority <= heap[child].priority)
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (n)
+        heap[i] = last;
+    return top;
+}
+
+static U64
+priority(U32 cost, U32 estimate) noexcept {
+    return (static_cast<U64>(cost + estimate) << 32) | (UINT32_MAX - cost);
+}
+
+static U32
+estimate(ivec3 from, ivec3 to) noexcept {
+    // Every step moves one tile along x or y, while layermods change the
+    // layer for free, so this never overestimates.
+    I32 dx = to.x - from.x;
+    I32 dy = to.y - from.y;
+    return static_cast<U32>((dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy));
+}
+
+static bool
+search(TileGrid& grid, PathRequest& request, PathScratch& scratch) noexcept {
+    request.steps.clear();
+    request.found = false;
+
+    ivec3 from = request.from;
+    ivec3 to = request.to;
+    if (!inGrid(grid, from) || !inGrid(grid, to))
+        return false;
+    if (from.x == to.x && from.y == to.y && from.z == to.z) {
+        request.found = true;
+        return true;
+    }
+
+    Size tiles = static_cast<Size>(grid.dim.x) * grid.dim.y * grid.dim.z;
+    if (scratch.stamps.size != tiles) {
+        scratch.stamps.resize(tiles);
+        scratch.costs.resize(tiles);
+        scratch.parents.resize(tiles);
+        memset(scratch.stamps.data, 0, tiles * sizeof(U32));
+        scratch.search = 0;
+    }
+
+    if (++scratch.search == 0) {
+        memset(scratch.stamps.data, 0, tiles * sizeof(U32));
+        scratch.search = 1;
+    }
+    U32 stamp = scratch.search;
+    Vector<OpenTile>& open = scratch.open;
+    open.clear();
+
+    U32 start = tileIndex(grid, from);
+    U32 goal = tileIndex(grid, to);
+    scratch.stamps[start] = stamp;
+    scratch.costs[start] = 0;
+    scratch.parents[start] = start;
+    OpenTile first = {priority(0, estimate(from, to)), start};
+    pushOpen(open, first);
+
+    Size visits = 0;
+    while (open.size) {
+        OpenTile current = popOpen(open);
+        U32 cost = UINT32_MAX - static_cast<U32>(current.priority);
+
+        // Skip tiles that were reached by a shorter path after this entry was
+        // added.
+        if (cost != scratch.costs[current.tile])
+            continue;
+        if (current.tile == goal)
+            break;
+        if (request.maxVisits && ++visits > request.maxVisits)
+            return false;
+
+        ivec3 here = tileAt(grid, current.tile);
+        for (Size i = 0; i < 4; i++) {
+            ivec3 next;
+            if (!stepFrom(grid, here, facings[i], request.nowalk, &next))
+                continue;
+
+            U32 n = tileIndex(grid, next);
+            if (scratch.stamps[n] == stamp && scratch.costs[n] <= cost + 1)
+                continue;
+
+            scratch.stamps[n] = stamp;
+            scratch.costs[n] = cost + 1;
+            scratch.parents[n] = current.tile;
+            OpenTile tile = {priority(cost + 1, estimate(next, to)), n};
+            pushOpen(open, tile);
+        }
+    }
+
+    if (scratch.stamps[goal] != stamp)
+        return false;
+
+    // Walk back from the goal, then put the steps in order.
+    for (U32 tile = goal; tile != start; tile = scratch.parents[tile]) {
+        ivec3 a = tileAt(grid, scratch.parents[tile]);
+        ivec3 b = tileAt(grid, tile);
+        ivec2 facing = {b.x - a.x, b.y - a.y};
+        request.steps.push(facing);
+    }
+    for (Size i = 0, j = request.steps.size - 1; i < j; i++, j--) {
+        ivec2 facing = request.steps[i];
+        request.steps[i] = request.steps[j];
+        request.steps[j] = facing;
+    }
+
+    request.found = true;
+    return true;
+}
+
+bool
+pathFind(TileGrid& grid, PathRequest& request) noexcept {
+    PathScratch scratch;
+    return search(grid, request, scratch);
+}
+
+struct PathJob {
+    TileGrid* grid;
+    PathRequest* requests;
+    Size count;
+};
+
+static void
+runPathJob(void* data) noexcept {
+    PathJob* job = static_cast<PathJob*>(data);
+
+    PathScratch scratch;
+    for (Size i = 0; i < job->count; i++)
+        search(*job->grid, job->requests[i], scratch);
+}
+
+void
+pathFindAll(TileGrid& grid, PathRequest* requests, Size count) noexcept {
+    Size jobs = min(count / PATH_JOB_MIN,
+                    static_cast<Size>(threadHardwareConcurrency()));
+    if (jobs < 2) {
+        PathScratch scratch;
+        for (Size i = 0; i < count; i++)
+            search(grid, requests[i], scratch);
+        return;
+    }
+
+    Vector<PathJob> batches;
+    batches.resize(jobs);
+
+    JobCounter counter;
+    Size begin = 0;
+    for (Size i = 0; i < jobs; i++) {
+        Size end = count * (i + 1) / jobs;
+        PathJob& job = batches[i];
+        job.grid = &grid;
+        job.requests = requests + begin;
+        job.count = end - begin;
+        begin = end;
+
+        Function fn = {runPathJob, &job};
+        JobsEnqueue(fn, &counter);
+    }
+    JobsWait(&counter);
+}
+
+
+/*
+ * Flow fields
+ */
+
+struct FlowField {
+    ivec3 target;
+    U32 nowalk;
+
+    // TileGrid::flagsVersion when the field was built.
+    U32 version;
+
+    // Steps from each tile to the target, indexed like TileGrid::graphics.
+    Vector<U16> distances;
+};
+
+FlowFields::FlowFields() noexcept { }
+
+FlowFields::~FlowFields() noexcept {
+    for (Size i = 0; i < fields.size; i++)
+        delete fields[i];
+}
+
+static void
+build(TileGrid& grid, FlowField& field, Vector<U32>& queue) noexcept {
+    Size tiles = static_cast<Size>(grid.dim.x) * grid.dim.y * grid.dim.z;
+    field.distances.resize(tiles);
+    memset(field.distances.data, 0xFF, tiles * sizeof(U16));
+    field.version = grid.flagsVersion;
+
+    if (!inGrid(grid, field.target))
+        return;
+
+    queue.clear();
+    U32 target = tileIndex(grid, field.target);
+    field.distances[target] = 0;
+    queue.push(target);
+
+    // Visit tiles in order of distance, finding the tiles that can step onto
+    // each one.
+    for (Size head = 0; head < queue.size; head++) {
+        U32 tile = queue[head];
+        U32 distance = field.distances[tile] + 1u;
+        if (distance >= PATH_UNREACHABLE)
+            break;
+
+        ivec3 here = tileAt(grid, tile);
+        for (Size i = 0; i < 4; i++) {
+            ivec2 facing = facings[i];
+            ivec3 from = {here.x - facing.x, here.y - facing.y, here.z};
+            if (!inGrid(grid, from))
+                continue;
+
+            // A layermod lets a tile on another layer step onto this one.
+            I32 z1 = here.z;
+            I32 z2 = here.z + 1;
+            if (grid.layermods[EXIT_UP + i].size ||
+                grid.layermods[EXIT_NORMAL].size) {
+                z1 = 0;
+                z2 = grid.dim.z;
+            }
+
+            for (from.z = z1; from.z < z2; from.z++) {
+                U32 f = tileIndex(grid, from);
+                if (field.distances[f] != PATH_UNREACHABLE)
+                    continue;
+
+                ivec3 dest;
+                if (!stepFrom(grid, from, facing, field.nowalk, &dest) ||
+                    tileIndex(grid, dest) != tile)
+                    continue;
+
+                field.distances[f] = static_cast<U16>(distance);
+                queue.push(f);
+            }
+        }
+    }
+}
+
+static FlowField&
+fieldFor(FlowFields& fields, TileGrid& grid, ivec3 target,
+         U32 nowalk) noexcept {
+    nowalk &= ~TILE_OCCUPIED;
+
+    Vector<FlowField*>& cache = fields.fields;
+    FlowField* field = 0;
+    for (Size i = 0; i < cache.size; i++) {
+        FlowField* f = cache[i];
+        if (f->target.x == target.x && f->target.y == target.y &&
+            f->target.z == target.z && f->nowalk == nowalk) {
+            field = f;
+            cache.erase(i);
+            break;
+        }
+    }
+
+    if (!field) {
+        if (cache.size < FLOW_FIELD_CACHE) {
+            field = new FlowField;
+        }
+        else {
+            field = cache[0];
+            cache.erase(0);
+        }
+        field->target = target;
+        field->nowalk = nowalk;
+        build(grid, *field, fields.queue);
+    }
+    else if (field->version != grid.flagsVersion) {
+        build(grid, *field, fields.queue);
+    }
+
+    cache.push(field);
+    return *field;
+}
+
+ivec2
+FlowFields::step(TileGrid& grid, ivec3 from, ivec3 target,
+                 U32 nowalk) noexcept {
+    ivec2 none = {0, 0};
+    if (!inGrid(grid, from))
+        return none;
+
+    FlowField& field = fieldFor(*this, grid, target, nowalk);
+
+    U32 best = field.distances[tileIndex(grid, from)];
+    ivec2 facing = none;
+    for (Size i = 0; i < 4; i++) {
+        ivec3 dest;
+        if (!stepFrom(grid, from, facings[i], field.nowalk, &dest))
+            continue;
+
+        U32 distance = field.distances[tileIndex(grid, dest)];
+        if (distance < best && !grid.tileFlags(dest, TILE_OCCUPIED)) {
+            best = distance;
+            facing = facings[i];
+        }
+    }
+    return facing;
+}
+
+U32
+FlowFields::distance(TileGrid& grid, ivec3 from, ivec3 target,
+                     U32 nowalk) noexcept {
+    if (!inGrid(grid, from))
+        return PATH_UNREACHABLE;
+
+    FlowField& field = fieldFor(*this, grid, target, nowalk);
+    return field.distances[tileIndex(grid, from)];
+}
+
+Size
+FlowFields::memoryUsage() noexcept {
+    Size total = fields.capacity * sizeof(FlowField*) +
+                 queue.capacity * sizeof(U32);
+    for (Size i = 0; i < fields.size; i++)
+        total += sizeof(FlowField) +
+                 fields[i]->distances.capacity * sizeof(U16);
+    return total;
+}
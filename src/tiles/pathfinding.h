@@ -0,0 +1,89 @@
+#ifndef SRC_TILES_PATHFINDING_H_
+#define SRC_TILES_PATHFINDING_H_
+
+#include "tiles/vec.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/vector.h"
+
+class TileGrid;
+
+// Paths between the tiles of a TileGrid, made of the single steps up, right,
+// down, and left that Character::moveByTile() takes.
+//
+// Steps follow the rules of Character::moveByTile() and canMove(): layermods
+// change the layer a step ends on, and a step may not end outside the grid or
+// on a tile with any of the flags in the nowalk mask. The mask holds
+// TILE_NOWALK* flags, usually a Character's nowalkFlags & ~nowalkExempt, and
+// may also hold:
+//
+//   TILE_OCCUPIED     to avoid tiles that Characters are on
+//   TILE_NOWALK_EXIT  to avoid steps that take an Exit out of the Area
+//
+// Looping maps are searched without wrapping around their edges.
+
+// Distance to a tile that cannot be reached.
+#define PATH_UNREACHABLE UINT16_MAX
+
+// A search for the shortest path from one tile to another.
+struct PathRequest {
+    ivec3 from;
+    ivec3 to;
+    U32 nowalk;
+
+    // Give up after visiting this many tiles, or 0 to allow the whole grid.
+    Size maxVisits;
+
+    // Set by the search. The direction of each step along the path, in
+    // order, if one was found.
+    Vector<ivec2> steps;
+    bool found;
+};
+
+// Find the shortest path with A*. Returns request.found.
+bool
+pathFind(TileGrid& grid, PathRequest& request) noexcept;
+
+// Find many paths, spread across the job system. Returns when all of them
+// are done. The grid must not change in the meantime.
+void
+pathFindAll(TileGrid& grid, PathRequest* requests, Size count) noexcept;
+
+struct FlowField;
+
+// Flow fields toward the targets most recently asked about in one TileGrid.
+//
+// A flow field holds the number of steps from every tile to its target, found
+// by a single breadth-first search outward from the target. Every Character
+// headed for the same tile shares it, so hundreds of them can chase the
+// Player for the cost of one search each time the Player moves.
+//
+// Fields ignore TILE_OCCUPIED, as occupancy changes whenever a Character
+// moves. Instead, step() only leads onto unoccupied tiles. A field is rebuilt
+// when it is next used after TileGrid::flagsVersion shows that other flags
+// have changed.
+struct FlowFields {
+    FlowFields() noexcept;
+    ~FlowFields() noexcept;
+
+    // The direction of the first step from a tile toward target, or {0, 0} if
+    // the tile is the target, target cannot be reached, or every step closer
+    // is occupied.
+    ivec2
+    step(TileGrid& grid, ivec3 from, ivec3 target, U32 nowalk) noexcept;
+
+    // The number of steps from a tile to target, or PATH_UNREACHABLE.
+    U32
+    distance(TileGrid& grid, ivec3 from, ivec3 target, U32 nowalk) noexcept;
+
+    Size
+    memoryUsage() noexcept;
+
+    // Least recently used first.
+    Vector<FlowField*> fields;
+
+    // Scratch space for building fields.
+    Vector<U32> queue;
+};
+
+#endif  // SRC_TILES_PATHFINDING_H_
@@ -0,0 +1,162 @@
+#include "tiles/prefetch.h"
+
+#include "tiles/area-blob.h"
+#include "tiles/resources.h"
+#include "util/compiler.h"
+#include "util/hashtable.h"
+#include "util/int.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+// Resources that each area loaded while it was first constructed and focused,
+// other than the ones found in its file. These are mostly NPC descriptors and
+// their sprite sheets and sounds, which only the area's scripts know about.
+static Hashmap<String, Vector<String>> manifests;
+
+// The area whose loads are being recorded, or empty.
+static String recordingArea;
+static Vector<String> recorded;
+
+static StringView
+dirname(StringView path) noexcept {
+    StringPosition slash = path.rfind('/');
+    return slash == SV_NOT_FOUND ? "" : path.substr(0, slash + 1);
+}
+
+static bool
+isSpace(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Find the values of every string member named key. This is a text search
+// rather than a parse, so it may find a member in an object the loader never
+// looks at. Prefetching a path that is not used costs only the read.
+static void
+findStrings(StringView json, StringView key, Vector<String>& values) noexcept {
+    String pattern = String() << "\"" << key << "\"";
+
+    for (StringPosition i = json.find(pattern); i != SV_NOT_FOUND;
+         i = json.find(pattern, i)) {
+        i += pattern.size;
+
+        while (i < json.size && isSpace(json.data[i]))
+            i++;
+        if (i == json.size || json.data[i] != ':')
+            continue;
+        i++;
+        while (i < json.size && isSpace(json.data[i]))
+            i++;
+        if (i == json.size || json.data[i] != '"')
+            continue;
+        i++;
+
+        String value;
+        bool ok = false;
+        for (; i < json.size; i++) {
+            char c = json.data[i];
+            if (c == '"') {
+                ok = true;
+                break;
+            }
+            if (c == '\\') {
+                // Tiled escapes the slashes in paths. Give up on anything
+                // fancier.
+                if (i + 1 == json.size)
+                    break;
+                c = json.data[++i];
+                if (c != '/' && c != '\\' && c != '"')
+                    break;
+            }
+            value << c;
+        }
+
+        if (ok && value.size)
+            values.push(static_cast<String&&>(value));
+    }
+}
+
+// Called on a worker thread once a tileset JSON file has been loaded.
+static void
+foundTileSet(StringView path, StringView data) noexcept {
+    Vector<String> images;
+    findStrings(data, "image", images);
+
+    for (String* image = images.begin(); image != images.end(); image++)
+        resourcePrefetch(String() << dirname(path) << *image);
+}
+
+// Prefetch what an area's file refers to. Called on the main thread or on a
+// worker.
+static void
+prefetchReferences(StringView descriptor, StringView data) noexcept {
+    if (isAreaBlob(data)) {
+        // A malformed blob is reported when the area is constructed.
+        Vector<StringView> paths;
+        areaBlobResources(data, paths);
+
+        for (StringView* path = paths.begin(); path != paths.end(); path++)
+            resourcePrefetch(*path);
+    }
+    else {
+        Vector<String> sources;
+        findStrings(data, "source", sources);
+
+        for (String* source = sources.begin(); source != sources.end();
+             source++) {
+            resourcePrefetch(String() << dirname(descriptor) << *source,
+                             foundTileSet);
+        }
+
+        Vector<String> music;
+        findStrings(data, "music", music);
+
+        for (String* path = music.begin(); path != music.end(); path++)
+            resourcePrefetch(*path);
+    }
+}
+
+static void
+prefetchManifest(StringView descriptor) noexcept {
+    Vector<String>* manifest = manifests.tryAt(descriptor);
+    if (!manifest)
+        return;
+
+    for (String* path = manifest->begin(); path != manifest->end(); path++)
+        resourcePrefetch(*path);
+}
+
+void
+prefetchArea(StringView descriptor, StringView data) noexcept {
+    prefetchReferences(descriptor, data);
+
+    if (manifests.contains(descriptor)) {
+        prefetchManifest(descriptor);
+    }
+    else {
+        recordingArea = descriptor;
+        recorded.clear();
+        resourceRecord(&recorded);
+    }
+}
+
+void
+prefetchAreaFile(StringView descriptor) noexcept {
+    resourcePrefetch(descriptor, prefetchReferences);
+    prefetchManifest(descriptor);
+}
+
+bool
+prefetchAreaReady(StringView descriptor) noexcept {
+    return resourcePrefetchDone(descriptor);
+}
+
+void
+prefetchFinish() noexcept {
+    if (recordingArea.size) {
+        resourceRecord(0);
+        manifests[recordingArea] = static_cast<Vector<String>&&>(recorded);
+        recordingArea.clear();
+    }
+
+    resourcePrefetchClear();
+}
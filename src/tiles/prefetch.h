@@ -0,0 +1,28 @@
+#ifndef SRC_TILES_PREFETCH_H_
+#define SRC_TILES_PREFETCH_H_
+
+#include "util/compiler.h"
+#include "util/string-view.h"
+
+//! Start loading the tileset JSONs, images and music that an area refers to,
+//! and any resources its scripts loaded the last time it was constructed, on
+//! worker threads. The loaders then take the data as they ask for it instead
+//! of reading each file in turn.
+void
+prefetchArea(StringView descriptor, StringView data) noexcept;
+
+//! Start loading an area's file, and then the resources it refers to, on
+//! worker threads, before it is needed.
+void
+prefetchAreaFile(StringView descriptor) noexcept;
+
+//! Whether an area's file, prefetched by prefetchAreaFile(), has been loaded.
+bool
+prefetchAreaReady(StringView descriptor) noexcept;
+
+//! Called once the area has been constructed and focused. Drops prefetched
+//! data that went unused.
+void
+prefetchFinish() noexcept;
+
+#endif  // SRC_TILES_PREFETCH_H_
@@ -4,6 +4,7 @@
 #include "util/compiler.h"
 #include "util/string-view.h"
 #include "util/string.h"
+#include "util/vector.h"
 
 // Provides data and resource extraction for a World.
 // Each World comes bundled with associated data.
@@ -12,4 +13,34 @@
 bool
 resourceLoad(StringView path, String& data) noexcept;
 
+// Load a resource without copying it, if possible. The data is either viewed
+// in place in the World's memory-mapped data file, where it is valid for the
+// rest of the program, or is copied into storage.
+bool
+resourceLoadView(StringView path, StringView& data, String& storage) noexcept;
+
+// Start loading a resource on a worker thread. The next resourceLoad() or
+// resourceLoadView() of the path waits for it and takes its data instead of
+// reading the data file again. If found is given, it is called on the worker
+// with the data, so that the resources it refers to can be prefetched in turn.
+// A prefetch that fails logs nothing. The error is logged by the load that
+// takes it, if there is one.
+void
+resourcePrefetch(StringView path,
+                 void (*found)(StringView path, StringView data)
+                     noexcept = 0) noexcept;
+
+// Whether a prefetch of the path has finished, or true if there is none.
+bool
+resourcePrefetchDone(StringView path) noexcept;
+
+// Wait for outstanding prefetches, then drop any that were never taken.
+void
+resourcePrefetchClear() noexcept;
+
+// Append the paths of resources that are loaded without having been
+// prefetched to paths, or stop if paths is null. Only for the main thread.
+void
+resourceRecord(Vector<String>* paths) noexcept;
+
 #endif  // SRC_TILES_RESOURCES_H_
@@ -1,5 +1,6 @@
 #include "tiles/tile-grid.h"
 
+#include "os/c.h"
 #include "util/assert.h"
 #include "util/compiler.h"
 #include "util/math2.h"
@@ -21,7 +22,12 @@ ivec2_to_dir(ivec2 v) noexcept {
     }
 }
 
-TileGrid::TileGrid() noexcept : loopX(false), loopY(false) {
+TileGrid::TileGrid() noexcept
+    : tilesVersion(0),
+      loopX(false),
+      loopY(false),
+      flagRowWords(0),
+      flagsVersion(0) {
     dim.x = dim.y = dim.z = 0;
     tileDim.x = tileDim.y = 0;
 }
@@ -43,6 +49,139 @@ TileGrid::setTileType(vicoord virt, U32 type) noexcept {
 
     I32 idx = (phys.z * dim.y + phys.y) * dim.x + phys.x;
     graphics[idx] = type;
+
+    ivec3 chunks = chunkDim();
+    Size chunkCount = static_cast<Size>(chunks.x * chunks.y * chunks.z);
+    if (chunkVersions.size != chunkCount) {
+        chunkVersions.resize(chunkCount);
+        memset(chunkVersions.data, 0, chunkCount * sizeof(U32));
+    }
+
+    chunkVersions[chunkIndex(phys)] += 1;
+    tilesVersion += 1;
+}
+
+ivec3
+TileGrid::chunkDim() noexcept {
+    ivec3 chunks = {
+        (dim.x + TILE_CHUNK_SIZE - 1) >> TILE_CHUNK_SHIFT,
+        (dim.y + TILE_CHUNK_SIZE - 1) >> TILE_CHUNK_SHIFT,
+        dim.z,
+    };
+    return chunks;
+}
+
+Size
+TileGrid::chunkIndex(ivec3 phys) noexcept {
+    ivec3 chunks = chunkDim();
+    I32 cx = phys.x >> TILE_CHUNK_SHIFT;
+    I32 cy = phys.y >> TILE_CHUNK_SHIFT;
+    return static_cast<Size>((phys.z * chunks.y + cy) * chunks.x + cx);
+}
+
+U32
+TileGrid::chunkVersion(Size chunk) noexcept {
+    return chunk < chunkVersions.size ? chunkVersions[chunk] : 0;
+}
+
+static const U32 planeFlags[TILE_FLAG_PLANES] = {
+    TILE_NOWALK,
+    TILE_NOWALK_PLAYER,
+    TILE_NOWALK_NPC,
+    TILE_OCCUPIED,
+};
+
+// Index of the word in flagPlanes holding a tile, or SIZE_MAX if the tile is
+// kept in sparseFlags.
+static Size
+flagWordIndex(TileGrid& grid, ivec3 phys) noexcept {
+    if (grid.flagRowWords == 0)
+        return SIZE_MAX;
+    if (phys.x < 0 || grid.dim.x <= phys.x || phys.y < 0 ||
+        grid.dim.y <= phys.y || phys.z < 0 || grid.dim.z <= phys.z)
+        return SIZE_MAX;
+    return static_cast<Size>(phys.z * grid.dim.y + phys.y) *
+               grid.flagRowWords +
+           static_cast<Size>(phys.x >> 5);
+}
+
+U32
+TileGrid::tileFlags(ivec3 phys, U32 mask) noexcept {
+    Size word = flagWordIndex(*this, phys);
+    if (word == SIZE_MAX) {
+        U32* flags = sparseFlags.tryAt(phys);
+        return flags ? *flags & mask : 0;
+    }
+    if (word >= flagPlanes[0].size) {
+        // The layer has no flags yet.
+        return 0;
+    }
+
+    U32 bit = static_cast<U32>(phys.x & 31);
+    U32 flags = 0;
+    for (Size i = 0; i < TILE_FLAG_PLANES; i++) {
+        if (mask & planeFlags[i])
+            flags |= ((flagPlanes[i][word] >> bit) & 1) * planeFlags[i];
+    }
+    return flags;
+}
+
+void
+TileGrid::addTileFlags(ivec3 phys, U32 flags) noexcept {
+    if (flags & ~TILE_OCCUPIED)
+        flagsVersion++;
+
+    Size layerTiles = static_cast<Size>(dim.x) * static_cast<Size>(dim.y);
+    if (flagRowWords == 0 && 0 < layerTiles &&
+        layerTiles <= TILE_FLAG_DENSE_MAX)
+        flagRowWords = static_cast<Size>((dim.x + 31) >> 5);
+
+    Size word = flagWordIndex(*this, phys);
+    if (word == SIZE_MAX) {
+        sparseFlags[phys] |= flags;
+        return;
+    }
+
+    if (word >= flagPlanes[0].size) {
+        // Grow every plane to hold this tile's layer.
+        Size size = static_cast<Size>((phys.z + 1) * dim.y) * flagRowWords;
+        for (Size i = 0; i < TILE_FLAG_PLANES; i++) {
+            Size old = flagPlanes[i].size;
+            flagPlanes[i].resize(size);
+            memset(flagPlanes[i].data + old, 0, (size - old) * sizeof(U32));
+        }
+    }
+
+    U32 bit = 1u << (phys.x & 31);
+    for (Size i = 0; i < TILE_FLAG_PLANES; i++) {
+        if (flags & planeFlags[i])
+            flagPlanes[i][word] |= bit;
+    }
+}
+
+void
+TileGrid::removeTileFlags(ivec3 phys, U32 flags) noexcept {
+    if (flags & ~TILE_OCCUPIED)
+        flagsVersion++;
+
+    Size word = flagWordIndex(*this, phys);
+    if (word == SIZE_MAX) {
+        U32* tileFlags = sparseFlags.tryAt(phys);
+        if (tileFlags) {
+            *tileFlags &= ~flags;
+            if (*tileFlags == 0)
+                sparseFlags.erase(phys);
+        }
+        return;
+    }
+    if (word >= flagPlanes[0].size)
+        return;
+
+    U32 bit = 1u << (phys.x & 31);
+    for (Size i = 0; i < TILE_FLAG_PLANES; i++) {
+        if (flags & planeFlags[i])
+            flagPlanes[i][word] &= ~bit;
+    }
 }
 
 bool
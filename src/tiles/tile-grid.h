@@ -5,6 +5,7 @@
 #include "tiles/vec.h"
 #include "util/compiler.h"
 #include "util/hashtable.h"
+#include "util/intern.h"
 #include "util/string.h"
 #include "util/vector.h"
 
@@ -43,6 +44,26 @@ class Entity;
 // Entity's "exempt" flag which will be read elsewhere in the engine.
 #define TILE_NOWALK_AREA_BOUND ((U32)(0x016))
 
+// A Character is standing on or moving onto this Tile.
+//
+// This flag is not carried by actual Tiles, but is set and cleared by
+// Character::enterTile() and Character::leaveTile().
+#define TILE_OCCUPIED ((U32)(0x100))
+
+// The flags kept for each tile: TILE_NOWALK, TILE_NOWALK_PLAYER,
+// TILE_NOWALK_NPC, and TILE_OCCUPIED.
+#define TILE_FLAG_PLANES 4
+
+// Layers with more tiles than this keep their flags in TileGrid::sparseFlags
+// rather than spending TILE_FLAG_PLANES bits on every tile.
+#define TILE_FLAG_DENSE_MAX (1 << 24)
+
+
+// Tile layers are divided into square chunks of TILE_CHUNK_SIZE tiles on a side
+// so that data derived from the tiles can be rebuilt one chunk at a time.
+#define TILE_CHUNK_SHIFT 4
+#define TILE_CHUNK_SIZE  (1 << TILE_CHUNK_SHIFT)
+
 
 // Types of exits.
 enum ExitDirection {
@@ -63,7 +84,7 @@ enum ExitDirection {
 // Tiles with an exit trigger attached can teleport the player to a new area in
 // the World. The Exit struct contains the destination area and coordinates.
 struct Exit {
-    String area;
+    Symbol area;
     vicoord coords;
 };
 
@@ -95,6 +116,24 @@ class TileGrid {
     void
     setTileType(vicoord virt, U32 type) noexcept;
 
+    //! Number of chunks along each axis. z is the number of layers.
+    ivec3
+    chunkDim() noexcept;
+    //! Index of the chunk containing a physical coordinate that is in bounds.
+    Size
+    chunkIndex(ivec3 phys) noexcept;
+    //! Number of times setTileType() has modified a chunk.
+    U32
+    chunkVersion(Size chunk) noexcept;
+
+    //! The flags of a tile that are in mask.
+    U32
+    tileFlags(ivec3 phys, U32 mask) noexcept;
+    void
+    addTileFlags(ivec3 phys, U32 flags) noexcept;
+    void
+    removeTileFlags(ivec3 phys, U32 flags) noexcept;
+
     //! Returns true if a Tile exists at the specified coordinate.
     bool
     inBounds(ivec3 phys) noexcept;
@@ -149,6 +188,13 @@ class TileGrid {
     // 3-dimensional array of the tiles that make up the grid.
     Vector<U32> graphics;
 
+    // Per-chunk modification counts. Empty until setTileType() is first
+    // called.
+    Vector<U32> chunkVersions;
+
+    // Total number of modifications made by setTileType().
+    U32 tilesVersion;
+
     enum LayerType { TILE_LAYER, OBJECT_LAYER };
     Vector<LayerType> layerTypes;
 
@@ -168,8 +214,6 @@ class TileGrid {
     bool loopX;
     bool loopY;
 
-    Hashmap<ivec3, bool, EmptyIcoord> occupied;
-
     enum ScriptType {
         SCRIPT_TYPE_ENTER,
         SCRIPT_TYPE_LEAVE,
@@ -182,7 +226,20 @@ class TileGrid {
             EmptyIcoord>
         scripts[SCRIPT_TYPE_LAST];
 
-    Hashmap<ivec3, U32, EmptyIcoord> flags;
+    // One bitset over the tiles of the grid for each flag. Row y of layer z
+    // starts at word (z * dim.y + y) * flagRowWords, and the sets grow a
+    // layer at a time as flags are added. flagRowWords is 0 until the first
+    // flag is added, and stays 0 if layers are too big for bitsets.
+    Vector<U32> flagPlanes[TILE_FLAG_PLANES];
+    Size flagRowWords;
+
+    // Number of times flags other than TILE_OCCUPIED have been added or
+    // removed.
+    U32 flagsVersion;
+
+    // Flags of tiles that are not covered by flagPlanes, which are those
+    // outside the grid and, for very large grids, all of them.
+    Hashmap<ivec3, U32, EmptyIcoord> sparseFlags;
 
     Hashmap<ivec3, Exit, EmptyIcoord> exits[EXITS_LENGTH];
     Hashmap<ivec3, float, EmptyIcoord> layermods[EXITS_LENGTH];
@@ -1,27 +1,49 @@
 #include "tiles/world.h"
 
 #include "data/data-world.h"
+#include "tiles/area-blob.h"
 #include "tiles/area-json.h"
 #include "tiles/area.h"
 #include "tiles/client-conf.h"
 #include "tiles/display-list.h"
+#include "tiles/image-decode.h"
+#include "tiles/images.h"
 #include "tiles/log.h"
 #include "tiles/music.h"
 #include "tiles/overlay.h"
 #include "tiles/player.h"
+#include "tiles/prefetch.h"
 #include "tiles/resources.h"
 #include "tiles/viewport.h"
 #include "tiles/window.h"
 #include "util/compiler.h"
 #include "util/hashtable.h"
-//#include "util/measure.h"
+#include "util/intern.h"
+#include "util/profile.h"
 #include "util/vector.h"
 
 // ScriptRef keydownScript, keyupScript;
 
-static Hashmap<String, Area*> areas;
+static ProfileZone drawZone("worldDraw");
+
+struct CachedArea {
+    Area* area;
+
+    // Value of areaUses when the Area was last loaded or focused.
+    U64 lastUse;
+};
+
+static Hashmap<Symbol, CachedArea> areas;
+static U64 areaUses = 0;
 static Area* worldArea = 0;
 
+// Areas that the focused Area's exits lead to, which are being loaded.
+static Vector<Symbol> preloads;
+
+// Whether an Area has been loaded or focused since the cache was last checked
+// against its budget.
+static bool areasChanged = false;
+
 /**
  * Total unpaused game run time.
  */
@@ -34,6 +56,132 @@ static I32 paused = 0;
 static Keys keyStates[10];
 static Size numKeyStates = 0;
 
+// Construct an Area from its file and add it to the cache. Returns null if it
+// could not be constructed.
+static Area*
+makeArea(Symbol name, StringView data, String& storage) noexcept {
+    StringView filename = symbolName(name);
+
+    DataArea* dataArea = dataWorldArea(filename);
+    if (!dataArea) {
+        logErr("World", String() << filename << ": no DataArea");
+        return 0;
+    }
+
+    // Areas compiled by "pack-tool compile" replace their JSON file.
+    Area* newArea;
+    if (isAreaBlob(data)) {
+        newArea = makeAreaFromBlob(&player, filename, data);
+    }
+    else {
+        // The JSON parser works in place, so it needs its own copy.
+        if (data.data != storage.data)
+            storage = data;
+        newArea = makeAreaFromJSON(&player, filename,
+                                   static_cast<String&&>(storage));
+    }
+
+    if (!newArea || !newArea->ok) {
+        delete newArea;
+        return 0;
+    }
+
+    CachedArea cached = {newArea, ++areaUses};
+    areas[name] = cached;
+    areasChanged = true;
+
+    return newArea;
+}
+
+// Start loading the Areas that the focused Area's exits lead to, so that
+// taking an exit does not wait on them.
+static void
+findPreloads() noexcept {
+    preloads.clear();
+
+    if (!confPreloadAreas)
+        return;
+
+    for (Size i = 0; i < EXITS_LENGTH; i++) {
+        Hashmap<ivec3, Exit, EmptyIcoord>& exits = worldArea->grid.exits[i];
+
+        for (Hashmap<ivec3, Exit, EmptyIcoord>::iterator it = exits.begin();
+             it != exits.end(); ++it) {
+            Symbol name = it->value.area;
+
+            if (name == Symbol() || areas.contains(name))
+                continue;
+
+            bool found = false;
+            for (Symbol* preload = preloads.begin(); preload != preloads.end();
+                 preload++) {
+                if (*preload == name)
+                    found = true;
+            }
+            if (found)
+                continue;
+
+            preloads.push(name);
+            prefetchAreaFile(symbolName(name));
+        }
+    }
+}
+
+// Construct one Area whose file has been loaded in the background. One per
+// tick keeps the work of several exits out of any single frame.
+static void
+preloadArea() noexcept {
+    if (preloads.size == 0)
+        return;
+
+    Symbol name = preloads[preloads.size - 1];
+    StringView filename = symbolName(name);
+    if (!prefetchAreaReady(filename))
+        return;
+
+    StringView data;
+    String storage;
+    if (resourceLoadView(filename, data, storage) && !areas.contains(name)) {
+        if (!makeArea(name, data, storage))
+            logErr("World", String() << filename << ": could not preload");
+    }
+
+    preloads.pop();
+}
+
+// Free the least recently used Areas, other than the focused one, until the
+// rest fit in the cache's budget.
+static void
+evictAreas() noexcept {
+    for (;;) {
+        Size usage = 0;
+        Hashmap<Symbol, CachedArea>::iterator lru = areas.end();
+
+        for (Hashmap<Symbol, CachedArea>::iterator it = areas.begin();
+             it != areas.end(); ++it) {
+            usage += it->value.area->memoryUsage();
+
+            if (it->value.area != worldArea &&
+                (lru == areas.end() || it->value.lastUse < lru->value.lastUse))
+                lru = it;
+        }
+
+        if (usage <= confAreaCacheBytes || lru == areas.end())
+            return;
+
+        Area* area = lru->value.area;
+
+        logInfo("World", String() << "Freeing " << symbolName(lru->key));
+
+        DataArea* dataArea = area->getDataArea();
+        if (dataArea && dataArea->area == area)
+            dataArea->area = 0;
+
+        areas.erase(lru);
+        delete area;
+    }
+}
+
 void
 worldInit() noexcept {
     alive = true;
@@ -90,7 +238,7 @@ worldButtonUp(Key key) noexcept {
 
 void
 worldDraw(DisplayList* display) noexcept {
-    // TimeMeasure m("Drew world");
+    ProfileScope scope(drawZone);
 
     redraw = false;
 
@@ -110,7 +258,9 @@ worldDraw(DisplayList* display) noexcept {
 
 bool
 worldNeedsRedraw() noexcept {
-    return redraw || (!paused && worldArea->needsRedraw());
+    // Images that are still loading are drawn as they are copied in.
+    return redraw || imageDecodeNeedsRedraw() ||
+           (!paused && worldArea->needsRedraw());
 }
 
 void
@@ -121,6 +271,18 @@ worldTick(Time dt) noexcept {
     total += dt;
 
     worldArea->tick(dt);
+
+    // Areas can only be freed or loaded here, while none is being ticked.
+    preloadArea();
+    if (areasChanged) {
+        evictAreas();
+
+        // Along with images that only freed Areas were using. They were
+        // released just now, at total, so the cutoff is just after it.
+        imagesPrune(total + 1);
+
+        areasChanged = false;
+    }
 }
 
 void
@@ -131,32 +293,53 @@ worldTurn() noexcept {
 
 void
 worldFocusArea(StringView filename, vicoord playerPos) noexcept {
-    Area** cachedArea = areas.tryAt(filename);
-    if (cachedArea) {
-        Area* area = *cachedArea;
-        worldFocusArea(area, playerPos);
+    worldFocusArea(intern(filename), playerPos);
+}
+
+void
+worldFocusArea(Symbol name, vicoord playerPos) noexcept {
+    StringView filename = symbolName(name);
+
+    CachedArea* cached = areas.tryAt(name);
+    if (cached) {
+        cached->lastUse = ++areaUses;
+        worldFocusArea(cached->area, playerPos);
+        findPreloads();
         return;
     }
 
-    Area* newArea = makeAreaFromJSON(&player, filename);
-    assert_(newArea);
+    // If the file is missing, an error has been logged and the JSON loader
+    // will fail below.
+    StringView data;
+    String storage;
+    resourceLoadView(filename, data, storage);
 
-    assert_(newArea->ok);
+    // Load the resources the area refers to while it is being constructed.
+    prefetchArea(filename, data);
 
-    DataArea* dataArea = dataWorldArea(filename);
-    assert_(dataArea);
-
-    dataArea->area = newArea;  // FIXME: Pass Area by parameter, not
-                               // member variable so we can avoid this
-                               // pointer.
-    areas[filename] = newArea;
+    Area* newArea = makeArea(name, data, storage);
+    assert_(newArea);
 
     worldFocusArea(newArea, playerPos);
+
+    prefetchFinish();
+
+    findPreloads();
 }
 
 void
 worldFocusArea(Area* area_, vicoord playerPos) noexcept {
     worldArea = area_;
+
+    // Areas that share a DataArea take turns with it.
+    DataArea* dataArea = worldArea->getDataArea();
+    if (dataArea)
+        dataArea->area = worldArea;  // FIXME: Pass Area by parameter, not
+                                     // member variable so we can avoid
+                                     // this pointer.
+
+    areasChanged = true;
+
     player.setArea(worldArea, playerPos);
     viewportSetArea(worldArea);
     worldArea->focus();
@@ -5,6 +5,7 @@
 #include "tiles/window.h"
 #include "util/compiler.h"
 #include "util/int.h"
+#include "util/intern.h"
 #include "util/string-view.h"
 
 class Area;
@@ -81,6 +82,8 @@ worldTurn() noexcept;
 void
 worldFocusArea(StringView filename, vicoord playerPos) noexcept;
 void
+worldFocusArea(Symbol filename, vicoord playerPos) noexcept;
+void
 worldFocusArea(Area* area, vicoord playerPos) noexcept;
 
 void
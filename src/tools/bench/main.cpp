@@ -0,0 +1,220 @@
+#include "data/data-world.h"
+#include "os/chrono.h"
+#include "os/os.h"
+#include "tiles/client-conf.h"
+#include "tiles/display-list.h"
+#include "tiles/images.h"
+#include "tiles/log.h"
+#include "tiles/window.h"
+#include "tiles/world.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/io.h"
+#include "util/jobs.h"
+#include "util/profile.h"
+#include "util/random.h"
+#include "util/sort.h"
+#include "util/string.h"
+#include "util/string2.h"
+#include "util/vector.h"
+
+/**
+ * Drive the world headlessly for a fixed number of simulated frames and
+ * report how long each phase of the frame took.
+ *
+ * Links against the null or software audio/video backend. Unlike
+ * windowMainLoop(), every frame is given the same dt and the same key input,
+ * so two runs on the same machine simulate the same game and their timings
+ * can be compared. With the software backend, the present phase measures
+ * displayListPresent() rasterizing each frame.
+ */
+
+static String exe;
+
+static const U32 DEFAULT_FRAMES = 3600;
+static const U32 DEFAULT_DT = 16;
+
+// Random numbers are the same in every run, so that scripts and NPCs do too.
+static const U32 SEED = 1;
+
+// Each step holds one arrow key for a number of frames, then releases it.
+struct KeyStep {
+    Key key;
+    U32 frames;
+};
+
+static const KeyStep script[] = {
+    {KEY_RIGHT_ARROW, 60},
+    {KEY_DOWN_ARROW, 60},
+    {KEY_LEFT_ARROW, 60},
+    {KEY_UP_ARROW, 60},
+    {0, 30},
+};
+static const Size scriptLength = sizeof(script) / sizeof(script[0]);
+
+struct Phase {
+    StringView name;
+    Vector<Nanoseconds> samples;
+};
+
+static void
+usage() noexcept {
+    serr << "usage: " << exe << " [frames] [dt-ms]\n";
+}
+
+static bool
+parseArg(U32& out, StringView arg) noexcept {
+    String s = arg;
+    return parseUInt(out, s);
+}
+
+static Nanoseconds
+percentile(Vector<Nanoseconds>& sorted, U32 p) noexcept {
+    if (sorted.size == 0)
+        return 0;
+    return sorted[(sorted.size - 1) * p / 100];
+}
+
+static float
+us(Nanoseconds ns) noexcept {
+    return static_cast<float>(ns) / 1000.0f;
+}
+
+static void
+reportPhase(Phase& phase) noexcept {
+    sortA(phase.samples);
+
+    Nanoseconds max = phase.samples.size ? phase.samples[phase.samples.size - 1]
+                                         : 0;
+
+    sout << phase.name << ": n " << phase.samples.size << " p50 "
+         << us(percentile(phase.samples, 50)) << "us p99 "
+         << us(percentile(phase.samples, 99)) << "us max " << us(max)
+         << "us\n";
+}
+
+static void
+reportItems(Vector<Nanoseconds>& items) noexcept {
+    sortA(items);
+
+    Nanoseconds max = items.size ? items[items.size - 1] : 0;
+    Nanoseconds total = 0;
+    for (Nanoseconds* count = items.begin(); count != items.end(); count++)
+        total += *count;
+
+    sout << "items: p50 " << percentile(items, 50) << " p99 "
+         << percentile(items, 99) << " max " << max << " total " << total
+         << "\n";
+}
+
+I32
+main(I32 argc, char* argv[]) noexcept {
+    Flusher f1(sout);
+    Flusher f2(serr);
+
+    exe = argv[0];
+    StringPosition dir = exe.view().rfind(DIR_SEPARATOR);
+    if (dir != SV_NOT_FOUND)
+        exe = exe.view().substr(dir + 1);
+
+    U32 frames = DEFAULT_FRAMES;
+    U32 dt = DEFAULT_DT;
+
+    if (argc > 3 || (argc > 1 && !parseArg(frames, argv[1])) ||
+        (argc > 2 && !parseArg(dt, argv[2])) || frames == 0 || dt == 0) {
+        usage();
+        return 1;
+    }
+
+    seedRandom(SEED);
+
+    logInit();
+
+    JobsInit();
+
+    confParse("./client.json");
+
+    windowCreate();
+    imageInit();
+
+    dataWorldInit();
+    worldInit();
+
+    Phase tick = {"tick", Vector<Nanoseconds>()};
+    Phase needsRedraw = {"needsRedraw", Vector<Nanoseconds>()};
+    Phase draw = {"draw", Vector<Nanoseconds>()};
+    Phase present = {"present", Vector<Nanoseconds>()};
+
+    tick.samples.reserve(frames);
+    needsRedraw.samples.reserve(frames);
+    draw.samples.reserve(frames);
+    present.samples.reserve(frames);
+
+    // Item counts, stored as Nanoseconds so they share the reporting code.
+    Vector<Nanoseconds> items;
+    items.reserve(frames);
+
+    DisplayList dl = {};
+
+    Size step = 0;
+    U32 stepFrame = 0;
+
+    for (U32 frame = 0; frame < frames; frame++) {
+        //
+        // Scripted input.
+        //
+        if (stepFrame == 0 && script[step].key)
+            windowEmitKeyDown(script[step].key);
+
+        stepFrame += 1;
+
+        if (stepFrame == script[step].frames) {
+            if (script[step].key)
+                windowEmitKeyUp(script[step].key);
+            step = (step + 1) % scriptLength;
+            stepFrame = 0;
+        }
+
+        //
+        // Simulate world and draw frame.
+        //
+        Nanoseconds start = chronoNow();
+        worldTick(static_cast<Time>(dt));
+        Nanoseconds ticked = chronoNow();
+        bool redraw = worldNeedsRedraw();
+        Nanoseconds checked = chronoNow();
+
+        tick.samples.push(ticked - start);
+        needsRedraw.samples.push(checked - ticked);
+
+        if (redraw) {
+            worldDraw(&dl);
+            Nanoseconds drew = chronoNow();
+
+            imageStartFrame();
+            displayListPresent(&dl);
+            imageEndFrame();
+            Nanoseconds presented = chronoNow();
+
+            draw.samples.push(drew - checked);
+            present.samples.push(presented - drew);
+            items.push(static_cast<Nanoseconds>(dl.items.size));
+
+            dl.items.clear();
+        }
+    }
+
+    sout << "frames " << frames << " dt " << dt << "ms\n";
+    reportPhase(tick);
+    reportPhase(needsRedraw);
+    reportPhase(draw);
+    reportPhase(present);
+    reportItems(items);
+
+    // Let the worker threads quit before static destructors run.
+    JobsQuit();
+
+    profileDump();
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+#ifndef SRC_UTIL_ATOMIC_H_
+#define SRC_UTIL_ATOMIC_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+
+// Atomic operations on aligned integers and pointers. Plain loads and stores
+// are relaxed. Read-modify-write operations and atomicFence() are sequentially
+// consistent.
+
+#if MSVC
+extern "C" {
+long
+_InterlockedCompareExchange(long volatile*, long, long) noexcept;
+__int64
+_InterlockedCompareExchange64(__int64 volatile*, __int64, __int64) noexcept;
+long
+_InterlockedExchangeAdd(long volatile*, long) noexcept;
+long
+_InterlockedOr(long volatile*, long) noexcept;
+void
+_ReadWriteBarrier() noexcept;
+}
+#    pragma intrinsic(_InterlockedCompareExchange)
+#    pragma intrinsic(_InterlockedCompareExchange64)
+#    pragma intrinsic(_InterlockedExchangeAdd)
+#    pragma intrinsic(_InterlockedOr)
+#    pragma intrinsic(_ReadWriteBarrier)
+
+// x86 and x64 loads already acquire and stores already release, so only the
+// compiler needs to be kept from reordering them.
+
+template<typename T>
+static inline T
+atomicLoad(T* p) noexcept {
+    return *static_cast<volatile T*>(p);
+}
+template<typename T>
+static inline T
+atomicLoadAcquire(T* p) noexcept {
+    T v = *static_cast<volatile T*>(p);
+    _ReadWriteBarrier();
+    return v;
+}
+template<typename T>
+static inline void
+atomicStore(T* p, T v) noexcept {
+    *static_cast<volatile T*>(p) = v;
+}
+template<typename T>
+static inline void
+atomicStoreRelease(T* p, T v) noexcept {
+    _ReadWriteBarrier();
+    *static_cast<volatile T*>(p) = v;
+}
+
+static inline void
+atomicFence() noexcept {
+    long fence = 0;
+    _InterlockedOr(&fence, 0);
+}
+static inline void
+atomicFenceRelease() noexcept {
+    _ReadWriteBarrier();
+}
+
+// Returns the new value.
+static inline I32
+atomicAdd(I32* p, I32 v) noexcept {
+    return _InterlockedExchangeAdd(reinterpret_cast<volatile long*>(p), v) + v;
+}
+
+// Returns whether *p was expected and is now desired.
+static inline bool
+atomicCas(I32* p, I32 expected, I32 desired) noexcept {
+    return _InterlockedCompareExchange(reinterpret_cast<volatile long*>(p),
+                                       desired, expected) == expected;
+}
+static inline bool
+atomicCas(I64* p, I64 expected, I64 desired) noexcept {
+    return _InterlockedCompareExchange64(reinterpret_cast<volatile __int64*>(p),
+                                         desired, expected) == expected;
+}
+#else
+template<typename T>
+static inline T
+atomicLoad(T* p) noexcept {
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+template<typename T>
+static inline T
+atomicLoadAcquire(T* p) noexcept {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+template<typename T>
+static inline void
+atomicStore(T* p, T v) noexcept {
+    __atomic_store_n(p, v, __ATOMIC_RELAXED);
+}
+template<typename T>
+static inline void
+atomicStoreRelease(T* p, T v) noexcept {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static inline void
+atomicFence() noexcept {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+static inline void
+atomicFenceRelease() noexcept {
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// Returns the new value.
+template<typename T>
+static inline T
+atomicAdd(T* p, T v) noexcept {
+    return __atomic_add_fetch(p, v, __ATOMIC_SEQ_CST);
+}
+
+// Returns whether *p was expected and is now desired.
+template<typename T>
+static inline bool
+atomicCas(T* p, T expected, T desired) noexcept {
+    return __atomic_compare_exchange_n(p, &expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+#endif
+
+#endif  // SRC_UTIL_ATOMIC_H_
@@ -0,0 +1,40 @@
+#include "util/checksum.h"
+
+#include "util/compiler.h"
+#include "util/int.h"
+
+U32
+crc32Checksum(const void* data, Size size) noexcept {
+    // Built on the stack, so that checksums can be taken on any thread.
+    U32 table[256];
+    for (U32 i = 0; i < 256; i++) {
+        U32 c = i;
+        for (I32 k = 0; k < 8; k++)
+            c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        table[i] = c;
+    }
+
+    const U8* bytes = static_cast<const U8*>(data);
+    U32 crc = 0xFFFFFFFF;
+    for (Size i = 0; i < size; i++)
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFF;
+}
+
+U32
+adler32Checksum(const void* data, Size size) noexcept {
+    const U8* bytes = static_cast<const U8*>(data);
+    U32 a = 1, b = 0;
+    while (size) {
+        // The most bytes before b can overflow.
+        Size chunk = size < 5552 ? size : 5552;
+        size -= chunk;
+        for (; chunk; chunk--) {
+            a += *bytes++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
@@ -0,0 +1,18 @@
+#ifndef SRC_UTIL_CHECKSUM_H_
+#define SRC_UTIL_CHECKSUM_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+
+// The checksums of the zlib and gzip formats, as used by deflate streams and
+// PNG files.
+
+// CRC-32 with the polynomial 0xEDB88320, as in gzip trailers and PNG chunks.
+U32
+crc32Checksum(const void* data, Size size) noexcept;
+
+// Adler-32, as in zlib trailers.
+U32
+adler32Checksum(const void* data, Size size) noexcept;
+
+#endif  // SRC_UTIL_CHECKSUM_H_
@@ -77,6 +77,14 @@
 #    define constexpr14
 #endif
 
+#if CXX
+#    if MSVC == 2010 || MSVC == 2012 || MSVC == 2013
+#        define thread_local __declspec(thread)
+#    elif 0 < GCC && GCC < 48
+#        define thread_local __thread
+#    endif
+#endif
+
 #if CLANG || GCC >= 45
 #    define unreachable __builtin_unreachable()
 #else
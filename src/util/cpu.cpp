@@ -17,7 +17,7 @@ struct Leaf {
     U32 eax, ebx, ecx, edx;
 };
 
-#    if defined(CLANG) || defined(GCC)
+#    if CLANG || GCC
 static struct Leaf
 getCpuidLeaf(U32 leafId, int subleaf) noexcept {
     struct Leaf leaf;
@@ -27,7 +27,16 @@ getCpuidLeaf(U32 leafId, int subleaf) noexcept {
                      : "a"(leafId), "b"(0), "c"(subleaf), "d"(0));
     return leaf;
 }
-#    elif defined(MSVC)
+#    elif MSVC
+extern "C" {
+void
+__cpuidex(int*, int, int) noexcept;
+unsigned __int64
+_xgetbv(unsigned int) noexcept;
+}
+#        pragma intrinsic(__cpuidex)
+#        pragma intrinsic(_xgetbv)
+
 static struct Leaf
 getCpuidLeaf(U32 leafId, int subleaf) noexcept {
     struct Leaf leaf;
@@ -112,7 +121,7 @@ hasYmmOsXSave(U32 xcr0Eax) noexcept {
     return hasMask(xcr0Eax, MASK_XMM | MASK_YMM);
 }
 
-#    if defined(CLANG) || defined(GCC)
+#    if CLANG || GCC
 static U32
 getXCR0Eax(void) noexcept {
     U32 eax, edx;
@@ -122,7 +131,7 @@ getXCR0Eax(void) noexcept {
     __asm(".byte 0x0F, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c"(0));
     return eax;
 }
-#    elif defined(MSVC)
+#    elif MSVC
 static U32
 getXCR0Eax(void) noexcept {
     return (U32)_xgetbv(0);
@@ -151,6 +160,7 @@ getCpu() noexcept {
         bool sseRegisters = hasXmmOsXSave(xcr0Eax);
         bool avxRegisters = hasYmmOsXSave(xcr0Eax);
         if (sseRegisters) {
+            features.ssse3 = isBitSet(leaf1.ecx, 9);
             features.sse4_1 = isBitSet(leaf1.ecx, 19);
             features.sse4_2 = isBitSet(leaf1.ecx, 20);
         }
@@ -159,10 +169,8 @@ getCpu() noexcept {
             features.avx2 = isBitSet(leaf7.ebx, 5);
         }
     }
-    else {
-        // TODO: Handle this case. It is on pre-AVX architectures.
-        unreachable;
-    }
+    // Without XSAVE, the OS does not save vector registers past SSE2 and the
+    // features above are left unset.
     return features;
 }
 #elif defined(__aarch64__)
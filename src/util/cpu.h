@@ -2,6 +2,7 @@
 #define SRC_UTIL_CPU_H_
 
 #include "util/compiler.h"
+#include "util/int.h"
 
 #define BE 0
 #define LE 1
@@ -46,6 +47,7 @@ struct X86Features {
     U32 popcnt : 1;
     U32 rdrnd  : 1;
 
+    U32 ssse3  : 1;
     U32 sse4_1 : 1;
     U32 sse4_2 : 1;
 
@@ -0,0 +1,149 @@
+#ifndef SRC_UTIL_HANDLE_TABLE_H_
+#define SRC_UTIL_HANDLE_TABLE_H_
+
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/hashtable.h"
+#include "util/int.h"
+#include "util/intern.h"
+#include "util/string-view.h"
+#include "util/vector.h"
+
+// A value in a HandleTable, or NO_HANDLE.
+typedef U32 Handle;
+
+#define NO_HANDLE 0
+
+// The low bits of a Handle hold the index of its slot, and the high bits hold
+// the slot's generation.
+#define HANDLE_INDEX_BITS 20
+#define HANDLE_INDEX_MASK ((1u << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_GENERATION_MASK ((1u << (32 - HANDLE_INDEX_BITS)) - 1)
+
+// HandleTable
+//
+// Values found by a string key, such as the path they were loaded from, and
+// referred to afterward by Handle.
+//
+// Keys are interned and kept in an open-addressed Hashmap, so a lookup takes
+// constant time and two keys with the same hash stay distinct. Each slot has
+// a generation that changes when its value is released, so a Handle to a
+// released value finds nothing rather than whatever value reused the slot.
+//
+// Handles stay valid as the table grows, but pointers to values do not.
+template<typename Value>
+class HandleTable {
+ public:
+    HandleTable() noexcept : freeSlot(NO_FREE_SLOT) { }
+
+    // Add a default-constructed value for a key that is not in the table.
+    Handle
+    insert(StringView key) noexcept {
+        assert_(key.size);
+
+        Symbol name = intern(key);
+        assert_(!handles.tryAt(name));
+
+        U32 index;
+        if (freeSlot != NO_FREE_SLOT) {
+            index = freeSlot;
+            freeSlot = slots[index].nextFree;
+        }
+        else {
+            assert_(slots.size < HANDLE_INDEX_MASK);
+            index = static_cast<U32>(slots.size);
+            slots.push(Slot());
+            slots[index].generation = 1;
+        }
+
+        Slot& slot = slots[index];
+        slot.key = name;
+        slot.used = true;
+
+        Handle handle = (slot.generation << HANDLE_INDEX_BITS) | index;
+        handles[name] = handle;
+        return handle;
+    }
+
+    // The Handle for a key, or NO_HANDLE.
+    Handle
+    find(StringView key) noexcept {
+        Symbol name = internFind(key);
+        if (name == Symbol())
+            return NO_HANDLE;
+
+        Handle* handle = handles.tryAt(name);
+        return handle ? *handle : NO_HANDLE;
+    }
+
+    // The value for a Handle, or null if it was released.
+    Value*
+    at(Handle handle) noexcept {
+        U32 index = handle & HANDLE_INDEX_MASK;
+        if (handle == NO_HANDLE || index >= slots.size)
+            return 0;
+
+        Slot& slot = slots[index];
+        if (!slot.used || handle >> HANDLE_INDEX_BITS != slot.generation)
+            return 0;
+        return &slot.value;
+    }
+
+    // The value for a key, or null.
+    Value*
+    tryAt(StringView key) noexcept {
+        Symbol name = internFind(key);
+        if (name == Symbol())
+            return 0;
+
+        Handle* handle = handles.tryAt(name);
+        return handle ? &slots[*handle & HANDLE_INDEX_MASK].value : 0;
+    }
+
+    // Remove a value, leaving its slot to be reused. The value is reset but
+    // not otherwise cleaned up.
+    void
+    release(Handle handle) noexcept {
+        assert_(at(handle));
+
+        U32 index = handle & HANDLE_INDEX_MASK;
+        Slot& slot = slots[index];
+
+        handles.erase(slot.key);
+        slot.key = Symbol();
+        slot.value = Value();
+        slot.used = false;
+
+        // Skip generation 0 so that no Handle is equal to NO_HANDLE.
+        slot.generation = (slot.generation + 1) & HANDLE_GENERATION_MASK;
+        if (slot.generation == 0)
+            slot.generation = 1;
+
+        slot.nextFree = freeSlot;
+        freeSlot = index;
+    }
+
+    Size
+    size() noexcept {
+        return handles.size;
+    }
+
+ private:
+    static const U32 NO_FREE_SLOT = UINT32_MAX;
+
+    struct Slot {
+        Value value;
+        Symbol key;
+        U32 generation;
+        bool used;
+
+        // The next slot in the free list, if this one is not used.
+        U32 nextFree;
+    };
+
+    Hashmap<Symbol, Handle> handles;
+    Vector<Slot> slots;
+    U32 freeSlot;
+};
+
+#endif  // SRC_UTIL_HANDLE_TABLE_H_
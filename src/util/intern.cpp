@@ -0,0 +1,167 @@
+#include "util/intern.h"
+
+#include "os/c.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/fnv.h"
+#include "util/int.h"
+#include "util/new.h"
+#include "util/string-view.h"
+
+// Interned strings are copied into blocks of this size, which are never
+// freed. Longer strings get an allocation of their own.
+#define INTERN_BLOCK_SIZE 65536
+#define INTERN_BLOCK_MAX  (INTERN_BLOCK_SIZE / 4)
+
+struct Interned {
+    const char* data;
+    U32 size;
+    U32 hash;
+};
+
+// Indexed by Symbol ID. Starts with the empty string once anything has been
+// interned.
+//
+// Nothing here has a constructor, so DataAreas constructed during static
+// initialization can intern their script names.
+static Interned* symbols = 0;
+static U32 symbolsSize = 0;
+static U32 symbolsCapacity = 0;
+
+// Open-addressed table of Symbol IDs, with linear probing. 0 marks an empty
+// slot, as the empty string is never put in the table.
+static U32* table = 0;
+static U32 tableCapacity = 0;
+
+// Unused space at the end of the newest block.
+static char* block = 0;
+static Size blockLeft = 0;
+
+static Size arenaBytes = 0;
+
+static const char*
+store(StringView s) noexcept {
+    if (s.size > INTERN_BLOCK_MAX) {
+        char* data = xmalloc(char, s.size);
+        memcpy(data, s.data, s.size);
+        arenaBytes += s.size;
+        return data;
+    }
+
+    if (s.size > blockLeft) {
+        block = xmalloc(char, INTERN_BLOCK_SIZE);
+        blockLeft = INTERN_BLOCK_SIZE;
+        arenaBytes += INTERN_BLOCK_SIZE;
+    }
+
+    char* data = block;
+    memcpy(data, s.data, s.size);
+    block += s.size;
+    blockLeft -= s.size;
+    return data;
+}
+
+static U32*
+slotFor(StringView s, U32 hash) noexcept {
+    U32 mask = tableCapacity - 1;
+    for (U32 i = hash & mask;; i = (i + 1) & mask) {
+        U32 id = table[i];
+        if (id == 0)
+            return &table[i];
+
+        Interned& sym = symbols[id];
+        if (sym.hash == hash && sym.size == s.size &&
+            memcmp(sym.data, s.data, s.size) == 0)
+            return &table[i];
+    }
+}
+
+static void
+grow() noexcept {
+    U32* oldTable = table;
+    U32 oldCapacity = tableCapacity;
+
+    tableCapacity = oldCapacity ? oldCapacity * 2 : 256;
+    table = xmalloc(U32, tableCapacity);
+    memset(table, 0, tableCapacity * sizeof(U32));
+
+    U32 mask = tableCapacity - 1;
+    for (U32 i = 0; i < oldCapacity; i++) {
+        U32 id = oldTable[i];
+        if (id == 0)
+            continue;
+
+        U32 j = symbols[id].hash & mask;
+        while (table[j])
+            j = (j + 1) & mask;
+        table[j] = id;
+    }
+
+    free(oldTable);
+}
+
+Symbol
+intern(StringView s) noexcept {
+    Symbol sym = {0};
+    if (s.size == 0)
+        return sym;
+
+    if (symbolsSize == symbolsCapacity) {
+        symbolsCapacity = symbolsCapacity ? symbolsCapacity * 2 : 256;
+        Interned* newSymbols = xmalloc(Interned, symbolsCapacity);
+        memcpy(newSymbols, symbols, symbolsSize * sizeof(Interned));
+        free(symbols);
+        symbols = newSymbols;
+    }
+    if (symbolsSize == 0) {
+        Interned empty = {"", 0, 0};
+        symbols[symbolsSize++] = empty;
+    }
+
+    // Keep the table at most half full.
+    if ((symbolsSize + 1) * 2 > tableCapacity)
+        grow();
+
+    U32 hash = static_cast<U32>(fnvHash(s.data, s.size));
+    U32* slot = slotFor(s, hash);
+    if (*slot == 0) {
+        assert_(s.size <= UINT32_MAX);
+        Interned interned = {store(s), static_cast<U32>(s.size), hash};
+        *slot = symbolsSize;
+        symbols[symbolsSize++] = interned;
+    }
+
+    sym.id = *slot;
+    return sym;
+}
+
+Symbol
+internFind(StringView s) noexcept {
+    Symbol sym = {0};
+    if (s.size == 0 || tableCapacity == 0)
+        return sym;
+
+    U32 hash = static_cast<U32>(fnvHash(s.data, s.size));
+    sym.id = *slotFor(s, hash);
+    return sym;
+}
+
+StringView
+symbolName(Symbol s) noexcept {
+    if (s.id == 0)
+        return StringView();
+
+    Interned& sym = symbols[s.id];
+    return StringView(sym.data, sym.size);
+}
+
+Size
+hash_(Symbol s) noexcept {
+    return s.id ? symbols[s.id].hash : 0;
+}
+
+Size
+internMemoryUsage() noexcept {
+    return arenaBytes + symbolsCapacity * sizeof(Interned) +
+           tableCapacity * sizeof(U32);
+}
@@ -0,0 +1,52 @@
+#ifndef SRC_UTIL_INTERN_H_
+#define SRC_UTIL_INTERN_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+
+// Symbol
+//
+// A string that has been interned: stored once for the life of the program
+// and referred to by a 32-bit ID. Two Symbols are equal exactly when their
+// strings are, so comparing them does not touch the strings, and a Hashmap
+// keyed by Symbols stores no copies of them.
+//
+// The default Symbol is the empty string, which makes it the empty key of a
+// Hashmap.
+//
+// Interning is not thread-safe and is done from the main thread.
+struct Symbol {
+    U32 id;
+};
+
+inline bool
+operator==(Symbol a, Symbol b) noexcept {
+    return a.id == b.id;
+}
+inline bool
+operator!=(Symbol a, Symbol b) noexcept {
+    return a.id != b.id;
+}
+
+// Find or add the Symbol for a string.
+Symbol
+intern(StringView s) noexcept;
+
+// The Symbol for a string if it has been interned, or the empty Symbol.
+Symbol
+internFind(StringView s) noexcept;
+
+// The string of a Symbol. It is never freed or moved.
+StringView
+symbolName(Symbol s) noexcept;
+
+// The hash of a Symbol's string, computed when it was interned.
+Size
+hash_(Symbol s) noexcept;
+
+// Bytes used by interned strings and the table that finds them.
+Size
+internMemoryUsage() noexcept;
+
+#endif  // SRC_UTIL_INTERN_H_
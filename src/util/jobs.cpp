@@ -4,113 +4,241 @@
 #include "os/mutex.h"
 #include "os/thread.h"
 #include "util/assert.h"
+#include "util/atomic.h"
 #include "util/compiler.h"
 #include "util/int.h"
+#include "util/new.h"
 #include "util/queue.h"
 #include "util/vector.h"
+#include "util/work-deque.h"
 
-static Size workerLimit = 0;
+// How many times an idle worker looks for jobs before it goes to sleep.
+#define IDLE_SPINS 64
+
+struct Job {
+    Function fn;
+    JobCounter* counter;
+};
+
+// One deque per thread. The main thread's is first.
+static Vector<WorkDeque*> deques;
 static Vector<Thread> workers;
-static U32 jobsRunning = 0;
 
-// Empty jobs are the signal to quit.
-static Queue<Function> jobs;
+// Index into deques of the current thread, or -1 for threads that do not
+// belong to the job system.
+static thread_local I32 self = -1;
+static thread_local U32 seed = 0;
+
+// Jobs enqueued by threads without a deque.
+static Mutex injectedMutex;
+static Queue<Job*> injected;
+static I32 injectedCount = 0;
 
-// Whether the destructor has been called,
-static bool tearingDown = false;
+// Jobs that have been enqueued but not yet started.
+static I32 queued = 0;
 
-// Access to workers vector, jobs deque, jobsRunning, and tearingDown.
-static Mutex jobsMutex;
+// Jobs that have been enqueued but not yet finished.
+static JobCounter unfinished;
 
-// Events for when a job is added.
+// Access to quitting, and where idle workers sleep.
+static Mutex sleepMutex;
 static ConditionVariable jobAvailable;
+static I32 sleepers = 0;
+static bool quitting = false;
+
+static U32
+randomVictim() noexcept {
+    // xorshift32
+    if (seed == 0)
+        seed = static_cast<U32>(self) * 2654435761u + 1;
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static Job*
+findJob() noexcept {
+    Job* job = 0;
+
+    if (self >= 0)
+        job = static_cast<Job*>(deques[self]->pop());
+
+    if (!job && atomicLoad(&injectedCount) > 0) {
+        LockGuard lock(injectedMutex);
+        if (injected.size) {
+            job = injected.front();
+            injected.pop();
+            atomicAdd(&injectedCount, -1);
+        }
+    }
+
+    if (!job) {
+        U32 n = static_cast<U32>(deques.size);
+        U32 start = randomVictim();
+        for (U32 i = 0; i < n && !job; i++) {
+            U32 victim = (start + i) % n;
+            if (static_cast<I32>(victim) != self)
+                job = static_cast<Job*>(deques[victim]->steal());
+        }
+    }
 
-// Events for when a job is finished.
-static ConditionVariable jobsDone;
+    if (job)
+        atomicAdd(&queued, -1);
+
+    return job;
+}
 
 static void
-work() noexcept {
-    Function fn;
+run(Job* job) noexcept {
+    job->fn.fn(job->fn.data);
+
+    if (job->counter)
+        atomicAdd(&job->counter->value, -1);
+    atomicAdd(&unfinished.value, -1);
+
+    delete job;
+}
 
-    do {
-        {
-            LockGuard lock(jobsMutex);
+static void
+work(void* data) noexcept {
+    self = static_cast<I32>(reinterpret_cast<Size>(data));
 
-            while (jobs.size == 0)
-                jobAvailable.wait(lock);
+    U32 idle = 0;
 
-            fn = jobs.front();
-            jobs.pop();
+    for (;;) {
+        Job* job = findJob();
+        if (job) {
+            run(job);
+            idle = 0;
+            continue;
+        }
 
-            jobsRunning += 1;
+        if (++idle < IDLE_SPINS) {
+            threadYield();
+            continue;
         }
+        idle = 0;
 
-        if (fn.fn)
-            fn.fn(fn.data);
+        LockGuard lock(sleepMutex);
 
-        {
-            LockGuard lock(jobsMutex);
+        if (quitting)
+            return;
 
-            jobsRunning -= 1;
+        // Pairs with the fence in JobsEnqueue(): either the enqueuer sees us
+        // asleep, or we see its job.
+        atomicAdd(&sleepers, 1);
+        atomicFence();
+        if (atomicLoad(&queued) == 0)
+            jobAvailable.wait(lock);
+        atomicAdd(&sleepers, -1);
+    }
+}
 
-            if (jobsRunning == 0 && jobs.size == 0)
-                jobsDone.notifyOne();
-        }
-    } while (fn.fn);
+// How many threads to start besides the main thread.
+static U32
+workerCount() noexcept {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    // Built without threads.
+    return 0;
+#else
+    // 0 if the number of cores is unknown.
+    U32 cores = threadHardwareConcurrency();
+    return cores > 1 ? cores - 1 : 0;
+#endif
 }
 
 void
-JobsEnqueue(Function fn) noexcept {
-    LockGuard lock(jobsMutex);
+JobsInit() noexcept {
+    assert_(deques.size == 0);
 
-    assert_(!tearingDown);
+    U32 n = workerCount() + 1;
 
-    jobs.push(fn);
+    for (U32 i = 0; i < n; i++)
+        deques.push(new WorkDeque);
 
-    if (workerLimit == 0)
-        workerLimit = threadHardwareConcurrency();
+    self = 0;
 
-    if (workers.size < workerLimit)
+    if (n > 1)
+        workers.reserve(n - 1);
+    for (U32 i = 1; i < n; i++) {
+        Function fn = {work, reinterpret_cast<void*>(static_cast<Size>(i))};
         workers.push(Thread(fn));
-
-    jobAvailable.notifyOne();
+    }
 }
 
 void
-JobsFlush() noexcept {
-    // TODO: Don't quit the threads.
+JobsEnqueue(Function fn, JobCounter* counter) noexcept {
+    assert_(deques.size);
 
-    // Wait for all jobs to finish.
-    {
-        Mutex m;
-        LockGuard lock(m);
+    // With no workers, nothing would run the job until someone waits on it.
+    if (workers.size == 0) {
+        fn.fn(fn.data);
+        return;
+    }
 
-        while (jobsRunning > 0 || jobs.size > 0)
-            jobsDone.wait(lock);
+    Job* job = new Job;
+    job->fn = fn;
+    job->counter = counter;
+
+    if (counter)
+        atomicAdd(&counter->value, 1);
+    atomicAdd(&unfinished.value, 1);
+    atomicAdd(&queued, 1);
+
+    if (self >= 0) {
+        deques[self]->push(job);
+    }
+    else {
+        LockGuard lock(injectedMutex);
+        injected.push(job);
+        atomicAdd(&injectedCount, 1);
     }
 
-    // Tell workers they can quit.
-    {
-        LockGuard lock(jobsMutex);
-
-        // Send over empty jobs.
-        for (Size i = 0; i < workers.size; i++) {
-            Function fn;
-            fn.fn = 0;
-            fn.data = 0;
-            jobs.push(fn);
-        }
+    atomicFence();
+    if (atomicLoad(&sleepers) > 0) {
+        LockGuard lock(sleepMutex);
+        jobAvailable.notifyOne();
+    }
+}
 
-        tearingDown = true;
+void
+JobsWait(JobCounter* counter) noexcept {
+    while (atomicLoadAcquire(&counter->value) > 0) {
+        Job* job = findJob();
+        if (job)
+            run(job);
+        else
+            threadYield();
     }
+}
 
+void
+JobsFlush() noexcept {
+    JobsWait(&unfinished);
+}
+
+void
+JobsQuit() noexcept {
+    if (deques.size == 0)
+        return;
+
+    JobsFlush();
+
+    {
+        LockGuard lock(sleepMutex);
+        quitting = true;
+    }
     jobAvailable.notifyAll();
 
-    // Wait for workers to quit.
     for (Thread* worker = workers.begin(); worker != workers.end(); worker++)
         worker->join();
-
-    // Reset.
     workers.clear();
-    tearingDown = false;
+
+    for (WorkDeque** d = deques.begin(); d != deques.end(); d++)
+        delete *d;
+    deques.clear();
+
+    self = -1;
+    quitting = false;
 }
@@ -3,10 +3,38 @@
 
 #include "util/compiler.h"
 #include "util/function.h"
+#include "util/int.h"
 
+// The number of unfinished jobs in a group, for waiting on all of them.
+struct JobCounter {
+    JobCounter() noexcept : value(0) { }
+
+    I32 value;
+};
+
+// Start a worker thread for each core but one. The calling thread becomes the
+// main thread, which runs jobs too while it waits on them. With one core, or
+// in a build without threads, there are no workers and jobs run as they are
+// enqueued.
 void
-JobsEnqueue(Function fn) noexcept;
+JobsInit() noexcept;
+
+// Run fn on some thread, perhaps this one before returning. If counter is
+// given, it counts the job until the job has returned. Jobs may enqueue more
+// jobs.
+void
+JobsEnqueue(Function fn, JobCounter* counter = 0) noexcept;
+
+// Run jobs on this thread until every job counted by counter has finished.
+void
+JobsWait(JobCounter* counter) noexcept;
+
+// Run jobs on this thread until every job has finished.
 void
 JobsFlush() noexcept;
 
+// Finish all jobs, then stop the worker threads.
+void
+JobsQuit() noexcept;
+
 #endif  // SRC_UTIL_JOBS_H_
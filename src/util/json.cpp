@@ -31,7 +31,9 @@
 
 #include "util/json.h"
 
+#include "os/c.h"
 #include "util/compiler.h"
+#include "util/cpu.h"
 #include "util/int.h"
 #include "util/new.h"
 #include "util/string-view.h"
@@ -112,6 +114,181 @@ char2int(char c) noexcept {
     return (c & ~' ') - 'A' + 10;
 }
 
+// Runs of whitespace and of plain string characters are skipped with vector
+// compares, 16 bytes at a time on x86-64 and aarch64 and 32 bytes at a time
+// on x86-64 CPUs with AVX2. Vector loads are aligned and only cover whole
+// blocks before the text's NUL terminator at end. The scalar loops finish the
+// last partial block, so nothing past the terminator is read.
+#if (GCC || CLANG) && (defined(__x86_64__) || defined(__aarch64__))
+#    define JSON_VECTOR 1
+#else
+#    define JSON_VECTOR 0
+#endif
+
+#if JSON_VECTOR
+typedef U8 Bytes16 __attribute__((vector_size(16), may_alias));
+
+static inline Bytes16
+load16(const char* p) noexcept {
+    return *reinterpret_cast<const Bytes16*>(p);
+}
+
+// Index of the first set byte in a comparison result, or 16 if there is none.
+static inline Size
+firstSet16(Bytes16 m) noexcept {
+#    if defined(__x86_64__)
+    typedef char Chars16 __attribute__((vector_size(16)));
+    U32 bits = __builtin_ia32_pmovmskb128(reinterpret_cast<Chars16>(m));
+    return bits ? __builtin_ctz(bits) : 16;
+#    else
+    U64 halves[2];
+    memcpy(halves, &m, sizeof(halves));
+    if (halves[0])
+        return __builtin_ctzll(halves[0]) / 8;
+    if (halves[1])
+        return 8 + __builtin_ctzll(halves[1]) / 8;
+    return 16;
+#    endif
+}
+
+static inline Bytes16
+notSpace16(Bytes16 b) noexcept {
+    return reinterpret_cast<Bytes16>(b != ' ') &
+           reinterpret_cast<Bytes16>(static_cast<Bytes16>(b - '\t') > 4);
+}
+
+static inline Bytes16
+stringSpecial16(Bytes16 b) noexcept {
+    return reinterpret_cast<Bytes16>(b == '"') |
+           reinterpret_cast<Bytes16>(b == '\\') |
+           reinterpret_cast<Bytes16>(b < ' ') |
+           reinterpret_cast<Bytes16>(b == 0x7F);
+}
+
+// These return the first match, or the start of the partial block at end if
+// there is none before it.
+static char*
+skipSpace16(char* s, char* end) noexcept {
+    for (; end - s >= 16; s += 16) {
+        Size i = firstSet16(notSpace16(load16(s)));
+        if (i != 16)
+            return s + i;
+    }
+    return s;
+}
+
+static char*
+skipString16(char* s, char* end) noexcept {
+    for (; end - s >= 16; s += 16) {
+        Size i = firstSet16(stringSpecial16(load16(s)));
+        if (i != 16)
+            return s + i;
+    }
+    return s;
+}
+
+#    if defined(__x86_64__)
+typedef U8 Bytes32 __attribute__((vector_size(32), may_alias));
+typedef char Chars32 __attribute__((vector_size(32)));
+
+// Callers must align s to 16 bytes, so the first load may be a half block.
+__attribute__((target("avx2"))) static char*
+skipSpace32(char* s, char* end) noexcept {
+    if (reinterpret_cast<Size>(s) % 32 && end - s >= 16) {
+        Size i = firstSet16(notSpace16(load16(s)));
+        if (i != 16)
+            return s + i;
+        s += 16;
+    }
+    for (; end - s >= 32; s += 32) {
+        Bytes32 b = *reinterpret_cast<const Bytes32*>(s);
+        Bytes32 m = reinterpret_cast<Bytes32>(b != ' ') &
+                    reinterpret_cast<Bytes32>(
+                        static_cast<Bytes32>(b - '\t') > 4);
+        U32 bits = __builtin_ia32_pmovmskb256(reinterpret_cast<Chars32>(m));
+        if (bits)
+            return s + __builtin_ctz(bits);
+    }
+    return s;
+}
+
+__attribute__((target("avx2"))) static char*
+skipString32(char* s, char* end) noexcept {
+    if (reinterpret_cast<Size>(s) % 32 && end - s >= 16) {
+        Size i = firstSet16(stringSpecial16(load16(s)));
+        if (i != 16)
+            return s + i;
+        s += 16;
+    }
+    for (; end - s >= 32; s += 32) {
+        Bytes32 b = *reinterpret_cast<const Bytes32*>(s);
+        Bytes32 m = reinterpret_cast<Bytes32>(b == '"') |
+                    reinterpret_cast<Bytes32>(b == '\\') |
+                    reinterpret_cast<Bytes32>(b < ' ') |
+                    reinterpret_cast<Bytes32>(b == 0x7F);
+        U32 bits = __builtin_ia32_pmovmskb256(reinterpret_cast<Chars32>(m));
+        if (bits)
+            return s + __builtin_ctz(bits);
+    }
+    return s;
+}
+
+static const bool haveAvx2 = getCpu().avx2;
+#    else
+static const bool haveAvx2 = false;
+#    endif
+#endif  // JSON_VECTOR
+
+static inline bool
+isstringspecial(char c) noexcept {
+    return c == '"' || c == '\\' || static_cast<U8>(c) < ' ' || c == '\x7F';
+}
+
+// Returns the first character at or after s that is not whitespace. The text
+// ends with a NUL at end.
+static inline char*
+skipSpace(char* s, char* end) noexcept {
+    // Tokens are usually separated by at most a space, so only look for a
+    // longer run once the first few characters have been checked.
+    for (I32 i = 0; i < 4; i++, s++)
+        if (!isspace(*s))
+            return s;
+#if JSON_VECTOR
+    for (; reinterpret_cast<Size>(s) % 16; s++)
+        if (!isspace(*s))
+            return s;
+#    if defined(__x86_64__)
+    if (haveAvx2)
+        s = skipSpace32(s, end);
+    else
+#    endif
+        s = skipSpace16(s, end);
+#endif
+    while (isspace(*s))
+        s++;
+    return s;
+}
+
+// Returns the first character at or after s that ends a string, starts an
+// escape, or is not allowed in a string. The text ends with a NUL at end.
+static inline char*
+skipString(char* s, char* end) noexcept {
+#if JSON_VECTOR
+    for (; reinterpret_cast<Size>(s) % 16; s++)
+        if (isstringspecial(*s))
+            return s;
+#    if defined(__x86_64__)
+    if (haveAvx2)
+        s = skipString32(s, end);
+    else
+#    endif
+        s = skipString16(s, end);
+#endif
+    while (!isstringspecial(*s))
+        s++;
+    return s;
+}
+
 static double
 string2double(char* s, char** endptr) noexcept {
     char ch = *s;
@@ -160,6 +337,30 @@ string2double(char* s, char** endptr) noexcept {
     return ch == '-' ? -result : result;
 }
 
+// Integers of up to this many digits convert to doubles exactly.
+#define JSON_EXACT_DIGITS 15
+
+// Parse a number, with a fast path for the integers that make up most of an
+// area's layer data.
+static inline double
+string2number(char* s, char** endptr) noexcept {
+    char* p = s;
+    if (*p == '-')
+        ++p;
+
+    char* digits = p;
+    U64 n = 0;
+    while (isdigit(*p) && p - digits < JSON_EXACT_DIGITS)
+        n = n * 10 + static_cast<U64>(*p++ - '0');
+
+    if (p == digits || isdigit(*p) || *p == '.' || *p == 'e' || *p == 'E')
+        return string2double(s, endptr);
+
+    *endptr = p;
+    double result = static_cast<double>(n);
+    return *s == '-' ? -result : result;
+}
+
 static inline JsonNode*
 insertAfter(JsonNode* tail, JsonNode* node) noexcept {
     if (!tail)
@@ -179,11 +380,105 @@ listToValue(JsonTag tag, JsonNode* tail) noexcept {
     return JsonValue(tag, 0);
 }
 
+struct JsonIndexSlot {
+    JsonNode* node;
+    U32 hash;
+    U32 size;
+};
+
+static inline JsonIndexSlot*
+indexSlots(JsonIndex* index) noexcept {
+    return reinterpret_cast<JsonIndexSlot*>(index + 1);
+}
+
+// Reserve an index for an object, sized for a load factor of at most 2/3.
+// It is filled when the object is first searched.
+static JsonValue
+indexedObject(JsonNode* head, Size members,
+              JsonAllocator& allocator) noexcept {
+    U32 slots = 4;
+    while (slots < members + members / 2)
+        slots *= 2;
+
+    JsonIndex* index = static_cast<JsonIndex*>(allocator.allocate(
+        sizeof(JsonIndex) + slots * sizeof(JsonIndexSlot)));
+    if (index == 0)
+        return JsonValue(JSON_OBJECT, head);
+
+    index->head = head;
+    index->mask = slots - 1;
+    index->built = false;
+
+    return JsonValue(JSON_OBJECT,
+                     reinterpret_cast<char*>(index) + JSON_VALUE_INDEXED);
+}
+
+static void
+buildIndex(JsonIndex* index) noexcept {
+    JsonIndexSlot* slots = indexSlots(index);
+    memset(slots, 0, (index->mask + 1) * sizeof(JsonIndexSlot));
+
+    for (JsonNode* node = index->head; node; node = node->next) {
+        U32 size = static_cast<U32>(strlen(node->key));
+        U32 hash = jsonHash(node->key, size);
+
+        for (U32 i = hash & index->mask;; i = (i + 1) & index->mask) {
+            JsonIndexSlot& slot = slots[i];
+            if (slot.node == 0) {
+                slot.node = node;
+                slot.hash = hash;
+                slot.size = size;
+                break;
+            }
+            // On a duplicate key, the first member wins, as in a linear
+            // search.
+            if (slot.hash == hash && slot.size == size &&
+                memcmp(slot.node->key, node->key, size) == 0)
+                break;
+        }
+    }
+
+    index->built = true;
+}
+
+// Whether NUL-terminated key a equals b.
+static inline bool
+keyEquals(const char* a, const char* b, Size size) noexcept {
+    for (Size i = 0; i < size; i++)
+        if (a[i] != b[i] || a[i] == 0)
+            return false;
+    return a[size] == 0;
+}
+
+// Whether the member whose value is being parsed is at path.
 static bool
-parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
+onPath(char** keys, SSize pos, StringView path) noexcept {
+    SSize end = static_cast<SSize>(path.size);
+    for (; pos >= 0; pos--) {
+        if (keys[pos] == 0)
+            continue;  // An array.
+        if (end < 0)
+            return false;
+
+        SSize start = end;
+        while (start > 0 && path.data[start - 1] != '/')
+            start--;
+        if (!keyEquals(keys[pos], path.data + start,
+                       static_cast<Size>(end - start)))
+            return false;
+        end = start - 1;
+    }
+    return end < 0;
+}
+
+// Parse the text in [s, end), where *end is NUL.
+static bool
+parse(char* s, char* end, JsonValue* value, JsonAllocator& allocator,
+      StringView rawArrays) noexcept {
     JsonNode* tails[JSON_STACK_SIZE];
     JsonTag tags[JSON_STACK_SIZE];
     char* keys[JSON_STACK_SIZE];
+    Size members[JSON_STACK_SIZE];
     JsonValue o;
     SSize pos = -1;
     bool separator = true;
@@ -191,11 +486,7 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
     char* endptr = s;
 
     while (*s) {
-        while (isspace(*s)) {
-            ++s;
-            if (!*s)
-                break;
-        }
+        s = skipSpace(s, end);
         endptr = s++;
         switch (*endptr) {
         case '-':
@@ -213,7 +504,7 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
         case '7':
         case '8':
         case '9':
-            o = JsonValue(string2double(endptr, &s));
+            o = JsonValue(string2number(endptr, &s));
             if (!isdelim(*s)) {
                 endptr = s;
                 return false;
@@ -221,7 +512,15 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
             break;
         case '"':
             o = JsonValue(JSON_STRING, s);
-            for (char* it = s; *s; ++it, ++s) {
+            for (char* it = s;; ++it, ++s) {
+                // Move the characters that need no unescaping in one go.
+                // Until the first escape, they are already in place.
+                char* run = skipString(s, end);
+                if (it != s)
+                    memmove(it, s, static_cast<Size>(run - s));
+                it += run - s;
+                s = run;
+
                 I32 c = *it = *s;
                 if (c == '\\') {
                     c = *++s;
@@ -261,15 +560,16 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
                     default: endptr = s; return false;
                     }
                 }
-                else if (static_cast<U32>(c) < ' ' || c == '\x7F') {
-                    endptr = s;
-                    return false;
-                }
                 else if (c == '"') {
                     *it = 0;
                     ++s;
                     break;
                 }
+                else {
+                    // A control character, including the text's terminator.
+                    endptr = s;
+                    return false;
+                }
             }
             if (!isdelim(*s)) {
                 endptr = s;
@@ -310,9 +610,25 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
                 return false;
             if (keys[pos] != 0)
                 return false;
-            o = listToValue(JSON_OBJECT, tails[pos--]);
+            o = listToValue(JSON_OBJECT, tails[pos]);
+            if (members[pos] >= JSON_INDEX_MIN_MEMBERS)
+                o = indexedObject(o.toNode(), members[pos], allocator);
+            pos--;
             break;
         case '[':
+            if (rawArrays.size && pos != -1 && keys[pos] != 0 &&
+                onPath(keys, pos, rawArrays)) {
+                // Anything but numbers in the array is caught when it is
+                // read.
+                char* close = static_cast<char*>(
+                    memchr(s, ']', static_cast<Size>(end - s)));
+                if (close == 0)
+                    return false;
+                *close = 0;
+                o = JsonValue(JSON_RAW_ARRAY, s);
+                s = close + 1;
+                break;
+            }
             if (++pos == JSON_STACK_SIZE)
                 return false;
             tails[pos] = 0;
@@ -326,6 +642,7 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
             tails[pos] = 0;
             tags[pos] = JSON_OBJECT;
             keys[pos] = 0;
+            members[pos] = 0;
             separator = true;
             continue;
         case ':':
@@ -338,7 +655,7 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
                 return false;
             separator = true;
             continue;
-        case '\0': continue;
+        case '\0': return false;
         default: return false;
         }
 
@@ -364,6 +681,7 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
             tails[pos] = insertAfter(tails[pos], node);
             tails[pos]->key = keys[pos];
             keys[pos] = 0;
+            members[pos]++;
         }
         else {
             if ((node = reinterpret_cast<JsonNode*>(allocator.allocate(
@@ -377,13 +695,87 @@ parse(char* s, JsonValue* value, JsonAllocator& allocator) noexcept {
     return false;
 }
 
+JsonValue
+JsonValue::operator[](const JsonKey& key) noexcept {
+    assert_(isObject());
+
+    U64 payload = getPayload();
+    if (!(payload & JSON_VALUE_INDEXED)) {
+        for (JsonNode* node = toNode(); node != 0; node = node->next)
+            if (keyEquals(node->key, key.name, key.size))
+                return node->value;
+        return JsonValue();
+    }
+
+    JsonIndex* index = reinterpret_cast<JsonIndex*>(payload -
+                                                    JSON_VALUE_INDEXED);
+    if (!index->built)
+        buildIndex(index);
+
+    JsonIndexSlot* slots = indexSlots(index);
+    for (U32 i = key.hash & index->mask;; i = (i + 1) & index->mask) {
+        JsonIndexSlot& slot = slots[i];
+        if (slot.node == 0)
+            return JsonValue();
+        if (slot.hash == key.hash && slot.size == key.size &&
+            memcmp(slot.node->key, key.name, key.size) == 0)
+            return slot.node->value;
+    }
+}
+
 JsonValue
 JsonValue::operator[](StringView key) noexcept {
-    for (JsonNode* node = toNode(); node != 0; node = node->next)
-        if (key == node->key)
-            return node->value;
+    return (*this)[JsonKey(key)];
+}
+
+bool
+jsonReadU32s(JsonValue array, U32* out, Size capacity, U32 limit,
+             Size& size) noexcept {
+    size = 0;
+
+    if (array.isArray()) {
+        for (JsonNode* node = array.toNode(); node; node = node->next) {
+            if (!node->value.isNumber() || size == capacity)
+                return false;
+            double d = node->value.toNumber();
+            if (!(0 <= d && d < limit) || d != static_cast<U32>(d))
+                return false;
+            out[size++] = static_cast<U32>(d);
+        }
+        return true;
+    }
 
-    return JsonValue();
+    if (!array.isRawArray())
+        return false;
+
+    // The text between the brackets, with the closing one replaced by a NUL.
+    const char* s = reinterpret_cast<const char*>(array.getPayload());
+
+    while (isspace(*s))
+        s++;
+    if (*s == 0)
+        return true;
+
+    for (;;) {
+        // Up to 10 digits, which is enough for any U32 and cannot overflow
+        // a U64.
+        const char* digits = s;
+        U64 n = 0;
+        while (isdigit(*s) && s - digits < 10)
+            n = n * 10 + static_cast<U64>(*s++ - '0');
+        if (s == digits || isdigit(*s) || n >= limit || size == capacity)
+            return false;
+        out[size++] = static_cast<U32>(n);
+
+        while (isspace(*s))
+            s++;
+        if (*s == 0)
+            return true;
+        if (*s++ != ',')
+            return false;
+        while (isspace(*s))
+            s++;
+    }
 }
 
 void
@@ -394,10 +786,11 @@ JsonAllocator::operator=(JsonAllocator&& other) noexcept {
 
 JsonDocument::JsonDocument() noexcept : ok(false) { }
 
-JsonDocument::JsonDocument(String text) noexcept
+JsonDocument::JsonDocument(String text, StringView rawArrays) noexcept
     : text(static_cast<String&&>(text)) {
     this->text << '\0';
-    ok = parse(this->text.data, &root, allocator);
+    ok = parse(this->text.data, this->text.data + this->text.size - 1, &root,
+               allocator, rawArrays);
 }
 
 JsonDocument::JsonDocument(JsonDocument&& other) noexcept {
@@ -40,6 +40,16 @@
 #define JSON_VALUE_TAG_MASK     0x7
 #define JSON_VALUE_TAG_SHIFT    48
 
+// Set in the payload of an object that points to a JsonIndex rather than to
+// its first member.
+#define JSON_VALUE_INDEXED 0x1
+
+// Objects with at least this many members get a hashed key index.
+#define JSON_INDEX_MIN_MEMBERS 8
+
+#define JSON_HASH_BASIS 2166136261u
+#define JSON_HASH_PRIME 16777619u
+
 enum JsonTag {
     JSON_NUMBER = 0,
     JSON_STRING,
@@ -47,10 +57,36 @@ enum JsonTag {
     JSON_OBJECT,
     JSON_TRUE,
     JSON_FALSE,
-    JSON_NULL
+    JSON_NULL,
+    JSON_RAW_ARRAY
 };
 
 struct JsonNode;
+struct JsonIndex;
+
+// 32-bit FNV-1a, written so that it can be evaluated at compile time.
+inline constexpr11 U32
+jsonHash(const char* s, Size n, U32 h = JSON_HASH_BASIS) noexcept {
+    return n == 0 ? h
+                  : jsonHash(s + 1, n - 1,
+                             (h ^ static_cast<U8>(*s)) * JSON_HASH_PRIME);
+}
+
+//! An object key with its hash. A JsonKey made from a string literal can be
+//! constexpr, so a key that is looked up often is only hashed once.
+struct JsonKey {
+    template<Size N>
+    constexpr11 JsonKey(const char (&name)[N]) noexcept
+        : name(name), size(N - 1), hash(jsonHash(name, N - 1)) { }
+    explicit JsonKey(StringView name) noexcept
+        : name(name.data),
+          size(name.size),
+          hash(jsonHash(name.data, name.size)) { }
+
+    const char* name;
+    Size size;
+    U32 hash;
+};
 
 union JsonValue {
     U64 ival;
@@ -101,6 +137,12 @@ union JsonValue {
         return getTag() == JSON_OBJECT;
     }
 
+    //! An array that JsonDocument left as text. Read it with jsonReadU32s().
+    inline bool
+    isRawArray() noexcept {
+        return getTag() == JSON_RAW_ARRAY;
+    }
+
     inline bool
     isDouble() noexcept {
         return static_cast<I64>(ival) <= static_cast<I64>(JSON_VALUE_NAN_MASK);
@@ -144,13 +186,20 @@ union JsonValue {
     }
 
     inline JsonNode*
-    toNode() noexcept {
-        assert_(isArray() || isObject());
-        return reinterpret_cast<JsonNode*>(getPayload());
-    }
+    toNode() noexcept;
 
+    //! Find an object's member. Objects with JSON_INDEX_MIN_MEMBERS or more
+    //! members build a hash index on their first lookup, so a document must
+    //! not be searched from more than one thread at a time.
+    JsonValue
+    operator[](const JsonKey& key) noexcept;
     JsonValue
     operator[](StringView key) noexcept;
+    template<Size N>
+    inline JsonValue
+    operator[](const char (&key)[N]) noexcept {
+        return (*this)[JsonKey(key)];
+    }
 
     inline U64
     getPayload() noexcept {
@@ -165,6 +214,24 @@ struct JsonNode {
     char* key;
 };
 
+// Header of an object with a key index. Allocated while parsing and followed
+// by its slots, which are filled on the object's first lookup.
+struct JsonIndex {
+    JsonNode* head;
+    U32 mask;
+    bool built;
+};
+
+inline JsonNode*
+JsonValue::toNode() noexcept {
+    assert_(isArray() || isObject());
+    U64 payload = getPayload();
+    if (payload & JSON_VALUE_INDEXED)
+        return reinterpret_cast<JsonIndex*>(payload - JSON_VALUE_INDEXED)
+            ->head;
+    return reinterpret_cast<JsonNode*>(payload);
+}
+
 struct JsonIterator {
     JsonNode* node;
 
@@ -224,11 +291,24 @@ struct JsonAllocator {
     Zone* head;
 };
 
+//! Decode an array of integers in [0, limit) into out, which has room for
+//! capacity of them, and set size to how many there were. Reads raw arrays
+//! as well as parsed ones.
+bool
+jsonReadU32s(JsonValue array, U32* out, Size capacity, U32 limit,
+             Size& size) noexcept;
+
 class JsonDocument {
  public:
     JsonDocument() noexcept;
     // Adds a NUL terminator. Best to try to pass a String with capacity > size.
-    JsonDocument(String text) noexcept;
+    //
+    // Arrays at rawArrays, a '/'-separated list of object keys from the root,
+    // are not parsed. They become JSON_RAW_ARRAY values that point into the
+    // text, which saves a node per element for large arrays of numbers. Arrays
+    // along the way are not named in the path, so "layers/data" matches
+    // root["layers"][i]["data"].
+    JsonDocument(String text, StringView rawArrays = StringView()) noexcept;
     JsonDocument(JsonDocument&& other) noexcept;
     ~JsonDocument() noexcept;
 
@@ -0,0 +1,242 @@
+#include "util/profile.h"
+
+#include "os/c.h"
+#include "os/mutex.h"
+#include "os/os.h"
+#include "util/compiler.h"
+#include "util/io.h"
+#include "util/math2.h"
+#include "util/new.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+// Number of records kept per thread. Older records are overwritten, but
+// histograms keep counting.
+#define RING_SIZE 16384
+
+// Histogram buckets. Each power of two is split into four linear sub-buckets,
+// which bounds the error of reported percentiles to 25%.
+#define BUCKETS 256
+
+struct ProfileRecord {
+    Nanoseconds start;
+    U32 duration;
+    U32 zone;
+};
+
+struct Histogram {
+    U32 buckets[BUCKETS];
+    U64 count;
+    Nanoseconds total;
+    Nanoseconds max;
+};
+
+struct ProfileThread {
+    U32 id;
+    U64 written;
+    ProfileRecord ring[RING_SIZE];
+    Histogram histograms[PROFILE_MAX_ZONES];
+};
+
+bool profileEnabled = false;
+
+// Filled in during static initialization.
+static ProfileZone* zones[PROFILE_MAX_ZONES];
+static U32 zoneCount = 0;
+
+static Mutex threadsMutex;
+static Vector<ProfileThread*> threads;
+static thread_local ProfileThread* self = 0;
+
+static String tracePath;
+static Nanoseconds epoch = 0;
+
+ProfileZone::ProfileZone(const char* name) noexcept : name(name) {
+    assert_(zoneCount < PROFILE_MAX_ZONES);
+    id = zoneCount++;
+    zones[id] = this;
+}
+
+static ProfileThread*
+registerThread() noexcept {
+    new0(ProfileThread, t);
+    memset(t, 0, sizeof(ProfileThread));
+
+    LockGuard guard(threadsMutex);
+    t->id = static_cast<U32>(threads.size);
+    threads.push(t);
+    return t;
+}
+
+static U32
+bucketOf(U64 ns) noexcept {
+    if (ns < 4)
+        return static_cast<U32>(ns);
+
+    U32 log2 = 0;
+#if CLANG || GCC
+    log2 = 63 - static_cast<U32>(__builtin_clzll(ns));
+#else
+    for (U64 n = ns; n > 1; n >>= 1)
+        log2++;
+#endif
+
+    U32 sub = static_cast<U32>(ns >> (log2 - 2)) & 3;
+    return (log2 - 1) * 4 + sub;
+}
+
+// The largest value that falls into the bucket.
+static Nanoseconds
+bucketLimit(U32 bucket) noexcept {
+    if (bucket < 4)
+        return bucket;
+
+    U32 log2 = bucket / 4 + 1;
+    U32 sub = bucket % 4;
+    return ((static_cast<Nanoseconds>(4 + sub + 1)) << (log2 - 2)) - 1;
+}
+
+void
+profileRecord(ProfileZone& zone, Nanoseconds start, Nanoseconds end) noexcept {
+    if (self == 0)
+        self = registerThread();
+
+    Nanoseconds duration = end - start;
+
+    ProfileRecord& record = self->ring[self->written % RING_SIZE];
+    record.start = start;
+    record.duration = duration < UINT32_MAX ? static_cast<U32>(duration)
+                                            : UINT32_MAX;
+    record.zone = zone.id;
+    self->written += 1;
+
+    Histogram& histogram = self->histograms[zone.id];
+    histogram.buckets[bucketOf(static_cast<U64>(duration))] += 1;
+    histogram.count += 1;
+    histogram.total += duration;
+    if (histogram.max < duration)
+        histogram.max = duration;
+}
+
+void
+profileEnable(StringView path) noexcept {
+    tracePath = path;
+    epoch = chronoNow();
+    profileEnabled = true;
+}
+
+static Nanoseconds
+percentile(Histogram& histogram, U64 p) noexcept {
+    U64 rank = (histogram.count * p + 99) / 100;
+    U64 seen = 0;
+    for (U32 i = 0; i < BUCKETS; i++) {
+        seen += histogram.buckets[i];
+        if (seen >= rank && seen > 0)
+            return min(bucketLimit(i), histogram.max);
+    }
+    return histogram.max;
+}
+
+// Print nanoseconds as microseconds with three decimal places.
+static void
+writeMicroseconds(String& out, Nanoseconds ns) noexcept {
+    if (ns < 0) {
+        out << '-';
+        ns = -ns;
+    }
+
+    I32 fraction = static_cast<I32>(ns % 1000);
+    out << static_cast<I64>(ns / 1000) << '.';
+    if (fraction < 100)
+        out << '0';
+    if (fraction < 10)
+        out << '0';
+    out << fraction;
+}
+
+static void
+writeSummary() noexcept {
+    for (U32 zone = 0; zone < zoneCount; zone++) {
+        Histogram merged;
+        memset(&merged, 0, sizeof(merged));
+
+        for (ProfileThread** t = threads.begin(); t != threads.end(); t++) {
+            Histogram& h = (*t)->histograms[zone];
+            for (U32 i = 0; i < BUCKETS; i++)
+                merged.buckets[i] += h.buckets[i];
+            merged.count += h.count;
+            merged.total += h.total;
+            if (merged.max < h.max)
+                merged.max = h.max;
+        }
+
+        if (merged.count == 0)
+            continue;
+
+        Nanoseconds mean =
+            merged.total / static_cast<Nanoseconds>(merged.count);
+
+        String line;
+        line << "Profile " << zones[zone]->name << ": n " << merged.count
+             << " mean ";
+        writeMicroseconds(line, mean);
+        line << "us p50 ";
+        writeMicroseconds(line, percentile(merged, 50));
+        line << "us p99 ";
+        writeMicroseconds(line, percentile(merged, 99));
+        line << "us max ";
+        writeMicroseconds(line, merged.max);
+        line << "us\n";
+
+        serr << line;
+    }
+}
+
+static bool
+writeTrace() noexcept {
+    String json;
+    json << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    bool first = true;
+
+    for (ProfileThread** t = threads.begin(); t != threads.end(); t++) {
+        ProfileThread* thread = *t;
+
+        U64 count = thread->written < RING_SIZE ? thread->written : RING_SIZE;
+        U64 oldest = thread->written - count;
+
+        for (U64 i = oldest; i < thread->written; i++) {
+            ProfileRecord& record = thread->ring[i % RING_SIZE];
+
+            if (!first)
+                json << ',';
+            first = false;
+
+            json << "\n{\"name\":\"" << zones[record.zone]->name
+                 << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread->id
+                 << ",\"ts\":";
+            writeMicroseconds(json, record.start - epoch);
+            json << ",\"dur\":";
+            writeMicroseconds(json, record.duration);
+            json << '}';
+        }
+    }
+
+    json << "\n]}\n";
+
+    return writeFile(tracePath, static_cast<U32>(json.size), json.data);
+}
+
+void
+profileDump() noexcept {
+    if (!profileEnabled)
+        return;
+    profileEnabled = false;
+
+    LockGuard guard(threadsMutex);
+
+    writeSummary();
+
+    if (!writeTrace())
+        serr << "Profile: could not write " << tracePath << "\n";
+}
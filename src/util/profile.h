@@ -0,0 +1,79 @@
+#ifndef SRC_UTIL_PROFILE_H_
+#define SRC_UTIL_PROFILE_H_
+
+#include "os/chrono.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+
+//
+// Scoped-zone profiler for code that runs every frame.
+//
+// Unlike TimeMeasure, a zone does no formatting or I/O while the game is
+// running. Each thread appends (zone, start, duration) records to its own
+// ring buffer and a per-zone latency histogram, so it is cheap enough to be
+// left in release builds. When profiling is disabled, a zone costs one branch.
+//
+// Zones are declared once at file scope and entered with a ProfileScope:
+//
+//     static ProfileZone tickZone("Area::tick");
+//
+//     void Area::tick(Time dt) noexcept {
+//         ProfileScope scope(tickZone);
+//         ...
+//     }
+//
+
+#define PROFILE_MAX_ZONES 64
+
+class ProfileZone {
+ public:
+    // Must be constructed at file scope so registration happens during static
+    // initialization, before any other thread exists.
+    explicit ProfileZone(const char* name) noexcept;
+
+ public:
+    const char* name;
+    U32 id;
+};
+
+extern bool profileEnabled;
+
+// Record the time the current thread spent in zone between start and end.
+void
+profileRecord(ProfileZone& zone, Nanoseconds start, Nanoseconds end) noexcept;
+
+class ProfileScope {
+ public:
+    inline explicit ProfileScope(ProfileZone& zone) noexcept
+        : zone(zone), start(profileEnabled ? chronoNow() : 0) { }
+
+    inline ~ProfileScope() noexcept {
+        if (start)
+            profileRecord(zone, start, chronoNow());
+    }
+
+ private:
+    ProfileScope(const ProfileScope&);
+    ProfileScope&
+    operator=(const ProfileScope&);
+
+ private:
+    ProfileZone& zone;
+    Nanoseconds start;
+};
+
+// Begin recording zones. On profileDump(), a Chrome trace (viewable in
+// chrome://tracing or Perfetto) is written to tracePath.
+void
+profileEnable(StringView tracePath) noexcept;
+
+// Stop recording, print a latency summary of each zone to serr, and write the
+// Chrome trace. Does nothing if profiling was never enabled.
+//
+// Called from exitProcess(). Other threads' buffers are read without
+// synchronization, so their final few records may be torn.
+void
+profileDump() noexcept;
+
+#endif  // SRC_UTIL_PROFILE_H_
@@ -11,6 +11,11 @@ initRandom() noexcept {
     state = static_cast<U32>(chronoNow());
 }
 
+void
+seedRandom(U32 seed) noexcept {
+    state = seed;
+}
+
 /* https://en.wikipedia.org/wiki/Lehmer_random_number_generator */
 static U32
 generate() noexcept {
@@ -7,6 +7,11 @@
 void
 initRandom() noexcept;
 
+//! Start the same sequence of random numbers every time. The seed must not
+//! be 0.
+void
+seedRandom(U32 seed) noexcept;
+
 //! Produce a random integer.
 /*!
     @param min Minimum value.
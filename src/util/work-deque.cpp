@@ -0,0 +1,104 @@
+#include "util/work-deque.h"
+
+#include "util/atomic.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/new.h"
+#include "util/vector.h"
+
+#define INITIAL_CAPACITY 256
+
+static WorkArray*
+makeArray(SSize capacity) noexcept {
+    WorkArray* array = new WorkArray;
+    array->capacity = capacity;
+    array->items = static_cast<void**>(malloc(sizeof(void*) * capacity));
+    return array;
+}
+
+static void
+destroyArray(WorkArray* array) noexcept {
+    free(array->items);
+    delete array;
+}
+
+static void*&
+slot(WorkArray* array, SSize i) noexcept {
+    return array->items[i & (array->capacity - 1)];
+}
+
+WorkDeque::WorkDeque() noexcept
+    : top(0),
+      bottom(0),
+      array(makeArray(INITIAL_CAPACITY)) { }
+
+WorkDeque::~WorkDeque() noexcept {
+    for (WorkArray** a = retired.begin(); a != retired.end(); a++)
+        destroyArray(*a);
+    destroyArray(array);
+}
+
+void
+WorkDeque::push(void* item) noexcept {
+    SSize b = atomicLoad(&bottom);
+    SSize t = atomicLoadAcquire(&top);
+    WorkArray* a = atomicLoad(&array);
+
+    if (b - t > a->capacity - 1) {
+        WorkArray* bigger = makeArray(a->capacity * 2);
+        for (SSize i = t; i < b; i++)
+            atomicStore(&slot(bigger, i), atomicLoad(&slot(a, i)));
+        retired.push(a);
+        atomicStoreRelease(&array, bigger);
+        a = bigger;
+    }
+
+    atomicStore(&slot(a, b), item);
+    atomicFenceRelease();
+    atomicStore(&bottom, b + 1);
+}
+
+void*
+WorkDeque::pop() noexcept {
+    SSize b = atomicLoad(&bottom) - 1;
+    WorkArray* a = atomicLoad(&array);
+    atomicStore(&bottom, b);
+    atomicFence();
+    SSize t = atomicLoad(&top);
+
+    if (t > b) {
+        // Empty.
+        atomicStore(&bottom, b + 1);
+        return 0;
+    }
+
+    void* item = atomicLoad(&slot(a, b));
+
+    if (t == b) {
+        // The last item, which a thief may be taking as well.
+        if (!atomicCas(&top, t, t + 1))
+            item = 0;
+        atomicStore(&bottom, b + 1);
+    }
+
+    return item;
+}
+
+void*
+WorkDeque::steal() noexcept {
+    SSize t = atomicLoadAcquire(&top);
+    atomicFence();
+    SSize b = atomicLoadAcquire(&bottom);
+
+    if (t >= b)
+        return 0;
+
+    WorkArray* a = atomicLoadAcquire(&array);
+    void* item = atomicLoad(&slot(a, t));
+
+    // Another thief or the owner got there first.
+    if (!atomicCas(&top, t, t + 1))
+        return 0;
+
+    return item;
+}
@@ -0,0 +1,52 @@
+#ifndef SRC_UTIL_WORK_DEQUE_H_
+#define SRC_UTIL_WORK_DEQUE_H_
+
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/vector.h"
+
+struct WorkArray {
+    SSize capacity;  // A power of two.
+    void** items;
+};
+
+// A Chase-Lev deque, from "Correct and Efficient Work-Stealing for Weak Memory
+// Models" by Lê, Pop, Cohen and Zappa Nardelli. Its owning thread pushes and
+// pops items at the bottom, and other threads steal them from the top. Items
+// may not be null.
+struct WorkDeque {
+    WorkDeque() noexcept;
+    ~WorkDeque() noexcept;
+
+    // Only for the owning thread.
+    void
+    push(void* item) noexcept;
+
+    // Take the item pushed last. Returns null if there are none, or if a thief
+    // took the last one first. Only for the owning thread.
+    void*
+    pop() noexcept;
+
+    // Take the item pushed first. Returns null if there are none, or if
+    // another thread took it first.
+    void*
+    steal() noexcept;
+
+    SSize top;
+    SSize bottom;
+    WorkArray* array;
+
+    // Arrays that have been outgrown. Thieves may still be reading them, so
+    // they are freed with the deque.
+    Vector<WorkArray*> retired;
+
+    // Keep each deque's indices off of its neighbors' cache lines.
+    U8 padding[64];
+
+ private:
+    WorkDeque(const WorkDeque&);
+    WorkDeque&
+    operator=(const WorkDeque&);
+};
+
+#endif  // SRC_UTIL_WORK_DEQUE_H_
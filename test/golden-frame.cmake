@@ -0,0 +1,45 @@
+# Draw the world in test/golden with the software renderer and compare the
+# last frame with frame.ppm, byte for byte.
+#
+# Run by CTest as:
+#
+#   cmake -DPACK_TOOL=... -DBENCH=... -DGOLDEN=... -DOUT=... -P golden-frame.cmake
+#
+# To accept a change to the rendering, copy the new frame over frame.ppm after
+# looking at both.
+
+set(FRAMES 40)
+set(LAST_FRAME "frame000039.ppm")
+
+file(REMOVE_RECURSE ${OUT})
+file(MAKE_DIRECTORY ${OUT})
+configure_file(${GOLDEN}/client.json ${OUT}/client.json COPYONLY)
+
+execute_process(
+    COMMAND ${PACK_TOOL} create ${OUT}/null.world
+            null-area.json null-player.json null-tileset.json tiles.bmp
+    WORKING_DIRECTORY ${GOLDEN}
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "pack-tool failed: ${result}")
+endif()
+
+execute_process(
+    COMMAND ${BENCH} ${FRAMES}
+    WORKING_DIRECTORY ${OUT}
+    RESULT_VARIABLE result
+    OUTPUT_QUIET
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "carob-bench failed: ${result}")
+endif()
+
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files
+            ${OUT}/${LAST_FRAME} ${GOLDEN}/frame.ppm
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${OUT}/${LAST_FRAME} differs from ${GOLDEN}/frame.ppm")
+endif()
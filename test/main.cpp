@@ -1,18 +1,62 @@
 #include "util/compiler.h"
 #include "util/io.h"
+#include "util/jobs.h"
 
+void
+testPackBase64() noexcept;
+void
+testPackInflate() noexcept;
+void
+testPackLz4() noexcept;
+void
+testTilesAtlas() noexcept;
+void
+testTilesDisplayList() noexcept;
+void
+testTilesMotion() noexcept;
+void
+testTilesPathfinding() noexcept;
+void
+testUtilChecksum() noexcept;
+void
+testUtilHandleTable() noexcept;
+void
+testUtilIntern() noexcept;
+void
+testUtilJobs() noexcept;
+void
+testUtilJson() noexcept;
 void
 testUtilString2() noexcept;
 void
 testUtilStringView() noexcept;
+void
+testUtilWorkDeque() noexcept;
 
 I32
 main() noexcept {
     Flusher f1(sout);
     Flusher f2(serr);
 
+    JobsInit();
+
+    testPackBase64();
+    testPackInflate();
+    testPackLz4();
+    testTilesAtlas();
+    testTilesDisplayList();
+    testTilesMotion();
+    testTilesPathfinding();
+    testUtilChecksum();
+    testUtilHandleTable();
+    testUtilIntern();
+    testUtilJobs();
+    testUtilJson();
     testUtilString2();
     testUtilStringView();
+    testUtilWorkDeque();
+
+    JobsQuit();
 
     return 0;
 }
@@ -0,0 +1,80 @@
+#include "pack/base64.h"
+
+#include "os/c.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+
+// Every byte value from 0 to 255, long enough to run through the 16-character
+// SSSE3 loop many times before the scalar tail.
+static const char allBytes[] =
+    "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1"
+    "Njc4OTo7PD0+P0BBQkNERUZHSElKS0xNTk9QUVJTVFVWV1hZWltcXV5fYGFiY2RlZmdoaWpr"
+    "bG1ub3BxcnN0dXZ3eHl6e3x9fn+AgYKDhIWGh4iJiouMjY6PkJGSk5SVlpeYmZqbnJ2en6Ch"
+    "oqOkpaanqKmqq6ytrq+wsbKztLW2t7i5uru8vb6/wMHCw8TFxsfIycrLzM3Oz9DR0tPU1dbX"
+    "2Nna29zd3t/g4eLj5OXm5+jp6uvs7e7v8PHy8/T19vf4+fr7/P3+/w==";
+
+void
+testPackBase64() noexcept {
+    U8 out[256];
+    char text[sizeof(allBytes)];
+
+    //
+    // Sizes
+    //
+    assert_(base64DecodedSize("") == 0);
+    assert_(base64DecodedSize("QQ==") == 1);
+    assert_(base64DecodedSize("QUI=") == 2);
+    assert_(base64DecodedSize("QUJD") == 3);
+    assert_(base64DecodedSize("QUJ") == SIZE_MAX);
+    assert_(base64DecodedSize(allBytes) == 256);
+
+    //
+    // Decoding
+    //
+    assert_(base64Decode("", out));
+    assert_(base64Decode("QQ==", out) && out[0] == 'A');
+    assert_(base64Decode("QUI=", out) && memcmp(out, "AB", 2) == 0);
+    assert_(base64Decode("QUJD", out) && memcmp(out, "ABC", 3) == 0);
+
+    assert_(base64Decode(allBytes, out));
+    for (Size i = 0; i < 256; i++)
+        assert_(out[i] == i);
+
+    // The whole alphabet, which has every character class the vector
+    // decoder distinguishes.
+    StringView alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    assert_(base64Decode(alphabet, out));
+    U32 bits = 0;
+    U32 nBits = 0;
+    Size n = 0;
+    for (U32 value = 0; value < 64; value++) {
+        bits = (bits << 6) | value;
+        nBits += 6;
+        if (nBits >= 8) {
+            nBits -= 8;
+            assert_(out[n++] == static_cast<U8>(bits >> nBits));
+        }
+    }
+
+    //
+    // Rejection
+    //
+    assert_(!base64Decode("QUJ", out));
+    assert_(!base64Decode("Q===", out));
+    assert_(!base64Decode("QQ==QUJD", out));
+
+    // A character outside the alphabet fails wherever it is, in both the
+    // vector loop and the scalar tail.
+    const char bad[] = {'*', '-', '_', ' ', '\n', '\0', '=', '\x80', '\xff'};
+    Size size = sizeof(allBytes) - 1;
+    for (Size b = 0; b < sizeof(bad); b++) {
+        for (Size i = 0; i < size - 2; i++) {
+            memcpy(text, allBytes, size);
+            text[i] = bad[b];
+            assert_(!base64Decode(StringView(text, size), out));
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#include "pack/inflate.h"
+
+#include "os/c.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+// zlib streams of one stored, one fixed Huffman, and one dynamic Huffman
+// block, and a gzip member of a fixed Huffman block.
+static const U8 zlibStored[] = {
+    0x78, 0x01, 0x01, 0x14, 0x00, 0xeb, 0xff, 0x48, 0x65, 0x6c, 0x6c,
+    0x6f, 0x2c, 0x20, 0x73, 0x74, 0x6f, 0x72, 0x65, 0x64, 0x20, 0x62,
+    0x6c, 0x6f, 0x63, 0x6b, 0x21, 0x4b, 0x8c, 0x07, 0x1e,
+};
+static const U8 zlibFixed[] = {
+    0x78, 0xda, 0x4b, 0x4c, 0x4a, 0x4e, 0x44,
+    0x45, 0x00, 0x41, 0x7c, 0x06, 0xe5,
+};
+static const U8 zlibDynamic[] = {
+    0x78, 0xda, 0x15, 0x8c, 0x51, 0x0a, 0x00, 0x41, 0x08, 0x42, 0xcf, 0x1a,
+    0x8c, 0x90, 0xb0, 0x14, 0x4c, 0xce, 0xfd, 0xd7, 0xbe, 0x14, 0x9f, 0x2a,
+    0xce, 0x1b, 0x49, 0x00, 0xd4, 0x58, 0x49, 0xd9, 0x31, 0x07, 0x0e, 0x25,
+    0xa2, 0x7a, 0xbe, 0xb7, 0xa4, 0x10, 0x65, 0x09, 0x76, 0x3c, 0xb9, 0x4c,
+    0x73, 0x64, 0xc4, 0x8d, 0x9d, 0x39, 0x43, 0xe3, 0xc4, 0x36, 0x4d, 0x77,
+    0x6b, 0x67, 0x25, 0x91, 0x3e, 0x3d, 0x2c, 0xa8, 0x58, 0x6d, 0x7c, 0xe1,
+    0xfb, 0x5e, 0xa7, 0x1f, 0x9b, 0x50, 0x35, 0xcf,
+};
+static const U8 gzipFixed[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x4b,
+    0xaf, 0xca, 0x2c, 0x50, 0xc8, 0x4d, 0xcd, 0x4d, 0x4a, 0x2d, 0x02,
+    0x00, 0x2e, 0xe3, 0x08, 0xa1, 0x0b, 0x00, 0x00, 0x00,
+};
+
+// The 128 bytes that zlibDynamic holds: letters drawn with English-like
+// frequencies, so the encoder picks its own code lengths.
+static void
+dynamicText(U8* out) noexcept {
+    const char letters[] = "eeeeeetttttaaaoooiinnshrdlu";
+    U32 state = 1;
+    for (Size i = 0; i < 128; i++) {
+        state = state * 1103515245 + 12345;
+        out[i] = static_cast<U8>(letters[((state >> 16) & 0xff) % 27]);
+    }
+}
+
+void
+testPackInflate() noexcept {
+    U8 out[128];
+    U8 expected[128];
+    U8 copy[sizeof(zlibDynamic)];
+
+    //
+    // Block types
+    //
+    assert_(zlibDecompress(zlibStored, sizeof(zlibStored), out, 20));
+    assert_(memcmp(out, "Hello, stored block!", 20) == 0);
+
+    assert_(zlibDecompress(zlibFixed, sizeof(zlibFixed), out, 18));
+    assert_(memcmp(out, "abcabcabcabcabcabc", 18) == 0);
+
+    dynamicText(expected);
+    assert_(zlibDecompress(zlibDynamic, sizeof(zlibDynamic), out, 128));
+    assert_(memcmp(out, expected, 128) == 0);
+
+    assert_(gzipDecompress(gzipFixed, sizeof(gzipFixed), out, 11));
+    assert_(memcmp(out, "gzip member", 11) == 0);
+
+    //
+    // Wrappers
+    //
+    assert_(!gzipDecompress(zlibFixed, sizeof(zlibFixed), out, 18));
+    assert_(!zlibDecompress(gzipFixed, sizeof(gzipFixed), out, 11));
+
+    //
+    // Sizes
+    //
+    assert_(!zlibDecompress(zlibFixed, sizeof(zlibFixed), out, 17));
+    assert_(!zlibDecompress(zlibFixed, sizeof(zlibFixed), out, 19));
+    assert_(!gzipDecompress(gzipFixed, sizeof(gzipFixed), out, 10));
+
+    for (Size n = 0; n < sizeof(zlibDynamic); n++)
+        assert_(!zlibDecompress(zlibDynamic, n, out, 128));
+    for (Size n = 0; n < sizeof(gzipFixed); n++)
+        assert_(!gzipDecompress(gzipFixed, n, out, 11));
+
+    //
+    // Checksums
+    //
+    U8 badAdler[sizeof(zlibFixed)];
+    memcpy(badAdler, zlibFixed, sizeof(zlibFixed));
+    badAdler[sizeof(badAdler) - 1] ^= 1;
+    assert_(!zlibDecompress(badAdler, sizeof(badAdler), out, 18));
+
+    U8 badCrc[sizeof(gzipFixed)];
+    memcpy(badCrc, gzipFixed, sizeof(gzipFixed));
+    badCrc[sizeof(badCrc) - 8] ^= 1;
+    assert_(!gzipDecompress(badCrc, sizeof(badCrc), out, 11));
+
+    U8 badSize[sizeof(gzipFixed)];
+    memcpy(badSize, gzipFixed, sizeof(gzipFixed));
+    badSize[sizeof(badSize) - 4] ^= 1;
+    assert_(!gzipDecompress(badSize, sizeof(badSize), out, 11));
+
+    U8 badHeader[sizeof(zlibFixed)];
+    memcpy(badHeader, zlibFixed, sizeof(zlibFixed));
+    badHeader[1] ^= 1;
+    assert_(!zlibDecompress(badHeader, sizeof(badHeader), out, 18));
+
+    // A stored block whose length does not match its complement.
+    U8 badStored[sizeof(zlibStored)];
+    memcpy(badStored, zlibStored, sizeof(zlibStored));
+    badStored[5] ^= 1;
+    assert_(!zlibDecompress(badStored, sizeof(badStored), out, 20));
+
+    // Corrupting any one byte of the compressed data is caught by a code
+    // check or the checksum.
+    for (Size i = 2; i < sizeof(zlibDynamic); i++) {
+        memcpy(copy, zlibDynamic, sizeof(zlibDynamic));
+        copy[i] ^= 0x5a;
+        assert_(!zlibDecompress(copy, sizeof(copy), out, 128));
+    }
+}
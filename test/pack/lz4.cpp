@@ -0,0 +1,110 @@
+#include "pack/lz4.h"
+
+#include "os/c.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+static U8 input[4096];
+static U8 packed[4096 + 4096 / 255 + 16];
+static U8 output[4096];
+
+static bool
+roundTrip(U32 size) noexcept {
+    U32 packedSize = lz4Compress(input, size, packed, lz4Bound(size));
+    if (packedSize == 0 || packedSize > lz4Bound(size))
+        return false;
+    if (!lz4Decompress(packed, packedSize, output, size))
+        return false;
+    return memcmp(input, output, size) == 0;
+}
+
+// Deterministic bytes with no repeats an LZ4 matcher can use.
+static void
+fillNoise(U32 size) noexcept {
+    U32 state = 12345;
+    for (U32 i = 0; i < size; i++) {
+        state = state * 1103515245 + 12345;
+        input[i] = static_cast<U8>(state >> 16);
+    }
+}
+
+void
+testPackLz4() noexcept {
+    //
+    // Round trips
+    //
+    assert_(roundTrip(0));
+
+    // At most MF_LIMIT bytes are always a single literal run.
+    memcpy(input, "aaaaaaaaaaaa", 12);
+    assert_(roundTrip(1));
+    assert_(roundTrip(12));
+    assert_(lz4Compress(input, 12, packed, sizeof(packed)) == 13);
+
+    fillNoise(4096);
+    assert_(roundTrip(4096));
+    assert_(lz4Compress(input, 4096, packed, sizeof(packed)) > 4096);
+
+    memset(input, 'x', 4096);
+    assert_(roundTrip(4096));
+    assert_(lz4Compress(input, 4096, packed, sizeof(packed)) < 64);
+
+    // Literal and match lengths at the 15 and 15 + 255 boundaries need one
+    // and two continuation bytes.
+    U32 lengths[] = {14, 15, 16, 269, 270, 271, 600};
+    for (Size i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        U32 n = lengths[i];
+
+        // n literals followed by a long match.
+        fillNoise(n);
+        memset(input + n, 'y', 1000);
+        assert_(roundTrip(n + 1000));
+
+        // A match of roughly n bytes between two literal runs.
+        fillNoise(64);
+        memset(input + 32, 'z', n);
+        memcpy(input + 32 + n, "tail-of-input", 13);
+        assert_(roundTrip(32 + n + 13));
+    }
+
+    //
+    // Output capacity
+    //
+    fillNoise(256);
+    assert_(lz4Compress(input, 256, packed, 100) == 0);
+
+    //
+    // Corrupt streams
+    //
+    memset(input, 'x', 1024);
+    U32 packedSize = lz4Compress(input, 1024, packed, sizeof(packed));
+    assert_(packedSize > 0);
+
+    // Every truncation fails.
+    for (U32 n = 0; n < packedSize; n++)
+        assert_(!lz4Decompress(packed, n, output, 1024));
+
+    // The wrong output size fails.
+    assert_(!lz4Decompress(packed, packedSize, output, 1023));
+    assert_(!lz4Decompress(packed, packedSize, output, 1025));
+
+    // A match offset of 0 or before the start of the output fails.
+    U8 zeroOffset[] = {0x10, 'a', 0x00, 0x00, 0x00};
+    assert_(!lz4Decompress(zeroOffset, sizeof(zeroOffset), output, 6));
+    U8 farOffset[] = {0x10, 'a', 0x02, 0x00, 0x00};
+    assert_(!lz4Decompress(farOffset, sizeof(farOffset), output, 6));
+
+    // A literal run longer than the input fails.
+    U8 longLiterals[] = {0x50, 'a', 'b'};
+    assert_(!lz4Decompress(longLiterals, sizeof(longLiterals), output, 5));
+
+    // An unterminated length continuation fails.
+    U8 openLength[] = {0xf0, 0xff, 0xff};
+    assert_(!lz4Decompress(openLength, sizeof(openLength), output, 4096));
+
+    // A valid overlapping match: "a" then 5 copies at offset 1.
+    U8 overlap[] = {0x11, 'a', 0x01, 0x00, 0x00};
+    assert_(lz4Decompress(overlap, sizeof(overlap), output, 6));
+    assert_(memcmp(output, "aaaaaa", 6) == 0);
+}
@@ -0,0 +1,222 @@
+#include "tiles/atlas.h"
+
+#include "tiles/images.h"
+#include "tiles/world.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string.h"
+#include "util/vector.h"
+
+#define PAGES 16
+
+// Stand-ins for a renderer's textures, which are never dereferenced.
+static char textures[PAGES];
+
+static Size freedTextures = 0;
+
+static void
+freeTexture(void*) noexcept {
+    freedTextures += 1;
+}
+
+// Insert and place an image, give its page a texture, and return the image.
+static Image
+load(Atlas& atlas, StringView path, U32 width, U32 height,
+     Handle* handle = 0) noexcept {
+    Handle h = atlas.insert(path);
+    if (handle)
+        *handle = h;
+
+    U32 page = atlas.place(h, width, height);
+    if (page == NO_ATLAS_PAGE)
+        return Image{};
+
+    assert_(page < PAGES);
+    if (!atlas.texture(page))
+        atlas.setTexture(page, &textures[page]);
+
+    TiledImage* tiles = atlas.at(h);
+    tiles->image.texture = atlas.texture(page);
+    return tiles->image;
+}
+
+static bool
+overlap(Image a, Image b) noexcept {
+    return a.texture == b.texture && a.x < b.x + b.width &&
+           b.x < a.x + a.width && a.y < b.y + b.height &&
+           b.y < a.y + a.height;
+}
+
+static void
+testNoOverlap() noexcept {
+    Atlas atlas(256, 256);
+    Vector<Image> live;
+    freedTextures = 0;
+
+    // Images of many sizes come and go, about 50 at a time. Every image stays
+    // on its page and off every other image on it.
+    U32 state = 12345;
+    for (U32 round = 0; round < 2000; round++) {
+        state = state * 1103515245 + 12345;
+        U32 limit = (state >> 16) & 1 ? 32 : 128;
+        state = state * 1103515245 + 12345;
+        U32 width = 1 + (state >> 8) % limit;
+        state = state * 1103515245 + 12345;
+        U32 height = 1 + (state >> 8) % limit;
+
+        Image image = load(atlas, String() << "image" << round, width, height);
+        assert_(IMAGE_VALID(image));
+        assert_(image.width == width && image.height == height);
+        assert_(image.x + width <= 256 && image.y + height <= 256);
+        for (Size i = 0; i < live.size; i++)
+            assert_(!overlap(image, live[i]));
+        live.push(image);
+
+        if (live.size > 50) {
+            state = state * 1103515245 + 12345;
+            Size i = (state >> 8) % live.size;
+            atlas.release(live[i]);
+            live[i] = live[live.size - 1];
+            live.pop();
+        }
+
+        if (round % 20 == 19)
+            atlas.prune(1, freeTexture);
+    }
+
+    // Freed room was reused rather than every image getting new room.
+    assert_(atlas.pageCount() < PAGES);
+}
+
+static void
+testReuseAfterPrune() noexcept {
+    Atlas atlas(64, 64);
+    freedTextures = 0;
+
+    Image a = load(atlas, "a", 32, 32);
+    Image b = load(atlas, "b", 32, 32);
+    assert_(atlas.pageCount() == 1);
+    assert_(a.x == 0 && a.y == 0 && b.x == 32 && b.y == 0);
+
+    // Room freed on a page in use goes to the next image that fits.
+    atlas.release(a);
+    assert_(atlas.prune(1, freeTexture) == 1);
+    assert_(freedTextures == 0);
+    assert_(atlas.stats(0).images == 1);
+    assert_(atlas.stats(0).freedPixels == 32 * 32);
+
+    Image c = load(atlas, "c", 16, 16);
+    assert_(c.texture == a.texture && c.x == 0 && c.y == 0);
+    assert_(!overlap(c, b));
+
+    // A page left empty has its texture freed, and is used again.
+    atlas.release(b);
+    atlas.release(c);
+    assert_(atlas.prune(1, freeTexture) == 2);
+    assert_(freedTextures == 1);
+    assert_(atlas.texture(0) == 0);
+    assert_(atlas.stats(0).images == 0 && atlas.stats(0).height == 0);
+
+    Image d = load(atlas, "d", 64, 64);
+    assert_(atlas.pageCount() == 1);
+    assert_(d.x == 0 && d.y == 0);
+}
+
+static void
+testLargerThanPage() noexcept {
+    Atlas atlas(64, 64);
+
+    Handle handle;
+    Image image = load(atlas, "wide", 65, 1, &handle);
+    assert_(!IMAGE_VALID(image));
+    assert_(atlas.place(handle, 1, 65) == NO_ATLAS_PAGE);
+    assert_(atlas.pageCount() == 0);
+
+    // An image exactly the size of a page fits.
+    image = load(atlas, "page", 64, 64);
+    assert_(IMAGE_VALID(image) && atlas.pageCount() == 1);
+}
+
+static void
+testOverflow() noexcept {
+    Atlas atlas(64, 64);
+
+    Image a = load(atlas, "a", 64, 48);
+    Image b = load(atlas, "b", 64, 16);
+    assert_(atlas.pageCount() == 1);
+    assert_(b.texture == a.texture && b.y == 48);
+
+    // A full page sends the next image to a new page.
+    Image c = load(atlas, "c", 8, 8);
+    assert_(atlas.pageCount() == 2);
+    assert_(c.texture != a.texture && c.x == 0 && c.y == 0);
+    assert_(atlas.stats(0).images == 2 && atlas.stats(1).images == 1);
+    assert_(atlas.stats(0).usedPixels == 64 * 64);
+
+    // Later images fill the new page before another is started.
+    Image d = load(atlas, "d", 56, 8);
+    assert_(atlas.pageCount() == 2);
+    assert_(d.texture == c.texture && !overlap(c, d));
+}
+
+static void
+testUsers() noexcept {
+    Atlas atlas(64, 64);
+    freedTextures = 0;
+
+    Image image = load(atlas, "shared", 16, 16);
+    assert_(atlas.find("missing") == 0);
+
+    // Two more users, for three in all.
+    TiledImage* found = atlas.find("shared");
+    assert_(found && found->image.x == image.x && found->image.y == image.y);
+    assert_(atlas.find("shared"));
+
+    // Images in use are kept however old they are.
+    atlas.release(image);
+    atlas.release(image);
+    assert_(atlas.prune(1000000, freeTexture) == 0);
+    assert_(atlas.find("shared"));
+    atlas.release(image);
+    atlas.release(image);
+
+    // Once unused, an image is kept until it has been unused for long
+    // enough. It fell out of use at time 0, as no world is running.
+    assert_(atlas.prune(0, freeTexture) == 0);
+    assert_(atlas.stats(0).images == 1);
+    assert_(atlas.prune(1, freeTexture) == 1);
+    assert_(atlas.find("shared") == 0);
+    assert_(freedTextures == 1);
+}
+
+static void
+testPruneSameTick() noexcept {
+    Atlas atlas(64, 64);
+    freedTextures = 0;
+
+    Image a = load(atlas, "a", 64, 32);
+    Image b = load(atlas, "b", 64, 32);
+
+    // As when Areas are freed, an image is released and pruned within one
+    // tick. Its room is reclaimed and goes to the next image.
+    atlas.release(a);
+    assert_(atlas.prune(worldTime() + 1, freeTexture) == 1);
+    assert_(atlas.stats(0).images == 1);
+    assert_(atlas.stats(0).freedPixels == 64 * 32);
+
+    Image c = load(atlas, "c", 64, 32);
+    assert_(atlas.pageCount() == 1);
+    assert_(c.texture == a.texture && c.x == a.x && c.y == a.y);
+    assert_(!overlap(c, b));
+}
+
+void
+testTilesAtlas() noexcept {
+    testNoOverlap();
+    testReuseAfterPrune();
+    testLargerThanPage();
+    testOverflow();
+    testUsers();
+    testPruneSameTick();
+}
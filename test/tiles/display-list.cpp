@@ -0,0 +1,147 @@
+#include "tiles/display-list.h"
+
+#include "tiles/images.h"
+#include "tiles/vec.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/vector.h"
+
+// Two textures that are never drawn.
+static char textureA;
+static char textureB;
+
+static DisplayList
+makeList(float width, float height) noexcept {
+    DisplayList display = {};
+    display.scale.x = display.scale.y = 1.0f;
+    display.size.x = width;
+    display.size.y = height;
+    return display;
+}
+
+// Add a 16x16 item, with its id in the x of its texture rectangle.
+static void
+add(DisplayList& display, U32 id, void* texture, float x, float y,
+    float z) noexcept {
+    DisplayItem item = {};
+    item.image.texture = texture;
+    item.image.x = id;
+    item.image.width = 16;
+    item.image.height = 16;
+    item.destination.x = x;
+    item.destination.y = y;
+    item.destination.z = z;
+    display.items.push(item);
+}
+
+static void
+testStability() noexcept {
+    DisplayList display = makeList(1000.0f, 1000.0f);
+    Vector<DisplayItem> sorted;
+
+    // Overlapping items on one layer keep their order even when their
+    // textures alternate, as with Entities sharing a tile.
+    add(display, 0, &textureA, 10.0f, 10.0f, 1.0f);
+    add(display, 1, &textureB, 10.0f, 10.0f, 1.0f);
+    add(display, 2, &textureA, 10.0f, 10.0f, 1.0f);
+    add(display, 3, &textureB, 10.0f, 10.0f, 0.0f);
+    add(display, 4, &textureA, 10.0f, 10.0f, 1.0f);
+    displayListSort(&display, sorted);
+    assert_(sorted.size == 5);
+    assert_(sorted[0].image.x == 3);
+    assert_(sorted[1].image.x == 0 && sorted[2].image.x == 1);
+    assert_(sorted[3].image.x == 2 && sorted[4].image.x == 4);
+
+    // Many items at a few depths match a stable insertion sort.
+    display.items.clear();
+    const float depths[] = {-3.0f, -0.5f, 0.0f, 0.25f, 2.0f, 700.0f};
+    U32 state = 3;
+    for (U32 i = 0; i < 2000; i++) {
+        state = state * 1103515245 + 12345;
+        float z = depths[(state >> 16) % 6];
+        add(display, i, (state >> 8) & 1 ? &textureA : &textureB, 0.0f,
+            0.0f, z);
+    }
+    displayListSort(&display, sorted);
+    assert_(sorted.size == 2000);
+    for (Size i = 1; i < sorted.size; i++) {
+        DisplayItem& a = sorted[i - 1];
+        DisplayItem& b = sorted[i];
+        assert_(a.destination.z <= b.destination.z);
+        if (a.destination.z == b.destination.z)
+            assert_(a.image.x < b.image.x);
+    }
+}
+
+static void
+testDepths() noexcept {
+    DisplayList display = makeList(1000.0f, 1000.0f);
+    Vector<DisplayItem> sorted;
+
+    add(display, 0, &textureA, 0.0f, 0.0f, 1.0f);
+    add(display, 1, &textureA, 0.0f, 0.0f, 0.0f);
+    add(display, 2, &textureA, 0.0f, 0.0f, -0.0f);
+    add(display, 3, &textureA, 0.0f, 0.0f, -1.0f);
+    add(display, 4, &textureA, 0.0f, 0.0f, -1e30f);
+    add(display, 5, &textureA, 0.0f, 0.0f, 1e30f);
+    add(display, 6, &textureA, 0.0f, 0.0f, -0.5f);
+    add(display, 7, &textureA, 0.0f, 0.0f, 0.0f);
+    add(display, 8, &textureA, 0.0f, 0.0f, -1.0f);
+    displayListSort(&display, sorted);
+
+    // -0 and 0 are one depth, and keep the order they were added in.
+    const U32 expected[] = {4, 3, 8, 6, 1, 2, 7, 0, 5};
+    assert_(sorted.size == 9);
+    for (Size i = 0; i < 9; i++)
+        assert_(sorted[i].image.x == expected[i]);
+}
+
+static void
+testCulling() noexcept {
+    DisplayList display = makeList(100.0f, 100.0f);
+    Vector<DisplayItem> sorted;
+
+    // Items that touch the screen by any fraction of a pixel are kept, and
+    // items that only share an edge with it are not.
+    add(display, 0, &textureA, 99.5f, 50.0f, 0.0f);
+    add(display, 1, &textureA, 100.0f, 50.0f, 0.0f);
+    add(display, 2, &textureA, -15.5f, 50.0f, 0.0f);
+    add(display, 3, &textureA, -16.0f, 50.0f, 0.0f);
+    add(display, 4, &textureA, 50.0f, 99.5f, 0.0f);
+    add(display, 5, &textureA, 50.0f, 100.0f, 0.0f);
+    add(display, 6, &textureA, 50.0f, -15.5f, 0.0f);
+    add(display, 7, &textureA, 50.0f, -16.0f, 0.0f);
+    add(display, 8, &textureA, -20.0f, -20.0f, 0.0f);
+    add(display, 9, &textureA, 120.0f, 120.0f, 0.0f);
+    displayListSort(&display, sorted);
+    assert_(sorted.size == 4);
+    assert_(sorted[0].image.x == 0 && sorted[1].image.x == 2);
+    assert_(sorted[2].image.x == 4 && sorted[3].image.x == 6);
+
+    // Scrolled, zoomed, and padded, the screen covers x from 20 to 70 and y
+    // from 10 to 60 in the map.
+    display = makeList(100.0f, 100.0f);
+    display.scale.x = display.scale.y = 2.0f;
+    display.scroll.x = display.scroll.y = 10.0f;
+    display.padding.x = 20.0f;
+    add(display, 0, &textureA, 69.0f, 30.0f, 0.0f);
+    add(display, 1, &textureA, 70.0f, 30.0f, 0.0f);
+    add(display, 2, &textureA, 5.0f, 30.0f, 0.0f);
+    add(display, 3, &textureA, 4.0f, 30.0f, 0.0f);
+    add(display, 4, &textureA, 30.0f, 59.0f, 0.0f);
+    add(display, 5, &textureA, 30.0f, 60.0f, 0.0f);
+    add(display, 6, &textureA, 30.0f, -5.0f, 0.0f);
+    add(display, 7, &textureA, 30.0f, -6.0f, 0.0f);
+    displayListSort(&display, sorted);
+    assert_(sorted.size == 4);
+    assert_(sorted[0].image.x == 0 && sorted[1].image.x == 2);
+    assert_(sorted[2].image.x == 4 && sorted[3].image.x == 6);
+}
+
+void
+testTilesDisplayList() noexcept {
+    testStability();
+    testDepths();
+    testCulling();
+}
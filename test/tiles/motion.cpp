@@ -0,0 +1,196 @@
+#include "tiles/motion.h"
+
+#include "tiles/area.h"
+#include "tiles/animation.h"
+#include "tiles/entity.h"
+#include "tiles/images.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+namespace {
+
+class Walker : public Entity {
+ public:
+    Walker(Area* area, float x, float y, float pixelsPerSecond) noexcept
+        : arrivals(0),
+          storeSizeOnArrival(0),
+          slotOnArrival(0),
+          next(false),
+          redirect(0),
+          halt(0) {
+        this->area = area;
+        this->pixelsPerSecond = pixelsPerSecond;
+        r.x = x;
+        r.y = y;
+
+        // Something to stand as on arrival. It is never drawn.
+        Image still = {};
+        still.texture = this;
+        phaseStance = Animation(still);
+    }
+
+    void
+    walkTo(float x, float y) noexcept {
+        fvec3 dest = {x, y, 0.0f};
+        setDestinationCoordinate(dest);
+        startMoving();
+    }
+
+    void
+    arrived() noexcept {
+        arrivals++;
+        storeSizeOnArrival = area->motion.entities.size;
+        slotOnArrival = motionSlot;
+        if (next) {
+            next = false;
+            walkTo(nextX, nextY);
+        }
+        if (redirect) {
+            redirect->walkTo(redirectX, redirectY);
+            redirect = 0;
+        }
+        if (halt) {
+            halt->stopMoving();
+            halt = 0;
+        }
+    }
+
+    I32 arrivals;
+    Size storeSizeOnArrival;
+    U32 slotOnArrival;
+
+    // Start another movement from within arrived().
+    bool next;
+    float nextX, nextY;
+
+    // Start another Walker on a new movement, or stop one, from within
+    // arrived().
+    Walker* redirect;
+    float redirectX, redirectY;
+    Walker* halt;
+};
+
+}  // namespace
+
+void
+testTilesMotion() noexcept {
+    Area area;
+
+    //
+    // Arrival
+    //
+    {
+        Walker w(&area, 0.0f, 0.0f, 100.0f);
+        w.walkTo(10.0f, 0.0f);
+        assert_(w.motionSlot == 0 && w.moving);
+
+        area.motion.tick(50);
+        assert_(w.r.x == 5.0f && w.r.y == 0.0f);
+        assert_(w.arrivals == 0 && w.moving);
+
+        // Exactly enough travel arrives with no rollover.
+        area.motion.tick(50);
+        assert_(w.r.x == 10.0f);
+        assert_(w.arrivals == 1 && !w.moving);
+        assert_(w.motionSlot == NO_MOTION_SLOT);
+        assert_(area.motion.entities.size == 0);
+
+        // Diagonal movement lands on the destination exactly.
+        w.walkTo(13.0f, 4.0f);
+        area.motion.tick(20);
+        assert_(w.arrivals == 1);
+        area.motion.tick(1000);
+        assert_(w.arrivals == 2);
+        assert_(w.r.x == 13.0f && w.r.y == 4.0f);
+    }
+
+    //
+    // Overshoot rollover
+    //
+    {
+        Walker w(&area, 0.0f, 0.0f, 100.0f);
+        w.walkTo(10.0f, 0.0f);
+        w.next = true;
+        w.nextX = 30.0f;
+        w.nextY = 0.0f;
+
+        // 20 pixels of travel: 10 to arrive, then 10 toward the next
+        // destination from the 100 ms left over.
+        area.motion.tick(200);
+        assert_(w.arrivals == 1);
+        assert_(w.moving && w.motionSlot == 0);
+        assert_(w.r.x == 20.0f);
+
+        area.motion.tick(100);
+        assert_(w.arrivals == 2 && !w.moving);
+        assert_(w.r.x == 30.0f);
+    }
+
+    //
+    // Deferred arrival callbacks
+    //
+    {
+        Walker a(&area, 0.0f, 0.0f, 100.0f);
+        Walker b(&area, 0.0f, 32.0f, 100.0f);
+        Walker c(&area, 0.0f, 64.0f, 100.0f);
+        a.walkTo(5.0f, 0.0f);
+        b.walkTo(0.0f, 37.0f);
+        c.walkTo(100.0f, 64.0f);
+        a.next = true;
+        a.nextX = -10.0f;
+        a.nextY = 0.0f;
+
+        area.motion.tick(100);
+
+        // Every arrival leaves the store before any arrived() runs, and
+        // runs with its position already at the destination. a's new
+        // movement is back in the store by the time b's arrived() runs.
+        assert_(a.arrivals == 1 && b.arrivals == 1 && c.arrivals == 0);
+        assert_(a.slotOnArrival == NO_MOTION_SLOT);
+        assert_(b.slotOnArrival == NO_MOTION_SLOT);
+        assert_(a.storeSizeOnArrival == 1);
+        assert_(b.storeSizeOnArrival == 2);
+        assert_(b.r.y == 37.0f);
+
+        // a turned around within arrived() and used the 50 ms left over.
+        assert_(a.moving && a.r.x == 0.0f);
+        assert_(c.moving && c.r.x == 10.0f);
+        assert_(area.motion.entities.size == 2);
+
+        // Removing from the middle keeps the other slots consistent.
+        assert_(area.motion.entities[a.motionSlot] == &a);
+        assert_(area.motion.entities[c.motionSlot] == &c);
+    }
+
+    //
+    // Arrivals overtaken by an earlier arrived()
+    //
+    {
+        Walker a(&area, 0.0f, 0.0f, 100.0f);
+        Walker b(&area, 0.0f, 32.0f, 100.0f);
+        Walker c(&area, 0.0f, 64.0f, 100.0f);
+        a.walkTo(5.0f, 0.0f);
+        b.walkTo(0.0f, 37.0f);
+        c.walkTo(5.0f, 64.0f);
+        a.redirect = &b;
+        a.redirectX = 0.0f;
+        a.redirectY = 52.0f;
+        a.halt = &c;
+
+        // All three reach their destinations, but a's arrived() sends b
+        // elsewhere and stops c before their own arrivals are delivered.
+        area.motion.tick(100);
+        assert_(a.arrivals == 1 && b.arrivals == 0 && c.arrivals == 0);
+        assert_(b.moving && b.r.y == 32.0f);
+        assert_(!c.moving && c.r.x == 0.0f);
+        assert_(area.motion.entities.size == 1);
+
+        area.motion.tick(100);
+        assert_(b.moving && b.r.y == 42.0f);
+        area.motion.tick(100);
+        assert_(b.arrivals == 1 && !b.moving && b.r.y == 52.0f);
+    }
+
+    assert_(area.motion.entities.size == 0);
+}
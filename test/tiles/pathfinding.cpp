@@ -0,0 +1,263 @@
+#include "tiles/pathfinding.h"
+
+#include "tiles/tile-grid.h"
+#include "tiles/vec.h"
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/vector.h"
+
+static void
+makeGrid(TileGrid& grid, I32 w, I32 h, I32 layers) noexcept {
+    grid.dim.x = w;
+    grid.dim.y = h;
+    grid.dim.z = layers;
+    grid.graphics.resize(static_cast<Size>(w * h * layers));
+    for (I32 z = 0; z < layers; z++) {
+        float depth = static_cast<float>(z);
+        grid.depth2idx[depth] = z;
+        grid.idx2depth.push(depth);
+    }
+}
+
+static ivec3
+at(I32 x, I32 y, I32 z) noexcept {
+    ivec3 phys = {x, y, z};
+    return phys;
+}
+
+static bool
+same(ivec3 a, ivec3 b) noexcept {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// Search from one tile to another, and return the number of steps, or -1.
+static I32
+pathLength(TileGrid& grid, ivec3 from, ivec3 to, U32 nowalk) noexcept {
+    PathRequest request;
+    request.from = from;
+    request.to = to;
+    request.nowalk = nowalk;
+    request.maxVisits = 0;
+    if (!pathFind(grid, request))
+        return -1;
+
+    // The steps lead to the destination in the x-y plane.
+    ivec3 here = from;
+    for (Size i = 0; i < request.steps.size; i++) {
+        here.x += request.steps[i].x;
+        here.y += request.steps[i].y;
+    }
+    assert_(here.x == to.x && here.y == to.y);
+
+    return static_cast<I32>(request.steps.size);
+}
+
+static void
+testWalls() noexcept {
+    TileGrid grid;
+    makeGrid(grid, 8, 6, 1);
+    FlowFields fields;
+
+    assert_(pathLength(grid, at(0, 0, 0), at(5, 3, 0), TILE_NOWALK) == 8);
+    assert_(pathLength(grid, at(2, 2, 0), at(2, 2, 0), TILE_NOWALK) == 0);
+    assert_(pathLength(grid, at(0, 0, 0), at(8, 0, 0), TILE_NOWALK) == -1);
+
+    // A wall at x = 3 with a gap at the bottom.
+    for (I32 y = 0; y < 5; y++)
+        grid.addTileFlags(at(3, y, 0), TILE_NOWALK);
+    assert_(pathLength(grid, at(0, 0, 0), at(5, 0, 0), TILE_NOWALK) == 15);
+    assert_(fields.distance(grid, at(0, 0, 0), at(5, 0, 0), TILE_NOWALK) ==
+            15);
+
+    // The flow field is rebuilt once the gap closes.
+    U32 version = grid.flagsVersion;
+    grid.addTileFlags(at(3, 5, 0), TILE_NOWALK);
+    assert_(grid.flagsVersion != version);
+    assert_(pathLength(grid, at(0, 0, 0), at(5, 0, 0), TILE_NOWALK) == -1);
+    assert_(fields.distance(grid, at(0, 0, 0), at(5, 0, 0), TILE_NOWALK) ==
+            PATH_UNREACHABLE);
+    ivec2 step = fields.step(grid, at(0, 0, 0), at(5, 0, 0), TILE_NOWALK);
+    assert_(step.x == 0 && step.y == 0);
+
+    // And again once the wall is opened in the middle.
+    grid.removeTileFlags(at(3, 2, 0), TILE_NOWALK);
+    assert_(fields.distance(grid, at(0, 0, 0), at(5, 0, 0), TILE_NOWALK) ==
+            9);
+    assert_(pathLength(grid, at(0, 0, 0), at(5, 0, 0), TILE_NOWALK) == 9);
+}
+
+static void
+testNowalkFlags() noexcept {
+    TileGrid grid;
+    makeGrid(grid, 8, 1, 1);
+    FlowFields fields;
+
+    // Only flags in the mask block a step.
+    grid.addTileFlags(at(3, 0, 0), TILE_NOWALK_NPC);
+    assert_(pathLength(grid, at(0, 0, 0), at(5, 0, 0), TILE_NOWALK) == 5);
+    assert_(pathLength(grid, at(0, 0, 0), at(5, 0, 0),
+                       TILE_NOWALK | TILE_NOWALK_NPC) == -1);
+    assert_(pathLength(grid, at(0, 0, 0), at(5, 0, 0),
+                       TILE_NOWALK | TILE_NOWALK_PLAYER) == 5);
+
+    // Occupied tiles block A* only when asked. Flow fields ignore them, but
+    // do not step onto them.
+    grid.addTileFlags(at(6, 0, 0), TILE_OCCUPIED);
+    assert_(pathLength(grid, at(4, 0, 0), at(7, 0, 0), TILE_NOWALK) == 3);
+    assert_(pathLength(grid, at(4, 0, 0), at(7, 0, 0),
+                       TILE_NOWALK | TILE_OCCUPIED) == -1);
+    assert_(fields.distance(grid, at(4, 0, 0), at(7, 0, 0),
+                            TILE_NOWALK | TILE_OCCUPIED) == 3);
+    ivec2 step = fields.step(grid, at(5, 0, 0), at(7, 0, 0), TILE_NOWALK);
+    assert_(step.x == 0 && step.y == 0);
+    step = fields.step(grid, at(4, 0, 0), at(7, 0, 0), TILE_NOWALK);
+    assert_(step.x == 1 && step.y == 0);
+
+    // Occupancy does not count as a change to the flags.
+    U32 version = grid.flagsVersion;
+    grid.removeTileFlags(at(6, 0, 0), TILE_OCCUPIED);
+    assert_(grid.flagsVersion == version);
+    step = fields.step(grid, at(5, 0, 0), at(7, 0, 0), TILE_NOWALK);
+    assert_(step.x == 1 && step.y == 0);
+
+    // Exits end a path only when asked.
+    Exit exit = {};
+    grid.exits[EXIT_NORMAL][at(6, 0, 0)] = exit;
+    assert_(pathLength(grid, at(4, 0, 0), at(7, 0, 0), TILE_NOWALK) == 3);
+    assert_(pathLength(grid, at(4, 0, 0), at(7, 0, 0),
+                       TILE_NOWALK | TILE_NOWALK_EXIT) == -1);
+}
+
+static void
+testLayermods() noexcept {
+    TileGrid grid;
+    makeGrid(grid, 6, 1, 2);
+    FlowFields fields;
+
+    // Arriving at (2, 0, 0) moves a Character to layer 1, from which there is
+    // no way back.
+    grid.layermods[EXIT_NORMAL][at(2, 0, 0)] = 1.0f;
+
+    assert_(pathLength(grid, at(0, 0, 0), at(5, 0, 1), TILE_NOWALK) == 5);
+    assert_(pathLength(grid, at(0, 0, 0), at(5, 0, 0), TILE_NOWALK) == -1);
+    assert_(pathLength(grid, at(0, 0, 0), at(1, 0, 0), TILE_NOWALK) == 1);
+
+    assert_(fields.distance(grid, at(0, 0, 0), at(5, 0, 1), TILE_NOWALK) ==
+            5);
+    assert_(fields.distance(grid, at(1, 0, 0), at(5, 0, 1), TILE_NOWALK) ==
+            4);
+    assert_(fields.distance(grid, at(0, 0, 0), at(5, 0, 0), TILE_NOWALK) ==
+            PATH_UNREACHABLE);
+    assert_(fields.distance(grid, at(3, 0, 0), at(5, 0, 0), TILE_NOWALK) ==
+            2);
+    ivec2 step = fields.step(grid, at(1, 0, 0), at(5, 0, 1), TILE_NOWALK);
+    assert_(step.x == 1 && step.y == 0);
+
+    // The layer is checked for nowalk flags before the layermod applies.
+    grid.addTileFlags(at(2, 0, 0), TILE_NOWALK);
+    assert_(pathLength(grid, at(0, 0, 0), at(5, 0, 1), TILE_NOWALK) == -1);
+    grid.removeTileFlags(at(2, 0, 0), TILE_NOWALK);
+    grid.addTileFlags(at(2, 0, 1), TILE_NOWALK);
+    assert_(pathLength(grid, at(0, 0, 0), at(5, 0, 1), TILE_NOWALK) == 5);
+    grid.removeTileFlags(at(2, 0, 1), TILE_NOWALK);
+
+    // A layermod to a depth that has no layer cannot be stepped on.
+    grid.layermods[EXIT_NORMAL][at(2, 0, 0)] = 7.0f;
+    assert_(pathLength(grid, at(0, 0, 0), at(5, 0, 1), TILE_NOWALK) == -1);
+    assert_(pathLength(grid, at(0, 0, 0), at(1, 0, 0), TILE_NOWALK) == 1);
+    grid.layermods[EXIT_NORMAL].erase(at(2, 0, 0));
+
+    // Leaving (3, 0, 1) to the left moves to layer 0.
+    grid.layermods[EXIT_LEFT][at(3, 0, 1)] = 0.0f;
+    assert_(pathLength(grid, at(5, 0, 1), at(0, 0, 0), TILE_NOWALK) == 5);
+    assert_(pathLength(grid, at(5, 0, 1), at(0, 0, 1), TILE_NOWALK) == -1);
+    assert_(fields.distance(grid, at(5, 0, 1), at(0, 0, 0), TILE_NOWALK) ==
+            5);
+}
+
+// A* and flow fields agree on a maze with layermods between its layers.
+static void
+testAgreement() noexcept {
+    TileGrid grid;
+    makeGrid(grid, 24, 16, 2);
+    FlowFields fields;
+
+    U32 state = 7;
+    for (I32 z = 0; z < 2; z++) {
+        for (I32 y = 0; y < 16; y++) {
+            for (I32 x = 0; x < 24; x++) {
+                state = state * 1103515245 + 12345;
+                U32 roll = (state >> 16) % 100;
+                if (roll < 25)
+                    grid.addTileFlags(at(x, y, z), TILE_NOWALK);
+                else if (roll < 28)
+                    grid.layermods[EXIT_NORMAL][at(x, y, z)] =
+                        static_cast<float>(1 - z);
+                else if (roll < 31)
+                    grid.layermods[EXIT_RIGHT][at(x, y, z)] =
+                        static_cast<float>(1 - z);
+            }
+        }
+    }
+
+    ivec3 target = at(12, 8, 0);
+    grid.removeTileFlags(target, TILE_NOWALK);
+    if (grid.layermods[EXIT_NORMAL].tryAt(target))
+        grid.layermods[EXIT_NORMAL].erase(target);
+
+    Vector<PathRequest> requests;
+    for (I32 z = 0; z < 2; z++) {
+        for (I32 y = 0; y < 16; y++) {
+            for (I32 x = 0; x < 24; x++) {
+                PathRequest request;
+                request.from = at(x, y, z);
+                request.to = target;
+                request.nowalk = TILE_NOWALK;
+                request.maxVisits = 0;
+                requests.push(static_cast<PathRequest&&>(request));
+            }
+        }
+    }
+    pathFindAll(grid, requests.data, requests.size);
+
+    Size reachable = 0;
+    for (Size i = 0; i < requests.size; i++) {
+        PathRequest& request = requests[i];
+        U32 distance =
+            fields.distance(grid, request.from, target, TILE_NOWALK);
+        if (request.found) {
+            assert_(distance == request.steps.size);
+            reachable++;
+        }
+        else {
+            assert_(distance == PATH_UNREACHABLE);
+        }
+    }
+    assert_(reachable > 1);
+
+    // The field's steps lead to the target in that many steps.
+    for (Size i = 0; i < requests.size; i++) {
+        ivec3 here = requests[i].from;
+        U32 distance = fields.distance(grid, here, target, TILE_NOWALK);
+        if (distance == PATH_UNREACHABLE || distance == 0)
+            continue;
+        for (U32 n = 0; n < distance; n++) {
+            ivec2 facing = fields.step(grid, here, target, TILE_NOWALK);
+            assert_(facing.x != 0 || facing.y != 0);
+            here = grid.moveDest(here, facing);
+            float* layermod = grid.layermods[EXIT_NORMAL].tryAt(here);
+            if (layermod)
+                here.z = grid.depth2idx[*layermod];
+        }
+        assert_(same(here, target));
+    }
+}
+
+void
+testTilesPathfinding() noexcept {
+    testWalls();
+    testNowalkFlags();
+    testLayermods();
+    testAgreement();
+}
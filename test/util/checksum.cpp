@@ -0,0 +1,21 @@
+#include "util/checksum.h"
+
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+
+void
+testUtilChecksum() noexcept {
+    assert_(crc32Checksum("", 0) == 0);
+    assert_(crc32Checksum("123456789", 9) == 0xCBF43926);
+    assert_(crc32Checksum("IEND", 4) == 0xAE426082);
+
+    assert_(adler32Checksum("", 0) == 1);
+    assert_(adler32Checksum("Wikipedia", 9) == 0x11E60398);
+
+    // Long enough that the sums are reduced several times along the way.
+    static U8 ones[20000];
+    for (Size i = 0; i < sizeof(ones); i++)
+        ones[i] = 0xFF;
+    assert_(adler32Checksum(ones, sizeof(ones)) == 0x9F51D664);
+}
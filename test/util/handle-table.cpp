@@ -0,0 +1,93 @@
+#include "util/handle-table.h"
+
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string.h"
+
+void
+testUtilHandleTable() noexcept {
+    HandleTable<I32> table;
+
+    //
+    // Insert and find
+    //
+    assert_(table.find("a") == NO_HANDLE);
+    assert_(table.tryAt("a") == 0);
+    assert_(table.at(NO_HANDLE) == 0);
+
+    Handle a = table.insert("a");
+    Handle b = table.insert("b");
+    assert_(a != NO_HANDLE && b != NO_HANDLE && a != b);
+    assert_(table.find("a") == a && table.find("b") == b);
+    assert_(table.size() == 2);
+
+    *table.at(a) = 10;
+    *table.at(b) = 20;
+    assert_(*table.tryAt("a") == 10 && *table.tryAt("b") == 20);
+
+    // Handles stay valid as the table grows.
+    for (I32 i = 0; i < 1000; i++)
+        *table.at(table.insert(String() << "grow " << i)) = i;
+    assert_(*table.at(a) == 10 && *table.at(b) == 20);
+    assert_(*table.tryAt("grow 999") == 999);
+
+    // Indices past the end find nothing.
+    assert_(table.at((1u << HANDLE_INDEX_BITS) | HANDLE_INDEX_MASK) == 0);
+
+    //
+    // Release and reuse
+    //
+    table.release(a);
+    assert_(table.at(a) == 0);
+    assert_(table.find("a") == NO_HANDLE && table.tryAt("a") == 0);
+    assert_(*table.at(b) == 20);
+
+    // The next insert reuses a's slot under a new generation, and starts
+    // from a default value.
+    Handle c = table.insert("c");
+    assert_((c & HANDLE_INDEX_MASK) == (a & HANDLE_INDEX_MASK));
+    assert_(c != a);
+    assert_(table.at(a) == 0);
+    assert_(table.at(c) && *table.at(c) == 0);
+
+    // A released key can be inserted again, but old Handles stay stale.
+    Handle a2 = table.insert("a");
+    assert_(a2 != a && table.find("a") == a2);
+    assert_(table.at(a) == 0);
+
+    // Freed slots are reused most recent first.
+    table.release(b);
+    table.release(c);
+    Handle d = table.insert("d");
+    Handle e = table.insert("e");
+    assert_((d & HANDLE_INDEX_MASK) == (c & HANDLE_INDEX_MASK));
+    assert_((e & HANDLE_INDEX_MASK) == (b & HANDLE_INDEX_MASK));
+    assert_(table.at(b) == 0 && table.at(c) == 0);
+
+    //
+    // Generation wraparound
+    //
+    HandleTable<I32> one;
+    Handle first = one.insert("x");
+    U32 generations = HANDLE_GENERATION_MASK;
+
+    // A slot goes through every generation but 0 before a Handle repeats.
+    Handle h = first;
+    for (U32 i = 1; i < generations; i++) {
+        one.release(h);
+        Handle next = one.insert("x");
+        assert_(next != NO_HANDLE && next != h);
+        assert_((next & HANDLE_INDEX_MASK) == (first & HANDLE_INDEX_MASK));
+        assert_(next >> HANDLE_INDEX_BITS != 0);
+        assert_(one.at(h) == 0 && one.at(next) != 0);
+        assert_(one.at(first) == 0);
+        h = next;
+    }
+    assert_(h >> HANDLE_INDEX_BITS == HANDLE_GENERATION_MASK);
+
+    one.release(h);
+    Handle wrapped = one.insert("x");
+    assert_(wrapped == first);
+    assert_(one.at(h) == 0 && one.at(wrapped) != 0);
+}
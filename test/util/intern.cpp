@@ -0,0 +1,68 @@
+#include "util/intern.h"
+
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+#include "util/string.h"
+
+void
+testUtilIntern() noexcept {
+    //
+    // The empty string
+    //
+    assert_(intern("") == Symbol());
+    assert_(internFind("") == Symbol());
+    assert_(symbolName(Symbol()).size == 0);
+
+    //
+    // Idempotence
+    //
+    assert_(internFind("intern test") == Symbol());
+
+    Symbol a = intern("intern test");
+    assert_(a != Symbol());
+    assert_(intern("intern test") == a);
+    assert_(internFind("intern test") == a);
+    assert_(intern("intern test 2") != a);
+
+    // Equality depends on the bytes, not on where they came from.
+    char buffer[] = "xintern testx";
+    assert_(intern(StringView(buffer + 1, 11)) == a);
+    assert_(internFind(StringView(buffer, 12)) == Symbol());
+    assert_(intern("Intern test") != a);
+
+    // Prefixes and strings with embedded NULs are distinct.
+    assert_(intern("intern tes") != a);
+    Symbol nul = intern(StringView("a\0b", 3));
+    assert_(nul != intern("a") && nul != intern(StringView("a\0c", 3)));
+    assert_(symbolName(nul) == StringView("a\0b", 3));
+
+    //
+    // Round trips
+    //
+    assert_(symbolName(a) == "intern test");
+    assert_(hash_(a) == hash_(intern("intern test")));
+
+    // Names stay put as the table and its storage grow.
+    const char* data = symbolName(a).data;
+    Symbol symbols[5000];
+    for (I32 i = 0; i < 5000; i++)
+        symbols[i] = intern(String() << "symbol " << i);
+    assert_(symbolName(a).data == data);
+    for (I32 i = 0; i < 5000; i++) {
+        String name;
+        name << "symbol " << i;
+        assert_(symbolName(symbols[i]) == name);
+        assert_(intern(name) == symbols[i]);
+        assert_(internFind(name) == symbols[i]);
+    }
+
+    // A string longer than a storage block round trips too.
+    String big;
+    for (I32 i = 0; i < 20000; i++)
+        big << static_cast<char>('a' + i % 26);
+    Symbol bigSymbol = intern(big);
+    assert_(symbolName(bigSymbol) == big);
+    assert_(intern(big) == bigSymbol);
+}
@@ -0,0 +1,107 @@
+#include "util/jobs.h"
+
+#include "util/assert.h"
+#include "util/atomic.h"
+#include "util/compiler.h"
+#include "util/function.h"
+#include "util/int.h"
+
+#define JOBS 1000
+
+static I32 ran[JOBS];
+static I32 total = 0;
+
+static void
+count(void* data) noexcept {
+    atomicAdd(static_cast<I32*>(data), 1);
+    atomicAdd(&total, 1);
+}
+
+struct Spawner {
+    I32 children;
+    JobCounter* counter;
+};
+
+// Enqueue more jobs from within a job, counted by the same counter.
+static void
+spawn(void* data) noexcept {
+    Spawner* spawner = static_cast<Spawner*>(data);
+    for (I32 i = 0; i < spawner->children; i++) {
+        Function fn = {count, &ran[i]};
+        JobsEnqueue(fn, spawner->counter);
+    }
+}
+
+static void
+clearRan() noexcept {
+    for (Size i = 0; i < JOBS; i++)
+        ran[i] = 0;
+    total = 0;
+}
+
+void
+testUtilJobs() noexcept {
+    //
+    // Waiting on a counter
+    //
+    {
+        JobCounter counter;
+        clearRan();
+
+        for (Size i = 0; i < JOBS; i++) {
+            Function fn = {count, &ran[i]};
+            JobsEnqueue(fn, &counter);
+        }
+        JobsWait(&counter);
+
+        // Every job ran once, and the counter let go of all of them.
+        assert_(counter.value == 0);
+        assert_(total == JOBS);
+        for (Size i = 0; i < JOBS; i++)
+            assert_(ran[i] == 1);
+
+        // Waiting on a counter with nothing counted returns at once.
+        JobsWait(&counter);
+    }
+
+    //
+    // Jobs that enqueue jobs
+    //
+    {
+        JobCounter counter;
+        clearRan();
+
+        // The children are counted before their parent finishes, so the
+        // counter cannot reach zero while any of them is left.
+        Spawner spawner = {JOBS, &counter};
+        Function fn = {spawn, &spawner};
+        JobsEnqueue(fn, &counter);
+        JobsWait(&counter);
+
+        assert_(counter.value == 0);
+        assert_(total == JOBS);
+        for (Size i = 0; i < JOBS; i++)
+            assert_(ran[i] == 1);
+    }
+
+    //
+    // Separate counters and flushing
+    //
+    {
+        JobCounter a, b;
+        clearRan();
+
+        for (Size i = 0; i < JOBS; i++) {
+            Function fn = {count, &ran[i]};
+            JobsEnqueue(fn, i % 2 ? &a : &b);
+        }
+        Function fn = {count, &ran[0]};
+        JobsEnqueue(fn);
+
+        // Jobs without a counter finish by the end of a flush.
+        JobsFlush();
+        assert_(a.value == 0 && b.value == 0);
+        assert_(total == JOBS + 1);
+        assert_(ran[0] == 2 && ran[JOBS - 1] == 1);
+    }
+}
@@ -0,0 +1,170 @@
+#include "util/json.h"
+
+#include "util/assert.h"
+#include "util/compiler.h"
+#include "util/int.h"
+#include "util/string-view.h"
+#include "util/string.h"
+
+// Long enough for a run to start and end at every offset of a 32-byte block.
+static const I32 RUN = 70;
+
+static String
+repeat(char c, I32 n) noexcept {
+    String s;
+    for (I32 i = 0; i < n; i++)
+        s << c;
+    return s;
+}
+
+static bool
+parses(StringView text) noexcept {
+    JsonDocument doc(text);
+    return doc.ok;
+}
+
+static bool
+isNumber(StringView text, double number) noexcept {
+    JsonDocument doc(text);
+    return doc.ok && doc.root.isNumber() && doc.root.toNumber() == number;
+}
+
+static bool
+readsU32s(StringView text, U32 limit, Size capacity, Size& size,
+          U32* out) noexcept {
+    JsonDocument doc(text, "data");
+    assert_(doc.ok);
+    JsonValue data = doc.root["data"];
+    assert_(data.isRawArray());
+    return jsonReadU32s(data, out, capacity, limit, size);
+}
+
+void
+testUtilJson() noexcept {
+    //
+    // Whitespace runs ending at every offset
+    //
+    for (I32 n = 0; n < RUN; n++) {
+        String text = repeat(' ', n) << "[1,\n" << repeat('\t', n) << "2]";
+        JsonDocument doc(text);
+        assert_(doc.ok);
+        JsonNode* node = doc.root.toNode();
+        assert_(node->value.toNumber() == 1);
+        assert_(node->next->value.toNumber() == 2);
+        assert_(node->next->next == 0);
+
+        // Text that is all whitespace runs into the terminator.
+        assert_(!parses(repeat(' ', n)));
+    }
+
+    //
+    // Quotes and escapes straddling every offset
+    //
+    for (I32 n = 0; n < RUN; n++) {
+        String a = repeat('a', n);
+
+        JsonDocument plain(String() << '"' << a << '"');
+        assert_(plain.ok);
+        assert_(plain.root.toString() == a);
+
+        for (I32 m = 0; m < 40; m += 13) {
+            String b = repeat('b', m);
+            JsonDocument escaped(String() << '"' << a << "\\\"" << b
+                                          << "\\n\\u00e9" << a << '"');
+            assert_(escaped.ok);
+            assert_(escaped.root.toString() ==
+                    (String() << a << '"' << b << "\n\xC3\xA9" << a));
+        }
+
+        // Control characters end a string anywhere in a run.
+        assert_(!parses(String() << '"' << a << '\x01' << a << '"'));
+        assert_(!parses(String() << '"' << a << '\x7F' << '"'));
+    }
+
+    //
+    // Unterminated strings
+    //
+    for (I32 n = 0; n < RUN; n++) {
+        String a = repeat('a', n);
+        assert_(!parses(String() << '"' << a));
+        assert_(!parses(String() << "[\"" << a));
+        assert_(!parses(String() << "{\"" << a << "\": \"" << a));
+        assert_(!parses(String() << '"' << a << '\\'));
+        assert_(!parses(String() << '"' << a << "\\u00"));
+    }
+
+    //
+    // Numbers
+    //
+    assert_(isNumber("0", 0));
+    assert_(isNumber("-7", -7));
+    assert_(isNumber("12.5", 12.5));
+    assert_(isNumber("-1e3", -1000));
+    assert_(isNumber("25E-1", 2.5));
+
+    // 15 digits take the integer fast path, and longer integers the general
+    // one. Both are exact below 2^53.
+    assert_(isNumber("123456789012345", 123456789012345.0));
+    assert_(isNumber("-999999999999999", -999999999999999.0));
+    assert_(isNumber("1234567890123456", 1234567890123456.0));
+    assert_(isNumber("100000000000000000000", 1e20));
+    {
+        JsonDocument doc("[123456789012345.5, 0000000000000001]");
+        assert_(doc.ok);
+        JsonNode* node = doc.root.toNode();
+        assert_(node->value.toNumber() == 123456789012345.5);
+        assert_(node->next->value.toNumber() == 1);
+    }
+
+    assert_(!parses("-"));
+    assert_(!parses("12a"));
+
+    //
+    // Raw arrays
+    //
+    U32 out[4];
+    Size size;
+
+    assert_(readsU32s("{\"data\": [1, 2,3 ]}", 4, 4, size, out));
+    assert_(size == 3 && out[0] == 1 && out[1] == 2 && out[2] == 3);
+    assert_(readsU32s("{\"data\": []}", 4, 4, size, out) && size == 0);
+    assert_(readsU32s("{\"data\": [ \n ]}", 4, 4, size, out) && size == 0);
+
+    // Values must be below the limit and fit in out.
+    assert_(!readsU32s("{\"data\": [1, 4]}", 4, 4, size, out));
+    assert_(!readsU32s("{\"data\": [1, 2, 3]}", 4, 2, size, out));
+
+    // Up to 10 digits are read, so every U32 below the limit is.
+    assert_(readsU32s("{\"data\": [4294967294]}", 0xFFFFFFFF, 4, size, out));
+    assert_(size == 1 && out[0] == 4294967294U);
+    assert_(!readsU32s("{\"data\": [4294967295]}", 0xFFFFFFFF, 4, size, out));
+    assert_(!readsU32s("{\"data\": [99999999999]}", 0xFFFFFFFF, 4, size,
+                       out));
+
+    // Anything but unsigned integers separated by commas is caught.
+    assert_(!readsU32s("{\"data\": [-1]}", 4, 4, size, out));
+    assert_(!readsU32s("{\"data\": [1.5]}", 4, 4, size, out));
+    assert_(!readsU32s("{\"data\": [1,]}", 4, 4, size, out));
+    assert_(!readsU32s("{\"data\": [1 2]}", 4, 4, size, out));
+    assert_(!readsU32s("{\"data\": [\"1\"]}", 4, 4, size, out));
+
+    // Only arrays at the path are left raw, and an unclosed one fails.
+    {
+        JsonDocument doc("{\"layers\": [{\"data\": [3, 1], \"other\": [2]}]}",
+                         "layers/data");
+        assert_(doc.ok);
+        JsonValue layer = doc.root["layers"].toNode()->value;
+        assert_(layer["data"].isRawArray());
+        assert_(layer["other"].isArray());
+
+        assert_(jsonReadU32s(layer["data"], out, 4, 4, size));
+        assert_(size == 2 && out[0] == 3 && out[1] == 1);
+
+        // Parsed arrays are read the same way.
+        assert_(jsonReadU32s(layer["other"], out, 4, 4, size));
+        assert_(size == 1 && out[0] == 2);
+        assert_(!jsonReadU32s(layer["other"], out, 4, 2, size));
+        assert_(!jsonReadU32s(layer["other"], out, 0, 4, size));
+    }
+    assert_(!JsonDocument("{\"data\": [1, 2", "data").ok);
+}
@@ -0,0 +1,164 @@
+#include "util/work-deque.h"
+
+#include "os/thread.h"
+#include "util/assert.h"
+#include "util/atomic.h"
+#include "util/compiler.h"
+#include "util/function.h"
+#include "util/int.h"
+
+#define ITEMS 20000
+#define THIEVES 3
+
+// How many times each item has been taken. Items point into it, so that every
+// item is a distinct non-null pointer.
+static I32 taken[ITEMS];
+
+static void
+clearTaken() noexcept {
+    for (Size i = 0; i < ITEMS; i++)
+        taken[i] = 0;
+}
+
+static void
+take(void* item) noexcept {
+    if (item)
+        atomicAdd(static_cast<I32*>(item), 1);
+}
+
+static bool
+eachTakenOnce(Size count) noexcept {
+    for (Size i = 0; i < count; i++)
+        if (taken[i] != 1)
+            return false;
+    return true;
+}
+
+struct Thief {
+    WorkDeque* deque;
+    I32* done;
+};
+
+// Steal until the owner is done and the deque is empty.
+static void
+steal(void* data) noexcept {
+    Thief* thief = static_cast<Thief*>(data);
+    for (;;) {
+        bool done = atomicLoadAcquire(thief->done) != 0;
+        void* item = thief->deque->steal();
+        take(item);
+        if (!item && done)
+            return;
+    }
+}
+
+void
+testUtilWorkDeque() noexcept {
+    //
+    // Push and pop
+    //
+    {
+        WorkDeque deque;
+        assert_(deque.pop() == 0);
+        assert_(deque.steal() == 0);
+
+        // Past the initial capacity, so the deque grows.
+        for (Size i = 0; i < 1000; i++)
+            deque.push(&taken[i]);
+        assert_(deque.retired.size > 0);
+
+        // The owner takes the newest item first.
+        for (Size i = 1000; i > 0; i--)
+            assert_(deque.pop() == &taken[i - 1]);
+        assert_(deque.pop() == 0);
+    }
+
+    //
+    // Steal
+    //
+    {
+        WorkDeque deque;
+        for (Size i = 0; i < 4; i++)
+            deque.push(&taken[i]);
+
+        // Thieves take the oldest item first, from the other end.
+        assert_(deque.steal() == &taken[0]);
+        assert_(deque.pop() == &taken[3]);
+        assert_(deque.steal() == &taken[1]);
+
+        // The last item goes to whoever asks first.
+        assert_(deque.pop() == &taken[2]);
+        assert_(deque.steal() == 0);
+        assert_(deque.pop() == 0);
+
+        // Growing after steals keeps the items that are left.
+        for (Size i = 0; i < 300; i++)
+            deque.push(&taken[i]);
+        for (Size i = 0; i < 100; i++)
+            assert_(deque.steal() == &taken[i]);
+        for (Size i = 300; i < 600; i++)
+            deque.push(&taken[i]);
+        for (Size i = 100; i < 600; i++)
+            assert_(deque.steal() == &taken[i]);
+        assert_(deque.pop() == 0);
+    }
+
+    //
+    // The last item, raced for by the owner and a thief
+    //
+    {
+        WorkDeque deque;
+        I32 done = 0;
+        Thief thief = {&deque, &done};
+        clearTaken();
+
+        Function fn = {steal, &thief};
+        Thread thread(fn);
+
+        // Each item is alone in the deque when the owner pops it, so it goes
+        // either to the owner or to the thief, never to both.
+        for (Size i = 0; i < ITEMS; i++) {
+            deque.push(&taken[i]);
+            take(deque.pop());
+        }
+
+        atomicStoreRelease(&done, 1);
+        thread.join();
+
+        assert_(eachTakenOnce(ITEMS));
+    }
+
+    //
+    // Many thieves
+    //
+    {
+        WorkDeque deque;
+        I32 done = 0;
+        Thief thief = {&deque, &done};
+        clearTaken();
+
+        Thread* threads[THIEVES];
+        for (Size i = 0; i < THIEVES; i++) {
+            Function fn = {steal, &thief};
+            threads[i] = new Thread(fn);
+        }
+
+        // The owner pushes in bursts and pops some back, while the deque
+        // grows under the thieves.
+        for (Size i = 0; i < ITEMS; i++) {
+            deque.push(&taken[i]);
+            if (i % 7 == 6)
+                take(deque.pop());
+        }
+        for (void* item = deque.pop(); item; item = deque.pop())
+            take(item);
+
+        atomicStoreRelease(&done, 1);
+        for (Size i = 0; i < THIEVES; i++) {
+            threads[i]->join();
+            delete threads[i];
+        }
+
+        assert_(eachTakenOnce(ITEMS));
+    }
+}